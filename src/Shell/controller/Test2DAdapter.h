@@ -16,6 +16,7 @@
 #include <sofa/core/topology/TopologyData.h>
 
 #include <sofa/helper/map.h>
+#include <sofa/type/fixed_array.h>
 #include <sofa/type/vector.h>
 
 #include <SofaShells/misc/Optimize2DSurface.h>
@@ -248,6 +249,22 @@ public:
     Data< sofa::type::vector<sofa::type::vector< unsigned int > > > m_interpolationIndices;
     /// Interpolation values for projected points.
     Data< sofa::type::vector<sofa::type::vector< Real > > > m_interpolationValues;
+    /// Triangle vertices interpolating each projected point.
+    Data< sofa::type::vector< sofa::type::fixed_array<unsigned int,3> > > m_interpolationTriangles;
+    /// Barycentric coordinates of each projected point in its triangle.
+    Data< sofa::type::vector< Vec3 > > m_interpolationBary;
+    /// Also output interpolationIndices and interpolationValues.
+    Data<bool> m_nestedInterpolation;
+    /// Parametrize each connected part of the surface as a separate chart.
+    Data<bool> m_splitCharts;
+    /// Smooth the points around the worst triangles first.
+    Data<bool> m_worstFirst;
+    /// Time in seconds available for smoothing in one step (0 for no limit).
+    Data<double> m_timeBudget;
+    /// Move all points smoothed in one step together.
+    Data<bool> m_batchRelocation;
+    /// Reproject attached points of a batch of moved points concurrently.
+    Data<bool> m_parallelProjection;
 
     virtual void init();
     virtual void reinit();
@@ -327,6 +344,31 @@ public:
     void relocatePoint(Index pt, Coord target, Index hint=InvalidID,
         bool bInRest=true);
 
+    /**
+     * @brief Queue a point relocation to be applied by commitRelocations().
+     *
+     * The target triangle and the barycentric coefficients are computed
+     * immediately. Moves in one batch must not involve neighbouring points.
+     * A point whose target lies outside of its N1-ring is moved right away
+     * instead, the batch relies on the rings being independent.
+     *
+     * @param pt        Index of the point to move.
+     * @param target    Target coordinates to move the point to.
+     * @param hint      Optional index of the triangle in which the point is
+     *                  located.
+     * @param bInRest   Whether to perform the operation on rest shape.
+     *
+     * @return False if the point doesn't need to or cannot be moved.
+     */
+    bool queueRelocation(Index pt, Coord target, Index hint=InvalidID,
+        bool bInRest=true);
+
+    /**
+     * @brief Apply all queued relocations with a single propagation of
+     * topological changes.
+     */
+    void commitRelocations();
+
     /**
      * @brief Distortion metric for a triangle.
      *
@@ -366,6 +408,15 @@ private:
     /// m_pointId != InvalidID).
     Index m_pointTriId;
 
+    /// Relocations queued by queueRelocation().
+    type::vector<unsigned int> m_moveIds;
+    type::vector< type::vector<unsigned int> > m_moveAncestors;
+    type::vector< type::vector<double> > m_moveCoefs;
+    /// @brief Set while relocated points are propagated. Topological
+    /// handlers then only see points being moved, not real changes of the
+    /// mesh.
+    bool m_movingPoints;
+
     /// Edges not eligible for edge swapping operation.
     // TODO: We need to add edge EdgeInfoHandler::swap().
     VecIndex m_protectedEdges;
@@ -431,6 +482,14 @@ private:
     // TODO: this is geometry algorithms
     void computeTriangleNormal(const Triangle &t, const VecCoord &x, Vec3 &normal) const;
 
+    /**
+     * @brief Worst functional of the triangles around a point.
+     *
+     * @param pt            Index of the point.
+     * @param functionals   Functional of each triangle.
+     */
+    Real pointFunctional(Index pt, const type::vector<Real> &functionals) const;
+
     // GPU-specific methods
     void colourGraph();
     void smoothLinear();
@@ -443,6 +502,25 @@ private:
      * @param pt    Index of a point that was relocated.
      */
     void projectionUpdate(Index pt);
+    /**
+     * Update projection of points affected by rellocation of several points.
+     * @param pts       Indices of relocated points, no two of them neighbours.
+     * @param parallel  Process the points concurrently.
+     */
+    void projectionUpdate(const VecIndex &pts, bool parallel);
+
+    /// Move a point into a triangle with given barycentric coefficients.
+    void applyRelocation(Index pt, const Triangle &tri,
+        const type::vector<double> &coefs);
+
+    /**
+     * @brief Find the triangle and barycentric coefficients to move a point
+     * to a new location.
+     *
+     * @return False if the point doesn't need to or cannot be moved.
+     */
+    bool computeRelocation(Index pt, const Coord &target, Index hint,
+        bool bInRest, Triangle &tri, type::vector<double> &coefs);
 
 protected:
 
@@ -40,19 +40,23 @@
 
 #include <SofaShells/config.h>
 
+#include <functional>
 #include <map>
+#include <queue>
 #include <float.h>
 
 #include <sofa/core/objectmodel/KeypressedEvent.h>
 #include <sofa/core/visual/VisualParams.h>  
 #include <sofa/helper/rmath.h>
 #include <sofa/helper/SimpleTimer.h>
+#include <sofa/helper/system/thread/CTime.h>
 #include <sofa/core/topology/TopologyData.inl>
 
 #include <SofaMeshCollision/TriangleModel.h>
 
 #include <SofaShells/misc/PointProjection.h>
 #include <SofaShells/controller/Test2DAdapter.h>
+#include <Shell/misc/ParallelFor.h>
 
 #define OTHER(x, a, b) ((x == a) ? b : a)
 
@@ -84,6 +88,7 @@ void Test2DAdapter<DataTypes>::PointInfoHandler:: applyCreateFunction(
 {
     adapter->m_toUpdate[pointIndex] = true;
     adapter->m_surf.pointAdd(pointIndex, point, ancestors, coeffs);
+    adapter->m_opt.invalidatePoint(pointIndex);
 }
 
 
@@ -94,6 +99,12 @@ void Test2DAdapter<DataTypes>::PointInfoHandler::applyDestroyFunction(unsigned i
     //std::cout << "pt " << __FUNCTION__ << pointIndex << std::endl;
     adapter->m_toUpdate.erase(pointIndex);
     adapter->m_surf.pointRemove(pointIndex);
+    if (adapter->m_movingPoints) {
+        // Only the triangles around the moved point are affected
+        adapter->m_opt.invalidatePoint(pointIndex);
+    } else {
+        adapter->m_opt.invalidateAll();
+    }
 }
 
 template<class DataTypes>
@@ -120,6 +131,7 @@ void Test2DAdapter<DataTypes>::PointInfoHandler::swap(unsigned int i1,
     }
 
     adapter->m_surf.pointSwap(i1, i2);
+    adapter->m_opt.invalidateAll();
 }
 
 
@@ -142,6 +154,12 @@ void Test2DAdapter<DataTypes>::TriangleInfoHandler::applyCreateFunction(
     adapter->m_toUpdate[t[1]] = true;
     adapter->m_toUpdate[t[2]] = true;
 
+    // Triangles around moved points are recreated in place, the moved
+    // points themselves were already invalidated by the point handler
+    if (!adapter->m_movingPoints) {
+        adapter->m_opt.invalidateAll();
+    }
+
     // Compute initial normal
     adapter->computeTriangleNormal(elem, adapter->m_state->read(sofa::core::VecCoordId::restPosition())->getValue(), tInfo.normal);
 }
@@ -157,6 +175,10 @@ void Test2DAdapter<DataTypes>::TriangleInfoHandler::applyDestroyFunction(unsigne
     adapter->m_toUpdate[t[0]] = true;
     adapter->m_toUpdate[t[1]] = true;
     adapter->m_toUpdate[t[2]] = true;
+
+    if (!adapter->m_movingPoints) {
+        adapter->m_opt.invalidateAll();
+    }
 }
 
 template<class DataTypes>
@@ -171,6 +193,8 @@ void Test2DAdapter<DataTypes>::TriangleInfoHandler::swap(unsigned int i1,
     } else if (adapter->m_pointTriId == i2) {
         adapter->m_pointTriId = i1;
     }
+
+    adapter->m_opt.invalidateAll();
 }
 
 #if 0
@@ -209,10 +233,27 @@ Test2DAdapter<DataTypes>::Test2DAdapter()
         "Interpolation indices for projected points."))
 , m_interpolationValues(initData(&m_interpolationValues, "interpolationValues",
         "Interpolation values for projected points."))
+, m_interpolationTriangles(initData(&m_interpolationTriangles, "interpolationTriangles",
+        "Triangle vertices interpolating each projected point."))
+, m_interpolationBary(initData(&m_interpolationBary, "interpolationBary",
+        "Barycentric coordinates of each projected point in its triangle."))
+, m_nestedInterpolation(initData(&m_nestedInterpolation, true, "nestedInterpolation",
+        "Also output interpolationIndices and interpolationValues."))
+, m_splitCharts(initData(&m_splitCharts, false, "splitCharts",
+        "Parametrize each connected part of the surface as a separate chart"))
+, m_worstFirst(initData(&m_worstFirst, false, "worstFirst",
+        "Smooth the points around the worst triangles first"))
+, m_timeBudget(initData(&m_timeBudget, 0.0, "timeBudget",
+        "Time in seconds available for smoothing in one step (0 for no limit)"))
+, m_batchRelocation(initData(&m_batchRelocation, false, "batchRelocation",
+        "Move all points smoothed in one step together"))
+, m_parallelProjection(initData(&m_parallelProjection, false, "parallelProjection",
+        "Reproject attached points of a batch of moved points concurrently"))
 , stepCounter(0)
 , m_precision(1e-8)
 , m_pointId(InvalidID)
 , m_pointTriId(InvalidID)
+, m_movingPoints(false)
 , m_opt(this, m_surf)
 , pointInfo(initData(&pointInfo, "pointInfo", "Internal point data"))
 , triInfo(initData(&triInfo, "triInfo", "Internal triangle data"))
@@ -319,7 +360,9 @@ void Test2DAdapter<DataTypes>::reinit()
 
     stepCounter = 0;
 
+    m_surf.setSplitCharts(m_splitCharts.getValue());
     m_surf.init(m_container, m_state->read(sofa::core::VecCoordId::restPosition())->getValue());
+    m_opt.invalidateAll();
 }
 
 
@@ -372,8 +415,8 @@ void Test2DAdapter<DataTypes>::onEndAnimationStep(const double /*dt*/)
     //mytimer.start("Init");
     sofa::type::vector<Real> &functionals = *m_functionals.beginEdit();
 
-    functionals.resize(nTriangles);
-    m_opt.initValues(functionals, m_container);
+    // Only the triangles changed since the last step are recomputed
+    m_opt.updateValues(functionals, m_container);
 
     //std::cout << "m: " << functionals << "\n";
     //mytimer.stop();
@@ -385,12 +428,67 @@ void Test2DAdapter<DataTypes>::onEndAnimationStep(const double /*dt*/)
     Real maxdelta=0.0;
     unsigned int moved=0;
     //mytimer.step("Optimize");
-    for (Index i=0; i<x.size(); i++) {
+
+    const bool worstFirst = m_worstFirst.getValue();
+    const double timeBudget = m_timeBudget.getValue();
+    const sofa::helper::system::thread::ctime_t start =
+        sofa::helper::system::thread::CTime::getRefTime();
+    const double ticksPerSec =
+        (double)sofa::helper::system::thread::CTime::getRefTicksPerSec();
+
+    // Points ordered by the worst functional around them. Entries become
+    // stale when a neighbour moves, the point is then queued again.
+    typedef std::pair<Real,Index> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+        std::greater<QueueEntry> > queue;
+    type::vector<char> visited;
+    if (worstFirst) {
+        visited.assign(x.size(), false);
+        for (Index i=0; i<x.size(); i++) {
+            if (!pointInfo.getValue()[i].isFixed()) {
+                queue.push(QueueEntry(pointFunctional(i, functionals), i));
+            }
+        }
+    }
+
+    // In batch mode the moves are applied at the end of the step, so the
+    // neighbours of a moved point must stay where they are until then.
+    const bool batch = m_batchRelocation.getValue();
+    type::vector<char> locked;
+    if (batch) {
+        locked.assign(x.size(), false);
+    }
+
+    Index next = 0;
+    while (true) {
+        if ((timeBudget > 0.0) &&
+            (double(sofa::helper::system::thread::CTime::getRefTime() - start)
+                / ticksPerSec > timeBudget)) {
+            break;
+        }
+
+        Index i;
+        if (worstFirst) {
+            if (queue.empty()) break;
+            QueueEntry top = queue.top();
+            queue.pop();
+            i = top.second;
+            if (visited[i] || (top.first != pointFunctional(i, functionals))) {
+                continue;
+            }
+            visited[i] = true;
+        } else {
+            if (next >= x.size()) break;
+            i = next++;
+        }
+
         if (pointInfo.getValue()[i].isFixed()) {
             //std::cout << "skipping fixed node " << i << "\n";
             continue;
         }
 
+        if (batch && locked[i]) continue;
+
         //mytimer.start("Optimize");
         Vec2 newPos;
         Index tId=InvalidID;
@@ -404,12 +502,40 @@ void Test2DAdapter<DataTypes>::onEndAnimationStep(const double /*dt*/)
             Vec3 xnew = m_surf.getPointPosition(newPos, tId, x0);
             //std::cout << "    moving " << xold << " -- " << xnew << "\n";
             //mytimer.step("Relocate");
+            if (batch) {
+                if (queueRelocation(i, xnew)) {
+                    const TrianglesAroundVertex &N1 = m_container->getTrianglesAroundVertex(i);
+                    for (Index it=0; it<N1.size(); it++) {
+                        const Triangle &t = m_container->getTriangle(N1[it]);
+                        locked[t[0]] = locked[t[1]] = locked[t[2]] = true;
+                    }
+                    moved++;
+                }
+                continue;
+            }
+
             relocatePoint(i, xnew);
 
             // Update boundary vertices
             //mytimer.step("Recheck boundary");
             recheckBoundary();
 
+            // Relocation changes the parametrization around the point
+            m_opt.updateValues(functionals, m_container);
+
+            if (worstFirst) {
+                const TrianglesAroundVertex &N1 = m_container->getTrianglesAroundVertex(i);
+                for (Index it=0; it<N1.size(); it++) {
+                    const Triangle &t = m_container->getTriangle(N1[it]);
+                    for (int j=0; j<3; j++) {
+                        if (!visited[t[j]] && !pointInfo.getValue()[t[j]].isFixed()) {
+                            queue.push(QueueEntry(
+                                pointFunctional(t[j], functionals), t[j]));
+                        }
+                    }
+                }
+            }
+
             moved++;
             Real delta = (x[i] - xold).norm2();
             if (delta > maxdelta) {
@@ -429,6 +555,23 @@ void Test2DAdapter<DataTypes>::onEndAnimationStep(const double /*dt*/)
         }
         //mytimer.stop();
     }
+
+    if (batch && moved > 0) {
+        commitRelocations();
+        recheckBoundary();
+        m_opt.updateValues(functionals, m_container);
+
+        // Update projection of tracked point in rest shape
+        if ((m_pointId != InvalidID) && locked[m_pointId]) {
+            Triangle tri = m_container->getTriangle(m_pointTriId);
+            type::vector< double > bary = m_algoGeom->compute3PointsBarycoefs(
+                m_point, tri[0], tri[1], tri[2], false);
+            m_pointRest =
+                x0[ tri[0] ] * bary[0] +
+                x0[ tri[1] ] * bary[1] +
+                x0[ tri[2] ] * bary[2];
+        }
+    }
     //mytimer.step("Eval");
 
     //stop = timer.getTime();
@@ -654,6 +797,20 @@ void Test2DAdapter<DataTypes>::computeTriangleNormal(const Triangle &t, const Ve
     normal.normalize();
 }
 
+template<class DataTypes>
+typename Test2DAdapter<DataTypes>::Real Test2DAdapter<DataTypes>::pointFunctional(
+    Index pt, const type::vector<Real> &functionals) const
+{
+    Real worst = DBL_MAX;
+    const TrianglesAroundVertex &N1 = m_container->getTrianglesAroundVertex(pt);
+    for (Index it=0; it<N1.size(); it++) {
+        if (functionals[ N1[it] ] < worst) {
+            worst = functionals[ N1[it] ];
+        }
+    }
+    return worst;
+}
+
 template<class DataTypes>
 void Test2DAdapter<DataTypes>::recheckBoundary()
 {
@@ -667,14 +824,14 @@ void Test2DAdapter<DataTypes>::recheckBoundary()
 }
 
 template<class DataTypes>
-void Test2DAdapter<DataTypes>::relocatePoint(Index pt, Coord target,
-    Index hint, bool bInRest)
+bool Test2DAdapter<DataTypes>::computeRelocation(Index pt, const Coord &target,
+    Index hint, bool bInRest, Triangle &tri, type::vector<double> &coefs)
 {
     if (m_modifier == NULL ||
         m_algoGeom == NULL ||
         m_container == NULL ||
         m_state == NULL)
-        return;
+        return false;
 
     //mytimer.step("Relocate");
 
@@ -686,7 +843,7 @@ void Test2DAdapter<DataTypes>::relocatePoint(Index pt, Coord target,
         : sofa::core::ConstVecCoordId::position()
         )->getValue();
 
-    if ((x[pt] - target).norm() < m_precision) return; // Nothing to do
+    if ((x[pt] - target).norm() < m_precision) return false; // Nothing to do
 
     if (tId == InvalidID) {
         tId = m_algoGeom->getTriangleInDirection(pt, target - x[pt]);
@@ -732,11 +889,38 @@ void Test2DAdapter<DataTypes>::relocatePoint(Index pt, Coord target,
         //    std::cout << m_container->getPointDataArray().getValue()[ e[0] ] << " " << m_container->getPointDataArray().getValue()[ e[1] ] << "\n";
         //}
 
-        return;
+        return false;
     }
 
-    Triangle tri = m_container->getTriangle(tId);
+    tri = m_container->getTriangle(tId);
+    coefs = m_algoGeom->compute3PointsBarycoefs(target,
+        tri[0], tri[1], tri[2], bInRest);
 
+    return true;
+}
+
+template<class DataTypes>
+void Test2DAdapter<DataTypes>::relocatePoint(Index pt, Coord target,
+    Index hint, bool bInRest)
+{
+    Triangle tri;
+    type::vector<double> coefs;
+    if (!computeRelocation(pt, target, hint, bInRest, tri, coefs))
+        return;
+
+    applyRelocation(pt, tri, coefs);
+
+    // Check
+    //const VecCoord& xnew = m_state->read(
+    //    sofa::core::ConstVecCoordId::restPosition())->getValue();
+    //std::cout << "requested " << target << "\tgot " << xnew[pt] << "\tdelta"
+    //    << (target - xnew[pt]).norm() << "\n";
+}
+
+template<class DataTypes>
+void Test2DAdapter<DataTypes>::applyRelocation(Index pt, const Triangle &tri,
+    const type::vector<double> &coefs)
+{
     type::vector <unsigned int> move_ids;
     type::vector< type::vector< unsigned int > > move_ancestors;
     type::vector< type::vector< double > > move_coefs;
@@ -748,23 +932,68 @@ void Test2DAdapter<DataTypes>::relocatePoint(Index pt, Coord target,
     move_ancestors.back().push_back(tri[1]);
     move_ancestors.back().push_back(tri[2]);
 
-    move_coefs.push_back(
-        m_algoGeom->compute3PointsBarycoefs(target,
-            tri[0], tri[1], tri[2], bInRest));
+    move_coefs.push_back(coefs);
 
     // Do the real work
+    m_movingPoints = true;
     m_modifier->movePointsProcess(move_ids, move_ancestors, move_coefs);
     m_modifier->notifyEndingEvent();
     m_modifier->propagateTopologicalChanges();
+    m_movingPoints = false;
 
     //mytimer.step("Projection");
     projectionUpdate(pt);
+}
 
-    // Check
-    //const VecCoord& xnew = m_state->read(
-    //    sofa::core::ConstVecCoordId::restPosition())->getValue();
-    //std::cout << "requested " << target << "\tgot " << xnew[pt] << "\tdelta"
-    //    << (target - xnew[pt]).norm() << "\n";
+template<class DataTypes>
+bool Test2DAdapter<DataTypes>::queueRelocation(Index pt, Coord target,
+    Index hint, bool bInRest)
+{
+    Triangle tri;
+    type::vector<double> coefs;
+    if (!computeRelocation(pt, target, hint, bInRest, tri, coefs))
+        return false;
+
+    // Queued moves and the concurrent reprojection only touch the N1-ring
+    // of the point, which is locked for the rest of the batch. Any
+    // triangle of the ring contains the point itself.
+    if (tri[0] != pt && tri[1] != pt && tri[2] != pt) {
+        applyRelocation(pt, tri, coefs);
+        return true;
+    }
+
+    m_moveIds.push_back(pt);
+
+    m_moveAncestors.resize(m_moveAncestors.size()+1);
+    m_moveAncestors.back().push_back(tri[0]);
+    m_moveAncestors.back().push_back(tri[1]);
+    m_moveAncestors.back().push_back(tri[2]);
+
+    m_moveCoefs.push_back(coefs);
+
+    return true;
+}
+
+template<class DataTypes>
+void Test2DAdapter<DataTypes>::commitRelocations()
+{
+    if (m_moveIds.empty()) return;
+
+    // All moves go through a single propagation of topological changes
+    m_movingPoints = true;
+    m_modifier->movePointsProcess(m_moveIds, m_moveAncestors, m_moveCoefs);
+    m_modifier->notifyEndingEvent();
+    m_modifier->propagateTopologicalChanges();
+    m_movingPoints = false;
+
+    // Queued points are not neighbours of each other, so their N1-rings are
+    // disjoint and the attached points can be reprojected concurrently.
+    VecIndex moved(m_moveIds.begin(), m_moveIds.end());
+    projectionUpdate(moved, m_parallelProjection.getValue());
+
+    m_moveIds.clear();
+    m_moveAncestors.clear();
+    m_moveCoefs.clear();
 }
 
 template<class DataTypes>
@@ -828,13 +1057,20 @@ void Test2DAdapter<DataTypes>::projectionInit()
     const VecCoord& xProj = m_projectedPoints.getValue();
     unsigned int nVertices = xProj.size();
 
+    const bool nested = m_nestedInterpolation.getValue();
+
+    sofa::type::vector< sofa::type::fixed_array<unsigned int,3> > &triangles =
+        *m_interpolationTriangles.beginEdit();
+    sofa::type::vector< Vec3 > &bary = *m_interpolationBary.beginEdit();
     sofa::type::vector<sofa::type::vector< unsigned int > > &indices =
         *m_interpolationIndices.beginEdit();
     sofa::type::vector<sofa::type::vector< Real > > &values =
         *m_interpolationValues.beginEdit();
 
-    indices.resize(nVertices);
-    values.resize(nVertices);
+    triangles.resize(nVertices);
+    bary.resize(nVertices);
+    indices.resize(nested ? nVertices : 0);
+    values.resize(nested ? nVertices : 0);
 
     type::vector<TriangleInformation>& tris = *triInfo.beginEdit();
     // Clear list of previously attached points.
@@ -860,18 +1096,26 @@ void Test2DAdapter<DataTypes>::projectionInit()
 
         // Add node indices to the list
         Triangle t = m_container->getTriangle(triangleID);
+        triangles[i] = sofa::type::fixed_array<unsigned int,3>(t[0], t[1], t[2]);
+
+        // Add the barycentric coordinates to the list
+        bary[i] = vertexBaryCoord;
+
+        if (!nested) continue;
+
         indices[i].clear();
         indices[i].push_back(t[0]);
         indices[i].push_back(t[1]);
         indices[i].push_back(t[2]);
 
-        // Add the barycentric coordinates to the list
         values[i].clear();
         values[i].push_back(vertexBaryCoord[0]);
         values[i].push_back(vertexBaryCoord[1]);
         values[i].push_back(vertexBaryCoord[2]);
     }
 
+    m_interpolationTriangles.endEdit();
+    m_interpolationBary.endEdit();
     m_interpolationIndices.endEdit();
     m_interpolationValues.endEdit();
     triInfo.endEdit();
@@ -880,95 +1124,137 @@ void Test2DAdapter<DataTypes>::projectionInit()
 template<class DataTypes>
 void Test2DAdapter<DataTypes>::projectionUpdate(Index pt)
 {
-    if (!m_container) return;
+    projectionUpdate(VecIndex(1, pt), false);
+}
 
-    PointProjection<Real> proj(*m_container);
+template<class DataTypes>
+void Test2DAdapter<DataTypes>::projectionUpdate(const VecIndex &pts, bool parallel)
+{
+    if (!m_container) return;
+    if (pts.empty()) return;
 
     const VecCoord& x0= m_state->read(
         sofa::core::ConstVecCoordId::restPosition())->getValue();
 
     const VecCoord& xProj = m_projectedPoints.getValue();
 
+    sofa::type::vector< sofa::type::fixed_array<unsigned int,3> > &triangles =
+        *m_interpolationTriangles.beginEdit();
+    sofa::type::vector< Vec3 > &bary = *m_interpolationBary.beginEdit();
     sofa::type::vector<sofa::type::vector< unsigned int > > &indices =
         *m_interpolationIndices.beginEdit();
     sofa::type::vector<sofa::type::vector< Real > > &values =
         *m_interpolationValues.beginEdit();
+    const bool nested = !values.empty();
 
     type::vector<TriangleInformation>& tris = *triInfo.beginEdit();
 
-    TrianglesAroundVertex N1 = m_container->getTrianglesAroundVertex(pt);
-
-    // List of newly attached points for each triangle
-    // We keep it separated to avoid double work.
-    std::map<Index, type::vector<Index> > newAttached;
-
-    // Recompute all barycentric coordinates
-    for (unsigned int it=0; it<N1.size(); it++) {
-        Index t = N1[it];
-        Triangle tri = m_container->getTriangle(t);
-
-        sofa::type::vector<Index> oldAttached = tris[t].attachedPoints;
-        tris[t].attachedPoints.clear();
-
-        for (unsigned int ip=0; ip<oldAttached.size(); ip++) {
-            Index ptAttached = oldAttached[ip];
-            Vec3 newBary;
-
-            proj.ComputeBaryCoords(newBary, xProj[ptAttached],
-                x0[ tri[0] ], x0[ tri[1] ], x0[ tri[2] ], false);
-
-            int neg = 0;
-            if (newBary[0] < -1e-20) neg++;
-            if (newBary[1] < -1e-20) neg++;
-            if (newBary[2] < -1e-20) neg++;
-
-            if (neg == 0) {
-                // Point still inside the triangle
-                tris[t].attachedPoints.push_back(ptAttached);
-                values[ptAttached][0] = newBary[0];
-                values[ptAttached][1] = newBary[1];
-                values[ptAttached][2] = newBary[2];
-                continue;
-            //} else if (neg == 1) {
-            //    // Only one negative coordinates means the point lies in one of
-            //    // the neighbouring triangles.
-            //    // TODO
-            //    continue;
-            }
+    // Make sure the shells are created before they are accessed concurrently
+    m_container->getTrianglesAroundVertexArray();
+
+    // Points which failed to project, reported after the loop because the
+    // message handlers are not thread safe
+    type::vector<VecIndex> failed(pts.size());
+
+    shell::misc::parallelForRange(parallel, size_t(0), pts.size(),
+        [&](size_t begin, size_t end) {
+            PointProjection<Real> proj(*m_container);
+            for (size_t ipt=begin; ipt<end; ipt++) {
+                const Index pt = pts[ipt];
+
+                TrianglesAroundVertex N1 = m_container->getTrianglesAroundVertex(pt);
+
+                // List of newly attached points for each triangle
+                // We keep it separated to avoid double work.
+                std::map<Index, type::vector<Index> > newAttached;
+
+                // Recompute all barycentric coordinates
+                for (unsigned int it=0; it<N1.size(); it++) {
+                    Index t = N1[it];
+                    Triangle tri = m_container->getTriangle(t);
+
+                    sofa::type::vector<Index> oldAttached = tris[t].attachedPoints;
+                    tris[t].attachedPoints.clear();
+
+                    for (unsigned int ip=0; ip<oldAttached.size(); ip++) {
+                        Index ptAttached = oldAttached[ip];
+                        Vec3 newBary;
+
+                        proj.ComputeBaryCoords(newBary, xProj[ptAttached],
+                            x0[ tri[0] ], x0[ tri[1] ], x0[ tri[2] ], false);
+
+                        int neg = 0;
+                        if (newBary[0] < -1e-20) neg++;
+                        if (newBary[1] < -1e-20) neg++;
+                        if (newBary[2] < -1e-20) neg++;
+
+                        if (neg == 0) {
+                            // Point still inside the triangle
+                            tris[t].attachedPoints.push_back(ptAttached);
+                            bary[ptAttached] = newBary;
+                            if (nested) {
+                                values[ptAttached][0] = newBary[0];
+                                values[ptAttached][1] = newBary[1];
+                                values[ptAttached][2] = newBary[2];
+                            }
+                            continue;
+                        //} else if (neg == 1) {
+                        //    // Only one negative coordinates means the point lies in one of
+                        //    // the neighbouring triangles.
+                        //    // TODO
+                        //    continue;
+                        }
+
+                        // Retry projection but only inside the N1-ring
+                        Index newTri;
+                        proj.ProjectPoint(newBary, newTri, xProj[ptAttached], x0, N1);
+                        if (newTri == InvalidID) {
+                            failed[ipt].push_back(ptAttached);
+                            continue;
+                        }
+
+                        // Reassign point to new triangle
+                        newAttached[newTri].push_back(ptAttached);
+
+                        // Update points
+                        Triangle newTri2 = m_container->getTriangle(newTri);
+                        triangles[ptAttached] = sofa::type::fixed_array<unsigned int,3>(
+                            newTri2[0], newTri2[1], newTri2[2]);
+
+                        // Update barycentric coordinates
+                        bary[ptAttached] = newBary;
+
+                        if (!nested) continue;
+
+                        indices[ptAttached][0] = newTri2[0];
+                        indices[ptAttached][1] = newTri2[1];
+                        indices[ptAttached][2] = newTri2[2];
+
+                        values[ptAttached][0] = newBary[0];
+                        values[ptAttached][1] = newBary[1];
+                        values[ptAttached][2] = newBary[2];
+                    }
+                }
 
-            // Retry projection but only inside the N1-ring
-            Index newTri;
-            proj.ProjectPoint(newBary, newTri, xProj[ptAttached], x0, N1);
-            if (newTri == InvalidID) {
-                msg_warning() << "Failed to project point " << ptAttached << "!" ;
-                continue;
+                // Add newly attached points to the lists
+                for (std::map<Index, type::vector<Index> >::const_iterator i =
+                    newAttached.begin();
+                    i != newAttached.end(); i++) {
+                    for (unsigned int j=0; j < i->second.size(); j++) {
+                        tris[i->first].attachedPoints.push_back(i->second[j]);
+                    }
+                }
             }
+        });
 
-            // Reassign point to new triangle
-            newAttached[newTri].push_back(ptAttached);
-
-            // Update points
-            Triangle newTri2 = m_container->getTriangle(newTri);
-            indices[ptAttached][0] = newTri2[0];
-            indices[ptAttached][1] = newTri2[1];
-            indices[ptAttached][2] = newTri2[2];
-
-            // Update barycentric coordinates
-            values[ptAttached][0] = newBary[0];
-            values[ptAttached][1] = newBary[1];
-            values[ptAttached][2] = newBary[2];
-        }
-    }
-
-    // Add newly attached points to the lists
-    for (std::map<Index, type::vector<Index> >::const_iterator i =
-        newAttached.begin();
-        i != newAttached.end(); i++) {
-        for (unsigned int j=0; j < i->second.size(); j++) {
-            tris[i->first].attachedPoints.push_back(i->second[j]);
+    for (size_t ipt=0; ipt<failed.size(); ipt++) {
+        for (Index ptAttached : failed[ipt]) {
+            msg_warning() << "Failed to project point " << ptAttached << "!" ;
         }
     }
 
+    m_interpolationTriangles.endEdit();
+    m_interpolationBary.endEdit();
     m_interpolationIndices.endEdit();
     m_interpolationValues.endEdit();
     triInfo.endEdit();
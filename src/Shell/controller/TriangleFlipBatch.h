@@ -0,0 +1,165 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/core/behavior/MechanicalState.h>
+#include <sofa/component/topology/container/dynamic/TriangleSetTopologyContainer.h>
+#include <sofa/component/topology/container/dynamic/TriangleSetTopologyModifier.h>
+#include <sofa/type/Vec.h>
+#include <sofa/type/vector.h>
+
+#include <atomic>
+#include <memory>
+
+#include <Shell/config.h>
+
+namespace shell::controller
+{
+
+/**
+ * @brief Collects edge flips (switching the shared edge of two neighbouring
+ * triangles) and applies them to the topology as one batch.
+ *
+ * Flips are queued with addFlip() during a step. validate() checks every
+ * queued flip for geometric validity and resolves conflicts between them
+ * (each triangle may take part in at most one flip and no two flips may
+ * create the same edge), the earliest queued flip winning. commit() then adds
+ * and removes all triangles of the accepted flips with a single propagation of
+ * topological changes, so that every TriangleData handler is invoked once per
+ * batch instead of once per flip.
+ *
+ * @tparam DataTypes Data type of the associated mechanical state.
+ */
+template<class DataTypes>
+class TriangleFlipBatch
+{
+public:
+    typedef typename DataTypes::VecCoord VecCoord;
+    typedef typename DataTypes::Coord Coord;
+    typedef typename Coord::value_type Real;
+    typedef sofa::type::Vec<3,Real> Vec3;
+
+    typedef sofa::component::topology::container::dynamic::TriangleSetTopologyContainer TriangleSetTopologyContainer;
+    typedef sofa::component::topology::container::dynamic::TriangleSetTopologyModifier TriangleSetTopologyModifier;
+
+    typedef TriangleSetTopologyContainer::TriangleID     Index;
+    typedef TriangleSetTopologyContainer::EdgeID         EdgeID;
+    typedef TriangleSetTopologyContainer::Triangle       Triangle;
+    typedef TriangleSetTopologyContainer::SeqTriangles   SeqTriangles;
+    typedef sofa::type::vector<Index> VecIndex;
+
+    /// One queued flip.
+    struct Flip {
+        Index t1, t2;       ///< Triangles to replace.
+        Triangle n1, n2;    ///< Replacement triangles (set by validate()).
+        Index e1, e2;       ///< Endpoints of the new edge, e1 < e2.
+        bool valid;         ///< Accepted by validate().
+    };
+
+    TriangleFlipBatch(TriangleSetTopologyContainer *container,
+        TriangleSetTopologyModifier *modifier,
+        sofa::core::behavior::MechanicalState<DataTypes> *state);
+
+    ~TriangleFlipBatch();
+
+    /// Validate flips concurrently using the main task scheduler.
+    void setParallel(bool parallel) { m_parallel = parallel; }
+
+    /// Minimal shape quality of new triangles (1 for equilateral, 0 for
+    /// degenerated). Flips producing worse triangles are rejected.
+    void setMinQuality(Real q) { m_minQuality = q; }
+
+    /// Discard all queued flips.
+    void clear();
+
+    /**
+     * @brief Queue the flip of the edge shared by two triangles.
+     *
+     * @return False if the triangles are not valid indices.
+     */
+    bool addFlip(Index t1, Index t2);
+
+    /**
+     * @brief Queue the flip of an edge.
+     *
+     * @return False if the edge is not shared by exactly two triangles.
+     */
+    bool addEdgeFlip(EdgeID edge);
+
+    /**
+     * @brief Check all queued flips and resolve the conflicts between them.
+     *
+     * @return Number of accepted flips.
+     */
+    unsigned int validate();
+
+    /**
+     * @brief Apply all accepted flips to the topology and clear the batch.
+     * Calls validate() if it hasn't been called since the last change.
+     *
+     * @return Number of applied flips.
+     */
+    unsigned int commit();
+
+    /// Number of queued flips.
+    size_t size() const { return m_flips.size(); }
+    /// Queued flips, with the result of the validation.
+    const sofa::type::vector<Flip>& getFlips() const { return m_flips; }
+
+    /// Number of flips accepted by the last validate().
+    unsigned int getNbAccepted() const { return m_nbAccepted; }
+    /// Number of flips rejected by the last validate().
+    unsigned int getNbRejected() const { return (unsigned int)m_flips.size() - m_nbAccepted; }
+
+    /// Duration of the last validate() in seconds.
+    double getValidateTime() const { return m_validateTime; }
+    /// Duration of the last commit() in seconds (excluding validation).
+    double getCommitTime() const { return m_commitTime; }
+
+private:
+
+    /// Compute the new triangles of a flip and check its geometry. Does not
+    /// modify any shared state.
+    bool computeFlip(Flip &flip, const VecCoord &x) const;
+
+    /// Shape quality of the triangle: 1 for equilateral, 0 if degenerated.
+    Real triangleQuality(const Vec3 &a, const Vec3 &b, const Vec3 &c) const;
+
+    TriangleSetTopologyContainer*  m_container;
+    TriangleSetTopologyModifier*  m_modifier;
+    sofa::core::behavior::MechanicalState<DataTypes>* m_state;
+
+    sofa::type::vector<Flip> m_flips;
+
+    // Index of the first flip claiming each triangle
+    std::unique_ptr< std::atomic<unsigned int>[] > m_owner;
+    size_t m_ownerSize;
+
+    bool m_parallel;
+    bool m_validated;
+    Real m_minQuality;
+    unsigned int m_nbAccepted;
+    double m_validateTime;
+    double m_commitTime;
+};
+
+} // namespace
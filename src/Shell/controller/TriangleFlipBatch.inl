@@ -0,0 +1,325 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <Shell/controller/TriangleFlipBatch.h>
+#include <Shell/misc/ParallelFor.h>
+
+#include <sofa/helper/system/thread/CTime.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <tuple>
+
+namespace shell::controller
+{
+
+template<class DataTypes>
+TriangleFlipBatch<DataTypes>::TriangleFlipBatch(
+    TriangleSetTopologyContainer *container,
+    TriangleSetTopologyModifier *modifier,
+    sofa::core::behavior::MechanicalState<DataTypes> *state)
+: m_container(container)
+, m_modifier(modifier)
+, m_state(state)
+, m_ownerSize(0)
+, m_parallel(false)
+, m_validated(false)
+, m_minQuality(0)
+, m_nbAccepted(0)
+, m_validateTime(0)
+, m_commitTime(0)
+{
+}
+
+template<class DataTypes>
+TriangleFlipBatch<DataTypes>::~TriangleFlipBatch()
+{
+}
+
+template<class DataTypes>
+void TriangleFlipBatch<DataTypes>::clear()
+{
+    m_flips.clear();
+    m_nbAccepted = 0;
+    m_validated = false;
+}
+
+template<class DataTypes>
+bool TriangleFlipBatch<DataTypes>::addFlip(Index t1, Index t2)
+{
+    if ((t1 == t2) || (t1 >= m_container->getNbTriangles()) ||
+        (t2 >= m_container->getNbTriangles()))
+        return false;
+
+    Flip flip;
+    flip.t1 = t1;
+    flip.t2 = t2;
+    flip.e1 = flip.e2 = sofa::InvalidID;
+    flip.valid = false;
+    m_flips.push_back(flip);
+
+    m_validated = false;
+    return true;
+}
+
+template<class DataTypes>
+bool TriangleFlipBatch<DataTypes>::addEdgeFlip(EdgeID edge)
+{
+    if (edge >= m_container->getNbEdges())
+        return false;
+
+    const TriangleSetTopologyContainer::TrianglesAroundEdge &tae =
+        m_container->getTrianglesAroundEdge(edge);
+    if (tae.size() != 2)
+        return false;
+
+    return addFlip(tae[0], tae[1]);
+}
+
+template<class DataTypes>
+unsigned int TriangleFlipBatch<DataTypes>::validate()
+{
+    const sofa::helper::system::thread::ctime_t start =
+        sofa::helper::system::thread::CTime::getRefTime();
+
+    const unsigned int none = std::numeric_limits<unsigned int>::max();
+    const size_t nbFlips = m_flips.size();
+
+    m_nbAccepted = 0;
+    m_validated = true;
+
+    if (nbFlips == 0) {
+        m_validateTime = 0;
+        return 0;
+    }
+
+    const size_t nbTriangles = m_container->getNbTriangles();
+    if (m_ownerSize < nbTriangles) {
+        m_owner.reset(new std::atomic<unsigned int>[nbTriangles]);
+        m_ownerSize = nbTriangles;
+    }
+
+    const VecCoord& x = m_state->read(sofa::core::vec_id::read_access::position)->getValue();
+
+    // Make sure the shells are created before they are accessed concurrently
+    m_container->getEdgesAroundVertexArray();
+
+    // Release the triangles we are interested in
+    shell::misc::parallelForRange(m_parallel, size_t(0), nbFlips, [&](size_t begin, size_t end) {
+        for (size_t i=begin; i<end; i++) {
+            m_owner[m_flips[i].t1].store(none, std::memory_order_relaxed);
+            m_owner[m_flips[i].t2].store(none, std::memory_order_relaxed);
+        }
+    });
+
+    // Check each flip on its own and claim its triangles. The flip with the
+    // lowest index gets the triangle.
+    shell::misc::parallelForRange(m_parallel, size_t(0), nbFlips, [&](size_t begin, size_t end) {
+        for (size_t i=begin; i<end; i++) {
+            Flip &flip = m_flips[i];
+            flip.valid = computeFlip(flip, x);
+            if (!flip.valid)
+                continue;
+
+            for (Index t : { flip.t1, flip.t2 }) {
+                unsigned int owner = m_owner[t].load(std::memory_order_relaxed);
+                while ((unsigned int)i < owner &&
+                    !m_owner[t].compare_exchange_weak(owner, (unsigned int)i,
+                        std::memory_order_relaxed)) {}
+            }
+        }
+    });
+
+    // Keep only the flips that own both of their triangles
+    shell::misc::parallelForRange(m_parallel, size_t(0), nbFlips, [&](size_t begin, size_t end) {
+        for (size_t i=begin; i<end; i++) {
+            Flip &flip = m_flips[i];
+            if (flip.valid) {
+                flip.valid =
+                    (m_owner[flip.t1].load(std::memory_order_relaxed) == (unsigned int)i) &&
+                    (m_owner[flip.t2].load(std::memory_order_relaxed) == (unsigned int)i);
+            }
+        }
+    });
+
+    // Two different flips must not create the same edge
+    sofa::type::vector< std::tuple<Index, Index, unsigned int> > newEdges;
+    newEdges.reserve(nbFlips);
+    for (size_t i=0; i<nbFlips; i++) {
+        if (m_flips[i].valid)
+            newEdges.push_back(std::make_tuple(m_flips[i].e1, m_flips[i].e2, (unsigned int)i));
+    }
+    std::sort(newEdges.begin(), newEdges.end());
+    for (size_t i=1; i<newEdges.size(); i++) {
+        if ((std::get<0>(newEdges[i]) == std::get<0>(newEdges[i-1])) &&
+            (std::get<1>(newEdges[i]) == std::get<1>(newEdges[i-1]))) {
+            m_flips[ std::get<2>(newEdges[i]) ].valid = false;
+        }
+    }
+
+    for (size_t i=0; i<nbFlips; i++) {
+        if (m_flips[i].valid)
+            m_nbAccepted++;
+    }
+
+    m_validateTime = double(sofa::helper::system::thread::CTime::getRefTime() - start) /
+        double(sofa::helper::system::thread::CTime::getRefTicksPerSec());
+
+    return m_nbAccepted;
+}
+
+template<class DataTypes>
+unsigned int TriangleFlipBatch<DataTypes>::commit()
+{
+    if (!m_validated)
+        validate();
+
+    const sofa::helper::system::thread::ctime_t start =
+        sofa::helper::system::thread::CTime::getRefTime();
+
+    SeqTriangles addList;
+    VecIndex removeList;
+    addList.reserve(2*m_nbAccepted);
+    removeList.reserve(2*m_nbAccepted);
+
+    for (const Flip &flip : m_flips) {
+        if (!flip.valid)
+            continue;
+
+        addList.push_back(flip.n1);
+        addList.push_back(flip.n2);
+        removeList.push_back(flip.t1);
+        removeList.push_back(flip.t2);
+    }
+
+    const unsigned int nbApplied = (unsigned int)addList.size()/2;
+
+    if (nbApplied > 0) {
+        // New triangles are appended at the end of the array
+        const Index first = (Index)m_container->getNbTriangles();
+        VecIndex addIds(addList.size());
+        for (size_t i=0; i<addIds.size(); i++)
+            addIds[i] = first + (Index)i;
+
+        // Queue both additions and removals and propagate them together so
+        // that each TriangleData is updated only once.
+        m_modifier->addTrianglesProcess(addList);
+        m_modifier->addTrianglesWarning((sofa::Size)addList.size(), addList, addIds);
+        m_modifier->removeTrianglesWarning(removeList);
+        m_modifier->propagateTopologicalChanges();
+
+        // Flipped edges become isolated, vertices never do
+        m_modifier->removeTrianglesProcess(removeList, true, false);
+        m_modifier->notifyEndingEvent();
+    }
+
+    m_commitTime = double(sofa::helper::system::thread::CTime::getRefTime() - start) /
+        double(sofa::helper::system::thread::CTime::getRefTicksPerSec());
+
+    m_flips.clear();
+    m_validated = false;
+
+    return nbApplied;
+}
+
+template<class DataTypes>
+bool TriangleFlipBatch<DataTypes>::computeFlip(Flip &flip, const VecCoord &x) const
+{
+    const SeqTriangles &triangles = m_container->getTriangles();
+    const Triangle &t1 = triangles[flip.t1];
+    const Triangle &t2 = triangles[flip.t2];
+
+    // Find the vertex of t1 opposite to the shared edge
+    int i1 = -1, nbCommon = 0;
+    for (int v1=0; v1<3; v1++) {
+        if ((t1[v1] == t2[0]) || (t1[v1] == t2[1]) || (t1[v1] == t2[2]))
+            nbCommon++;
+        else
+            i1 = v1;
+    }
+    if ((nbCommon != 2) || (i1 < 0))
+        return false; // Not neighbours
+
+    // ... and the one of t2
+    Index q = sofa::InvalidID;
+    for (int v2=0; v2<3; v2++) {
+        if ((t2[v2] != t1[0]) && (t2[v2] != t1[1]) && (t2[v2] != t1[2]))
+            q = t2[v2];
+    }
+
+    // Oriented as t1: p -> s1 -> s2, the quad is then p, s1, q, s2
+    const Index p = t1[i1];
+    const Index s1 = t1[(i1+1)%3];
+    const Index s2 = t1[(i1+2)%3];
+
+    if ((q == sofa::InvalidID) || (q == p))
+        return false;
+
+    // The new edge must not exist already
+    const TriangleSetTopologyContainer::EdgesAroundVertex &eav =
+        m_container->getEdgesAroundVertex(p);
+    for (EdgeID e : eav) {
+        const TriangleSetTopologyContainer::Edge &edge = m_container->getEdge(e);
+        if ((edge[0] == q) || (edge[1] == q))
+            return false;
+    }
+
+    flip.n1 = Triangle(p, s1, q);
+    flip.n2 = Triangle(q, s2, p);
+    flip.e1 = std::min(p, q);
+    flip.e2 = std::max(p, q);
+
+    const Vec3 xp = DataTypes::getCPos(x[p]);
+    const Vec3 xq = DataTypes::getCPos(x[q]);
+    const Vec3 xs1 = DataTypes::getCPos(x[s1]);
+    const Vec3 xs2 = DataTypes::getCPos(x[s2]);
+
+    // Reject flips of non-convex quads, the new triangles would fold over
+    const Vec3 nOld = cross(xs1 - xp, xs2 - xp) + cross(xs2 - xq, xs1 - xq);
+    if ((dot(cross(xs1 - xp, xq - xp), nOld) <= 0) ||
+        (dot(cross(xs2 - xq, xp - xq), nOld) <= 0))
+        return false;
+
+    const Real q1 = triangleQuality(xp, xs1, xq);
+    const Real q2 = triangleQuality(xq, xs2, xp);
+    if ((q1 <= 0) || (q2 <= 0) || (q1 < m_minQuality) || (q2 < m_minQuality))
+        return false;
+
+    return true;
+}
+
+template<class DataTypes>
+typename TriangleFlipBatch<DataTypes>::Real TriangleFlipBatch<DataTypes>::triangleQuality(
+    const Vec3 &a, const Vec3 &b, const Vec3 &c) const
+{
+    // 4*sqrt(3)*area / sum of squared edge lengths, 1 for equilateral triangle
+    const Real l2 = (b-a).norm2() + (c-b).norm2() + (a-c).norm2();
+    if (l2 < std::numeric_limits<Real>::min())
+        return 0;
+
+    const Real area = cross(b-a, c-a).norm() / 2;
+    return Real(4.0*std::sqrt(3.0)) * area / l2;
+}
+
+} // namespace
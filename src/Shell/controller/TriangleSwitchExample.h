@@ -9,6 +9,10 @@
 #include <sofa/component/topology/container/dynamic/TriangleSetTopologyContainer.h>
 #include <sofa/component/topology/container/dynamic/TriangleSetTopologyModifier.h>
 
+#include <Shell/controller/TriangleFlipBatch.h>
+
+#include <memory>
+
 namespace sofa::component::controller
 {
 
@@ -42,6 +46,7 @@ public:
     void reinit() override;
 
     Data<unsigned int>      f_interval;
+    Data<bool>              f_parallel;
 
     void onEndAnimationStep(const double dt) override;
 
@@ -53,6 +58,8 @@ private:
     topology::container::dynamic::TriangleSetTopologyContainer*  m_container;
     topology::container::dynamic::TriangleSetTopologyModifier*  m_modifier;
     sofa::core::behavior::MechanicalState<DataTypes>* m_state;
+
+    std::unique_ptr< shell::controller::TriangleFlipBatch<DataTypes> > m_batch;
 };
 } // namespace
 
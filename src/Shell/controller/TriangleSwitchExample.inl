@@ -2,6 +2,7 @@
 #define SOFA_COMPONENT_CONTROLLER_TRIANGLESWITCHEXAMPLE_INL
 
 #include <Shell/controller/TriangleSwitchExample.h>
+#include <Shell/controller/TriangleFlipBatch.inl>
 
 namespace sofa
 {
@@ -15,6 +16,7 @@ namespace controller
 template<class DataTypes>
 TriangleSwitchExample<DataTypes>::TriangleSwitchExample()
 : f_interval(initData(&f_interval, (unsigned int)10, "interval", "Switch triangles every number of steps"))
+, f_parallel(initData(&f_parallel, false, "parallel", "Validate the switches in parallel"))
 , stepCounter(0)
 {
 }
@@ -39,6 +41,9 @@ void TriangleSwitchExample<DataTypes>::init()
     if (m_modifier == NULL)
         msg_error() << "Unable to find TriangleSetTopologyModifier.";
 
+    if ((m_container != NULL) && (m_modifier != NULL) && (m_state != NULL))
+        m_batch.reset(new shell::controller::TriangleFlipBatch<DataTypes>(m_container, m_modifier, m_state));
+
     reinit();
 }
 
@@ -55,6 +60,9 @@ void TriangleSwitchExample<DataTypes>::reinit()
         f_interval.endEdit();
     }
 
+    if (m_batch)
+        m_batch->setParallel(f_parallel.getValue());
+
     stepCounter = 0;
 }
 
@@ -62,7 +70,7 @@ void TriangleSwitchExample<DataTypes>::reinit()
 template<class DataTypes>
 void TriangleSwitchExample<DataTypes>::onEndAnimationStep(const double /*dt*/)
 {
-    if ((m_container == NULL) || (m_modifier == NULL) || (m_state == NULL))
+    if (!m_batch)
         return;
 
     stepCounter++;
@@ -72,90 +80,27 @@ void TriangleSwitchExample<DataTypes>::onEndAnimationStep(const double /*dt*/)
 
     stepCounter = 0;
 
+    // Switch the shared edge of each pair of consecutive triangles
+    m_batch->clear();
+    for (Index i=0; i+1 < m_container->getNbTriangles(); i+=2) {
+        m_batch->addFlip(i, i+1);
+    }
 
-    SeqTriangles add_list;
-    VecIndex remove_list;
-
-    for (Index i=0; i < m_container->getNbTriangles()-1; i+=2) {
-        Triangle t1, t2, t1n, t2n;
-        t1 = m_container->getTriangle(i);
-        t2 = m_container->getTriangle(i+1);
-
-        remove_list.push_back(i);
-        remove_list.push_back(i+1);
-
-        // Find common vertices (the shared edge) and the other two
-        VecIndex common, other;
-
-        int v1, v2;
-        for (v1=0; v1 < 3; v1++) {
-            for (v2=0; v2 < 3; v2++) {
-                if (t1[v1] == t2[v2]) break;
-            }
-            if (v2 < 3) {
-                // found
-                common.push_back(t1[v1]);
-            } else {
-                // not found
-                other.push_back(t1[v1]);
-            }
-        }
-
-        for (v2=0; v2 < 3; v2++) {
-            for (v1=0; v1 < 3; v1++) {
-                if (t1[v1] == t2[v2]) break;
-            }
-            if (v1 >= 3) {
-                // not found
-                other.push_back(t2[v2]);
-                break;
-            }
-        }
-
-        if ((common.size() != 2) || (other.size() != 2)) {
-            msg_error() << "Invalid triangle pair " << i << ", " << i+1;
-            continue;
-        }
-
-        //std::cout << "common= " << common << " other= " << other << std::endl;
-
-        // Construct new triangles
-        t1n[0] = t2n[0] = other[0];
-        t1n[1] = t2n[1] = other[1];
-        t1n[2] = common[0];
-        t2n[2] = common[1];
-
-        // Make sure the vertex order of the triangle is correct
-
-        Vec3 nt1, nt1n;
-        computeTriangleNormal(t1, nt1);
-        computeTriangleNormal(t1n, nt1n);
-        if (dot(nt1, nt1n) > 0) {
-            // Invert the vertex order
-            Index tmp = t1n[1];
-            t1n[1] = t1n[2];
-            t1n[2] = tmp;
-        }
-
-        Vec3 nt2, nt2n;
-        computeTriangleNormal(t2, nt2);
-        computeTriangleNormal(t2n, nt2n);
-        if (dot(nt2, nt2n) > 0) {
-            // Invert the vertex order
-            Index tmp = t2n[1];
-            t2n[1] = t2n[2];
-            t2n[2] = tmp;
-        }
-
-        //  Add triangles to the list
-        add_list.push_back(t1n);
-        add_list.push_back(t2n);
+    m_batch->validate();
+    if (m_batch->getNbRejected() > 0) {
+        msg_warning() << m_batch->getNbRejected() << " invalid or conflicting triangle pairs skipped";
     }
 
-    // Add new and remove old triangles
-    m_modifier->addTriangles(add_list);
-    m_modifier->removeTriangles(remove_list, true, true);
-    m_modifier->notifyEndingEvent();
+    // Add new and remove old triangles in one go
+    const unsigned int nbFlips = m_batch->commit();
+
+    if (this->f_printLog.getValue()) {
+        const double time = m_batch->getValidateTime() + m_batch->getCommitTime();
+        msg_info() << nbFlips << " switches on " << m_container->getNbTriangles()
+            << " triangles: validation " << m_batch->getValidateTime()*1000 << " ms, commit "
+            << m_batch->getCommitTime()*1000 << " ms, "
+            << (time > 0 ? nbFlips/time : 0) << " switches/s";
+    }
 }
 
 // Computes triangle normal
@@ -0,0 +1,114 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/core/DataEngine.h>
+#include <sofa/core/objectmodel/BaseObject.h>
+#include <sofa/helper/OptionsGroup.h>
+#include <sofa/type/Vec.h>
+#include <sofa/defaulttype/VecTypes.h>
+#include <sofa/defaulttype/RigidTypes.h>
+#include <Shell/config.h>
+
+namespace shell::engine
+{
+
+/**
+ * @brief Renumbers the nodes and elements of a mesh to improve memory
+ * locality.
+ *
+ * The nodes are ordered either by reverse Cuthill-McKee on the node graph
+ * (which also minimises the bandwidth of assembled matrices) or along a
+ * Morton (Z-order) curve. Elements are then sorted by their smallest new node
+ * index, so that element loops traverse the node arrays almost sequentially.
+ * The orientation of the elements is preserved.
+ *
+ * @tparam DataTypes Associated data type.
+ */
+template <class DataTypes>
+class ReorderMesh : public sofa::core::DataEngine
+{
+public:
+    SOFA_CLASS(SOFA_TEMPLATE(ReorderMesh,DataTypes), sofa::core::DataEngine);
+
+    typedef typename DataTypes::VecCoord VecCoord;
+    typedef typename DataTypes::Coord    Coord;
+    typedef typename Coord::value_type   Real;
+
+    typedef sofa::type::Vec<3,Real> Vec3;
+    typedef unsigned int Index;
+    typedef sofa::type::vector<Index> VecIndex;
+
+protected:
+    ReorderMesh();
+
+    virtual ~ReorderMesh();
+
+public:
+
+    void init() override;
+    void reinit() override;
+    void doUpdate() override;
+
+    // Data
+
+    sofa::Data<sofa::helper::OptionsGroup> f_method;
+
+    sofa::Data<VecCoord> f_input_position;
+    sofa::Data< sofa::type::vector<Vec3> > f_input_normals;
+    sofa::Data< sofa::type::vector< sofa::type::fixed_array<Index,2> > > f_input_edges;
+    sofa::Data< sofa::type::vector< sofa::type::fixed_array<Index,3> > > f_input_triangles;
+
+    sofa::Data<VecCoord> f_output_position;
+    sofa::Data< sofa::type::vector<Vec3> > f_output_normals;
+    sofa::Data< sofa::type::vector< sofa::type::fixed_array<Index,2> > > f_output_edges;
+    sofa::Data< sofa::type::vector< sofa::type::fixed_array<Index,3> > > f_output_triangles;
+
+    sofa::Data<VecIndex> f_output_pointPermutation;
+    sofa::Data<VecIndex> f_output_pointInversePermutation;
+    sofa::Data<VecIndex> f_output_edgePermutation;
+    sofa::Data<VecIndex> f_output_trianglePermutation;
+
+    sofa::Data<Index> f_output_bandwidthBefore;
+    sofa::Data<Index> f_output_bandwidthAfter;
+
+protected:
+
+    /// Build the node graph in compressed row format from edges and triangles.
+    void buildNodeGraph(Index nbPoints, VecIndex &offsets, VecIndex &neighbours);
+
+    /// Node ordering along a Morton curve. perm[new] = old.
+    void orderMorton(const VecCoord &x, VecIndex &perm);
+
+    /// Sort elements by their smallest new node index and renumber them.
+    template<unsigned int N> void reorderElements(
+        const VecIndex &inversePerm,
+        const sofa::Data< sofa::type::vector< sofa::type::fixed_array<Index,N> > > &inElements,
+        sofa::Data< sofa::type::vector< sofa::type::fixed_array<Index,N> > > &outElements,
+        sofa::Data<VecIndex> &elementPerm);
+
+    /// Largest difference between indices of two connected nodes.
+    Index computeBandwidth(const VecIndex &map, const VecIndex &offsets,
+        const VecIndex &neighbours);
+};
+
+} // namespace
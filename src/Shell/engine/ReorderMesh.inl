@@ -0,0 +1,311 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <Shell/engine/ReorderMesh.h>
+#include <Shell/misc/ReverseCuthillMcKee.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+
+namespace shell::engine
+{
+
+using namespace sofa::type;
+using namespace sofa::core::objectmodel;
+
+template <class DataTypes>
+ReorderMesh<DataTypes>::ReorderMesh()
+: f_method(initData(&f_method,"method","Node ordering: reverse Cuthill-McKee on the node graph or Morton curve on positions"))
+  , f_input_position(initData(&f_input_position,"position","Input Vertices"))
+  , f_input_normals(initData(&f_input_normals,"normals","Input Normals"))
+  , f_input_edges(initData(&f_input_edges,"edges","Input Edges"))
+  , f_input_triangles(initData(&f_input_triangles,"triangles","Input Triangles"))
+
+  , f_output_position(initData(&f_output_position,"reorderedPosition","Output Vertices in the new order"))
+  , f_output_normals(initData(&f_output_normals,"reorderedNormals","Output Normals in the new order"))
+  , f_output_edges(initData(&f_output_edges,"reorderedEdges","Output Edges using the new node indices, in the new order"))
+  , f_output_triangles(initData(&f_output_triangles,"reorderedTriangles","Output Triangles using the new node indices, in the new order"))
+  , f_output_pointPermutation(initData(&f_output_pointPermutation,"pointPermutation","Input index of each output node"))
+  , f_output_pointInversePermutation(initData(&f_output_pointInversePermutation,"pointInversePermutation","Output index of each input node"))
+  , f_output_edgePermutation(initData(&f_output_edgePermutation,"edgePermutation","Input index of each output edge"))
+  , f_output_trianglePermutation(initData(&f_output_trianglePermutation,"trianglePermutation","Input index of each output triangle"))
+  , f_output_bandwidthBefore(initData(&f_output_bandwidthBefore,"bandwidthBefore","Bandwidth of the node graph of the input mesh"))
+  , f_output_bandwidthAfter(initData(&f_output_bandwidthAfter,"bandwidthAfter","Bandwidth of the node graph of the output mesh"))
+{
+    sofa::helper::OptionsGroup* method = f_method.beginEdit();
+    method->setNames( {
+        "RCM",      // Reverse Cuthill-McKee
+        "Morton"    // Z-order curve
+    });
+    method->setSelectedItem("RCM");
+    f_method.endEdit();
+}
+
+template <class DataTypes>
+ReorderMesh<DataTypes>::~ReorderMesh()
+{
+}
+
+template <class DataTypes>
+void ReorderMesh<DataTypes>::init()
+{
+    addInput(&f_method);
+
+    addInput(&f_input_position);
+    addInput(&f_input_normals);
+    addInput(&f_input_edges);
+    addInput(&f_input_triangles);
+
+    addOutput(&f_output_position);
+    addOutput(&f_output_normals);
+    addOutput(&f_output_edges);
+    addOutput(&f_output_triangles);
+
+    addOutput(&f_output_pointPermutation);
+    addOutput(&f_output_pointInversePermutation);
+    addOutput(&f_output_edgePermutation);
+    addOutput(&f_output_trianglePermutation);
+
+    addOutput(&f_output_bandwidthBefore);
+    addOutput(&f_output_bandwidthAfter);
+
+    setDirtyValue();
+}
+
+template <class DataTypes>
+void ReorderMesh<DataTypes>::reinit()
+{
+    update();
+}
+
+template <class DataTypes>
+void ReorderMesh<DataTypes>::doUpdate()
+{
+    const VecCoord& inPt = f_input_position.getValue();
+    const sofa::type::vector<Vec3>& inNorm = f_input_normals.getValue();
+    const Index nbPoints = (Index)inPt.size();
+
+    bool bHasNormals = false;
+    if (inPt.size() == inNorm.size()) {
+        bHasNormals = true;
+    } else if (inNorm.size() != 0) {
+        msg_warning() << "Normal count does not match node count! Ignoring normals.";
+    }
+
+    VecIndex offsets, neighbours;
+    buildNodeGraph(nbPoints, offsets, neighbours);
+
+    // New node order
+    VecIndex& perm = *f_output_pointPermutation.beginEdit();
+    if (f_method.getValue().getSelectedItem() == "Morton") {
+        orderMorton(inPt, perm);
+    } else {
+        perm = shell::misc::reverseCuthillMcKee(nbPoints, offsets, neighbours);
+    }
+
+    VecIndex& iperm = *f_output_pointInversePermutation.beginEdit();
+    iperm.resize(nbPoints);
+    for (Index i=0; i<nbPoints; i++) {
+        iperm[perm[i]] = i;
+    }
+
+    // Reordered nodes
+    VecCoord& outPt = *f_output_position.beginEdit();
+    sofa::type::vector<Vec3>& outNorm = *f_output_normals.beginEdit();
+    outPt.resize(nbPoints);
+    outNorm.resize(bHasNormals ? nbPoints : 0);
+    for (Index i=0; i<nbPoints; i++) {
+        outPt[i] = inPt[perm[i]];
+        if (bHasNormals)
+            outNorm[i] = inNorm[perm[i]];
+    }
+    f_output_position.endEdit();
+    f_output_normals.endEdit();
+
+    // Bandwidth of the node graph
+    VecIndex identity(nbPoints);
+    std::iota(identity.begin(), identity.end(), 0);
+    f_output_bandwidthBefore.setValue(computeBandwidth(identity, offsets, neighbours));
+    f_output_bandwidthAfter.setValue(computeBandwidth(iperm, offsets, neighbours));
+
+    msg_info() << "Bandwidth " << f_output_bandwidthBefore.getValue() << " -> "
+        << f_output_bandwidthAfter.getValue();
+
+    // Reordered elements
+    reorderElements<2>(iperm, f_input_edges, f_output_edges, f_output_edgePermutation);
+    reorderElements<3>(iperm, f_input_triangles, f_output_triangles, f_output_trianglePermutation);
+
+    f_output_pointPermutation.endEdit();
+    f_output_pointInversePermutation.endEdit();
+}
+
+template <class DataTypes>
+void ReorderMesh<DataTypes>::buildNodeGraph(Index nbPoints, VecIndex &offsets, VecIndex &neighbours)
+{
+    const sofa::type::vector< sofa::type::fixed_array<Index,2> >& inEdges = f_input_edges.getValue();
+    const sofa::type::vector< sofa::type::fixed_array<Index,3> >& inTri = f_input_triangles.getValue();
+
+    // Collect all connections (in both directions)
+    sofa::type::vector< std::pair<Index, Index> > pairs;
+    pairs.reserve(2*inEdges.size() + 6*inTri.size());
+
+    auto addPair = [&](Index a, Index b) {
+        if (a == b || a >= nbPoints || b >= nbPoints)
+            return;
+        pairs.push_back(std::make_pair(a, b));
+        pairs.push_back(std::make_pair(b, a));
+    };
+
+    for (const auto &e : inEdges) {
+        addPair(e[0], e[1]);
+    }
+    for (const auto &t : inTri) {
+        addPair(t[0], t[1]);
+        addPair(t[1], t[2]);
+        addPair(t[2], t[0]);
+    }
+
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+    // Compressed rows
+    offsets.assign(nbPoints+1, 0);
+    neighbours.resize(pairs.size());
+    for (size_t i=0; i<pairs.size(); i++) {
+        offsets[pairs[i].first+1]++;
+        neighbours[i] = pairs[i].second;
+    }
+    for (Index i=0; i<nbPoints; i++) {
+        offsets[i+1] += offsets[i];
+    }
+}
+
+template <class DataTypes>
+void ReorderMesh<DataTypes>::orderMorton(const VecCoord &x, VecIndex &perm)
+{
+    const Index nbPoints = (Index)x.size();
+    perm.resize(nbPoints);
+    if (nbPoints == 0)
+        return;
+
+    // Bounding box
+    Vec3 bbMin = DataTypes::getCPos(x[0]), bbMax = bbMin;
+    for (Index i=1; i<nbPoints; i++) {
+        const Vec3 p = DataTypes::getCPos(x[i]);
+        for (int d=0; d<3; d++) {
+            if (p[d] < bbMin[d]) bbMin[d] = p[d];
+            if (p[d] > bbMax[d]) bbMax[d] = p[d];
+        }
+    }
+
+    Real size = std::max(bbMax[0]-bbMin[0], std::max(bbMax[1]-bbMin[1], bbMax[2]-bbMin[2]));
+    if (size <= 0) size = 1;
+
+    // Spread the lower 21 bits so that there are two zeros between each bit
+    auto spread = [](uint64_t v) {
+        v &= 0x1fffff;
+        v = (v | v << 32) & 0x1f00000000ffffULL;
+        v = (v | v << 16) & 0x1f0000ff0000ffULL;
+        v = (v | v << 8)  & 0x100f00f00f00f00fULL;
+        v = (v | v << 4)  & 0x10c30c30c30c30c3ULL;
+        v = (v | v << 2)  & 0x1249249249249249ULL;
+        return v;
+    };
+
+    const Real scale = Real((1 << 21) - 1) / size;
+    sofa::type::vector< std::pair<uint64_t, Index> > keys(nbPoints);
+    for (Index i=0; i<nbPoints; i++) {
+        const Vec3 p = (DataTypes::getCPos(x[i]) - bbMin) * scale;
+        keys[i].first = spread((uint64_t)p[0]) | (spread((uint64_t)p[1]) << 1) |
+            (spread((uint64_t)p[2]) << 2);
+        keys[i].second = i;
+    }
+
+    std::sort(keys.begin(), keys.end());
+    for (Index i=0; i<nbPoints; i++) {
+        perm[i] = keys[i].second;
+    }
+}
+
+template <class DataTypes>
+template<unsigned int N>
+void ReorderMesh<DataTypes>::reorderElements(
+    const VecIndex &inversePerm,
+    const sofa::Data< sofa::type::vector< sofa::type::fixed_array<Index,N> > > &inElements,
+    sofa::Data< sofa::type::vector< sofa::type::fixed_array<Index,N> > > &outElements,
+    sofa::Data<VecIndex> &elementPerm)
+{
+    const sofa::type::vector< sofa::type::fixed_array <Index, N> >& inEle = inElements.getValue();
+    const Index nbPoints = (Index)inversePerm.size();
+
+    // Renumber the nodes
+    sofa::type::vector< sofa::type::fixed_array <Index, N> > renumbered(inEle.size());
+    sofa::type::vector< std::pair<Index, Index> > keys(inEle.size());
+    for (Index i=0; i<inEle.size(); i++) {
+        Index minId = nbPoints;
+        for (Index j=0; j<N; j++) {
+            Index id = inEle[i][j];
+            if (id < nbPoints) {
+                renumbered[i][j] = inversePerm[id];
+            } else {
+                msg_warning() << "Invalid node ID in elements! " <<
+                    id << " is not a valid node ID!" ;
+                renumbered[i][j] = 0;
+            }
+            minId = std::min(minId, renumbered[i][j]);
+        }
+        keys[i] = std::make_pair(minId, i);
+    }
+
+    // Sort by the first node accessed
+    std::sort(keys.begin(), keys.end());
+
+    VecIndex& ePerm = *elementPerm.beginEdit();
+    sofa::type::vector< sofa::type::fixed_array <Index, N> >& outEle = *outElements.beginEdit();
+    ePerm.resize(inEle.size());
+    outEle.resize(inEle.size());
+    for (Index i=0; i<inEle.size(); i++) {
+        ePerm[i] = keys[i].second;
+        outEle[i] = renumbered[keys[i].second];
+    }
+    outElements.endEdit();
+    elementPerm.endEdit();
+}
+
+template <class DataTypes>
+typename ReorderMesh<DataTypes>::Index ReorderMesh<DataTypes>::computeBandwidth(
+    const VecIndex &map, const VecIndex &offsets, const VecIndex &neighbours)
+{
+    Index bandwidth = 0;
+    for (Index i=0; i+1<offsets.size(); i++) {
+        for (Index k=offsets[i]; k<offsets[i+1]; k++) {
+            Index a = map[i], b = map[neighbours[k]];
+            bandwidth = std::max(bandwidth, a > b ? a - b : b - a);
+        }
+    }
+    return bandwidth;
+}
+
+} // namespace
@@ -39,6 +39,8 @@
 
 #include <Shell/controller/MeshInterpolator.h>
 #include <Shell/engine/JoinMeshPoints.h>
+#include <Shell/misc/DrawBuffer.h>
+#include <Shell/misc/SymmetricMatrix.h>
 
 
 // Uncomment the following to use quaternions instead of matrices for
@@ -116,6 +118,7 @@ class BezierTriangularBendingFEMForceField : public core::behavior::ForceField<D
         typedef Mat<9, 9, Real> StiffnessMatrix;
         typedef Mat<9, 9, Real> StiffnessMatrixBending;
         typedef Mat<18, 18, Real> StiffnessMatrixGlobalSpace;
+        typedef shell::misc::SymmetricMatrix<9, Real> StiffnessMatrixPacked;    ///< stored (symmetric) stiffness matrix
 
         sofa::core::topology::BaseMeshTopology* _topology;
         sofa::core::topology::BaseMeshTopology* _topologyTarget;
@@ -185,11 +188,11 @@ public:
                 StrainDisplacementBending strainDisplacementMatrixB3;
                 StrainDisplacementBending strainDisplacementMatrixB4;
 
-                // Stiffness matrix K = J * M * Jt
-                StiffnessMatrix stiffnessMatrix;
+                // Stiffness matrix K = J * M * Jt (symmetric, packed)
+                StiffnessMatrixPacked stiffnessMatrix;
 
-                // Stiffness matrix for bending K = Jt * M * J
-                StiffnessMatrixBending stiffnessMatrixBending;
+                // Stiffness matrix for bending K = Jt * M * J (symmetric, packed)
+                StiffnessMatrixPacked stiffnessMatrixBending;
 
                 // Surface Area * 2
                 Real area2;
@@ -238,7 +241,8 @@ public:
         void addBToMatrix(sofa::linearalgebra::BaseMatrix * /*mat*/, double /*bFact*/, unsigned int &/*offset*/) override;
         void handleTopologyChange() override;
 
-        SReal getPotentialEnergy(const sofa::core::MechanicalParams* /*mparams*/, const DataVecCoord& /*x*/) const override { return 0; }
+        /// Strain energy of the positions passed to the last addForce()
+        SReal getPotentialEnergy(const sofa::core::MechanicalParams* /*mparams*/, const DataVecCoord& /*x*/) const override { return potentialEnergy; }
 
         void draw(const core::visual::VisualParams* vparams) override;
 
@@ -280,6 +284,11 @@ protected :
         MaterialStiffness materialMatrix;
         MaterialStiffness materialMatrixBending;
 
+        /// Bezier nodes for draw(), rebuilt when triangleInfo changes
+        shell::misc::DrawBuffer drawBuffer;
+
+        /// Strain energy computed by the last addForce()
+        SReal potentialEnergy;
 
         void initTriangleOnce(const int i, const Index&a, const Index&b, const Index&c);
         void initTriangle(const int i);
@@ -308,7 +317,7 @@ protected :
         void interpolateRefFrame(TriangleInformation *tinfo, const Vec2& baryCoord, const Index& a, const Index& b, const Index& c, const VecCoord& x, sofa::type::fixed_array<Vec3,10>& X_bezierPoints );
 
 
-        void accumulateForce(VecDeriv& f, const VecCoord & p, const Index elementIndex);
+        void accumulateForce(VecDeriv& f, const VecCoord & p, const Index elementIndex, SReal &energy);
 
         void convertStiffnessMatrixToGlobalSpace(StiffnessMatrixGlobalSpace &K_gs, TriangleInformation *tinfo);
 };
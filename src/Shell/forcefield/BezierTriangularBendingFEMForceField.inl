@@ -86,6 +86,7 @@ BezierTriangularBendingFEMForceField<DataTypes>::BezierTriangularBendingFEMForce
 , triangleInfo(initData(&triangleInfo, "triangleInfo", "Internal triangle data"))
 {
     triangleHandler = new TRQSTriangleHandler(this, &triangleInfo);
+    potentialEnergy = 0;
 }
 
 // --------------------------------------------------------------------------------------
@@ -343,8 +344,13 @@ void BezierTriangularBendingFEMForceField<DataTypes>::initTriangle(const int i)
     computeStrainDisplacementMatrixBending(*tinfo);
 
     // Compute stiffness matrices K = ∫ J^T*M*J dV
-    computeStiffnessMatrixMembrane(tinfo->stiffnessMatrix, *tinfo);
-    computeStiffnessMatrixBending(tinfo->stiffnessMatrixBending, *tinfo);
+    StiffnessMatrix K;
+    computeStiffnessMatrixMembrane(K, *tinfo);
+    tinfo->stiffnessMatrix = StiffnessMatrixPacked(K);
+
+    StiffnessMatrixBending K_bending;
+    computeStiffnessMatrixBending(K_bending, *tinfo);
+    tinfo->stiffnessMatrixBending = StiffnessMatrixPacked(K_bending);
 
     triangleInfo.endEdit();
 }
@@ -1260,7 +1266,7 @@ void BezierTriangularBendingFEMForceField<DataTypes>::computeForceBending(Displa
 // ---
 // --------------------------------------------------------------------------------------
 template <class DataTypes>
-void BezierTriangularBendingFEMForceField<DataTypes>::accumulateForce(VecDeriv &f, const VecCoord &x, const Index elementIndex)
+void BezierTriangularBendingFEMForceField<DataTypes>::accumulateForce(VecDeriv &f, const VecCoord &x, const Index elementIndex, SReal &energy)
 {
     type::vector<TriangleInformation>& triangleInf = *(triangleInfo.beginEdit());
     TriangleInformation *tinfo = &triangleInf[elementIndex];
@@ -1291,7 +1297,8 @@ void BezierTriangularBendingFEMForceField<DataTypes>::accumulateForce(VecDeriv &
     DisplacementBending F_bending;
     computeForceBending(F_bending, D_bending, elementIndex);
 
-
+    // Strain energy 1/2 u^T K u in the corotational frame
+    energy += (D * F + D_bending * F_bending) / 2;
 
     // Transform forces back into global reference frame
     Vec3 fa1 = tinfo->frameOrientationInv * Vec3(F[0], F[1], F_bending[0]);
@@ -1329,10 +1336,12 @@ void BezierTriangularBendingFEMForceField<DataTypes>::addForce(const sofa::core:
     int nbTriangles=_topology->getNbTriangles();
     f.resize(p.size());
 
+    SReal energy = 0;
     for (int i=0; i<nbTriangles; i++)
     {
-        accumulateForce(f, p, i);
+        accumulateForce(f, p, i, energy);
     }
+    potentialEnergy = energy;
 
     dataF.endEdit();
 }
@@ -1364,7 +1373,7 @@ template<class DataTypes>
 void BezierTriangularBendingFEMForceField<DataTypes>::convertStiffnessMatrixToGlobalSpace(StiffnessMatrixGlobalSpace &K_gs, TriangleInformation *tinfo)
 {
     // Stiffness matrix of current triangle
-    const StiffnessMatrix &K = tinfo->stiffnessMatrix;
+    const StiffnessMatrixPacked &K = tinfo->stiffnessMatrix;
 
     // Firstly, add all degrees of freedom (we add the unused translation in z)
     StiffnessMatrixGlobalSpace K_18x18;
@@ -1383,25 +1392,25 @@ void BezierTriangularBendingFEMForceField<DataTypes>::convertStiffnessMatrixToGl
             jg = 6*by;
 
             // linear X
-            K_18x18[ig+0][jg+0] = K[3*bx+0][3*by+0]; // linear X
-            K_18x18[ig+0][jg+1] = K[3*bx+0][3*by+1]; // linear Y
-            K_18x18[ig+0][jg+5] = K[3*bx+0][3*by+2]; // angular Z
+            K_18x18[ig+0][jg+0] = K(3*bx+0, 3*by+0); // linear X
+            K_18x18[ig+0][jg+1] = K(3*bx+0, 3*by+1); // linear Y
+            K_18x18[ig+0][jg+5] = K(3*bx+0, 3*by+2); // angular Z
 
             // linear Y
-            K_18x18[ig+1][jg+0] = K[3*bx+1][3*by+0]; // linear X
-            K_18x18[ig+1][jg+1] = K[3*bx+1][3*by+1]; // linear Y
-            K_18x18[ig+1][jg+5] = K[3*bx+1][3*by+2]; // angular Z
+            K_18x18[ig+1][jg+0] = K(3*bx+1, 3*by+0); // linear X
+            K_18x18[ig+1][jg+1] = K(3*bx+1, 3*by+1); // linear Y
+            K_18x18[ig+1][jg+5] = K(3*bx+1, 3*by+2); // angular Z
 
             // angular Z
-            K_18x18[ig+5][jg+0] = K[3*bx+2][3*by+0]; // linear X
-            K_18x18[ig+5][jg+1] = K[3*bx+2][3*by+1]; // linear Y
-            K_18x18[ig+5][jg+5] = K[3*bx+2][3*by+2]; // angular Z
+            K_18x18[ig+5][jg+0] = K(3*bx+2, 3*by+0); // linear X
+            K_18x18[ig+5][jg+1] = K(3*bx+2, 3*by+1); // linear Y
+            K_18x18[ig+5][jg+5] = K(3*bx+2, 3*by+2); // angular Z
                 }
             }
 
 
         // Stiffness matrix in bending of current triangle
-        const StiffnessMatrixBending &K_bending = tinfo->stiffnessMatrixBending;
+        const StiffnessMatrixPacked &K_bending = tinfo->stiffnessMatrixBending;
 
         // Copy the stiffness matrix by block 3x3 into global matrix (the new index of each bloc into global matrix is a combination of 2, 8 and 15 in indices)
         for (unsigned int bx=0; bx<3; bx++)
@@ -1419,29 +1428,15 @@ void BezierTriangularBendingFEMForceField<DataTypes>::convertStiffnessMatrixToGl
                 {
                     for (unsigned int j=0; j<3; j++)
                     {
-                        K_18x18[ig+i][jg+j] += K_bending[3*bx+i][3*by+j];
+                        K_18x18[ig+i][jg+j] += K_bending(3*bx+i, 3*by+j);
                     }
                 }
 
             }
         }
 
-    // Extend rotation matrix and its transpose
-    StiffnessMatrixGlobalSpace R18x18, Rt18x18;
-
-    for(unsigned int i=0;i<3;++i)
-    {
-        for(unsigned int j=0;j<3;++j)
-        {
-            R18x18[i][j] = R18x18[i+3][j+3] = R18x18[i+6][j+6] = R18x18[i+9][j+9] = R18x18[i+12][j+12] = R18x18[i+15][j+15] =
-                tinfo->frameOrientation[i][j];
-            Rt18x18[i][j] = Rt18x18[i+3][j+3] = Rt18x18[i+6][j+6] = Rt18x18[i+9][j+9] = Rt18x18[i+12][j+12] = Rt18x18[i+15][j+15] =
-                tinfo->frameOrientationInv[i][j];
-        }
-    }
-
     // Then we put the stifness matrix into the global frame
-    K_gs = Rt18x18 * K_18x18 * R18x18;
+    shell::misc::rotateSymmetric18(K_gs, K_18x18, tinfo->frameOrientation, tinfo->frameOrientationInv);
 
 }
 
@@ -1455,9 +1450,6 @@ void BezierTriangularBendingFEMForceField<DataTypes>::addKToMatrix(const core::M
     StiffnessMatrixGlobalSpace K_gs;
 
     // Build Matrix Block for this ForceField
-    unsigned int i, j ,n1, n2, row, column, ROW, COLUMN;
-    Index node1, node2;
-
     sofa::core::behavior::MultiMatrixAccessor::MatrixRef r = matrix->getMatrix(this->mstate);
     type::vector<TriangleInformation>& triangleInf = *(triangleInfo.beginEdit());
 
@@ -1470,29 +1462,7 @@ void BezierTriangularBendingFEMForceField<DataTypes>::addKToMatrix(const core::M
 
             convertStiffnessMatrixToGlobalSpace(K_gs, tinfo);
 
-            // find index of node 1
-            for (n1=0; n1<3; n1++)
-            {
-                    node1 = triangle[n1];
-
-                    for(i=0; i<6; i++)
-                    {
-                            ROW = r.offset+6*node1+i;
-                            row = 6*n1+i;
-                            // find index of node 2
-                            for (n2=0; n2<3; n2++)
-                            {
-                                    node2 = triangle[n2];
-
-                                    for (j=0; j<6; j++)
-                                    {
-                                            COLUMN = r.offset+6*node2+j;
-                                            column = 6*n2+j;
-                                            r.matrix->add(ROW, COLUMN, - K_gs[row][column] * kFactor);
-                                    }
-                            }
-                    }
-            }
+            shell::misc::addSymmetricElementMatrix(r.matrix, r.offset, triangle, K_gs, (Real)-kFactor);
     }
 
     triangleInfo.endEdit();
@@ -1569,42 +1539,36 @@ void BezierTriangularBendingFEMForceField<DataTypes>::draw(const core::visual::V
         const VecCoord& x0 = this->mstate->read(sofa::core::vec_id::read_access::position)->getValue();
 
 
-        type::vector<TriangleInformation>& triangleInf = *(triangleInfo.beginEdit());
-
-        // Render Bezier points
+        const type::vector<TriangleInformation>& triangleInf = triangleInfo.getValue();
 
-        glPointSize(8);
-        glDisable(GL_LIGHTING);
-        glBegin(GL_POINTS);
-
-        for (sofa::Index i=0; i<_topology->getNbTriangles(); ++i)
+        // Render Bezier points, the arrays are rebuilt only when the nodes
+        // have been updated
+        if (!drawBuffer.isValid(triangleInfo.getCounter()))
         {
-            TriangleInformation *tinfo = &triangleInf[i];
-
-            for (int j=0; j<9; j++)
+            drawBuffer.clear();
+            for (sofa::Index i=0; i<triangleInf.size(); ++i)
             {
-                glColor4f(0.0, 0.7, 0.0, 1.0);
-                glVertex3f(
-                    tinfo->bezierNodes[j][0],
-                    tinfo->bezierNodes[j][1],
-                    tinfo->bezierNodes[j][2]);
-            }
+                const TriangleInformation &tinfo = triangleInf[i];
+
+                for (int j=0; j<9; j++)
+                    drawBuffer.addPoint(tinfo.bezierNodes[j], sofa::type::RGBAColor(0.0, 0.7, 0.0, 1.0));
 
-            // Central node in lighter color
-            glColor4f(0.0, 1.0, 0.0, 1.0);
-            glVertex3f(
-                tinfo->bezierNodes[9][0],
-                tinfo->bezierNodes[9][1],
-                tinfo->bezierNodes[9][2]);
+                // Central node in lighter color
+                drawBuffer.addPoint(tinfo.bezierNodes[9], sofa::type::RGBAColor(0.0, 1.0, 0.0, 1.0));
+            }
+            drawBuffer.validate(triangleInfo.getCounter());
         }
 
-        glEnd();
-        glPointSize(1);
+        {
+            const auto stateLifeCycle = vparams->drawTool()->makeStateLifeCycle();
+            vparams->drawTool()->disableLighting();
+            vparams->drawTool()->drawPoints(drawBuffer.points, 8, drawBuffer.colours);
+        }
 
         // Render the frame of each element
         for (sofa::Index i=0; i<_topology->getNbTriangles(); ++i)
         {
-            TriangleInformation *tinfo = &triangleInf[i];
+            const TriangleInformation *tinfo = &triangleInf[i];
 
             Vec3 P1P2= x0[tinfo->b].getCenter() - x0[tinfo->a].getCenter();
             Vec3 P2P3= x0[tinfo->c].getCenter() - x0[tinfo->b].getCenter();
@@ -1623,8 +1587,6 @@ void BezierTriangularBendingFEMForceField<DataTypes>::draw(const core::visual::V
                 Vec3(length, length, length));
 
         }
-
-        triangleInfo.endEdit();
     } // if(getShowForceFields())
 }
 
@@ -32,6 +32,8 @@
 #include <sofa/core/topology/BaseMeshTopology.h>
 #include <sofa/core/topology/TopologyData.h>
 
+#include <Shell/misc/BlockDiagonal.h>
+
 
 namespace sofa
 {
@@ -166,7 +168,14 @@ public:
         void addDForce(const sofa::core::MechanicalParams* /*mparams*/, DataVecDeriv& datadF, const DataVecDeriv& datadX ) override ;
         void addKToMatrix(const core::MechanicalParams* mparams, const sofa::core::behavior::MultiMatrixAccessor* matrix) override;
 
-        SReal getPotentialEnergy(const sofa::core::MechanicalParams* /*mparams*/, const DataVecCoord& /*x*/) const override { return 0; }
+        /// Strain energy of the positions passed to the last addForce()
+        SReal getPotentialEnergy(const sofa::core::MechanicalParams* /*mparams*/, const DataVecCoord& /*x*/) const override { return potentialEnergy; }
+
+        typedef shell::misc::BlockDiagonal<3,Real> NodeBlockDiagonal;
+
+        /// Add kFactor times the node diagonal blocks of the stiffness matrix
+        /// (as assembled by addKToMatrix) into blocks, without assembling it
+        void addNodeBlockDiagonal(NodeBlockDiagonal &blocks, const Real kFactor, const bool parallel);
 
         sofa::core::topology::BaseMeshTopology* getTopology() {return _topology;}
 
@@ -186,6 +195,9 @@ protected :
         MaterialStiffness materialMatrix, materialMatrixMembrane;
         TriangleData< sofa::type::vector<TriangleInformation> > triangleInfo;
 
+        /// Strain energy computed by the last addForce()
+        SReal potentialEnergy;
+
         // What to measure
         //bool bMeasureStrain;
         //bool bMeasureStress;
@@ -198,7 +210,7 @@ protected :
         void computeStiffnessMatrix(StiffnessMatrix &K, TriangleInformation &tinfo);
 
         void computeDisplacement(Displacement &D, const VecCoord &x, const Index elementIndex);
-        void accumulateForce(VecDeriv& f, const VecCoord & p, const Index elementIndex);
+        void accumulateForce(VecDeriv& f, const VecCoord & p, const Index elementIndex, SReal &energy);
         void computeForce(Displacement &F, const Displacement& D, const Index elementIndex);
         virtual void applyStiffness(VecDeriv& f, const VecDeriv& dx, const Index elementIndex, const double kFactor);
 
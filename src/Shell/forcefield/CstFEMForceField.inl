@@ -83,6 +83,8 @@ CstFEMForceField<DataTypes>::CstFEMForceField()
     //f_measure.endEdit();
 
     triangleHandler = new TRQSTriangleHandler(this, &triangleInfo);
+
+    potentialEnergy = 0;
 }
 
 
@@ -170,10 +172,12 @@ void CstFEMForceField<DataTypes>::addForce(const sofa::core::MechanicalParams* /
     int nbTriangles=_topology->getNbTriangles();
     f.resize(p.size());
 
+    SReal energy = 0;
     for (int i=0; i<nbTriangles; i++)
     {
-        accumulateForce(f, p, i);
+        accumulateForce(f, p, i, energy);
     }
+    potentialEnergy = energy;
 
     dataF.endEdit();
 }
@@ -420,7 +424,7 @@ void CstFEMForceField<DataTypes>::computeDisplacement(Displacement &D, const Vec
 
 
 template <class DataTypes>
-void CstFEMForceField<DataTypes>::accumulateForce(VecDeriv &f, const VecCoord &x, const Index elementIndex)
+void CstFEMForceField<DataTypes>::accumulateForce(VecDeriv &f, const VecCoord &x, const Index elementIndex, SReal &energy)
 {
     type::vector<TriangleInformation>& triangleInf = *(triangleInfo.beginEdit());
     TriangleInformation *tinfo = &triangleInf[elementIndex];
@@ -438,6 +442,9 @@ void CstFEMForceField<DataTypes>::accumulateForce(VecDeriv &f, const VecCoord &x
     Displacement F;
     computeForce(F, D, elementIndex);
 
+    // Strain energy 1/2 u^T K u in the corotational frame
+    energy += (D * F) * f_stiffnessFactor.getValue() / 2;
+
     // Compute the measure (stress/strain)
     //if (bMeasureStrain) {
     //    type::vector<Real> &values = *f_measuredValues.beginEdit();
@@ -608,6 +615,26 @@ void CstFEMForceField<DataTypes>::addKToMatrix(const core::MechanicalParams* mpa
 }
 
 
+template<class DataTypes>
+void CstFEMForceField<DataTypes>::addNodeBlockDiagonal(NodeBlockDiagonal &blocks, const Real kFactor, const bool parallel)
+{
+    const type::vector<TriangleInformation>& ti = triangleInfo.getValue();
+    const Real factor = -kFactor * f_stiffnessFactor.getValue();
+
+    // Position of the in-plane dofs (u, v) in the node block
+    const unsigned int dofs[2] = { 0, 1 };
+
+    shell::misc::accumulateNodeBlocks(blocks, _topology, parallel,
+        [&](Mat<3,3,Real> &block, Index t, unsigned int j) {
+            const TriangleInformation &tinfo = ti[t];
+
+            Mat<3,3,Real> local;
+            local.clear();
+            shell::misc::addElementNodeBlock(local, tinfo.stiffnessMatrix, 2, j, dofs);
+            shell::misc::addRotatedNodeBlock(block, local, tinfo.R, factor);
+        });
+}
+
 
 template<class DataTypes>
 void CstFEMForceField<DataTypes>::convertStiffnessMatrixToGlobalSpace(StiffnessMatrixFull &Kg, const TriangleInformation &tinfo)
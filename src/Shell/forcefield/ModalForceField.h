@@ -0,0 +1,74 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/core/behavior/ForceField.h>
+#include <sofa/core/objectmodel/DataFileName.h>
+#include <sofa/defaulttype/VecTypes.h>
+
+#include <Shell/config.h>
+
+namespace shell::forcefield
+{
+
+/**
+ * @brief Stiffness of a modal reduced model, f_j = -lambda_j q_j.
+ *
+ * The modes computed by ModalAnalysis are mass-normalised, so that the
+ * reduced mass is the identity (e.g. a UniformMass of vertexMass 1 on the
+ * modal coordinates) and the reduced stiffness is diagonal. The eigenvalues
+ * are read from the file of the modes if it is set.
+ */
+template<class DataTypes>
+class ModalForceField : public sofa::core::behavior::ForceField<DataTypes>
+{
+public:
+    SOFA_CLASS(SOFA_TEMPLATE(ModalForceField,DataTypes), SOFA_TEMPLATE(sofa::core::behavior::ForceField,DataTypes));
+
+    typedef sofa::core::behavior::ForceField<DataTypes> Inherited;
+    typedef typename DataTypes::Real Real;
+    typedef typename DataTypes::VecCoord VecCoord;
+    typedef typename DataTypes::VecDeriv VecDeriv;
+    typedef sofa::core::objectmodel::Data<VecCoord> DataVecCoord;
+    typedef sofa::core::objectmodel::Data<VecDeriv> DataVecDeriv;
+
+protected:
+
+    ModalForceField();
+
+    virtual ~ModalForceField();
+
+public:
+
+    void init() override;
+
+    void addForce(const sofa::core::MechanicalParams* mparams, DataVecDeriv& f, const DataVecCoord& x, const DataVecDeriv& v) override;
+    void addDForce(const sofa::core::MechanicalParams* mparams, DataVecDeriv& df, const DataVecDeriv& dx) override;
+    void addKToMatrix(const sofa::core::MechanicalParams* mparams, const sofa::core::behavior::MultiMatrixAccessor* matrix) override;
+
+    SReal getPotentialEnergy(const sofa::core::MechanicalParams* mparams, const DataVecCoord& x) const override;
+
+    sofa::core::objectmodel::DataFileName d_filename;
+    sofa::Data< sofa::type::vector<Real> > d_eigenvalues;
+};
+
+} // namespace
@@ -0,0 +1,122 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <Shell/forcefield/ModalForceField.h>
+#include <Shell/misc/ModalBasis.h>
+
+#include <sofa/core/behavior/ForceField.inl>
+#include <sofa/core/behavior/MultiMatrixAccessor.h>
+#include <sofa/core/MechanicalParams.h>
+
+#include <algorithm>
+
+namespace shell::forcefield
+{
+
+template<class DataTypes>
+ModalForceField<DataTypes>::ModalForceField()
+: d_filename(initData(&d_filename, "filename", "File of the modes written by ModalAnalysis"))
+, d_eigenvalues(initData(&d_eigenvalues, "eigenvalues", "Eigenvalues of the modes, read from the file if it is set"))
+{
+}
+
+template<class DataTypes>
+ModalForceField<DataTypes>::~ModalForceField()
+{
+}
+
+template<class DataTypes>
+void ModalForceField<DataTypes>::init()
+{
+    Inherited::init();
+
+    if (d_filename.getFullPath().empty())
+        return;
+
+    shell::misc::ModalBasis basis;
+    if (!basis.read(d_filename.getFullPath()))
+    {
+        msg_error() << "Cannot read the modes from '" << d_filename.getFullPath() << "'";
+        return;
+    }
+
+    sofa::type::vector<Real> &eigenvalues = *d_eigenvalues.beginEdit();
+    eigenvalues.resize(basis.getNbModes());
+    for (sofa::Size j=0; j<basis.getNbModes(); j++)
+        eigenvalues[j] = (Real)basis.eigenvalue(j);
+    d_eigenvalues.endEdit();
+}
+
+template<class DataTypes>
+void ModalForceField<DataTypes>::addForce(const sofa::core::MechanicalParams* /*mparams*/, DataVecDeriv& dataF, const DataVecCoord& dataX, const DataVecDeriv& /*dataV*/)
+{
+    VecDeriv &f = *dataF.beginEdit();
+    const VecCoord &q = dataX.getValue();
+    const sofa::type::vector<Real> &eigenvalues = d_eigenvalues.getValue();
+
+    const std::size_t nbModes = std::min({eigenvalues.size(), q.size(), f.size()});
+    for (std::size_t j=0; j<nbModes; j++)
+        f[j][0] -= eigenvalues[j] * q[j][0];
+
+    dataF.endEdit();
+}
+
+template<class DataTypes>
+void ModalForceField<DataTypes>::addDForce(const sofa::core::MechanicalParams* mparams, DataVecDeriv& dataDf, const DataVecDeriv& dataDx)
+{
+    VecDeriv &df = *dataDf.beginEdit();
+    const VecDeriv &dq = dataDx.getValue();
+    const sofa::type::vector<Real> &eigenvalues = d_eigenvalues.getValue();
+    const Real kFactor = (Real)sofa::core::mechanicalparams::kFactorIncludingRayleighDamping(mparams, this->rayleighStiffness.getValue());
+
+    const std::size_t nbModes = std::min({eigenvalues.size(), dq.size(), df.size()});
+    for (std::size_t j=0; j<nbModes; j++)
+        df[j][0] -= kFactor * eigenvalues[j] * dq[j][0];
+
+    dataDf.endEdit();
+}
+
+template<class DataTypes>
+void ModalForceField<DataTypes>::addKToMatrix(const sofa::core::MechanicalParams* mparams, const sofa::core::behavior::MultiMatrixAccessor* matrix)
+{
+    sofa::core::behavior::MultiMatrixAccessor::MatrixRef r = matrix->getMatrix(this->mstate);
+    const sofa::type::vector<Real> &eigenvalues = d_eigenvalues.getValue();
+    const SReal kFactor = sofa::core::mechanicalparams::kFactorIncludingRayleighDamping(mparams, this->rayleighStiffness.getValue());
+
+    for (std::size_t j=0; j<eigenvalues.size(); j++)
+        r.matrix->add(r.offset + (sofa::Index)j, r.offset + (sofa::Index)j, -kFactor * eigenvalues[j]);
+}
+
+template<class DataTypes>
+SReal ModalForceField<DataTypes>::getPotentialEnergy(const sofa::core::MechanicalParams* /*mparams*/, const DataVecCoord& dataX) const
+{
+    const VecCoord &q = dataX.getValue();
+    const sofa::type::vector<Real> &eigenvalues = d_eigenvalues.getValue();
+
+    SReal energy = 0;
+    for (std::size_t j=0; j<std::min(eigenvalues.size(), q.size()); j++)
+        energy += 0.5 * eigenvalues[j] * q[j][0] * q[j][0];
+    return energy;
+}
+
+} // namespace
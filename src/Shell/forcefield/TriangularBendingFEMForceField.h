@@ -30,6 +30,11 @@
 
 #include <Shell/controller/MeshInterpolator.h>
 #include <Shell/engine/JoinMeshPoints.h>
+#include <Shell/misc/BlockDiagonal.h>
+#include <Shell/misc/GeometricStiffness.h>
+#include <Shell/misc/MixedPrecision.h>
+#include <Shell/misc/SubdivisionHierarchy.h>
+#include <Shell/misc/SymmetricMatrix.h>
 
 
 namespace shell::forcefield
@@ -85,6 +90,10 @@ class TriangularBendingFEMForceField : public sofa::core::behavior::ForceField<D
         typedef Mat<6, 6, Real> StiffnessMatrix;
         typedef Mat<9, 9, Real> StiffnessMatrixBending;
         typedef Mat<18, 18, Real> StiffnessMatrixGlobalSpace;
+        typedef shell::misc::SymmetricMatrix<6, Real> StiffnessMatrixPacked;            ///< stored in-plane stiffness
+        typedef shell::misc::SymmetricMatrix<9, Real> StiffnessMatrixBendingPacked;     ///< stored bending stiffness
+        typedef shell::misc::MixedSymmetricMatrix<6, Real> StiffnessMatrixStored;       ///< in-plane stiffness in the precision chosen by mixedPrecision
+        typedef shell::misc::MixedSymmetricMatrix<9, Real> StiffnessMatrixBendingStored;///< bending stiffness in the precision chosen by mixedPrecision
 
         sofa::core::topology::BaseMeshTopology* _topology;
 
@@ -115,10 +124,11 @@ public:
                 Vec3 localB, localC;
                 // Transformation rotation;
                 Quat Qframe;
-                // Stiffness matrix K = J * M * Jt
-                StiffnessMatrix stiffnessMatrix;
-                // Stiffness matrix for bending K = Jt * M * J
-                StiffnessMatrixBending stiffnessMatrixBending;
+                // Stiffness matrix K = J * M * Jt (symmetric, packed, in
+                // single precision with mixedPrecision)
+                StiffnessMatrixStored stiffnessMatrix;
+                // Stiffness matrix for bending K = Jt * M * J (idem)
+                StiffnessMatrixBendingStored stiffnessMatrixBending;
 
                 // Surface
                 Real area;
@@ -128,6 +138,9 @@ public:
                 Vec<9, Real> coefficients; // coefficients Ci computed from tinfo->invC * (tinfo->u + tinfo->u_flat)
                 Vec <9, Real> u_rest; // difference between the initial position and the flate position to allow the use of an initial deformed shape
 
+                // Frame rotation and element forces of the last force evaluation
+                shell::misc::GeometricStiffness<Real> geometric;
+
                 TriangleInformation() { }
 
                 /// Output stream
@@ -166,15 +179,24 @@ public:
         void addDForce(const sofa::core::MechanicalParams* /*mparams*/, DataVecDeriv& datadF, const DataVecDeriv& datadX ) override ;
         void addKToMatrix(const sofa::core::MechanicalParams* mparams, const sofa::core::behavior::MultiMatrixAccessor* matrix) override;
         void addBToMatrix(sofa::linearalgebra::BaseMatrix * /*mat*/, double /*bFact*/, unsigned int &/*offset*/) override;
+        /// Strain energy computed by the last addForce(), x is not used
         double getPotentialEnergy(const VecCoord& x) const;
         void handleTopologyChange() override;
 
-        SReal getPotentialEnergy(const sofa::core::MechanicalParams* /*mparams*/, const DataVecCoord& /*x*/) const override { return 0; }
+        /// Strain energy of the positions passed to the last addForce()
+        SReal getPotentialEnergy(const sofa::core::MechanicalParams* /*mparams*/, const DataVecCoord& /*x*/) const override { return m_potentialEnergy; }
+
+        typedef shell::misc::BlockDiagonal<6,Real> NodeBlockDiagonal;
+
+        /// Add kFactor times the node diagonal blocks of the stiffness matrix
+        /// (as assembled by addKToMatrix) into blocks, without assembling it
+        void addNodeBlockDiagonal(NodeBlockDiagonal &blocks, const Real kFactor, const bool parallel);
 
         void draw(const sofa::core::visual::VisualParams* vparams) override;
 
         sofa::core::topology::BaseMeshTopology* getTopology() {return _topology;}
         TriangleData< sofa::type::vector<TriangleInformation> >& getTriangleInfo() {return triangleInfo;}
+        const shell::misc::SubdivisionHierarchy& getRefinementHierarchy() const {return m_refinementHierarchy;}
 
         sofa::Data<Real> d_poisson;
         sofa::Data<Real> d_young;
@@ -189,6 +211,8 @@ public:
             sofa::BaseLink::FLAG_STOREPATH|sofa::BaseLink::FLAG_STRONGLINK> l_targetTopology;
         VecCoordHigh m_targetVertices;
         SeqTriangles m_targetTriangles;
+        // Nested meshes between the simulated mesh and the refined one
+        shell::misc::SubdivisionHierarchy m_refinementHierarchy;
 
         // Allow transition between rest shapes
         sofa::SingleLink<TriangularBendingFEMForceField<DataTypes>,
@@ -208,12 +232,30 @@ public:
         sofa::Data<bool> d_exportAtEnd;
         unsigned int m_stepCounter;
 
+        sofa::Data<bool> d_mixedPrecision;
+        sofa::Data<bool> d_checkMixedPrecision;
+        sofa::Data<Real> d_mixedPrecisionError;
+        sofa::Data<bool> d_geometricStiffness;
+
         TRQSTriangleHandler* m_triangleHandler;
 
 protected :
 
         TriangleData< sofa::type::vector<TriangleInformation> > triangleInfo;
 
+        // Difference between single and full precision element forces
+        shell::misc::MixedPrecisionError m_mixedError;
+
+        // Strain energy computed by the last addForce()
+        SReal m_potentialEnergy;
+
+        // Geometric stiffness requested for the last addForce()
+        bool m_geometricStiffness;
+
+        // With mixedPrecision, the stiffness matrices of the rest shape are
+        // built once by initTriangle() in single precision and reused
+        bool m_singleStiffness;
+
         void computeDisplacement(Displacement &Disp, const VecCoord &x, const Index elementIndex);
         void computeDisplacementBending(DisplacementBending &Disp, const VecCoord &x, const Index elementIndex);
         void computeStrainDisplacementMatrix(StrainDisplacement &J, const Index elementIndex, const Vec3& b, const Vec3& c);
@@ -221,6 +263,8 @@ protected :
         void tensorFlatPlate(Mat<3, 9, Real>& D, const Vec3 &P);
         void computeStiffnessMatrix(StiffnessMatrix &K, const StrainDisplacement &J, const MaterialStiffness &M);
         void computeStiffnessMatrixBending(StiffnessMatrixBending &K, TriangleInformation *tinfo);
+        void computeRestStiffnessMatrix(StiffnessMatrix &K, const Index elementIndex);
+        void computeRestStiffnessMatrixBending(StiffnessMatrixBending &K_bending, const Index elementIndex);
         void computeForce(Displacement &F, const Displacement& D, const Index elementIndex);
         void computeForceBending(DisplacementBending &F, const DisplacementBending& D, const Index elementIndex);
 
@@ -233,13 +277,11 @@ protected :
         void initTriangleOnce(const int i, const Index&a, const Index&b, const Index&c);
         void initTriangle(const int i);
         void computeRotation(Quat &Qframe, const VecCoord &p, const Index &a, const Index &b, const Index &c);
-        void accumulateForce(VecDeriv& f, const VecCoord & p, const Index elementIndex);
+        void accumulateForce(VecDeriv& f, const VecCoord & p, const Index elementIndex, SReal &energy);
 
         void convertStiffnessMatrixToGlobalSpace(StiffnessMatrixGlobalSpace &K_gs, TriangleInformation *tinfo);
 
         void refineCoarseMeshToTarget(void);
-        void subdivide(const Vec3& a, const Vec3& b, const Vec3& c, sofa::type::vector<Vec3> &subVertices, SeqTriangles &subTriangles);
-        void addVertexAndFindIndex(sofa::type::vector<Vec3> &subVertices, const Vec3 &vertex, int &index);
         void movePoint(Vec3& pointToMove);
         void findClosestGravityPoints(const Vec3& point, sofa::type::vector<Vec3>& listClosestPoints);
 
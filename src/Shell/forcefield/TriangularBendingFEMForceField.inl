@@ -59,8 +59,8 @@ void TriangularBendingFEMForceField<DataTypes>::TRQSTriangleHandler::applyCreate
     if (ff)
     {
         ff->initTriangleOnce(triangleIndex, t[0], t[1], t[2]);
-        ff->initTriangle(triangleIndex);
         ff->computeMaterialStiffness(triangleIndex);
+        ff->initTriangle(triangleIndex);
     }
 }
 
@@ -87,9 +87,16 @@ TriangularBendingFEMForceField<DataTypes>::TriangularBendingFEMForceField()
 , d_exportAtBegin(initData(&d_exportAtBegin, false, "exportAtBegin", "export file at the initialization"))
 , d_exportAtEnd(initData(&d_exportAtEnd, false, "exportAtEnd", "export file when the simulation is finished"))
 , m_stepCounter(0)
+, d_mixedPrecision(initData(&d_mixedPrecision, false, "mixedPrecision", "Build the element stiffness matrices of the rest shape once, in single precision only, and compute element forces with them instead of updating them with the current shape"))
+, d_checkMixedPrecision(initData(&d_checkMixedPrecision, false, "checkMixedPrecision", "Also compute element forces with full precision matrices of the rest shape, computed again for each element, and report the difference"))
+, d_mixedPrecisionError(initData(&d_mixedPrecisionError, (Real)0, "mixedPrecisionError", "Relative difference between single and full precision element forces in the last addForce"))
+, d_geometricStiffness(initData(&d_geometricStiffness, false, "geometricStiffness", "Add the geometric (initial stress) stiffness due to the rotation of the element frames to the tangent stiffness"))
 , triangleInfo(initData(&triangleInfo, "triangleInfo", "Internal triangle data"))
 {
     m_triangleHandler = new TRQSTriangleHandler(this, &triangleInfo);
+    m_potentialEnergy = 0;
+    m_geometricStiffness = false;
+    m_singleStiffness = false;
 }
 
 // --------------------------------------------------------------------------------------
@@ -171,19 +178,17 @@ void TriangularBendingFEMForceField<DataTypes>::refineCoarseMeshToTarget(void)
     // List of triangles
     const SeqTriangles triangles = _topology->getTriangles();
 
-    // Creates new mesh
-    sofa::type::vector<Vec3> subVertices;
-    SeqTriangles subTriangles;
+    // Builds the nested meshes, each level subdivides every triangle of the
+    // previous one into 4
+    const int iterations = std::max(d_iterations.getValue(), 0);
+    m_refinementHierarchy.build((sofa::Size)x.size(), triangles, (unsigned int)iterations);
 
-    // Initialises list of subvertices and triangles
+    // Initialises list of subvertices
+    sofa::type::vector<Vec3> subVertices;
     for (unsigned int i=0; i<x.size(); i++)
     {
         subVertices.push_back(x[i].getCenter());
     }
-    for (unsigned int t=0; t<triangles.size(); t++)
-    {
-        subTriangles.push_back(triangles[t]);
-    }
 
     // Adjusts position of each subvertex to get closer to actual surface before iterating again
     for (unsigned int i=0; i<subVertices.size(); i++)
@@ -191,20 +196,13 @@ void TriangularBendingFEMForceField<DataTypes>::refineCoarseMeshToTarget(void)
         movePoint(subVertices[i]);
     }
 
-
     // Refines mesh
-    for (int n=0; n<d_iterations.getValue(); n++)
+    for (int n=1; n<=iterations; n++)
     {
-        // Subdivides each triangle into 4 smaller ones
-        subTriangles.clear();
-        for (unsigned int t=0; t<triangles.size(); t++)
-        {
-            Vec3 a = subVertices[(int)triangles[t][0]];
-            Vec3 b = subVertices[(int)triangles[t][1]];
-            Vec3 c = subVertices[(int)triangles[t][2]];
-
-            subdivide(a, b, c, subVertices, subTriangles);
-        }
+        // Places the new vertices in the middle of the subdivided edges
+        sofa::type::vector<Vec3> coarseVertices;
+        coarseVertices.swap(subVertices);
+        m_refinementHierarchy.prolongate(n, coarseVertices, subVertices);
 
         // Adjusts position of each subvertex to get closer to actual surface before iterating again
         for (unsigned int i=0; i<subVertices.size(); i++)
@@ -213,6 +211,7 @@ void TriangularBendingFEMForceField<DataTypes>::refineCoarseMeshToTarget(void)
         }
     }
 
+    const SeqTriangles& subTriangles = m_refinementHierarchy.getFinestLevel().triangles;
 
     msg_info() << "Number of vertices of the resulting mesh = " << subVertices.size();
     msg_info() << "Number of shells of the resulting mesh   = " << subTriangles.size();
@@ -232,62 +231,6 @@ void TriangularBendingFEMForceField<DataTypes>::refineCoarseMeshToTarget(void)
     msg_info() << "Mesh written in mesh_refined.obj";
 }
 
-// --------------------------------------------------------------------------------------
-// Subdivides each triangle into 4 by taking the middle of each edge
-// --------------------------------------------------------------------------------------
-template <class DataTypes>
-void TriangularBendingFEMForceField<DataTypes>::subdivide(const Vec3& a, const Vec3& b, const Vec3& c, sofa::type::vector<Vec3> &subVertices, SeqTriangles &subTriangles)
-{
-    // Global coordinates
-    Vec3 mAB, mAC, mBC;
-    mAB = (a+b)/2;
-    mAC = (a+c)/2;
-    mBC = (b+c)/2;
-
-    // Adds vertex if we deal with a new point
-    int indexAB, indexAC, indexBC;
-    addVertexAndFindIndex(subVertices, mAB, indexAB);
-    addVertexAndFindIndex(subVertices, mAC, indexAC);
-    addVertexAndFindIndex(subVertices, mBC, indexBC);
-
-    // Finds index of the 3 original vertices
-    int indexA, indexB, indexC;
-    addVertexAndFindIndex(subVertices, a, indexA);
-    addVertexAndFindIndex(subVertices, b, indexB);
-    addVertexAndFindIndex(subVertices, c, indexC);
-
-    // Adds the 4 subdivided triangles to the list
-    subTriangles.push_back(Triangle(indexA, indexAB, indexAC));
-    subTriangles.push_back(Triangle(indexAB, indexB, indexBC));
-    subTriangles.push_back(Triangle(indexAC, indexBC, indexC));
-    subTriangles.push_back(Triangle(indexBC, indexAC, indexAB));
-}
-
-
-// --------------------------------------------------------------------------------------
-// Adds a vertex if it is not already in the list
-// --------------------------------------------------------------------------------------
-template <class DataTypes>
-void TriangularBendingFEMForceField<DataTypes>::addVertexAndFindIndex(sofa::type::vector<Vec3> &subVertices, const Vec3 &vertex, int &index)
-{
-    bool alreadyHere = false;
-
-    for (unsigned int v=0; v<subVertices.size(); v++)
-    {
-        if ( (subVertices[v]-vertex).norm() < 0.0000001)
-        {
-            alreadyHere = true;
-            index = v;
-        }
-    }
-    if (alreadyHere == false)
-    {
-        subVertices.push_back(vertex);
-        index = (int)subVertices.size()-1;
-    }
-}
-
-
 template <class DataTypes>
 void TriangularBendingFEMForceField<DataTypes>::movePoint(Vec3& pointToMove)
 {
@@ -371,6 +314,8 @@ template <class DataTypes>void TriangularBendingFEMForceField<DataTypes>::reinit
         }
     }
 
+    m_singleStiffness = d_mixedPrecision.getValue();
+
     /// Prepare to store info in the triangle array
     triangleInf.resize(_topology->getNbTriangles());
 
@@ -389,8 +334,7 @@ template <class DataTypes>void TriangularBendingFEMForceField<DataTypes>::reinit
 template <class DataTypes>
 double TriangularBendingFEMForceField<DataTypes>::getPotentialEnergy(const VecCoord& /*x*/) const
 {
-    msg_warning() << "TriangularBendingFEMForceField::getPotentialEnergy is not implemented.";
-    return 0;
+    return m_potentialEnergy;
 }
 
 
@@ -535,6 +479,21 @@ void TriangularBendingFEMForceField<DataTypes>::initTriangle(const int i)
 
     }
 
+    if (m_singleStiffness)
+    {
+        // The matrices of the rest shape are kept, in single precision
+        StiffnessMatrix K;
+        computeRestStiffnessMatrix(K, i);
+        tinfo->stiffnessMatrix.set(StiffnessMatrixPacked(K), true);
+
+        if (d_bending.getValue())
+        {
+            StiffnessMatrixBending K_bending;
+            computeRestStiffnessMatrixBending(K_bending, i);
+            tinfo->stiffnessMatrixBending.set(StiffnessMatrixBendingPacked(K_bending), true);
+        }
+    }
+
     triangleInfo.endEdit();
 }
 
@@ -617,6 +576,15 @@ void TriangularBendingFEMForceField<DataTypes>::applyStiffness(VecDeriv& v, cons
         v[c] += Deriv(-fc1, -fc2) * kFactor;
     }
 
+    // Rotation of the element forces with the frame
+    if (m_geometricStiffness)
+    {
+        const Vec3 theta = tinfo->geometric.spin(getVCenter(dx[a]), getVCenter(dx[b]), getVCenter(dx[c]));
+        v[a] += Deriv(tinfo->geometric.dForce(0, theta), tinfo->geometric.dMoment(0, theta)) * kFactor;
+        v[b] += Deriv(tinfo->geometric.dForce(1, theta), tinfo->geometric.dMoment(1, theta)) * kFactor;
+        v[c] += Deriv(tinfo->geometric.dForce(2, theta), tinfo->geometric.dMoment(2, theta)) * kFactor;
+    }
+
 
     triangleInfo.endEdit();
 }
@@ -890,6 +858,20 @@ void TriangularBendingFEMForceField<DataTypes>::computeForce(Displacement &F, co
     sofa::type::vector<TriangleInformation>& triangleInf = *(triangleInfo.beginEdit());
     TriangleInformation *tinfo = &triangleInf[elementIndex];
 
+    if (m_singleStiffness)
+    {
+        // Single precision matrix of the rest shape, built by initTriangle()
+        F = tinfo->stiffnessMatrix.single() * D;
+        if (d_checkMixedPrecision.getValue())
+        {
+            StiffnessMatrix K;
+            computeRestStiffnessMatrix(K, elementIndex);
+            m_mixedError.add(F, Displacement(K * D));
+        }
+        triangleInfo.endEdit();
+        return;
+    }
+
     // Compute strain-displacement matrix J
     StrainDisplacement J;
     computeStrainDisplacementMatrix(J, elementIndex, tinfo->localB, tinfo->localC);
@@ -898,7 +880,7 @@ void TriangularBendingFEMForceField<DataTypes>::computeForce(Displacement &F, co
     // Compute stiffness matrix K = J*material*Jt
     StiffnessMatrix K;
     computeStiffnessMatrix(K, J, tinfo->materialMatrix);
-    tinfo->stiffnessMatrix = K;
+    tinfo->stiffnessMatrix.set(StiffnessMatrixPacked(K), false);
 
     // Compute forces
     F = K * D;
@@ -916,6 +898,20 @@ void TriangularBendingFEMForceField<DataTypes>::computeForceBending(Displacement
     sofa::type::vector<TriangleInformation>& triangleInf = *(triangleInfo.beginEdit());
     TriangleInformation *tinfo = &triangleInf[elementIndex];
 
+    if (m_singleStiffness)
+    {
+        // Single precision matrix of the rest shape, built by initTriangle()
+        F_bending = tinfo->stiffnessMatrixBending.single() * D_bending;
+        if (d_checkMixedPrecision.getValue())
+        {
+            StiffnessMatrixBending K_bending;
+            computeRestStiffnessMatrixBending(K_bending, elementIndex);
+            m_mixedError.add(F_bending, DisplacementBending(K_bending * D_bending));
+        }
+        triangleInfo.endEdit();
+        return;
+    }
+
     // Compute strain-displacement matrix J
     computeStrainDisplacementMatrixBending(tinfo, tinfo->localB, tinfo->localC);
 
@@ -924,7 +920,7 @@ void TriangularBendingFEMForceField<DataTypes>::computeForceBending(Displacement
     computeStiffnessMatrixBending(K_bending, tinfo);
     Real t = d_thickness.getValue();
     K_bending *= t*t*t*(triangleInf[elementIndex].area)/3;
-    tinfo->stiffnessMatrixBending = K_bending;
+    tinfo->stiffnessMatrixBending.set(StiffnessMatrixBendingPacked(K_bending), false);
 
     // Compute forces
     F_bending = K_bending * D_bending;
@@ -932,11 +928,48 @@ void TriangularBendingFEMForceField<DataTypes>::computeForceBending(Displacement
     triangleInfo.endEdit();
 }
 
+// --------------------------------------------------------------------------------------
+// ---  Stiffness matrices of the rest shape, in full precision
+// --------------------------------------------------------------------------------------
+template <class DataTypes>
+void TriangularBendingFEMForceField<DataTypes>::computeRestStiffnessMatrix(StiffnessMatrix &K, const Index elementIndex)
+{
+    sofa::type::vector<TriangleInformation>& triangleInf = *(triangleInfo.beginEdit());
+    TriangleInformation *tinfo = &triangleInf[elementIndex];
+
+    // computeStrainDisplacementMatrix() also sets the area, keep the one
+    // of the current shape
+    const Real area = tinfo->area;
+    StrainDisplacement J;
+    computeStrainDisplacementMatrix(J, elementIndex, tinfo->restLocalPositions[0], tinfo->restLocalPositions[1]);
+    tinfo->area = area;
+
+    computeStiffnessMatrix(K, J, tinfo->materialMatrix);
+
+    triangleInfo.endEdit();
+}
+
+template <class DataTypes>
+void TriangularBendingFEMForceField<DataTypes>::computeRestStiffnessMatrixBending(StiffnessMatrixBending &K_bending, const Index elementIndex)
+{
+    // On a copy, the strain-displacement matrices of the element are those
+    // of its current shape
+    TriangleInformation rest = triangleInfo.getValue()[elementIndex];
+    const Vec3 &b = rest.restLocalPositions[0];
+    const Vec3 &c = rest.restLocalPositions[1];
+    computeStrainDisplacementMatrixBending(&rest, b, c);
+
+    computeStiffnessMatrixBending(K_bending, &rest);
+    const Real t = d_thickness.getValue();
+    const Real restArea = b[0]*c[1] / 2;
+    K_bending *= t*t*t*restArea/3;
+}
+
 // --------------------------------------------------------------------------------------
 // ---
 // --------------------------------------------------------------------------------------
 template <class DataTypes>
-void TriangularBendingFEMForceField<DataTypes>::accumulateForce(VecDeriv &f, const VecCoord &x, const Index elementIndex)
+void TriangularBendingFEMForceField<DataTypes>::accumulateForce(VecDeriv &f, const VecCoord &x, const Index elementIndex, SReal &energy)
 {
     sofa::type::vector<TriangleInformation>& triangleInf = *(triangleInfo.beginEdit());
     TriangleInformation *tinfo = &triangleInf[elementIndex];
@@ -959,11 +992,18 @@ void TriangularBendingFEMForceField<DataTypes>::accumulateForce(VecDeriv &f, con
     Displacement F;
     computeForce(F, D, elementIndex);
 
+    // Strain energy 1/2 u^T K u in the corotational frame
+    energy += (D * F) / 2;
+
     // Transform forces back into global reference frame
     getVCenter(f[a]) -= tinfo->Qframe.inverseRotate(Vec3(F[0], F[1], 0));
     getVCenter(f[b]) -= tinfo->Qframe.inverseRotate(Vec3(F[2], F[3], 0));
     getVCenter(f[c]) -= tinfo->Qframe.inverseRotate(Vec3(F[4], F[5], 0));
 
+    // Element forces in the local frame for the geometric stiffness
+    Vec3 Fl[3] = { Vec3(F[0], F[1], 0), Vec3(F[2], F[3], 0), Vec3(F[4], F[5], 0) };
+    Vec3 Ml[3];
+
     if (d_bending.getValue())
     {
         // Compute bending displacement for bending into the triangle's frame
@@ -973,6 +1013,7 @@ void TriangularBendingFEMForceField<DataTypes>::accumulateForce(VecDeriv &f, con
         // Compute bending forces on this element (in the co-rotational space)
         DisplacementBending F_bending;
         computeForceBending(F_bending, D_bending, elementIndex);
+        energy += (D_bending * F_bending) / 2;
 
         // Transform forces back into global reference frame
         Vec3 fa1 = tinfo->Qframe.inverseRotate(Vec3(0.0, 0.0, F_bending[0]));
@@ -987,6 +1028,19 @@ void TriangularBendingFEMForceField<DataTypes>::accumulateForce(VecDeriv &f, con
         f[a] += Deriv(-fa1, -fa2);
         f[b] += Deriv(-fb1, -fb2);
         f[c] += Deriv(-fc1, -fc2);
+
+        for (unsigned int i=0; i<3; i++) {
+            Fl[i][2] = F_bending[3*i];
+            Ml[i] = Vec3(F_bending[3*i+1], F_bending[3*i+2], 0);
+        }
+    }
+
+    if (m_geometricStiffness) {
+        Transformation R;
+        tinfo->Qframe.toMatrix(R);
+        tinfo->geometric.setEdgeFrame(sofa::type::fixed_array<Vec3,3>(Vec3(0,0,0), tinfo->localB, tinfo->localC), R);
+        for (unsigned int i=0; i<3; i++)
+            tinfo->geometric.setForce(i, tinfo->Qframe.inverseRotate(Fl[i]), tinfo->Qframe.inverseRotate(Ml[i]));
     }
 
     triangleInfo.endEdit();
@@ -1005,10 +1059,21 @@ void TriangularBendingFEMForceField<DataTypes>::addForce(const sofa::core::Mecha
     int nbTriangles=_topology->getNbTriangles();
     f.resize(p.size());
 
+    const bool checkMixed = m_singleStiffness && d_checkMixedPrecision.getValue();
+    if (checkMixed)
+        m_mixedError.clear();
+
+    m_geometricStiffness = d_geometricStiffness.getValue();
+
+    SReal energy = 0;
     for (int i=0; i<nbTriangles; i++)
     {
-        accumulateForce(f, p, i);
+        accumulateForce(f, p, i, energy);
     }
+    m_potentialEnergy = energy;
+
+    if (checkMixed)
+        d_mixedPrecisionError.setValue((Real)m_mixedError.relative());
 
     dataF.endEdit();
 }
@@ -1040,7 +1105,7 @@ template<class DataTypes>
 void TriangularBendingFEMForceField<DataTypes>::convertStiffnessMatrixToGlobalSpace(StiffnessMatrixGlobalSpace &K_gs, TriangleInformation *tinfo)
 {
     // Stiffness matrix of current triangle
-    const StiffnessMatrix &K = tinfo->stiffnessMatrix;
+    const StiffnessMatrixPacked K = tinfo->stiffnessMatrix.toFull();
 
     // Firstly, add all degrees of freedom (we add the unused translation in z)
     StiffnessMatrixGlobalSpace K_18x18;
@@ -1063,7 +1128,7 @@ void TriangularBendingFEMForceField<DataTypes>::convertStiffnessMatrixToGlobalSp
             {
                 for (unsigned int j=0; j<2; j++)
                 {
-                    K_18x18[ig+i][jg+j] = K[2*bx+i][2*by+j];
+                    K_18x18[ig+i][jg+j] = K(2*bx+i, 2*by+j);
                 }
             }
         }
@@ -1073,7 +1138,7 @@ void TriangularBendingFEMForceField<DataTypes>::convertStiffnessMatrixToGlobalSp
     if (d_bending.getValue())
     {
         // Stiffness matrix in bending of current triangle
-        const StiffnessMatrixBending &K_bending = tinfo->stiffnessMatrixBending;
+        const StiffnessMatrixBendingPacked K_bending = tinfo->stiffnessMatrixBending.toFull();
 
         // Copy the stiffness matrix by block 3x3 into global matrix (the new index of each bloc into global matrix is a combination of 2, 8 and 15 in indices)
         for (unsigned int bx=0; bx<3; bx++)
@@ -1091,7 +1156,7 @@ void TriangularBendingFEMForceField<DataTypes>::convertStiffnessMatrixToGlobalSp
                 {
                     for (unsigned int j=0; j<3; j++)
                     {
-                        K_18x18[ig+i][jg+j] += K_bending[3*bx+i][3*by+j];
+                        K_18x18[ig+i][jg+j] += K_bending(3*bx+i, 3*by+j);
                     }
                 }
 
@@ -1105,19 +1170,8 @@ void TriangularBendingFEMForceField<DataTypes>::convertStiffnessMatrixToGlobalSp
     tinfo->Qframe.toMatrix(R);
     Rt.transpose(R);
 
-    StiffnessMatrixGlobalSpace R18x18, Rt18x18;
-
-    for(unsigned int i=0;i<3;++i)
-    {
-        for(unsigned int j=0;j<3;++j)
-        {
-            R18x18[i][j] = R18x18[i+3][j+3] = R18x18[i+6][j+6] = R18x18[i+9][j+9] = R18x18[i+12][j+12] = R18x18[i+15][j+15] = R[i][j];
-            Rt18x18[i][j] = Rt18x18[i+3][j+3] = Rt18x18[i+6][j+6] = Rt18x18[i+9][j+9] = Rt18x18[i+12][j+12] = Rt18x18[i+15][j+15] = Rt[i][j];
-        }
-    }
-
     // Then we put the stifness matrix into the global frame
-    K_gs = Rt18x18 * K_18x18 * R18x18;
+    shell::misc::rotateSymmetric18(K_gs, K_18x18, R, Rt);
 
 }
 
@@ -1127,9 +1181,6 @@ void TriangularBendingFEMForceField<DataTypes>::addKToMatrix(const sofa::core::M
     StiffnessMatrixGlobalSpace K_gs;
 
     // Build Matrix Block for this ForceField
-    unsigned int i, j ,n1, n2, row, column, ROW, COLUMN;
-    Index node1, node2;
-
     sofa::core::behavior::MultiMatrixAccessor::MatrixRef r = matrix->getMatrix(this->mstate);
     sofa::type::vector<TriangleInformation>& triangleInf = *(triangleInfo.beginEdit());
 
@@ -1142,34 +1193,42 @@ void TriangularBendingFEMForceField<DataTypes>::addKToMatrix(const sofa::core::M
 
             convertStiffnessMatrixToGlobalSpace(K_gs, tinfo);
 
-            // find index of node 1
-            for (n1=0; n1<3; n1++)
-            {
-                    node1 = triangle[n1];
+            shell::misc::addSymmetricElementMatrix(r.matrix, r.offset, triangle, K_gs, (Real)-kFactor);
 
-                    for(i=0; i<6; i++)
-                    {
-                            ROW = r.offset+6*node1+i;
-                            row = 6*n1+i;
-                            // find index of node 2
-                            for (n2=0; n2<3; n2++)
-                            {
-                                    node2 = triangle[n2];
-
-                                    for (j=0; j<6; j++)
-                                    {
-                                            COLUMN = r.offset+6*node2+j;
-                                            column = 6*n2+j;
-                                            r.matrix->add(ROW, COLUMN, - K_gs[row][column] * kFactor);
-                                    }
-                            }
-                    }
-            }
+            if (m_geometricStiffness)
+                tinfo->geometric.addToMatrix(r.matrix, r.offset, triangle, (Real)kFactor);
     }
 
     triangleInfo.endEdit();
 }
 
+template<class DataTypes>
+void TriangularBendingFEMForceField<DataTypes>::addNodeBlockDiagonal(NodeBlockDiagonal &blocks, const Real kFactor, const bool parallel)
+{
+    const sofa::type::vector<TriangleInformation>& ti = triangleInfo.getValue();
+    const bool bending = d_bending.getValue();
+
+    // Position of the membrane (u, v) and bending (w, θx, θy) dofs in the
+    // node block
+    const unsigned int membraneDofs[2] = { 0, 1 };
+    const unsigned int bendingDofs[3] = { 2, 3, 4 };
+
+    shell::misc::accumulateNodeBlocks(blocks, _topology, parallel,
+        [&](Mat<6,6,Real> &block, Index t, unsigned int j) {
+            const TriangleInformation &tinfo = ti[t];
+
+            Mat<6,6,Real> local;
+            local.clear();
+            shell::misc::addElementNodeBlock(local, tinfo.stiffnessMatrix, 2, j, membraneDofs);
+            if (bending)
+                shell::misc::addElementNodeBlock(local, tinfo.stiffnessMatrixBending, 3, j, bendingDofs);
+
+            Transformation R;
+            tinfo.Qframe.toMatrix(R);
+            shell::misc::addRotatedNodeBlock(block, local, R, -kFactor);
+        });
+}
+
 
 template<class DataTypes>
 void TriangularBendingFEMForceField<DataTypes>::addBToMatrix(sofa::linearalgebra::BaseMatrix * /*mat*/, double /*bFact*/, unsigned int &/*offset*/)
@@ -0,0 +1,157 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <Shell/forcefield/TriangularShellForceField.h>
+
+#include <Shell/config.h>
+
+namespace shell::forcefield
+{
+
+/**
+ * @brief TriangularShellForceField simulating several material variants
+ * (Young modulus, Poisson ratio, thickness) of the same mesh at once.
+ *
+ * The mechanical state holds nbVariants copies of the mesh, variant after
+ * variant: node i of variant v is v*nbPoints + i. If it only holds the
+ * mesh, it is replicated at init. All variants share the rest shape, the
+ * elements and the frames computed from the first copy.
+ *
+ * The element stiffness matrices are linear in the material matrix
+ * E/(1-nu^2) [1 nu 0; nu 1 0; 0 0 (1-nu)/2], each element keeps them for
+ * the two terms of this matrix (and for the higher order stiffness of the
+ * ANDES membranes, which scales with the thickness), the variants only
+ * differ by the factors these matrices are combined with. The element
+ * kernels work on lanes, arrays holding the value of one dof for all the
+ * variants next to each other, and their inner loops run over the variants
+ * so that they can be vectorised.
+ *
+ * Each variant can be extracted as an ordinary state with
+ * EnsembleVariantMapping.
+ */
+template<class DataTypes>
+class TriangularShellEnsembleForceField : public sofa::component::forcefield::TriangularShellForceField<DataTypes>
+{
+public:
+    SOFA_CLASS(SOFA_TEMPLATE(TriangularShellEnsembleForceField,DataTypes), SOFA_TEMPLATE(sofa::component::forcefield::TriangularShellForceField,DataTypes));
+
+    typedef sofa::component::forcefield::TriangularShellForceField<DataTypes> Inherited;
+    typedef typename Inherited::Real Real;
+    typedef typename Inherited::Vec3 Vec3;
+    typedef typename Inherited::Quat Quat;
+    typedef typename Inherited::VecCoord VecCoord;
+    typedef typename Inherited::VecDeriv VecDeriv;
+    typedef typename Inherited::DataVecCoord DataVecCoord;
+    typedef typename Inherited::DataVecDeriv DataVecDeriv;
+    typedef typename Inherited::Triangle Triangle;
+    typedef typename Inherited::TriangleInformation TriangleInformation;
+    typedef typename Inherited::NodeBlockDiagonal NodeBlockDiagonal;
+    typedef sofa::Index Index;
+
+protected:
+
+    typedef typename Inherited::MaterialStiffness MaterialStiffness;
+    typedef typename Inherited::Transformation Transformation;
+    typedef typename Inherited::StiffnessMatrix StiffnessMatrix;
+    typedef typename Inherited::StiffnessMatrixFull StiffnessMatrixFull;
+    typedef typename Inherited::StiffnessMatrixPacked StiffnessMatrixPacked;
+
+    TriangularShellEnsembleForceField();
+
+    virtual ~TriangularShellEnsembleForceField();
+
+public:
+
+    void reinit() override;
+
+    void addForce(const sofa::core::MechanicalParams* mparams, DataVecDeriv& f, const DataVecCoord& x, const DataVecDeriv& v) override;
+    void addDForce(const sofa::core::MechanicalParams* mparams, DataVecDeriv& df, const DataVecDeriv& dx) override;
+    void addKToMatrix(const sofa::core::MechanicalParams* mparams, const sofa::core::behavior::MultiMatrixAccessor* matrix) override;
+
+    /// Node diagonal blocks of each variant, at the nodes of its copy of
+    /// the mesh
+    void addNodeBlockDiagonal(NodeBlockDiagonal &blocks, const Real kFactor, const bool parallel) override;
+
+    sofa::Data<unsigned int> d_nbVariants;
+    sofa::Data< sofa::type::vector<Real> > d_youngVariants;
+    sofa::Data< sofa::type::vector<Real> > d_poissonVariants;
+    sofa::Data< sofa::type::vector<Real> > d_thicknessVariants;
+    sofa::Data< sofa::type::vector<SReal> > d_variantEnergies;
+
+protected:
+
+    /// Element stiffness matrices for the two terms of the material matrix:
+    /// membrane, higher order membrane (ANDES) and bending
+    struct ElementBasis
+    {
+        StiffnessMatrixPacked membrane[4];
+        StiffnessMatrixPacked bending[2];
+    };
+    sofa::type::vector<ElementBasis> m_basis;
+
+    /// Number of membrane and bending matrices in use
+    unsigned int m_nbMembraneBasis, m_nbBendingBasis;
+
+    /// Factor of each basis matrix for each variant, on lanes
+    sofa::type::vector<Real> m_membraneFactors, m_bendingFactors;
+
+    Index m_nbVariants, m_nbPoints;
+
+    /// Element frames of the last addForce(), one lane per entry of the
+    /// 3x3 rotation
+    sofa::type::vector<Real> m_rotations;
+
+    // Lanes of an element: local displacements and forces (9 dofs each),
+    // node dofs in the element and global frames (18 each), one entry of
+    // the element matrix and the strain energy
+    sofa::type::vector<Real> m_laneDm, m_laneDb, m_laneFm, m_laneFb;
+    sofa::type::vector<Real> m_laneLocal, m_laneGlobal;
+    sofa::type::vector<Real> m_laneK, m_laneEnergy;
+
+    /// Element with the matrices and frame of one variant, for the assembly
+    TriangleInformation m_variantElement;
+
+    /// Make the mechanical state hold one copy of the mesh per variant,
+    /// return false if it cannot
+    bool replicateState();
+    void computeVariantFactors();
+    void computeBasis(sofa::type::vector<TriangleInformation> &ti);
+
+    /// Local displacements of element t for variant v, its frame is stored
+    /// in R
+    void computeDisplacement(const TriangleInformation &tinfo, const VecCoord &x, const Index v, Real *R);
+
+    /// Lanes F += K D with K the sum of the basis matrices times the
+    /// factors of each variant
+    void multiplyLanes(Real *F, const Real *D, const StiffnessMatrixPacked *basis, const Real *factors, const unsigned int nbBasis);
+
+    /// Lanes out = R in (or R^T in) for 3D vectors
+    void rotateLanes(Real *out, const Real *R, const Real *in, const bool transpose) const;
+
+    /// Split node dofs in the element frame into membrane and bending dofs,
+    /// and back
+    void splitLanes(Real *Dm, Real *Db, const Real *local) const;
+    void mergeLanes(Real *local, const Real *Fm, const Real *Fb) const;
+};
+
+} // namespace
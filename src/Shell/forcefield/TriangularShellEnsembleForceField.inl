@@ -0,0 +1,619 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <Shell/forcefield/TriangularShellEnsembleForceField.h>
+#include <Shell/forcefield/TriangularShellForceField.inl>
+#include <Shell/misc/BlockDiagonal.h>
+#include <Shell/misc/ParallelFor.h>
+#include <Shell/misc/SymmetricMatrix.h>
+
+#include <sofa/core/behavior/MultiMatrixAccessor.h>
+#include <sofa/core/MechanicalParams.h>
+
+#include <algorithm>
+
+namespace shell::forcefield
+{
+
+template<class DataTypes>
+TriangularShellEnsembleForceField<DataTypes>::TriangularShellEnsembleForceField()
+: d_nbVariants(initData(&d_nbVariants, 1u, "nbVariants", "Number of material variants simulated together"))
+, d_youngVariants(initData(&d_youngVariants, "youngModuli", "Young modulus of each variant, youngModulus for the variants not listed"))
+, d_poissonVariants(initData(&d_poissonVariants, "poissonRatios", "Poisson ratio of each variant, poissonRatio for the variants not listed"))
+, d_thicknessVariants(initData(&d_thicknessVariants, "thicknesses", "Thickness of each variant, thickness for the variants not listed"))
+, d_variantEnergies(initData(&d_variantEnergies, "variantEnergies", "Strain energy of each variant in the last addForce"))
+, m_nbMembraneBasis(0)
+, m_nbBendingBasis(0)
+, m_nbVariants(1)
+, m_nbPoints(0)
+{
+    d_variantEnergies.setReadOnly(true);
+}
+
+template<class DataTypes>
+TriangularShellEnsembleForceField<DataTypes>::~TriangularShellEnsembleForceField()
+{
+}
+
+template<class DataTypes>
+void TriangularShellEnsembleForceField<DataTypes>::reinit()
+{
+    m_basis.clear();
+    if (!this->_topology || !replicateState())
+        return;
+
+    // Elements and frames of the first variant
+    Inherited::reinit();
+
+    if (this->bMeasureStrain || this->bMeasureStress)
+    {
+        msg_warning() << "The measure is not computed for an ensemble.";
+        this->bMeasureStrain = this->bMeasureStress = false;
+    }
+    if (this->d_mixedPrecision.getValue() || this->d_laggedStiffness.getValue() || this->d_geometricStiffness.getValue()
+        || this->d_elementSleeping.getValue())
+        msg_warning() << "mixedPrecision, laggedStiffness, geometricStiffness and elementSleeping are ignored for an ensemble.";
+
+    const std::string membrane = this->d_membraneElement.getValue().getSelectedItem();
+    m_nbMembraneBasis = (membrane == "None") ? 0 : (membrane == "CST") ? 2 : 4;
+    m_nbBendingBasis = (this->d_bendingElement.getValue().getSelectedItem() == "None") ? 0 : 2;
+
+    computeVariantFactors();
+
+    sofa::type::vector<TriangleInformation> &ti = *this->triangleInfo.beginEdit();
+    computeBasis(ti);
+
+    // Start from the rest frames
+    const Index N = m_nbVariants;
+    m_rotations.resize(9*N*ti.size());
+    for (std::size_t t=0; t<ti.size(); t++)
+        for (unsigned int k=0; k<9; k++)
+            std::fill_n(&m_rotations[(9*t + k)*N], N, ti[t].R[k/3][k%3]);
+    this->triangleInfo.endEdit();
+
+    m_laneDm.resize(9*N); m_laneDb.resize(9*N);
+    m_laneFm.resize(9*N); m_laneFb.resize(9*N);
+    m_laneLocal.resize(18*N); m_laneGlobal.resize(18*N);
+    m_laneK.resize(N); m_laneEnergy.resize(N);
+
+    msg_info() << N << " variants of " << ti.size() << " elements.";
+}
+
+template<class DataTypes>
+bool TriangularShellEnsembleForceField<DataTypes>::replicateState()
+{
+    m_nbVariants = std::max(d_nbVariants.getValue(), 1u);
+    m_nbPoints = this->_topology->getNbPoints();
+
+    const Index N = m_nbVariants, n = m_nbPoints;
+    const Index size = this->mstate->getSize();
+    if (size == N*n)
+        return true;
+    if (size != n)
+    {
+        msg_error() << "The mechanical state has " << size << " nodes, expected " << n
+            << " (the mesh) or " << N*n << " (" << N << " copies of the mesh).";
+        return false;
+    }
+
+    this->mstate->resize(N*n);
+
+    const auto replicate = [&](auto &x) {
+        for (Index v=1; v<N; v++)
+            for (Index i=0; i<n; i++)
+                x[v*n + i] = x[i];
+    };
+
+    sofa::helper::WriteAccessor<DataVecCoord> x = *this->mstate->write(sofa::core::vec_id::write_access::position);
+    sofa::helper::WriteAccessor<DataVecCoord> x0 = *this->mstate->write(sofa::core::vec_id::write_access::restPosition);
+    sofa::helper::WriteAccessor<DataVecDeriv> v = *this->mstate->write(sofa::core::vec_id::write_access::velocity);
+    replicate(x);
+    replicate(x0);
+    replicate(v);
+
+    return true;
+}
+
+template<class DataTypes>
+void TriangularShellEnsembleForceField<DataTypes>::computeVariantFactors()
+{
+    const Index N = m_nbVariants;
+    const auto value = [](const sofa::type::vector<Real> &values, Index v, Real nominal) {
+        return v < values.size() ? values[v] : nominal;
+    };
+
+    // The ANDES-OPT higher order stiffness also depends on the Poisson
+    // ratio, its basis is computed for nu = 0
+    const bool andesOpt = (this->d_membraneElement.getValue().getSelectedItem() == "ANDES-OPT");
+
+    m_membraneFactors.resize(4*N);
+    m_bendingFactors.resize(2*N);
+    for (Index v=0; v<N; v++)
+    {
+        const Real E = value(d_youngVariants.getValue(), v, this->d_young.getValue());
+        const Real nu = value(d_poissonVariants.getValue(), v, this->d_poisson.getValue());
+        const Real t = value(d_thicknessVariants.getValue(), v, this->d_thickness.getValue());
+
+        const Real c = E / (1 - nu*nu);
+        const Real tb = this->d_isShellveryThin.getValue() ? t*t : t*t*t/12;
+        const Real beta = andesOpt ? Inherited::andesOptBeta0(nu) / Inherited::andesOptBeta0(0) : 1;
+
+        m_membraneFactors[0*N + v] = c*t;
+        m_membraneFactors[1*N + v] = c*t*nu;
+        m_membraneFactors[2*N + v] = c*t*t*beta;
+        m_membraneFactors[3*N + v] = c*t*t*beta*nu;
+        m_bendingFactors[0*N + v] = c*tb;
+        m_bendingFactors[1*N + v] = c*tb*nu;
+    }
+}
+
+template<class DataTypes>
+void TriangularShellEnsembleForceField<DataTypes>::computeBasis(sofa::type::vector<TriangleInformation> &ti)
+{
+    // The two terms of the material matrix, D = E/(1-nu^2) (D_0 + nu D_1)
+    const MaterialStiffness D[2] = {
+        MaterialStiffness(Vec3(1,0,0), Vec3(0,1,0), Vec3(0,0,0.5)),
+        MaterialStiffness(Vec3(0,1,0), Vec3(1,0,0), Vec3(0,0,-0.5))
+    };
+
+    m_basis.resize(ti.size());
+    for (unsigned int k=0; k<2; k++)
+    {
+        this->materialMatrixMembrane = D[k];
+        this->materialMatrixBending = D[k];
+        this->materialPoisson = 0;
+
+        // The ANDES membranes add the higher order stiffness times the
+        // thickness to the basic stiffness
+        for (unsigned int h=0; h<2; h++)
+        {
+            if (h == 1 && m_nbMembraneBasis < 4)
+                break;
+            this->materialThickness = (Real)h;
+
+            shell::misc::parallelForRange(this->d_parallelInit.getValue(), std::size_t(0), ti.size(),
+                [&](std::size_t begin, std::size_t end) {
+                    StiffnessMatrix K;
+                    for (std::size_t t=begin; t<end; t++) {
+                        // The element functions may write into the element
+                        TriangleInformation tinfo = ti[t];
+                        ElementBasis &basis = m_basis[t];
+
+                        K.clear();
+                        this->computeStiffnessMatrixMembrane(K, tinfo);
+                        if (h == 0) {
+                            basis.membrane[k].set(K);
+
+                            K.clear();
+                            this->computeStiffnessMatrixBending(K, tinfo);
+                            basis.bending[k].set(K);
+                        } else {
+                            basis.membrane[2+k].set(K - basis.membrane[k].toMat());
+                        }
+                    }
+                });
+        }
+    }
+
+    // Back to the nominal material
+    this->computeMaterialStiffness();
+}
+
+template<class DataTypes>
+void TriangularShellEnsembleForceField<DataTypes>::computeDisplacement(const TriangleInformation &tinfo, const VecCoord &x, const Index v, Real *R)
+{
+    const Index N = m_nbVariants;
+    const Index offset = v*m_nbPoints;
+    const Index nodes[3] = { offset + tinfo.a, offset + tinfo.b, offset + tinfo.c };
+
+    sofa::type::fixed_array<Vec3, 3> p;
+    for (unsigned int j=0; j<3; j++)
+        p[j] = x[nodes[j]].getCenter();
+
+    if (this->d_corotated.getValue()) {
+        const Vec3 center = (p[0] + p[1] + p[2])/3;
+        for (unsigned int j=0; j<3; j++)
+            p[j] -= center;
+    }
+
+    Transformation Rv;
+    this->computeRotation(Rv, p);
+    for (unsigned int k=0; k<9; k++)
+        R[k*N + v] = Rv[k/3][k%3];
+
+#ifdef CRQUAT
+    Quat Q; Q.fromMatrix(Rv);
+#endif
+    for (unsigned int j=0; j<3; j++)
+    {
+        const Vec3 u = Rv * p[j] - tinfo.restPositions[j];
+#ifdef CRQUAT
+        const Quat q = (Q * x[nodes[j]].getOrientation()) * tinfo.restOrientationsInv[j];
+#else
+        Transformation orientation;
+        x[nodes[j]].getOrientation().toMatrix(orientation);
+        Quat q; q.fromMatrix(Rv * orientation * tinfo.restOrientationsInv[j]);
+#endif
+        const Vec3 r = q.toEulerVector();
+
+        m_laneDm[(3*j+0)*N + v] = u[0];
+        m_laneDm[(3*j+1)*N + v] = u[1];
+        m_laneDm[(3*j+2)*N + v] = r[2];
+
+        m_laneDb[(3*j+0)*N + v] = u[2];
+        m_laneDb[(3*j+1)*N + v] = r[0];
+        m_laneDb[(3*j+2)*N + v] = r[1];
+    }
+}
+
+template<class DataTypes>
+void TriangularShellEnsembleForceField<DataTypes>::multiplyLanes(Real *F, const Real *D, const StiffnessMatrixPacked *basis, const Real *factors, const unsigned int nbBasis)
+{
+    const Index N = m_nbVariants;
+    Real *k = m_laneK.data();
+
+    // Walk the packed upper triangle, each entry of the element matrix is
+    // formed for all the variants and used at both of its positions
+    sofa::Size entry = 0;
+    for (unsigned int i=0; i<9; i++)
+    {
+        for (unsigned int j=i; j<9; j++, entry++)
+        {
+            bool zero = true;
+            for (unsigned int b=0; b<nbBasis; b++)
+            {
+                const Real kb = basis[b].data()[entry];
+                if (kb == 0)
+                    continue;
+
+                const Real *factor = factors + b*N;
+                if (zero) {
+                    for (Index v=0; v<N; v++)
+                        k[v] = factor[v] * kb;
+                    zero = false;
+                } else {
+                    for (Index v=0; v<N; v++)
+                        k[v] += factor[v] * kb;
+                }
+            }
+            if (zero)
+                continue;
+
+            Real *Fi = F + i*N;
+            const Real *Dj = D + j*N;
+            for (Index v=0; v<N; v++)
+                Fi[v] += k[v] * Dj[v];
+
+            if (j != i) {
+                Real *Fj = F + j*N;
+                const Real *Di = D + i*N;
+                for (Index v=0; v<N; v++)
+                    Fj[v] += k[v] * Di[v];
+            }
+        }
+    }
+}
+
+template<class DataTypes>
+void TriangularShellEnsembleForceField<DataTypes>::rotateLanes(Real *out, const Real *R, const Real *in, const bool transpose) const
+{
+    const Index N = m_nbVariants;
+    for (unsigned int i=0; i<3; i++)
+    {
+        Real *o = out + i*N;
+        std::fill_n(o, N, (Real)0);
+        for (unsigned int j=0; j<3; j++)
+        {
+            const Real *r = R + (transpose ? 3*j+i : 3*i+j)*N;
+            const Real *a = in + j*N;
+            for (Index v=0; v<N; v++)
+                o[v] += r[v] * a[v];
+        }
+    }
+}
+
+template<class DataTypes>
+void TriangularShellEnsembleForceField<DataTypes>::splitLanes(Real *Dm, Real *Db, const Real *local) const
+{
+    // Position of the membrane (u, v, θz) and bending (w, θx, θy) dofs in
+    // the node dofs
+    const unsigned int membraneDofs[3] = { 0, 1, 5 };
+    const unsigned int bendingDofs[3] = { 2, 3, 4 };
+
+    const Index N = m_nbVariants;
+    for (unsigned int j=0; j<3; j++)
+    {
+        for (unsigned int i=0; i<3; i++)
+        {
+            std::copy_n(local + (6*j + membraneDofs[i])*N, N, Dm + (3*j + i)*N);
+            std::copy_n(local + (6*j + bendingDofs[i])*N, N, Db + (3*j + i)*N);
+        }
+    }
+}
+
+template<class DataTypes>
+void TriangularShellEnsembleForceField<DataTypes>::mergeLanes(Real *local, const Real *Fm, const Real *Fb) const
+{
+    // Position of the membrane (u, v, θz) and bending (w, θx, θy) dofs in
+    // the node dofs
+    const unsigned int membraneDofs[3] = { 0, 1, 5 };
+    const unsigned int bendingDofs[3] = { 2, 3, 4 };
+
+    const Index N = m_nbVariants;
+    for (unsigned int j=0; j<3; j++)
+    {
+        for (unsigned int i=0; i<3; i++)
+        {
+            std::copy_n(Fm + (3*j + i)*N, N, local + (6*j + membraneDofs[i])*N);
+            std::copy_n(Fb + (3*j + i)*N, N, local + (6*j + bendingDofs[i])*N);
+        }
+    }
+}
+
+template<class DataTypes>
+void TriangularShellEnsembleForceField<DataTypes>::addForce(const sofa::core::MechanicalParams* /*mparams*/, DataVecDeriv& dataF, const DataVecCoord& dataX, const DataVecDeriv& /*dataV*/)
+{
+    VecDeriv &f = *dataF.beginEdit();
+    const VecCoord &x = dataX.getValue();
+    f.resize(x.size());
+
+    const sofa::type::vector<TriangleInformation> &ti = this->triangleInfo.getValue();
+    const Index N = m_nbVariants, n = m_nbPoints;
+    if (m_basis.size() != ti.size() || x.size() != N*n)
+    {
+        dataF.endEdit();
+        return;
+    }
+
+    std::fill(m_laneEnergy.begin(), m_laneEnergy.end(), (Real)0);
+
+    for (std::size_t t=0; t<ti.size(); t++)
+    {
+        const TriangleInformation &tinfo = ti[t];
+        Real *R = &m_rotations[9*N*t];
+
+        // The frames and rotation vectors are computed variant by variant,
+        // everything else on lanes
+        for (Index v=0; v<N; v++)
+            computeDisplacement(tinfo, x, v, R);
+
+        std::fill(m_laneFm.begin(), m_laneFm.end(), (Real)0);
+        std::fill(m_laneFb.begin(), m_laneFb.end(), (Real)0);
+        multiplyLanes(m_laneFm.data(), m_laneDm.data(), m_basis[t].membrane, m_membraneFactors.data(), m_nbMembraneBasis);
+        multiplyLanes(m_laneFb.data(), m_laneDb.data(), m_basis[t].bending, m_bendingFactors.data(), m_nbBendingBasis);
+
+        // Strain energy 1/2 u^T K u in the corotational frame
+        for (unsigned int i=0; i<9; i++)
+        {
+            const Real *dm = &m_laneDm[i*N], *fm = &m_laneFm[i*N];
+            const Real *db = &m_laneDb[i*N], *fb = &m_laneFb[i*N];
+            for (Index v=0; v<N; v++)
+                m_laneEnergy[v] += (dm[v]*fm[v] + db[v]*fb[v]) / 2;
+        }
+
+        // Back into the global frame
+        mergeLanes(m_laneLocal.data(), m_laneFm.data(), m_laneFb.data());
+        for (unsigned int j=0; j<6; j++)
+            rotateLanes(&m_laneGlobal[3*j*N], R, &m_laneLocal[3*j*N], true);
+
+        const Index nodes[3] = { tinfo.a, tinfo.b, tinfo.c };
+        for (Index v=0; v<N; v++)
+        {
+            for (unsigned int j=0; j<3; j++)
+            {
+                auto &fj = f[v*n + nodes[j]];
+                for (unsigned int i=0; i<3; i++) {
+                    getVCenter(fj)[i] -= m_laneGlobal[(6*j + i)*N + v];
+                    getVOrientation(fj)[i] -= m_laneGlobal[(6*j + 3 + i)*N + v];
+                }
+            }
+        }
+    }
+
+    sofa::type::vector<SReal> &energies = *d_variantEnergies.beginEdit();
+    energies.assign(m_laneEnergy.begin(), m_laneEnergy.end());
+    d_variantEnergies.endEdit();
+
+    this->m_potentialEnergy = 0;
+    for (Index v=0; v<N; v++)
+        this->m_potentialEnergy += m_laneEnergy[v];
+
+    dataF.endEdit();
+}
+
+template<class DataTypes>
+void TriangularShellEnsembleForceField<DataTypes>::addDForce(const sofa::core::MechanicalParams* mparams, DataVecDeriv& datadF, const DataVecDeriv& datadX)
+{
+    VecDeriv &df = *datadF.beginEdit();
+    const VecDeriv &dx = datadX.getValue();
+    df.resize(dx.size());
+
+    const Real kFactor = (Real)mparams->kFactor();
+    const sofa::type::vector<TriangleInformation> &ti = this->triangleInfo.getValue();
+    const Index N = m_nbVariants, n = m_nbPoints;
+    if (m_basis.size() != ti.size() || dx.size() != N*n)
+    {
+        datadF.endEdit();
+        return;
+    }
+
+    for (std::size_t t=0; t<ti.size(); t++)
+    {
+        const TriangleInformation &tinfo = ti[t];
+        const Real *R = &m_rotations[9*N*t];
+        const Index nodes[3] = { tinfo.a, tinfo.b, tinfo.c };
+
+        // Gather the node dofs of all variants and rotate them into the
+        // element frames
+        for (Index v=0; v<N; v++)
+        {
+            for (unsigned int j=0; j<3; j++)
+            {
+                const auto &dxj = dx[v*n + nodes[j]];
+                for (unsigned int i=0; i<3; i++) {
+                    m_laneGlobal[(6*j + i)*N + v] = getVCenter(dxj)[i];
+                    m_laneGlobal[(6*j + 3 + i)*N + v] = getVOrientation(dxj)[i];
+                }
+            }
+        }
+        for (unsigned int j=0; j<6; j++)
+            rotateLanes(&m_laneLocal[3*j*N], R, &m_laneGlobal[3*j*N], false);
+        splitLanes(m_laneDm.data(), m_laneDb.data(), m_laneLocal.data());
+
+        std::fill(m_laneFm.begin(), m_laneFm.end(), (Real)0);
+        std::fill(m_laneFb.begin(), m_laneFb.end(), (Real)0);
+        multiplyLanes(m_laneFm.data(), m_laneDm.data(), m_basis[t].membrane, m_membraneFactors.data(), m_nbMembraneBasis);
+        multiplyLanes(m_laneFb.data(), m_laneDb.data(), m_basis[t].bending, m_bendingFactors.data(), m_nbBendingBasis);
+
+        mergeLanes(m_laneLocal.data(), m_laneFm.data(), m_laneFb.data());
+        for (unsigned int j=0; j<6; j++)
+            rotateLanes(&m_laneGlobal[3*j*N], R, &m_laneLocal[3*j*N], true);
+
+        for (Index v=0; v<N; v++)
+        {
+            for (unsigned int j=0; j<3; j++)
+            {
+                auto &dfj = df[v*n + nodes[j]];
+                for (unsigned int i=0; i<3; i++) {
+                    getVCenter(dfj)[i] -= m_laneGlobal[(6*j + i)*N + v] * kFactor;
+                    getVOrientation(dfj)[i] -= m_laneGlobal[(6*j + 3 + i)*N + v] * kFactor;
+                }
+            }
+        }
+    }
+
+    datadF.endEdit();
+}
+
+template<class DataTypes>
+void TriangularShellEnsembleForceField<DataTypes>::addKToMatrix(const sofa::core::MechanicalParams* mparams, const sofa::core::behavior::MultiMatrixAccessor* matrix)
+{
+    sofa::core::behavior::MultiMatrixAccessor::MatrixRef r = matrix->getMatrix(this->mstate);
+    const Real kFactor = (Real)mparams->kFactor();
+
+    const sofa::type::vector<TriangleInformation> &ti = this->triangleInfo.getValue();
+    const Index N = m_nbVariants, n = m_nbPoints;
+    if (m_basis.size() != ti.size())
+        return;
+
+    StiffnessMatrixFull K_gs;
+    for (std::size_t t=0; t<ti.size(); t++)
+    {
+        const TriangleInformation &tinfo = ti[t];
+        const ElementBasis &basis = m_basis[t];
+        const Real *R = &m_rotations[9*N*t];
+
+        // The variants only share the element basis, each one is assembled
+        // as a separate copy of the mesh
+        for (Index v=0; v<N; v++)
+        {
+            StiffnessMatrix Km, Kb;
+            Km.clear();
+            Kb.clear();
+            for (unsigned int b=0; b<m_nbMembraneBasis; b++)
+                Km += basis.membrane[b].toMat() * m_membraneFactors[b*N + v];
+            for (unsigned int b=0; b<m_nbBendingBasis; b++)
+                Kb += basis.bending[b].toMat() * m_bendingFactors[b*N + v];
+
+            m_variantElement.stiffnessMatrixMembrane.set(StiffnessMatrixPacked(Km), false);
+            m_variantElement.stiffnessMatrixBending.set(StiffnessMatrixPacked(Kb), false);
+            for (unsigned int k=0; k<9; k++)
+                m_variantElement.R[k/3][k%3] = R[k*N + v];
+            m_variantElement.Rt.transpose(m_variantElement.R);
+
+            this->convertStiffnessMatrixToGlobalSpace(K_gs, m_variantElement);
+
+            const Triangle triangle(v*n + tinfo.a, v*n + tinfo.b, v*n + tinfo.c);
+            shell::misc::addSymmetricElementMatrix(r.matrix, r.offset, triangle, K_gs, -kFactor);
+        }
+    }
+}
+
+template<class DataTypes>
+void TriangularShellEnsembleForceField<DataTypes>::addNodeBlockDiagonal(NodeBlockDiagonal &blocks, const Real kFactor, const bool parallel)
+{
+    typedef sofa::type::Mat<6,6,Real> Block;
+
+    const sofa::type::vector<TriangleInformation> &ti = this->triangleInfo.getValue();
+    const Index N = m_nbVariants, n = m_nbPoints;
+    if (m_basis.size() != ti.size() || blocks.size() < (std::size_t)N*n)
+        return;
+
+    // Position of the membrane (u, v, θz) and bending (w, θx, θy) dofs in
+    // the node block
+    const unsigned int membraneDofs[3] = { 0, 1, 5 };
+    const unsigned int bendingDofs[3] = { 2, 3, 4 };
+
+    // Make sure the shells are created before they are accessed concurrently
+    if (n > 0)
+        this->_topology->getTrianglesAroundVertex(0);
+
+    // Each node of the mesh gathers the blocks of its copies in all the
+    // variants, so that no two threads write the same block
+    shell::misc::parallelForRange(parallel, Index(0), n, [&](Index begin, Index end) {
+        Block membrane[4], bending[2];
+        for (Index i=begin; i<end; i++)
+        {
+            for (const Index t : this->_topology->getTrianglesAroundVertex(i))
+            {
+                const Triangle &tri = this->_topology->getTriangle(t);
+                for (unsigned int j=0; j<3; j++)
+                {
+                    if (tri[j] != i)
+                        continue;
+
+                    // Node block of each basis matrix, combined for each
+                    // variant below
+                    const ElementBasis &basis = m_basis[t];
+                    for (unsigned int b=0; b<m_nbMembraneBasis; b++) {
+                        membrane[b].clear();
+                        shell::misc::addElementNodeBlock(membrane[b], basis.membrane[b], 3, j, membraneDofs);
+                    }
+                    for (unsigned int b=0; b<m_nbBendingBasis; b++) {
+                        bending[b].clear();
+                        shell::misc::addElementNodeBlock(bending[b], basis.bending[b], 3, j, bendingDofs);
+                    }
+
+                    const Real *R = &m_rotations[9*N*t];
+                    for (Index v=0; v<N; v++)
+                    {
+                        Block local;
+                        local.clear();
+                        for (unsigned int b=0; b<m_nbMembraneBasis; b++)
+                            local += membrane[b] * m_membraneFactors[b*N + v];
+                        for (unsigned int b=0; b<m_nbBendingBasis; b++)
+                            local += bending[b] * m_bendingFactors[b*N + v];
+
+                        sofa::type::Mat<3,3,Real> Rv;
+                        for (unsigned int k=0; k<9; k++)
+                            Rv[k/3][k%3] = R[k*N + v];
+
+                        shell::misc::addRotatedNodeBlock(blocks[v*n + i], local, Rv, -kFactor);
+                    }
+                }
+            }
+        }
+    });
+}
+
+} // namespace
@@ -33,11 +33,20 @@
 #include <sofa/core/behavior/ForceField.h>
 #include <sofa/core/behavior/MechanicalState.h>
 #include <sofa/core/objectmodel/Data.h>
+#include <sofa/core/objectmodel/DataFileName.h>
 #include <sofa/helper/OptionsGroup.h>
 
 #include <sofa/core/topology/BaseMeshTopology.h>
 #include <sofa/core/topology/TopologyData.h>
 
+#include <Shell/misc/BlockDiagonal.h>
+#include <Shell/misc/ElementSleeping.h>
+#include <Shell/misc/GeometricStiffness.h>
+#include <Shell/misc/MixedPrecision.h>
+#include <Shell/misc/RestStateCache.h>
+#include <Shell/misc/SymmetricMatrix.h>
+#include <Shell/misc/TimeSeriesWriter.h>
+
 
 // Uncomment the following to use quaternions instead of matrices for
 // rotations. Quaternions are slightly faster but numericaly quite unstable
@@ -107,12 +116,64 @@ class TriangularShellForceField : public core::behavior::ForceField<DataTypes>
         typedef Mat<3, 3, Real> Transformation;                 // matrix for rigid transformations like rotations
         typedef Mat<9, 9, Real> StiffnessMatrix;                // element stiffness matrix
         typedef Mat<18, 18, Real> StiffnessMatrixFull;          // stiffness matrix for shell (= bending plate + membrane)
+        typedef shell::misc::SymmetricMatrix<18, Real> StiffnessMatrixFullPacked; // ... stored
+        typedef shell::misc::SymmetricMatrix<9, Real> StiffnessMatrixPacked;   // stored element stiffness matrix
+        typedef shell::misc::MixedSymmetricMatrix<9, Real> StiffnessMatrixStored; // ... in the precision chosen by mixedPrecision
 
         typedef void (TriangularShellForceField<DataTypes>::*compstiff)(StiffnessMatrix &K, TriangleInformation &tinfo);
+        typedef SReal (TriangularShellForceField<DataTypes>::*forcekernel)(VecDeriv &f, const VecCoord &x);
+        typedef void (TriangularShellForceField<DataTypes>::*dforcekernel)(VecDeriv &df, const VecDeriv &dx, const Real kFactor);
         typedef type::fixed_array<Real, 10> AndesBeta;
 
         sofa::core::topology::BaseMeshTopology* _topology;
 
+        // Element policies used by the force loops. Each one multiplies the
+        // local displacements of an element by its packed 9x9 stiffness
+        // matrix (in either precision) and knows its structure.
+
+        /// No element: the product vanishes and is compiled out.
+        struct NoElement
+        {
+            template<class MatReal>
+            static void multiply(Displacement &F, const shell::misc::SymmetricMatrix<9,MatReal> &/*K*/, const Displacement &/*D*/)
+            {
+                F.clear();
+            }
+        };
+
+        /// Full 9x9 stiffness matrix (ANDES templates and DKT).
+        struct DenseElement
+        {
+            template<class MatReal>
+            static void multiply(Displacement &F, const shell::misc::SymmetricMatrix<9,MatReal> &K, const Displacement &D)
+            {
+                F = K * D;
+            }
+        };
+
+        /// CST membrane: there is no drilling stiffness, rows and columns of
+        /// the rotations (2, 5 and 8) are zero and the product is 6x6.
+        struct CSTElement
+        {
+            template<class MatReal>
+            static void multiply(Displacement &F, const shell::misc::SymmetricMatrix<9,MatReal> &K, const Displacement &D)
+            {
+                const Index dofs[6] = { 0, 1, 3, 4, 6, 7 };
+
+                MatReal d[6];
+                for (unsigned int j=0; j<6; j++)
+                    d[j] = (MatReal)D[dofs[j]];
+
+                F.clear();
+                for (unsigned int i=0; i<6; i++) {
+                    MatReal s = 0;
+                    for (unsigned int j=0; j<6; j++)
+                        s += K(dofs[i], dofs[j]) * d[j];
+                    F[dofs[i]] = (Real)s;
+                }
+            }
+        };
+
 public:
 
         class TriangleInformation
@@ -143,9 +204,10 @@ public:
                 StrainDisplacement strainDisplacementMatrixMembrane[4];
                 StrainDisplacement strainDisplacementMatrixBending[4];
 
-                // Stiffness matrix
-                StiffnessMatrix stiffnessMatrixMembrane;
-                StiffnessMatrix stiffnessMatrixBending;
+                // Stiffness matrix (symmetric, packed, in single precision
+                // with mixedPrecision)
+                StiffnessMatrixStored stiffnessMatrixMembrane;
+                StiffnessMatrixStored stiffnessMatrixBending;
 
                 // Measure stress or strain
                 struct MeasurePoint {
@@ -153,9 +215,18 @@ public:
                     StrainDisplacement B;   // Strain-displacement Matrix
                     StrainDisplacement Bb;  // Strain-displacement Matrix bending
                     Index id;               // Index into the result array
+                    Real value;             // Last measured value
                 };
                 type::vector<MeasurePoint> measure;
 
+                // Local displacements of the last force evaluation, the
+                // measure is computed from them at the end of the step
+                Displacement measureDm, measureDb;
+
+                // Frame rotation and element forces of the last force
+                // evaluation for the geometric stiffness
+                shell::misc::GeometricStiffness<Real> geometric;
+
 
                 // The following are in rest shape
                 // - element area
@@ -165,6 +236,32 @@ public:
                 // - squared lengths of 'd'
                 type::fixed_array <Real, 3> l2;
 
+                /// Visit the rest state, i.e. everything set by initTriangle(),
+                /// for shell::misc::RestStateCache
+                template<class Archive>
+                void serializeRest(Archive &ar)
+                {
+                    ar(a); ar(b); ar(c);
+                    ar(restPositions);
+                    ar(restOrientationsInv);
+                    ar(R); ar(Rt);
+#ifdef CRQUAT
+                    ar(Q);
+#endif
+                    ar(strainDisplacementMatrixMembrane);
+                    ar(strainDisplacementMatrixBending);
+                    ar(stiffnessMatrixMembrane); ar(stiffnessMatrixBending);
+
+                    std::uint64_t nbMeasure = measure.size();
+                    ar(nbMeasure);
+                    measure.resize(nbMeasure);
+                    for (MeasurePoint &mp : measure) {
+                        ar(mp.point); ar(mp.B); ar(mp.Bb); ar(mp.id);
+                    }
+
+                    ar(area); ar(d); ar(l2);
+                }
+
                 /// Output stream
                 inline friend std::ostream& operator<< ( std::ostream& os, const TriangleInformation& /*ti*/ )
                 {
@@ -187,6 +284,7 @@ public:
                     const Triangle & t,
                     const sofa::type::vector< unsigned int > &,
                     const sofa::type::vector< double > &, const VecCoord& x0);
+                void applyDestroyFunction(unsigned int triangleIndex, TriangleInformation &tInfo);
 
             protected:
                 TriangularShellForceField<DataTypes>* ff;
@@ -201,11 +299,22 @@ public:
         void addDForce(const sofa::core::MechanicalParams* /*mparams*/, DataVecDeriv& datadF, const DataVecDeriv& datadX ) override ;
         void addKToMatrix(const core::MechanicalParams* mparams, const sofa::core::behavior::MultiMatrixAccessor* matrix) override;
         void draw(const core::visual::VisualParams* vparams) override;
+        void handleEvent(sofa::core::objectmodel::Event *event) override;
 
-        SReal getPotentialEnergy(const sofa::core::MechanicalParams* /*mparams*/, const DataVecCoord& /*x*/) const override { return 0; }
+        /// Strain energy of the positions passed to the last addForce()
+        SReal getPotentialEnergy(const sofa::core::MechanicalParams* /*mparams*/, const DataVecCoord& /*x*/) const override { return m_potentialEnergy; }
+
+        typedef shell::misc::BlockDiagonal<6,Real> NodeBlockDiagonal;
+
+        /// Add kFactor times the node diagonal blocks of the stiffness matrix
+        /// (as assembled by addKToMatrix) into blocks, without assembling it
+        virtual void addNodeBlockDiagonal(NodeBlockDiagonal &blocks, const Real kFactor, const bool parallel);
 
         sofa::core::topology::BaseMeshTopology* getTopology() {return _topology;}
 
+        /// Element data, i.e. frames and stiffness matrices
+        const type::vector<TriangleInformation>& getTriangleInformation() const { return triangleInfo.getValue(); }
+
         Data<Real> d_poisson;
         Data<Real> d_young;
         Data <Real> d_thickness;
@@ -214,9 +323,27 @@ public:
         Data<bool> d_corotated;
         Data<sofa::helper::OptionsGroup> d_measure;
         Data<type::vector<Real> > d_measuredValues;
+        Data<unsigned int> d_measurePeriod;
+        Data<bool> d_parallelMeasure;
+        sofa::core::objectmodel::DataFileName d_measureFile;
         Data<bool> d_isShellveryThin;
         Data<bool> d_use_rest_position;
         Data<Real> d_arrow_radius;
+        Data<bool> d_mixedPrecision;
+        Data<bool> d_checkMixedPrecision;
+        Data<Real> d_mixedPrecisionError;
+        Data<bool> d_parallelInit;
+        sofa::core::objectmodel::DataFileName d_restStateCache;
+        Data<bool> d_laggedStiffness;
+        Data<Real> d_laggedMaxRotation;
+        Data<unsigned int> d_laggedMaxAssemblies;
+        Data<Real> d_frameRotationChange;
+        Data<unsigned int> d_stiffnessVersion;
+        Data<bool> d_geometricStiffness;
+        Data<bool> d_elementSleeping;
+        Data<Real> d_sleepTolerance;
+        Data<unsigned int> d_activeElements;
+        Data<Real> d_sleepErrorBound;
 
         TRQSTriangleHandler* triangleHandler;
 
@@ -226,26 +353,99 @@ protected :
         compstiff csMembrane;
         compstiff csBending;
 
+        // Force loops specialised for the selected elements, indexed by
+        // mixedPrecision
+        forcekernel m_addForceKernel[2];
+        dforcekernel m_addDForceKernel[2];
+
         /// Material stiffness matrix
         MaterialStiffness materialMatrix, materialMatrixMembrane, materialMatrixBending;
+        /// Thickness and Poisson ratio the material matrices were computed
+        /// with, for the terms of the ANDES elements that depend on them
+        Real materialThickness, materialPoisson;
         TriangleData< sofa::type::vector<TriangleInformation> > triangleInfo;
 
         // What to measure
         bool bMeasureStrain;
         bool bMeasureStress;
 
+        // Back buffer of d_measuredValues, steps since the last measure and
+        // optional recording of the values
+        type::vector<Real> m_measureBuffer;
+        unsigned int m_measureStep;
+        shell::misc::TimeSeriesWriter m_measureWriter;
+
+        // Difference between single and full precision element forces
+        shell::misc::MixedPrecisionError m_mixedError;
+
+        // Strain energy computed by the last addForce()
+        SReal m_potentialEnergy;
+
+        // Lagged stiffness: element matrices in global frame and the frame
+        // rotations they were assembled with, assemblies since they were
+        // computed
+        struct LaggedElement {
+            Transformation R;
+            StiffnessMatrixFullPacked K;
+        };
+        type::vector<LaggedElement> m_lagged;
+        unsigned int m_laggedAssemblies;
+        bool m_laggedValid;
+
+        // Geometric stiffness requested for the last addForce()
+        bool m_geometricStiffness;
+
+        // Element matrices are stored in single precision (mixedPrecision
+        // when they were computed)
+        bool m_singleStiffness;
+
+        // Elements whose forces are reused while their nodes barely move,
+        // and whether it is enabled for the current addForce()
+        shell::misc::ElementSleeping<DataTypes> m_sleeping;
+        bool m_sleepingActive;
+
+        /// Largest rotation (in radians) of the element frames since the
+        /// lagged matrices were computed
+        Real laggedRotationChange(const type::vector<TriangleInformation> &ti) const;
+        void updateLaggedStiffness(const type::vector<TriangleInformation> &ti);
+
         void initTriangle(const int i, const Index&a, const Index&b, const Index&c, const VecCoord& x0);
+        void initTriangle(TriangleInformation &tinfo, const Index&a, const Index&b, const Index&c, const VecCoord& x0);
+
+        /// Initialise all elements, in parallel if requested, or read them
+        /// from the rest state cache
+        void initTriangles(type::vector<TriangleInformation> &ti, const VecCoord& x0);
+        /// Identify the mesh, rest positions and material for the cache
+        std::uint64_t restStateKey(const VecCoord& x0);
 
         void computeRotation(Transformation& R, const VecCoord &x, const Index &a, const Index &b, const Index &c);
         void computeRotation(Transformation& R, const type::fixed_array<Vec3, 3> &x);
         void computeMaterialStiffness();
 
         void computeDisplacement(Displacement &Dm, Displacement &Db, const VecCoord &x, const Index elementIndex);
-        void accumulateForce(VecDeriv& f, const VecCoord & p, const Index elementIndex);
         void computeStiffnessMatrixMembrane(StiffnessMatrix &K, TriangleInformation &tinfo);
         void computeStiffnessMatrixBending(StiffnessMatrix &K, TriangleInformation &tinfo);
+
+        // Select the force loops for the membrane and bending policies
+        template<class Membrane> void selectKernels(const bool bending);
+        template<class Membrane, class Bending> void selectKernels();
+
+        /// Add the forces of all elements and return their strain energy
+        template<class Membrane, class Bending, bool Mixed>
+        SReal addForceElements(VecDeriv& f, const VecCoord& x);
+        template<class Membrane, class Bending, bool Mixed>
+        void addDForceElements(VecDeriv& df, const VecDeriv& dx, const Real kFactor);
+
+        template<class Membrane, class Bending, bool Mixed>
+        void accumulateForce(VecDeriv& f, const VecCoord & p, const Index elementIndex, SReal &energy);
+
+        /// Compute the stress or strain from the displacements stored by the
+        /// last force evaluation and publish it in d_measuredValues
+        void computeMeasure();
+        template<class Membrane, class Bending, bool Mixed>
         void computeForce(Displacement &Fm, const Displacement& Dm, Displacement &Fb, const Displacement& Db,const Index elementIndex);
-        virtual void applyStiffness(VecDeriv& f, const VecDeriv& dx, const Index elementIndex, const double kFactor);
+        template<class Membrane, class Bending, bool Mixed>
+        void applyStiffness(VecDeriv& f, const VecDeriv& dx, const Index elementIndex, const Real kFactor);
 
         void convertStiffnessMatrixToGlobalSpace(StiffnessMatrixFull &K_gs, const TriangleInformation &tinfo);
 
@@ -262,6 +462,8 @@ protected :
 
         // Helper functions for the elements
         void andesTemplate(StiffnessMatrix &K, const TriangleInformation &tinfo, const Real alpha, const AndesBeta &beta);
+        /// Scale of the higher order stiffness of ANDES-OPT
+        static Real andesOptBeta0(const Real nu);
         void dktSD(StrainDisplacement &B, const TriangleInformation &tinfo, const Real xi, const Real eta);
 
 };
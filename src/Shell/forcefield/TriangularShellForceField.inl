@@ -26,6 +26,7 @@
 #define SOFA_COMPONENT_FORCEFIELD_TRIANGULAR_BENDING_FEM_FORCEFIELD_INL
 
 #include <Shell/forcefield/TriangularShellForceField.h>
+#include <Shell/misc/ParallelFor.h>
 #include <sofa/core/behavior/ForceField.inl>
 #include <sofa/core/topology/TopologyData.inl>
 #include <sofa/gl/template.h>
@@ -37,8 +38,10 @@
 #include <iostream> //for debugging
 #include <vector>
 #include <algorithm>
+#include <cmath>
 #include <sofa/defaulttype/VecTypes.h>
 #include <sofa/core/visual/VisualParams.h>
+#include <sofa/simulation/AnimateEndEvent.h>
 #include <assert.h>
 #include <map>
 #include <utility>
@@ -67,6 +70,18 @@ void TriangularShellForceField<DataTypes>::TRQSTriangleHandler::applyCreateFunct
         ff->initTriangle(triangleIndex, t[0], t[1], t[2], x0);
 }
 
+template< class DataTypes>
+void TriangularShellForceField<DataTypes>::TRQSTriangleHandler::applyDestroyFunction(unsigned int /*triangleIndex*/, TriangleInformation &/*tInfo*/)
+{
+    if (ff)
+    {
+        // The last triangle takes the place of the removed one, the kept
+        // forces and lagged matrices no longer match the elements
+        ff->m_laggedValid = false;
+        ff->m_sleeping.clear();
+    }
+}
+
 
 // --------------------------------------------------------------------------------------
 // --- Constructor
@@ -81,11 +96,29 @@ TriangularShellForceField<DataTypes>::TriangularShellForceField()
     , d_corotated(initData(&d_corotated, true, "corotated", "Compute forces in corotational frame"))
     , d_measure(initData(&d_measure, "measure", "Compute the strain or stress"))
     , d_measuredValues(initData(&d_measuredValues, "measuredValues", "Measured values for stress or strain"))
+    , d_measurePeriod(initData(&d_measurePeriod, 1u, "measurePeriod", "Compute the measure at the end of every N-th time step"))
+    , d_parallelMeasure(initData(&d_parallelMeasure, false, "parallelMeasure", "Compute the measure of the elements in parallel"))
+    , d_measureFile(initData(&d_measureFile, "measureFile", "Binary file recording the measured values every time they are computed (optional)"))
     , d_isShellveryThin(initData(&d_isShellveryThin, false, "isShellveryThin", "This bool is to adapt "
                                                                                "computation in case we are using verry tiny(thickness) shell element"))
     , d_use_rest_position(initData(&d_use_rest_position, true, "use_rest_position", "Use the rest position inteat of using postion to update the restposition"))
     , triangleInfo(initData(&triangleInfo, "triangleInfo", "Internal triangle data"))
     , d_arrow_radius(initData(&d_arrow_radius, (Real)0.1, "arrow_radius", "the arrow radius"))
+    , d_mixedPrecision(initData(&d_mixedPrecision, false, "mixedPrecision", "Store the element stiffness matrices in single precision only and compute element forces with them"))
+    , d_checkMixedPrecision(initData(&d_checkMixedPrecision, false, "checkMixedPrecision", "Also compute element forces with full precision matrices, computed again for each element, and report the difference"))
+    , d_mixedPrecisionError(initData(&d_mixedPrecisionError, (Real)0, "mixedPrecisionError", "Relative difference between single and full precision element forces in the last addForce"))
+    , d_parallelInit(initData(&d_parallelInit, false, "parallelInit", "Initialise the elements in parallel"))
+    , d_restStateCache(initData(&d_restStateCache, "restStateCache", "File caching the rest state of the elements (optional). It is read if it matches the mesh and the material, and written otherwise"))
+    , d_laggedStiffness(initData(&d_laggedStiffness, false, "laggedStiffness", "Assemble the stiffness with the element frames of a previous assembly until they have rotated too much"))
+    , d_laggedMaxRotation(initData(&d_laggedMaxRotation, (Real)0.05, "laggedMaxRotation", "Largest rotation of an element frame (in radians) before the lagged stiffness is updated"))
+    , d_laggedMaxAssemblies(initData(&d_laggedMaxAssemblies, 10u, "laggedMaxAssemblies", "Update the lagged stiffness after this many assemblies (0 for no limit)"))
+    , d_frameRotationChange(initData(&d_frameRotationChange, (Real)0, "frameRotationChange", "Largest rotation of an element frame since the stiffness assembled last was computed"))
+    , d_stiffnessVersion(initData(&d_stiffnessVersion, 0u, "stiffnessVersion", "Incremented each time the assembled stiffness changes, the matrix (and its factorisation) can be reused as long as it is the same"))
+    , d_geometricStiffness(initData(&d_geometricStiffness, false, "geometricStiffness", "Add the geometric (initial stress) stiffness due to the rotation of the element frames to the tangent stiffness. Needs corotated, not assembled with the lagged stiffness"))
+    , d_elementSleeping(initData(&d_elementSleeping, false, "elementSleeping", "Reuse the forces and frames of the elements whose nodes barely move instead of computing them again"))
+    , d_sleepTolerance(initData(&d_sleepTolerance, (Real)1e-6, "sleepTolerance", "Largest bound of the force error of a sleeping element"))
+    , d_activeElements(initData(&d_activeElements, 0u, "activeElements", "Number of elements computed by the last addForce"))
+    , d_sleepErrorBound(initData(&d_sleepErrorBound, (Real)0, "sleepErrorBound", "Sum of the force error bounds of the sleeping elements in the last addForce"))
 
 {
     d_membraneElement.beginEdit()->setNames( {
@@ -117,6 +150,22 @@ TriangularShellForceField<DataTypes>::TriangularShellForceField()
     d_measure.endEdit();
 
     triangleHandler = new TRQSTriangleHandler(this, &triangleInfo);
+
+    selectKernels<NoElement, NoElement>();
+
+    bMeasureStrain = bMeasureStress = false;
+    m_measureStep = 0;
+    m_potentialEnergy = 0;
+    m_laggedAssemblies = 0;
+    m_laggedValid = false;
+    m_geometricStiffness = false;
+    m_singleStiffness = false;
+    m_sleepingActive = false;
+
+    d_frameRotationChange.setReadOnly(true);
+    d_stiffnessVersion.setReadOnly(true);
+    d_activeElements.setReadOnly(true);
+    d_sleepErrorBound.setReadOnly(true);
 }
 
 
@@ -162,6 +211,11 @@ template <class DataTypes> void TriangularShellForceField<DataTypes>::reinit()
     // Prepare material matrices
     computeMaterialStiffness();
 
+    // Element matrices may change
+    m_laggedValid = false;
+    m_sleeping.clear();
+    m_singleStiffness = d_mixedPrecision.getValue();
+
     // Decode the selected elements to use
     if (d_membraneElement.getValue().getSelectedItem() == "None") {
         csMembrane = NULL;
@@ -201,6 +255,14 @@ template <class DataTypes> void TriangularShellForceField<DataTypes>::reinit()
         return;
     }
 
+    // Pick the force loops for this combination of elements
+    if (csMembrane == NULL)
+        selectKernels<NoElement>(csBending != NULL);
+    else if (csMembrane == &TriangularShellForceField<DataTypes>::computeStiffnessMatrixCST)
+        selectKernels<CSTElement>(csBending != NULL);
+    else
+        selectKernels<DenseElement>(csBending != NULL);
+
     // What to compute?
     if (d_measure.getValue().getSelectedItem() == "None") {
         bMeasureStrain = false;  bMeasureStress = false;
@@ -217,6 +279,20 @@ template <class DataTypes> void TriangularShellForceField<DataTypes>::reinit()
     {
         d_measuredValues.beginEdit()->resize(_topology->getNbPoints());
         d_measuredValues.endEdit();
+        m_measureBuffer.resize(_topology->getNbPoints());
+        m_measureStep = 0;
+
+        // The measure is computed at the end of the time step
+        *this->f_listening.beginEdit() = true;
+        this->f_listening.endEdit();
+
+        const std::string &filename = d_measureFile.getFullPath();
+        if (filename.empty()) {
+            m_measureWriter.close();
+        } else if (filename != m_measureWriter.getFilename()) {
+            if (!m_measureWriter.open(filename))
+                msg_warning() << "Cannot open '" << filename << "' for writing" ;
+        }
     }
 
     /// Prepare to store info in the triangle array
@@ -227,20 +303,90 @@ template <class DataTypes> void TriangularShellForceField<DataTypes>::reinit()
     if (use_rest_position)
     {
         const VecCoord& x0 =this->mstate->read(sofa::core::vec_id::read_access::restPosition)->getValue();
-        for (sofa::Index i=0; i<_topology->getNbTriangles(); ++i)
-            triangleHandler->applyCreateFunction(i, ti[i], _topology->getTriangle(i),
-                                                 (const sofa::type::vector< unsigned int >)0, (const sofa::type::vector< double >)0, x0);
+        initTriangles(ti, x0);
     }
     else
     {
         const VecCoord& x0 =this->mstate->read(sofa::core::vec_id::read_access::position)->getValue();
-        for (sofa::Index i=0; i<_topology->getNbTriangles(); ++i)
-            triangleHandler->applyCreateFunction(i, ti[i], _topology->getTriangle(i),
-                                                 (const sofa::type::vector< unsigned int >)0, (const sofa::type::vector< double >)0, x0);
+        initTriangles(ti, x0);
     }
     triangleInfo.endEdit();
 }
 
+// --------------------------------------------------------------------------------------
+// --- Initialise all the elements
+// --------------------------------------------------------------------------------------
+template <class DataTypes>
+void TriangularShellForceField<DataTypes>::initTriangles(type::vector<TriangleInformation> &ti, const VecCoord& x0)
+{
+    const std::string &cacheFile = d_restStateCache.getFullPath();
+    std::uint64_t key = 0;
+
+    if (!cacheFile.empty())
+    {
+        key = restStateKey(x0);
+        if (shell::misc::RestStateCache::load(cacheFile, key, ti))
+        {
+            msg_info() << "Rest state of " << ti.size() << " elements read from '" << cacheFile << "'";
+            return;
+        }
+    }
+
+    // Make sure the parameters are up to date before they are read concurrently
+    d_corotated.getValue();
+    this->f_printLog.getValue();
+
+    const SeqTriangles &triangles = _topology->getTriangles();
+    shell::misc::parallelForRange(d_parallelInit.getValue(), std::size_t(0), ti.size(),
+        [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i=begin; i<end; i++) {
+                const Triangle &t = triangles[i];
+                initTriangle(ti[i], t[0], t[1], t[2], x0);
+            }
+        });
+
+    if (!cacheFile.empty())
+    {
+        if (shell::misc::RestStateCache::save(cacheFile, key, ti))
+            msg_info() << "Rest state of " << ti.size() << " elements written to '" << cacheFile << "'";
+        else
+            msg_warning() << "Cannot write the rest state to '" << cacheFile << "'";
+    }
+}
+
+// --------------------------------------------------------------------------------------
+// --- Key of the rest state cache
+// --------------------------------------------------------------------------------------
+template <class DataTypes>
+std::uint64_t TriangularShellForceField<DataTypes>::restStateKey(const VecCoord& x0)
+{
+    shell::misc::Hash64 h;
+
+    // Layout of the stored values
+    h.add((std::uint32_t)sizeof(Real));
+#ifdef CRQUAT
+    h.add((std::uint32_t)1);
+#else
+    h.add((std::uint32_t)0);
+#endif
+
+    // Mesh and rest shape
+    h.addArray(_topology->getTriangles());
+    h.addArray(x0);
+
+    // Elements and material
+    h.add(d_membraneElement.getValue().getSelectedItem());
+    h.add(d_bendingElement.getValue().getSelectedItem());
+    h.add(d_corotated.getValue());
+    h.add(d_isShellveryThin.getValue());
+    h.add(d_young.getValue());
+    h.add(d_poisson.getValue());
+    h.add(d_thickness.getValue());
+    h.add(m_singleStiffness);
+
+    return h.value();
+}
+
 // --------------------------------------------------------------------------------------
 // ---
 // --------------------------------------------------------------------------------------
@@ -256,14 +402,36 @@ void TriangularShellForceField<DataTypes>::addForce(const sofa::core::Mechanical
     //
     //    start = timer.getTime();
 
-    int nbTriangles=_topology->getNbTriangles();
     f.resize(p.size());
 
-    for (int i=0; i<nbTriangles; i++)
+    const bool mixed = m_singleStiffness;
+    const bool checkMixed = mixed && d_checkMixedPrecision.getValue();
+    if (checkMixed)
+        m_mixedError.clear();
+
+    m_geometricStiffness = d_geometricStiffness.getValue() && d_corotated.getValue();
+
+    m_sleepingActive = d_elementSleeping.getValue();
+    if (m_sleepingActive)
+        m_sleeping.update(p, _topology->getNbTriangles(), d_sleepTolerance.getValue(), d_corotated.getValue());
+
+    m_potentialEnergy = (this->*m_addForceKernel[mixed ? 1 : 0])(f, p);
+
+    if (m_sleepingActive)
+    {
+        m_sleeping.addSleepingForces(f, m_potentialEnergy);
+        d_activeElements.setValue(m_sleeping.getNbActive());
+        d_sleepErrorBound.setValue(m_sleeping.getErrorBound());
+    }
+    else
     {
-        accumulateForce(f, p, i);
+        d_activeElements.setValue(_topology->getNbTriangles());
+        d_sleepErrorBound.setValue(0);
     }
 
+    if (checkMixed)
+        d_mixedPrecisionError.setValue((Real)m_mixedError.relative());
+
     dataF.endEdit();
 
     //    stop = timer.getTime();
@@ -288,13 +456,9 @@ void TriangularShellForceField<DataTypes>::addDForce(const sofa::core::Mechanica
     //
     //    start = timer.getTime();
 
-    int nbTriangles=_topology->getNbTriangles();
     df.resize(dp.size());
 
-    for (int i=0; i<nbTriangles; i++)
-    {
-        applyStiffness(df, dp, i, kFactor);
-    }
+    (this->*m_addDForceKernel[m_singleStiffness ? 1 : 0])(df, dp, (Real)kFactor);
 
     datadF.endEdit();
 
@@ -302,6 +466,53 @@ void TriangularShellForceField<DataTypes>::addDForce(const sofa::core::Mechanica
     //    dmsg_info() << "time addDForce = " << stop-start ;
 }
 
+// --------------------------------------------------------------------------------------
+// --- Selection of the force loops
+// --------------------------------------------------------------------------------------
+template <class DataTypes>
+template <class Membrane>
+void TriangularShellForceField<DataTypes>::selectKernels(const bool bending)
+{
+    if (bending)
+        selectKernels<Membrane, DenseElement>();
+    else
+        selectKernels<Membrane, NoElement>();
+}
+
+template <class DataTypes>
+template <class Membrane, class Bending>
+void TriangularShellForceField<DataTypes>::selectKernels()
+{
+    m_addForceKernel[0] = &TriangularShellForceField<DataTypes>::template addForceElements<Membrane, Bending, false>;
+    m_addForceKernel[1] = &TriangularShellForceField<DataTypes>::template addForceElements<Membrane, Bending, true>;
+    m_addDForceKernel[0] = &TriangularShellForceField<DataTypes>::template addDForceElements<Membrane, Bending, false>;
+    m_addDForceKernel[1] = &TriangularShellForceField<DataTypes>::template addDForceElements<Membrane, Bending, true>;
+}
+
+template <class DataTypes>
+template <class Membrane, class Bending, bool Mixed>
+SReal TriangularShellForceField<DataTypes>::addForceElements(VecDeriv& f, const VecCoord& x)
+{
+    SReal energy = 0;
+    const Index nbTriangles = _topology->getNbTriangles();
+    for (Index i=0; i<nbTriangles; i++)
+    {
+        if (m_sleepingActive && m_sleeping.isAsleep(i))
+            continue;
+        accumulateForce<Membrane, Bending, Mixed>(f, x, i, energy);
+    }
+    return energy;
+}
+
+template <class DataTypes>
+template <class Membrane, class Bending, bool Mixed>
+void TriangularShellForceField<DataTypes>::addDForceElements(VecDeriv& df, const VecDeriv& dx, const Real kFactor)
+{
+    const Index nbTriangles = _topology->getNbTriangles();
+    for (Index i=0; i<nbTriangles; i++)
+        applyStiffness<Membrane, Bending, Mixed>(df, dx, i, kFactor);
+}
+
 //#define PRINT
 
 template<class DataTypes>
@@ -310,9 +521,6 @@ void TriangularShellForceField<DataTypes>::addKToMatrix(const core::MechanicalPa
     StiffnessMatrixFull K_gs;
 
     // Build Matrix Block for this ForceField
-    unsigned int i, j ,n1, n2, row, column, ROW, COLUMN;
-    Index node1, node2;
-
     sofa::core::behavior::MultiMatrixAccessor::MatrixRef r = matrix->getMatrix(this->mstate);
     type::vector<TriangleInformation>& triangleInf = *(triangleInfo.beginEdit());
 
@@ -334,37 +542,49 @@ void TriangularShellForceField<DataTypes>::addKToMatrix(const core::MechanicalPa
 #endif
     // XXX: Matrix not necessarily empty!
 
-    for(sofa::Index t=0 ; t != _topology->getNbTriangles() ; ++t)
+    if (d_laggedStiffness.getValue())
     {
-        const TriangleInformation &tinfo = triangleInf[t];
-        const Triangle triangle = _topology->getTriangle(t);
+        // Reuse the element matrices of a previous assembly as long as the
+        // frames have not rotated too much
+        const unsigned int maxAssemblies = d_laggedMaxAssemblies.getValue();
+        Real rotation = 0;
+        bool update = !m_laggedValid || (m_lagged.size() != triangleInf.size()) ||
+            ((maxAssemblies > 0) && (m_laggedAssemblies >= maxAssemblies));
+        if (!update) {
+            rotation = laggedRotationChange(triangleInf);
+            update = (rotation > d_laggedMaxRotation.getValue());
+        }
 
-        convertStiffnessMatrixToGlobalSpace(K_gs, tinfo);
+        if (update) {
+            updateLaggedStiffness(triangleInf);
+            rotation = 0;
+        }
+        m_laggedAssemblies++;
+        d_frameRotationChange.setValue(rotation);
 
-        // find index of node 1
-        for (n1=0; n1<3; n1++)
+        for(sofa::Index t=0 ; t != _topology->getNbTriangles() ; ++t)
         {
-            node1 = triangle[n1];
+            shell::misc::addSymmetricElementMatrix(r.matrix, r.offset, _topology->getTriangle(t),
+                m_lagged[t].K, (Real)-kFactor);
+        }
+    }
+    else
+    {
+        for(sofa::Index t=0 ; t != _topology->getNbTriangles() ; ++t)
+        {
+            const TriangleInformation &tinfo = triangleInf[t];
+            const Triangle triangle = _topology->getTriangle(t);
 
-            for(i=0; i<6; i++)
-            {
-                ROW = r.offset+6*node1+i;
-                row = 6*n1+i;
-                // find index of node 2
-                for (n2=0; n2<3; n2++)
-                {
-                    node2 = triangle[n2];
-
-                    for (j=0; j<6; j++)
-                    {
-                        COLUMN = r.offset+6*node2+j;
-                        column = 6*n2+j;
-                        r.matrix->add(ROW, COLUMN, - K_gs[row][column] * kFactor);
-                        //r.matrix->add(ROW, COLUMN, K_gs[row][column]);
-                    }
-                }
-            }
+            convertStiffnessMatrixToGlobalSpace(K_gs, tinfo);
+
+            shell::misc::addSymmetricElementMatrix(r.matrix, r.offset, triangle, K_gs, (Real)-kFactor);
+
+            if (m_geometricStiffness)
+                tinfo.geometric.addToMatrix(r.matrix, r.offset, triangle, (Real)kFactor);
         }
+
+        m_laggedValid = false;
+        d_stiffnessVersion.setValue(d_stiffnessVersion.getValue() + 1);
     }
 
 #ifdef PRINT
@@ -384,6 +604,72 @@ void TriangularShellForceField<DataTypes>::addKToMatrix(const core::MechanicalPa
     triangleInfo.endEdit();
 }
 
+template<class DataTypes>
+void TriangularShellForceField<DataTypes>::addNodeBlockDiagonal(NodeBlockDiagonal &blocks, const Real kFactor, const bool parallel)
+{
+    const type::vector<TriangleInformation>& ti = triangleInfo.getValue();
+
+    // Position of the membrane (u, v, θz) and bending (w, θx, θy) dofs in
+    // the node block
+    const unsigned int membraneDofs[3] = { 0, 1, 5 };
+    const unsigned int bendingDofs[3] = { 2, 3, 4 };
+
+    shell::misc::accumulateNodeBlocks(blocks, _topology, parallel,
+        [&](Mat<6,6,Real> &block, Index t, unsigned int j) {
+            const TriangleInformation &tinfo = ti[t];
+
+            Mat<6,6,Real> local;
+            local.clear();
+            shell::misc::addElementNodeBlock(local, tinfo.stiffnessMatrixMembrane, 3, j, membraneDofs);
+            shell::misc::addElementNodeBlock(local, tinfo.stiffnessMatrixBending, 3, j, bendingDofs);
+            shell::misc::addRotatedNodeBlock(block, local, tinfo.R, -kFactor);
+        });
+}
+
+
+// --------------------------------------------------------------------------------------
+// --- Lagged stiffness
+// --------------------------------------------------------------------------------------
+template<class DataTypes>
+typename TriangularShellForceField<DataTypes>::Real TriangularShellForceField<DataTypes>::laggedRotationChange(const type::vector<TriangleInformation> &ti) const
+{
+    // The angle of R * R_lagged^T is given by its trace, 1 + 2 cos(angle).
+    // Only the smallest cosine is needed.
+    Real minCos = 1;
+    for (std::size_t t=0; t<ti.size(); t++)
+    {
+        const Transformation &R = ti[t].R;
+        const Transformation &Rl = m_lagged[t].R;
+
+        Real trace = 0;
+        for (unsigned int i=0; i<3; i++)
+            for (unsigned int j=0; j<3; j++)
+                trace += R[i][j] * Rl[i][j];
+
+        minCos = std::min(minCos, (trace - 1)/2);
+    }
+
+    return std::acos(std::max(minCos, (Real)-1));
+}
+
+template<class DataTypes>
+void TriangularShellForceField<DataTypes>::updateLaggedStiffness(const type::vector<TriangleInformation> &ti)
+{
+    StiffnessMatrixFull K_gs;
+
+    m_lagged.resize(ti.size());
+    for (std::size_t t=0; t<ti.size(); t++)
+    {
+        convertStiffnessMatrixToGlobalSpace(K_gs, ti[t]);
+        m_lagged[t].R = ti[t].R;
+        m_lagged[t].K.set(K_gs);
+    }
+
+    m_laggedAssemblies = 0;
+    m_laggedValid = true;
+    d_stiffnessVersion.setValue(d_stiffnessVersion.getValue() + 1);
+}
+
 
 // --------------------------------------------------------------------------------------
 // --- Store the initial position of the nodes
@@ -392,86 +678,96 @@ template <class DataTypes>
 void TriangularShellForceField<DataTypes>::initTriangle(const int i, const Index&a, const Index&b, const Index&c, const VecCoord& x0)
 {
     type::vector<TriangleInformation>& ti = *(triangleInfo.beginEdit());
-    TriangleInformation *tinfo = &ti[i];
+    initTriangle(ti[i], a, b, c, x0);
+    triangleInfo.endEdit();
 
+    // The kept forces and lagged matrices no longer match the elements
+    m_laggedValid = false;
+    m_sleeping.clear();
+}
+
+template <class DataTypes>
+void TriangularShellForceField<DataTypes>::initTriangle(TriangleInformation &tinfo, const Index&a, const Index&b, const Index&c, const VecCoord& x0)
+{
     // Store indices of each vertex
-    tinfo->a = a;
-    tinfo->b = b;
-    tinfo->c = c;
+    tinfo.a = a;
+    tinfo.b = b;
+    tinfo.c = c;
 
-    tinfo->measure.resize(3);
-    tinfo->measure[0].id = a; tinfo->measure[0].point = Vec3(0,0,0);
-    tinfo->measure[1].id = b; tinfo->measure[1].point = Vec3(1,0,0);
-    tinfo->measure[2].id = c; tinfo->measure[2].point = Vec3(0,1,0);
+    tinfo.measure.resize(3);
+    tinfo.measure[0].id = a; tinfo.measure[0].point = Vec3(0,0,0);
+    tinfo.measure[1].id = b; tinfo.measure[1].point = Vec3(1,0,0);
+    tinfo.measure[2].id = c; tinfo.measure[2].point = Vec3(0,1,0);
 
     // Rotation from global to local frame
     Transformation R0;
 
     // Rest positions expressed in the local frame
-    tinfo->restPositions[0] = x0[a].getCenter();
-    tinfo->restPositions[1] = x0[b].getCenter();
-    tinfo->restPositions[2] = x0[c].getCenter();
+    tinfo.restPositions[0] = x0[a].getCenter();
+    tinfo.restPositions[1] = x0[b].getCenter();
+    tinfo.restPositions[2] = x0[c].getCenter();
 
     if (d_corotated.getValue()) {
         // Center the element
-        Vec3 center = (tinfo->restPositions[0] + tinfo->restPositions[1] +
-                       tinfo->restPositions[2])/3;
+        Vec3 center = (tinfo.restPositions[0] + tinfo.restPositions[1] +
+                       tinfo.restPositions[2])/3;
 
-        tinfo->restPositions[0] -= center;
-        tinfo->restPositions[1] -= center;
-        tinfo->restPositions[2] -= center;
+        tinfo.restPositions[0] -= center;
+        tinfo.restPositions[1] -= center;
+        tinfo.restPositions[2] -= center;
     }
 
-    computeRotation(R0, tinfo->restPositions);
-    tinfo->R = R0;
-    tinfo->Rt.transpose(R0);
+    computeRotation(R0, tinfo.restPositions);
+    tinfo.R = R0;
+    tinfo.Rt.transpose(R0);
 #ifdef CRQUAT
-    tinfo->Q.fromMatrix(tinfo->R);
+    tinfo.Q.fromMatrix(tinfo.R);
 #endif
 
-    tinfo->restPositions[0] = R0 * tinfo->restPositions[0];
-    tinfo->restPositions[1] = R0 * tinfo->restPositions[1];
-    tinfo->restPositions[2] = R0 * tinfo->restPositions[2];
+    tinfo.restPositions[0] = R0 * tinfo.restPositions[0];
+    tinfo.restPositions[1] = R0 * tinfo.restPositions[1];
+    tinfo.restPositions[2] = R0 * tinfo.restPositions[2];
 
 // Rest orientations -- inverted (!)
 #ifdef CRQUAT
-    tinfo->restOrientationsInv[0] = (tinfo->Q * x0[a].getOrientation()).inverse();
-    tinfo->restOrientationsInv[1] = (tinfo->Q * x0[b].getOrientation()).inverse();
-    tinfo->restOrientationsInv[2] = (tinfo->Q * x0[c].getOrientation()).inverse();
+    tinfo.restOrientationsInv[0] = (tinfo.Q * x0[a].getOrientation()).inverse();
+    tinfo.restOrientationsInv[1] = (tinfo.Q * x0[b].getOrientation()).inverse();
+    tinfo.restOrientationsInv[2] = (tinfo.Q * x0[c].getOrientation()).inverse();
 #else
-    x0[a].getOrientation().toMatrix(tinfo->restOrientationsInv[0]);
-    x0[b].getOrientation().toMatrix(tinfo->restOrientationsInv[1]);
-    x0[c].getOrientation().toMatrix(tinfo->restOrientationsInv[2]);
+    x0[a].getOrientation().toMatrix(tinfo.restOrientationsInv[0]);
+    x0[b].getOrientation().toMatrix(tinfo.restOrientationsInv[1]);
+    x0[c].getOrientation().toMatrix(tinfo.restOrientationsInv[2]);
 
-    tinfo->restOrientationsInv[0].transpose( tinfo->R * tinfo->restOrientationsInv[0] );
-    tinfo->restOrientationsInv[1].transpose( tinfo->R * tinfo->restOrientationsInv[1] );
-    tinfo->restOrientationsInv[2].transpose( tinfo->R * tinfo->restOrientationsInv[2] );
+    tinfo.restOrientationsInv[0].transpose( tinfo.R * tinfo.restOrientationsInv[0] );
+    tinfo.restOrientationsInv[1].transpose( tinfo.R * tinfo.restOrientationsInv[1] );
+    tinfo.restOrientationsInv[2].transpose( tinfo.R * tinfo.restOrientationsInv[2] );
 #endif
 
     // Do some precomputations
     // - directional vectors
-    tinfo->d[0] = tinfo->restPositions[0] - tinfo->restPositions[1];
-    tinfo->d[1] = tinfo->restPositions[1] - tinfo->restPositions[2];
-    tinfo->d[2] = tinfo->restPositions[2] - tinfo->restPositions[0];
+    tinfo.d[0] = tinfo.restPositions[0] - tinfo.restPositions[1];
+    tinfo.d[1] = tinfo.restPositions[1] - tinfo.restPositions[2];
+    tinfo.d[2] = tinfo.restPositions[2] - tinfo.restPositions[0];
 
     // - squared lengths
-    tinfo->l2[0] = tinfo->d[0][0]*tinfo->d[0][0] + tinfo->d[0][1]*tinfo->d[0][1];
-    tinfo->l2[1] = tinfo->d[1][0]*tinfo->d[1][0] + tinfo->d[1][1]*tinfo->d[1][1];
-    tinfo->l2[2] = tinfo->d[2][0]*tinfo->d[2][0] + tinfo->d[2][1]*tinfo->d[2][1];
+    tinfo.l2[0] = tinfo.d[0][0]*tinfo.d[0][0] + tinfo.d[0][1]*tinfo.d[0][1];
+    tinfo.l2[1] = tinfo.d[1][0]*tinfo.d[1][0] + tinfo.d[1][1]*tinfo.d[1][1];
+    tinfo.l2[2] = tinfo.d[2][0]*tinfo.d[2][0] + tinfo.d[2][1]*tinfo.d[2][1];
 
     // - triangle area
-    tinfo->area = helper::rabs(tinfo->d[2][0]*(-tinfo->d[0][1]) - (-tinfo->d[0][0])*tinfo->d[2][1])/2;
+    tinfo.area = helper::rabs(tinfo.d[2][0]*(-tinfo.d[0][1]) - (-tinfo.d[0][0])*tinfo.d[2][1])/2;
 
     // Compute stiffness matrix for membrane element
-    computeStiffnessMatrixMembrane(tinfo->stiffnessMatrixMembrane, *tinfo);
-    //dmsg_info() << "Km^e=" << tinfo->stiffnessMatrixMembrane ;
+    StiffnessMatrix K;
+    computeStiffnessMatrixMembrane(K, tinfo);
+    tinfo.stiffnessMatrixMembrane.set(StiffnessMatrixPacked(K), m_singleStiffness);
+    //dmsg_info() << "Km^e=" << K ;
 
     // Compute stiffness matrix for bending plate elemnt
-    computeStiffnessMatrixBending(tinfo->stiffnessMatrixBending, *tinfo);
-    //dmsg_info() << "Kb^e=" << tinfo->stiffnessMatrixBending ;
-
-
-    triangleInfo.endEdit();
+    K.clear();
+    computeStiffnessMatrixBending(K, tinfo);
+    tinfo.stiffnessMatrixBending.set(StiffnessMatrixPacked(K), m_singleStiffness);
+    //dmsg_info() << "Kb^e=" << K ;
 }
 
 
@@ -561,6 +857,8 @@ void TriangularShellForceField<DataTypes>::computeMaterialStiffness()
 
     materialMatrixMembrane = materialMatrix;
     materialMatrixBending = materialMatrix;
+    materialThickness = t;
+    materialPoisson = nu;
 
     // Integrate through the shell thickness
     materialMatrixMembrane *= t;
@@ -670,7 +968,8 @@ void TriangularShellForceField<DataTypes>::computeDisplacement(Displacement &Dm,
 // ---
 // --------------------------------------------------------------------------------------
 template <class DataTypes>
-void TriangularShellForceField<DataTypes>::accumulateForce(VecDeriv &f, const VecCoord &x, const Index elementIndex)
+template <class Membrane, class Bending, bool Mixed>
+void TriangularShellForceField<DataTypes>::accumulateForce(VecDeriv &f, const VecCoord &x, const Index elementIndex, SReal &energy)
 {
     type::vector<TriangleInformation>& triangleInf = *(triangleInfo.beginEdit());
     TriangleInformation *tinfo = &triangleInf[elementIndex];
@@ -686,7 +985,7 @@ void TriangularShellForceField<DataTypes>::accumulateForce(VecDeriv &f, const Ve
 
     // Compute the membrane and bending plate forces on this element
     Displacement Fm, Fb;
-    computeForce(Fm, Dm, Fb, Db, elementIndex);
+    computeForce<Membrane, Bending, Mixed>(Fm, Dm, Fb, Db, elementIndex);
 
     if (this->f_printLog.getValue()) {
         dmsg_info() << "E: " << elementIndex << "\tu: " << Dm << "\tf: " << Fm << "\n";
@@ -701,38 +1000,40 @@ void TriangularShellForceField<DataTypes>::accumulateForce(VecDeriv &f, const Ve
 
     }
 
-    // Compute the measure (stress/strain)
-    if (bMeasureStrain) {
-        type::vector<Real> &values = *d_measuredValues.beginEdit();
-        for (unsigned int i=0; i< tinfo->measure.size(); i++) {
-            Vec3 strain = tinfo->measure[i].B * Dm + tinfo->measure[i].Bb * Db;
-            // Norm from strain in x and y
-            // NOTE: Shear strain is not included
-            values[ tinfo->measure[i].id ] = helper::rsqrt(
-                strain[0] * strain[0] + strain[1] * strain[1]);
-        }
-        d_measuredValues.endEdit();
-    } else if (bMeasureStress) {
-        type::vector<Real> &values = *d_measuredValues.beginEdit();
-        for (unsigned int i=0; i< tinfo->measure.size(); i++) {
-            Vec3 stress = materialMatrix * tinfo->measure[i].B * Dm
-                          + materialMatrix * tinfo->measure[i].Bb * Db;
-            // Von Mises stress criterion (plane stress)
-            values[ tinfo->measure[i].id ] = helper::rsqrt(
-                stress[0] * stress[0] - stress[0] * stress[1]
-                + stress[1] * stress[1] + 3 * stress[2] * stress[2]);
-        }
-        d_measuredValues.endEdit();
-    }
+    // Keep the displacements for the measure
+    tinfo->measureDm = Dm;
+    tinfo->measureDb = Db;
+
+    // Strain energy 1/2 u^T K u in the corotational frame
+    const SReal elementEnergy = (Dm * Fm + Db * Fb) / 2;
+    energy += elementEnergy;
 
     // Transform forces back into global frame
-    getVCenter(f[a]) -= tinfo->Rt * Vec3(Fm[0], Fm[1], Fb[0]);
-    getVCenter(f[b]) -= tinfo->Rt * Vec3(Fm[3], Fm[4], Fb[3]);
-    getVCenter(f[c]) -= tinfo->Rt * Vec3(Fm[6], Fm[7], Fb[6]);
+    const Deriv fe[3] = {
+        Deriv(-(tinfo->Rt * Vec3(Fm[0], Fm[1], Fb[0])), -(tinfo->Rt * Vec3(Fb[1], Fb[2], Fm[2]))),
+        Deriv(-(tinfo->Rt * Vec3(Fm[3], Fm[4], Fb[3])), -(tinfo->Rt * Vec3(Fb[4], Fb[5], Fm[5]))),
+        Deriv(-(tinfo->Rt * Vec3(Fm[6], Fm[7], Fb[6])), -(tinfo->Rt * Vec3(Fb[7], Fb[8], Fm[8])))
+    };
+    f[a] += fe[0];
+    f[b] += fe[1];
+    f[c] += fe[2];
+
+    if (m_sleepingActive) {
+        const Index nodes[3] = { a, b, c };
+        const Real normM = tinfo->stiffnessMatrixMembrane.norm();
+        const Real normB = tinfo->stiffnessMatrixBending.norm();
+        Real localRotation = 0;
+        for (unsigned int k=0; k<3; k++)
+            localRotation = std::max(localRotation, Vec3(Db[3*k+1], Db[3*k+2], Dm[3*k+2]).norm());
+        m_sleeping.store(elementIndex, x, nodes, fe, elementEnergy, std::sqrt(normM*normM + normB*normB), localRotation);
+    }
 
-    getVOrientation(f[a]) -= tinfo->Rt * Vec3(Fb[1], Fb[2], Fm[2]);
-    getVOrientation(f[b]) -= tinfo->Rt * Vec3(Fb[4], Fb[5], Fm[5]);
-    getVOrientation(f[c]) -= tinfo->Rt * Vec3(Fb[7], Fb[8], Fm[8]);
+    if (m_geometricStiffness) {
+        tinfo->geometric.setEdgeFrame(tinfo->deformedPositions, tinfo->R);
+        tinfo->geometric.setForce(0, tinfo->Rt * Vec3(Fm[0], Fm[1], Fb[0]), tinfo->Rt * Vec3(Fb[1], Fb[2], Fm[2]));
+        tinfo->geometric.setForce(1, tinfo->Rt * Vec3(Fm[3], Fm[4], Fb[3]), tinfo->Rt * Vec3(Fb[4], Fb[5], Fm[5]));
+        tinfo->geometric.setForce(2, tinfo->Rt * Vec3(Fm[6], Fm[7], Fb[6]), tinfo->Rt * Vec3(Fb[7], Fb[8], Fm[8]));
+    }
 
     triangleInfo.endEdit();
 }
@@ -773,14 +1074,36 @@ void TriangularShellForceField<DataTypes>::computeStiffnessMatrixBending(Stiffne
 // ---  Compute force F = K * u
 // --------------------------------------------------------------------------------------
 template <class DataTypes>
+template <class Membrane, class Bending, bool Mixed>
 void TriangularShellForceField<DataTypes>::computeForce(Displacement &Fm, const Displacement& Dm, Displacement &Fb, const Displacement& Db,const Index elementIndex)
 {
     type::vector<TriangleInformation>& triangleInf = *(triangleInfo.beginEdit());
     TriangleInformation &tinfo = triangleInf[elementIndex];
 
     // Compute forces
-    Fm = tinfo.stiffnessMatrixMembrane * Dm;
-    Fb = tinfo.stiffnessMatrixBending * Db;
+    if constexpr (Mixed) {
+        Membrane::multiply(Fm, tinfo.stiffnessMatrixMembrane.single(), Dm);
+        Bending::multiply(Fb, tinfo.stiffnessMatrixBending.single(), Db);
+
+        if (d_checkMixedPrecision.getValue()) {
+            // Only the single precision matrices are stored, the reference
+            // ones are computed again (on a copy, the element is not touched)
+            TriangleInformation ref = tinfo;
+            StiffnessMatrix K;
+            Displacement Fm_full, Fb_full;
+            K.clear();
+            computeStiffnessMatrixMembrane(K, ref);
+            Membrane::multiply(Fm_full, StiffnessMatrixPacked(K), Dm);
+            K.clear();
+            computeStiffnessMatrixBending(K, ref);
+            Bending::multiply(Fb_full, StiffnessMatrixPacked(K), Db);
+            m_mixedError.add(Fm, Fm_full);
+            m_mixedError.add(Fb, Fb_full);
+        }
+    } else {
+        Membrane::multiply(Fm, tinfo.stiffnessMatrixMembrane.full(), Dm);
+        Bending::multiply(Fb, tinfo.stiffnessMatrixBending.full(), Db);
+    }
 
     triangleInfo.endEdit();
 }
@@ -790,7 +1113,8 @@ void TriangularShellForceField<DataTypes>::computeForce(Displacement &Fm, const
 // ---
 // --------------------------------------------------------------------------------------
 template <class DataTypes>
-void TriangularShellForceField<DataTypes>::applyStiffness(VecDeriv& v, const VecDeriv& dx, const Index elementIndex, const double kFactor)
+template <class Membrane, class Bending, bool Mixed>
+void TriangularShellForceField<DataTypes>::applyStiffness(VecDeriv& v, const VecDeriv& dx, const Index elementIndex, const Real kFactor)
 {
     type::vector<TriangleInformation>& ti = *(triangleInfo.beginEdit());
     TriangleInformation &tinfo = ti[elementIndex];
@@ -840,8 +1164,13 @@ void TriangularShellForceField<DataTypes>::applyStiffness(VecDeriv& v, const Vec
 
     // Compute dF
     Displacement dFm, dFb;
-    dFm = tinfo.stiffnessMatrixMembrane * Dm;
-    dFb = tinfo.stiffnessMatrixBending * Db;
+    if constexpr (Mixed) {
+        Membrane::multiply(dFm, tinfo.stiffnessMatrixMembrane.single(), Dm);
+        Bending::multiply(dFb, tinfo.stiffnessMatrixBending.single(), Db);
+    } else {
+        Membrane::multiply(dFm, tinfo.stiffnessMatrixMembrane.full(), Dm);
+        Bending::multiply(dFb, tinfo.stiffnessMatrixBending.full(), Db);
+    }
 
     if (this->f_printLog.getValue()) {
         dmsg_info() << "E: " << elementIndex << "\tdu: " << Dm << "\tdf: " << dFm << "\n";
@@ -861,6 +1190,19 @@ void TriangularShellForceField<DataTypes>::applyStiffness(VecDeriv& v, const Vec
     getVOrientation(v[b]) -= tinfo.Rt * Vec3(dFb[4], dFb[5], dFm[5]) * kFactor;
     getVOrientation(v[c]) -= tinfo.Rt * Vec3(dFb[7], dFb[8], dFm[8]) * kFactor;
 
+    // Rotation of the element forces with the frame
+    if (m_geometricStiffness) {
+        const Vec3 theta = tinfo.geometric.spin(getVCenter(dx[a]), getVCenter(dx[b]), getVCenter(dx[c]));
+
+        getVCenter(v[a]) += tinfo.geometric.dForce(0, theta) * kFactor;
+        getVCenter(v[b]) += tinfo.geometric.dForce(1, theta) * kFactor;
+        getVCenter(v[c]) += tinfo.geometric.dForce(2, theta) * kFactor;
+
+        getVOrientation(v[a]) += tinfo.geometric.dMoment(0, theta) * kFactor;
+        getVOrientation(v[b]) += tinfo.geometric.dMoment(1, theta) * kFactor;
+        getVOrientation(v[c]) += tinfo.geometric.dMoment(2, theta) * kFactor;
+    }
+
     triangleInfo.endEdit();
 }
 
@@ -875,7 +1217,7 @@ void TriangularShellForceField<DataTypes>::convertStiffnessMatrixToGlobalSpace(S
 
 
     // Copy the stiffness matrix into 18x18 matrix (the new index of each block in global matrix is a combination of 0, 6 and 12 in indices)
-    const StiffnessMatrix &K = tinfo.stiffnessMatrixMembrane;
+    const StiffnessMatrixPacked K = tinfo.stiffnessMatrixMembrane.toFull();
     for (unsigned int bx=0; bx<3; bx++)
     {
         // Global row index
@@ -887,25 +1229,25 @@ void TriangularShellForceField<DataTypes>::convertStiffnessMatrixToGlobalSpace(S
             jg = 6*by;
 
             // linear X
-            K_18x18[ig+0][jg+0] = K[3*bx+0][3*by+0]; // linear X
-            K_18x18[ig+0][jg+1] = K[3*bx+0][3*by+1]; // linear Y
-            K_18x18[ig+0][jg+5] = K[3*bx+0][3*by+2]; // angular Z
+            K_18x18[ig+0][jg+0] = K(3*bx+0, 3*by+0); // linear X
+            K_18x18[ig+0][jg+1] = K(3*bx+0, 3*by+1); // linear Y
+            K_18x18[ig+0][jg+5] = K(3*bx+0, 3*by+2); // angular Z
 
             // linear Y
-            K_18x18[ig+1][jg+0] = K[3*bx+1][3*by+0]; // linear X
-            K_18x18[ig+1][jg+1] = K[3*bx+1][3*by+1]; // linear Y
-            K_18x18[ig+1][jg+5] = K[3*bx+1][3*by+2]; // angular Z
+            K_18x18[ig+1][jg+0] = K(3*bx+1, 3*by+0); // linear X
+            K_18x18[ig+1][jg+1] = K(3*bx+1, 3*by+1); // linear Y
+            K_18x18[ig+1][jg+5] = K(3*bx+1, 3*by+2); // angular Z
 
             // angular Z
-            K_18x18[ig+5][jg+0] = K[3*bx+2][3*by+0]; // linear X
-            K_18x18[ig+5][jg+1] = K[3*bx+2][3*by+1]; // linear Y
-            K_18x18[ig+5][jg+5] = K[3*bx+2][3*by+2]; // angular Z
+            K_18x18[ig+5][jg+0] = K(3*bx+2, 3*by+0); // linear X
+            K_18x18[ig+5][jg+1] = K(3*bx+2, 3*by+1); // linear Y
+            K_18x18[ig+5][jg+5] = K(3*bx+2, 3*by+2); // angular Z
         }
     }
 
 
     // Copy the stiffness matrix by block 3x3 into global matrix (the new index of each bloc into global matrix is a combination of 2, 8 and 15 in indices)
-    const StiffnessMatrix &K_bending = tinfo.stiffnessMatrixBending;
+    const StiffnessMatrixPacked K_bending = tinfo.stiffnessMatrixBending.toFull();
     for (unsigned int bx=0; bx<3; bx++)
     {
         // Global row index
@@ -921,7 +1263,7 @@ void TriangularShellForceField<DataTypes>::convertStiffnessMatrixToGlobalSpace(S
             {
                 for (unsigned int j=0; j<3; j++)
                 {
-                    K_18x18[ig+i][jg+j] += K_bending[3*bx+i][3*by+j];
+                    K_18x18[ig+i][jg+j] += K_bending(3*bx+i, 3*by+j);
                 }
             }
 
@@ -929,22 +1271,8 @@ void TriangularShellForceField<DataTypes>::convertStiffnessMatrixToGlobalSpace(S
     }
 
 
-    // Extend rotation matrix and its transpose
-    StiffnessMatrixFull R18x18, Rt18x18;
-
-    for(unsigned int i=0;i<3;++i)
-    {
-        for(unsigned int j=0;j<3;++j)
-        {
-            R18x18[i][j] = R18x18[i+3][j+3] = R18x18[i+6][j+6] = R18x18[i+9][j+9] = R18x18[i+12][j+12] = R18x18[i+15][j+15] = tinfo.R[i][j];
-            Rt18x18[i][j] = Rt18x18[i+3][j+3] = Rt18x18[i+6][j+6] = Rt18x18[i+9][j+9] = Rt18x18[i+12][j+12] = Rt18x18[i+15][j+15] = tinfo.Rt[i][j];
-        }
-    }
-
     // Then we put the stifness matrix into the global frame
-    K_gs = Rt18x18 * K_18x18 * R18x18;
-    //dmsg_info() << "R=" << R18x18 << " -- " << Rt18x18 ;
-    //dmsg_info() << "K_gs=" << K_gs ;
+    shell::misc::rotateSymmetric18(K_gs, K_18x18, tinfo.R, tinfo.Rt);
 }
 
 
@@ -1005,7 +1333,7 @@ template <class DataTypes>
 void TriangularShellForceField<DataTypes>::andesTemplate(StiffnessMatrix &K, const TriangleInformation &tinfo,
                                                          const Real alpha, const AndesBeta &beta)
 {
-    Real h = d_thickness.getValue();
+    Real h = materialThickness;
     Real A4 = 4*tinfo.area;
 
     // Force-lumping matrix
@@ -1154,11 +1482,16 @@ void TriangularShellForceField<DataTypes>::computeStiffnessMatrixLSTRet(Stiffnes
 
 // Optimal ANDES membrane element
 // See: C. A. Felippa, A study of optimal membrane triangles with drilling freedoms, 2003
+template <class DataTypes>
+typename TriangularShellForceField<DataTypes>::Real TriangularShellForceField<DataTypes>::andesOptBeta0(const Real nu)
+{
+    return helper::rmax(0.5 - 2.0*nu*nu, 0.01);
+}
+
 template <class DataTypes>
 void TriangularShellForceField<DataTypes>::computeStiffnessMatrixAndesOpt(StiffnessMatrix &K, TriangleInformation &tinfo)
 {
-    Real beta0 = helper::rmax(0.5 - 2.0*d_poisson.getValue()*d_poisson.getValue(), 0.01);
-    return andesTemplate(K, tinfo, 3.0/2.0, AndesBeta(beta0, 1.0, 2.0, 1.0, 0.0, 1.0, -1.0, -1.0, -1.0, -2.0));
+    return andesTemplate(K, tinfo, 3.0/2.0, AndesBeta(andesOptBeta0(materialPoisson), 1.0, 2.0, 1.0, 0.0, 1.0, -1.0, -1.0, -1.0, -2.0));
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - 
@@ -1276,6 +1609,71 @@ void TriangularShellForceField<DataTypes>::dktSD(StrainDisplacement &B, const Tr
     B /= 2*tinfo.area;
 }
 
+// --------------------------------------------------------------------------------------
+// --- Measure of stress or strain, done once per (measurePeriod) time step(s)
+// --------------------------------------------------------------------------------------
+template <class DataTypes>
+void TriangularShellForceField<DataTypes>::handleEvent(sofa::core::objectmodel::Event *event)
+{
+    if (dynamic_cast<sofa::simulation::AnimateEndEvent*>(event))
+    {
+        if (!bMeasureStrain && !bMeasureStress)
+            return;
+
+        const unsigned int period = d_measurePeriod.getValue();
+        if (period == 0 || ++m_measureStep < period)
+            return;
+
+        m_measureStep = 0;
+        computeMeasure();
+    }
+}
+
+template <class DataTypes>
+void TriangularShellForceField<DataTypes>::computeMeasure()
+{
+    type::vector<TriangleInformation>& ti = *(triangleInfo.beginEdit());
+    const bool strain = bMeasureStrain;
+
+    // Each element only writes into its own measure points
+    shell::misc::parallelForRange(d_parallelMeasure.getValue(), std::size_t(0), ti.size(),
+        [&](std::size_t begin, std::size_t end) {
+            for (std::size_t t=begin; t<end; t++) {
+                TriangleInformation &tinfo = ti[t];
+                for (auto &mp : tinfo.measure) {
+                    if (strain) {
+                        Vec3 e = mp.B * tinfo.measureDm + mp.Bb * tinfo.measureDb;
+                        // Norm from strain in x and y
+                        // NOTE: Shear strain is not included
+                        mp.value = helper::rsqrt(e[0] * e[0] + e[1] * e[1]);
+                    } else {
+                        Vec3 stress = materialMatrix * (mp.B * tinfo.measureDm + mp.Bb * tinfo.measureDb);
+                        // Von Mises stress criterion (plane stress)
+                        mp.value = helper::rsqrt(
+                            stress[0] * stress[0] - stress[0] * stress[1]
+                            + stress[1] * stress[1] + 3 * stress[2] * stress[2]);
+                    }
+                }
+            }
+        });
+
+    // Gather into the back buffer. Points shared by several elements get the
+    // value of the last one, as they always did.
+    m_measureBuffer.resize(d_measuredValues.getValue().size());
+    for (const TriangleInformation &tinfo : ti) {
+        for (const auto &mp : tinfo.measure)
+            m_measureBuffer[mp.id] = mp.value;
+    }
+
+    triangleInfo.endEdit();
+
+    // Swap the buffers, the published values are always complete
+    d_measuredValues.beginEdit()->swap(m_measureBuffer);
+    d_measuredValues.endEdit();
+
+    m_measureWriter.write(this->getContext()->getTime(), d_measuredValues.getValue());
+}
+
 template <class DataTypes>
 void TriangularShellForceField<DataTypes>::draw(const core::visual::VisualParams* vparams){
    // Draw arrows from using shell triangle info (tinfo.R) in the center of the triangle
@@ -35,6 +35,7 @@
 #include <sofa/component/topology/container/dynamic/TriangleSetTopologyContainer.h>
 
 #include <Shell/forcefield/TriangularBendingFEMForceField.h>
+#include <Shell/misc/DrawBuffer.h>
 
 #include <sofa/defaulttype/VecTypes.h>
 #include <sofa/helper/system/thread/CTime.h>
@@ -135,6 +136,7 @@ protected:
 
         type::vector<Vec3> colourMapping;
         type::vector<Vec3> coloursPerVertex;
+        shell::misc::DrawBuffer drawBuffer;
         type::vector<Real> vectorErrorCoarse;
         type::vector<Real> vectorErrorTarget;
 
@@ -1038,65 +1038,37 @@ void BendingPlateMechanicalMapping<TIn, TOut>::applyJT(const core::ConstraintPar
 template <class TIn, class TOut>
 void BendingPlateMechanicalMapping<TIn, TOut>::draw(const core::visual::VisualParams* vparams)
 {
-    const OutVecCoord &outVertices = this->toModel->read(sofa::core::vec_id::read_access::position)->getValue();
+    const Data<OutVecCoord> *dataOut = this->toModel->read(sofa::core::vec_id::read_access::position);
+    const OutVecCoord &outVertices = dataOut->getValue();
 
     if(vparams->displayFlags().getShowVisualModels())
     {
-        glDisable(GL_LIGHTING);
-
         if (measureError.getValue())
         {
-            shader.TurnOn();
-
-
+            // Rebuild the arrays only when the mapped positions changed
             const SeqTriangles &outTriangles = outputTopo->getTriangles();
-            unsigned int index;
+            if (!drawBuffer.isValid(dataOut->getCounter()) ||
+                (drawBuffer.points.size() != 3*outTriangles.size()))
+            {
+                drawBuffer.setTriangles(outVertices, outTriangles, coloursPerVertex);
+                drawBuffer.validate(dataOut->getCounter());
+            }
 
-            glEnable(GL_DEPTH_TEST);
-            glPolygonOffset(1.0, 1.0);
+            const auto stateLifeCycle = vparams->drawTool()->makeStateLifeCycle();
+            vparams->drawTool()->disableLighting();
+            vparams->drawTool()->enableDepthTest();
+
+            shader.TurnOn();
 
             if(vparams->displayFlags().getShowWireFrame())
             {
-                glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-                glEnable(GL_POLYGON_OFFSET_LINE);
-                glColor4f(0.0, 0.0, 1.0, 1.0);
-                glBegin(GL_TRIANGLES);
-                for (unsigned int i=0; i<outTriangles.size(); i++)
-                {
-                    index = outTriangles[i][0];
-                    glVertex3f(outVertices[index][0], outVertices[index][1], outVertices[index][2]);
-
-                    index = outTriangles[i][1];
-                    glVertex3f(outVertices[index][0], outVertices[index][1], outVertices[index][2]);
-
-                    index = outTriangles[i][2];
-                    glVertex3f(outVertices[index][0], outVertices[index][1], outVertices[index][2]);
-                }
-                glEnd();
-                glDisable(GL_POLYGON_OFFSET_LINE);
+                vparams->drawTool()->setPolygonMode(0, true);
+                vparams->drawTool()->drawTriangles(drawBuffer.points, sofa::type::RGBAColor(0.0, 0.0, 1.0, 1.0));
+                vparams->drawTool()->setPolygonMode(0, false);
             }
             else
             {
-                glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-                glEnable(GL_POLYGON_OFFSET_FILL);
-                //            glColor4f(0.0, 0.0, 0.0, 0.0);
-                glBegin(GL_TRIANGLES);
-                for (unsigned int i=0; i<outTriangles.size(); i++)
-                {
-                    index = outTriangles[i][0];
-                    glColor4f(coloursPerVertex[index][0], coloursPerVertex[index][1], coloursPerVertex[index][2], 1.0);
-                    glVertex3f(outVertices[index][0], outVertices[index][1], outVertices[index][2]);
-
-                    index = outTriangles[i][1];
-                    glColor4f(coloursPerVertex[index][0], coloursPerVertex[index][1], coloursPerVertex[index][2], 1.0);
-                    glVertex3f(outVertices[index][0], outVertices[index][1], outVertices[index][2]);
-
-                    index = outTriangles[i][2];
-                    glColor4f(coloursPerVertex[index][0], coloursPerVertex[index][1], coloursPerVertex[index][2], 1.0);
-                    glVertex3f(outVertices[index][0], outVertices[index][1], outVertices[index][2]);
-                }
-                glEnd();
-                glDisable(GL_POLYGON_OFFSET_FILL);
+                vparams->drawTool()->drawTriangles(drawBuffer.points, drawBuffer.colours);
             }
 
             shader.TurnOff();
@@ -42,9 +42,8 @@
 #include <sofa/helper/system/thread/CTime.h>
 
 #include <Shell/forcefield/BezierTriangularBendingFEMForceField.h>
+#include <Shell/misc/DrawBuffer.h>
 
-// Use quaternions for rotations
-//#define ROTQ
 // We have own code to check the getJ() because checkJacobian sucks (at this
 // point in time).
 //#define CHECK_J
@@ -115,11 +114,14 @@ public:
     , bezierForcefield(NULL)
     , normals(initData(&normals, "normals","Node normals at the rest shape"))
     , measureError(initData(&measureError, false, "measureError","Error with high resolution mesh"))
+    , parallel(initData(&parallel, false, "parallel","Evaluate the mapping in parallel over the triangles"))
     , targetTopology(initLink("targetTopology","Targeted high resolution topology"))
     , verticesTarget(OutVecCoord()) // dummy initialization
     , trianglesTarget(SeqTriangles()) // dummy initialization
     , matrixJ()
     , updateJ(false)
+    , netSource(NULL)
+    , netCounter(-1)
     {
     }
 
@@ -188,11 +190,14 @@ protected:
     , bezierForcefield(NULL)
     , normals(initData(&normals, "normals","Node normals at the rest shape"))
     , measureError(initData(&measureError, false, "measureError","Error with high resolution mesh"))
+    , parallel(initData(&parallel, false, "parallel","Evaluate the mapping in parallel over the triangles"))
     , targetTopology(initLink("targetTopology","Targeted high resolution topology"))
     , verticesTarget(OutVecCoord()) // dummy initialization
     , trianglesTarget(SeqTriangles()) // dummy initialization
     , matrixJ()
     , updateJ(false)
+    , netSource(NULL)
+    , netCounter(-1)
     {
     }
 
@@ -210,11 +215,18 @@ protected:
         Vec3 P2_P0;
         Vec3 P2_P1;
 
-        // Contains the list of poinst connected to this triangle
-        sofa::type::vector<int> attachedPoints;
+        // Rotation matrices at corner nodes
+        sofa::type::fixed_array<Mat33, 3> R;
 
     } TriangleInformation;
 
+    // A point attached to a triangle
+    typedef struct {
+        Index point;                            // Index of the 'out' point
+        Vec3 bary;                              // Barycentric coordinates
+        sofa::type::fixed_array<Real, 10> w;    // Weights of the Bézier nodes
+    } AttachedPoint;
+
     gl::GLSLShader shader;
 
     BaseMeshTopology* inputTopo;
@@ -225,6 +237,7 @@ protected:
 
     Data< type::vector<Vec3> > normals;
     Data<bool> measureError;
+    Data<bool> parallel;
     SingleLink<BezierTriangleMechanicalMapping<TIn, TOut>,
     sofa::core::topology::BaseMeshTopology,
     BaseLink::FLAG_STOREPATH|BaseLink::FLAG_STRONGLINK> targetTopology;
@@ -235,14 +248,31 @@ protected:
 
     type::vector<Vec3> colourMapping;
     type::vector<Vec3> coloursPerVertex;
+    shell::misc::DrawBuffer drawBuffer;
     type::vector<Real> vectorErrorCoarse;
     type::vector<Real> vectorErrorTarget;
 
     type::vector<TriangleInformation> triangleInfo;
 
+    // Attached points sorted by triangle, points of triangle t are in
+    // [attachedOffsets[t], attachedOffsets[t+1])
+    type::vector<AttachedPoint> attachedPoints;
+    type::vector<Index> attachedOffsets;
+
+    // Forces and torques on corner nodes per triangle, used by applyJT()
+    type::vector<Vec3> triangleForces;
+
     std::unique_ptr<MatrixType> matrixJ;
     bool updateJ;
 
+    // The positions the Bézier nodes in triangleInfo were computed from
+    const Data<InVecCoord>* netSource;
+    int netCounter;
+
+    // Compute the Bézier nodes and corner rotations of all triangles, unless
+    // they are already up to date with the positions
+    void updateControlNet(const Data<InVecCoord>& dIn);
+
     // Pointer on the topological mapping to retrieve the list of edges
     // XXX: The edges are no longer there!!!
     //TriangleSubdivisionTopologicalMapping* triangleSubdivisionTopologicalMapping;
@@ -253,6 +283,10 @@ protected:
     void ComputeNormals(type::vector<Vec3> &normals);
     void FindTriangleInNormalDirection(const InVecCoord& highResVertices, const SeqTriangles highRestriangles, const type::vector<Vec3> &normals);
 
+    // Fills attachedPoints and attachedOffsets from the triangle each 'out'
+    // point was attached to
+    void buildAttachedPoints(const type::vector<Index> &attachedTriangle, unsigned int nbTriangles);
+
     // Computes the barycentric coordinates of a vertex within a triangle
     void computeBaryCoefs(Vec3 &baryCoefs, const Vec3 &p, const Vec3 &a, const Vec3 &b, const Vec3 &c, bool bConstraint = true);
 
@@ -28,6 +28,7 @@
 #include <Shell/mapping/BezierTriangleMechanicalMapping.h>
 #include <sofa/component/topology/container/dynamic/TriangleSetTopologyContainer.h>
 #include <sofa/core/visual/VisualParams.h>
+#include <Shell/misc/ParallelFor.h>
 
 namespace sofa
 {
@@ -164,10 +165,11 @@ void BezierTriangleMechanicalMapping<TIn, TOut>::init()
             tinfo.P2_P0 = inVerticesRigid0[c].getOrientation().inverseRotate( tinfo.bezierNodes[8] );
 
         }
-
-        tinfo.attachedPoints.clear();
     }
 
+    // Triangle to which each 'out' vertex is attached
+    type::vector<Index> attachedTriangle(outVertices.size(), sofa::InvalidID);
+
 
     // Iterates over 'out' vertices
     for (unsigned int i=0; i<outVertices.size(); i++)
@@ -209,7 +211,7 @@ void BezierTriangleMechanicalMapping<TIn, TOut>::init()
             else
             {
                 triangleID = trianglesAroundVertex[0];
-                triangleInfo[triangleID].attachedPoints.push_back(i);
+                attachedTriangle[i] = triangleID;
 
                 // Computes barycentric coordinates within the triangle
                 computeBaryCoefs(vertexBaryCoord, outVertices[i],
@@ -234,7 +236,7 @@ void BezierTriangleMechanicalMapping<TIn, TOut>::init()
             else
             {
                 triangleID = trianglesAroundEdge[0];
-                triangleInfo[triangleID].attachedPoints.push_back(i);
+                attachedTriangle[i] = triangleID;
 
                 // Computes barycentric coordinates within the triangle
                 computeBaryCoefs(vertexBaryCoord, outVertices[i],
@@ -250,7 +252,7 @@ void BezierTriangleMechanicalMapping<TIn, TOut>::init()
         if (which == 2)
         {
             // If it is a triangle, consider it
-            triangleInfo[closestTriangle].attachedPoints.push_back(i);
+            attachedTriangle[i] = closestTriangle;
 
             // Computes barycentric coordinates within each triangles
             computeBaryCoefs(vertexBaryCoord, outVertices[i],
@@ -263,6 +265,12 @@ void BezierTriangleMechanicalMapping<TIn, TOut>::init()
         }
     }
 
+    buildAttachedPoints(attachedTriangle, inTriangles.size());
+
+    // Force the computation of the Bézier nodes
+    netSource = NULL;
+    netCounter = -1;
+
 
 #if 0
     // Retrieves topological mapping to get list of edges  (for contour rendering)
@@ -334,6 +342,131 @@ void BezierTriangleMechanicalMapping<TIn, TOut>::reinit()
 }
 
 
+template <class TIn, class TOut>
+void BezierTriangleMechanicalMapping<TIn, TOut>::buildAttachedPoints(const type::vector<Index> &attachedTriangle, unsigned int nbTriangles)
+{
+    // Count the points of each triangle
+    attachedOffsets.assign(nbTriangles+1, 0);
+    for (unsigned int i=0; i<attachedTriangle.size(); i++)
+    {
+        if (attachedTriangle[i] != sofa::InvalidID)
+            attachedOffsets[ attachedTriangle[i]+1 ]++;
+    }
+    for (unsigned int t=0; t<nbTriangles; t++)
+    {
+        attachedOffsets[t+1] += attachedOffsets[t];
+    }
+
+    // Store the points sorted by triangle with precomputed weights
+    attachedPoints.resize(attachedOffsets[nbTriangles]);
+    type::vector<Index> next(attachedOffsets.begin(), attachedOffsets.end()-1);
+    for (unsigned int i=0; i<attachedTriangle.size(); i++)
+    {
+        if (attachedTriangle[i] == sofa::InvalidID)
+            continue;
+
+        AttachedPoint &ap = attachedPoints[ next[attachedTriangle[i]]++ ];
+        const Vec3 &bc = barycentricCoordinates[i];
+        ap.point = i;
+        ap.bary = bc;
+        ap.w[0] = bc[0]*bc[0]*bc[0];
+        ap.w[1] = bc[1]*bc[1]*bc[1];
+        ap.w[2] = bc[2]*bc[2]*bc[2];
+        ap.w[3] = 3*bc[0]*bc[0]*bc[1];
+        ap.w[4] = 3*bc[0]*bc[0]*bc[2];
+        ap.w[5] = 3*bc[1]*bc[1]*bc[2];
+        ap.w[6] = 3*bc[0]*bc[1]*bc[1];
+        ap.w[7] = 3*bc[0]*bc[2]*bc[2];
+        ap.w[8] = 3*bc[1]*bc[2]*bc[2];
+        ap.w[9] = 6*bc[0]*bc[1]*bc[2];
+    }
+}
+
+
+template <class TIn, class TOut>
+void BezierTriangleMechanicalMapping<TIn, TOut>::updateControlNet(const Data<InVecCoord>& dIn)
+{
+    // Nothing changed since the last call
+    if ((&dIn == netSource) && (dIn.getCounter() == netCounter))
+        return;
+
+    helper::ReadAccessor< Data<InVecCoord> > in = dIn;
+    const SeqTriangles& inTriangles = inputTopo->getTriangles();
+
+    shell::misc::parallelForRange(parallel.getValue(), (unsigned int)0, (unsigned int)inTriangles.size(),
+        [&](unsigned int begin, unsigned int end) {
+    for (unsigned int t=begin; t<end; t++)
+    {
+        TriangleInformation &tinfo = triangleInfo[t];
+        const Triangle &triangle = inTriangles[t];
+
+        // Rotation matrices at corner nodes
+        in[ triangle[0] ].getOrientation().toMatrix(tinfo.R[0]);
+        in[ triangle[1] ].getOrientation().toMatrix(tinfo.R[1]);
+        in[ triangle[2] ].getOrientation().toMatrix(tinfo.R[2]);
+
+        if (bezierForcefield)
+        {
+            // Use data from the force field
+            const typename BezierFF::TriangleInformation &fftinfo =
+                bezierForcefield->getTriangleInfo(t);
+            tinfo.bezierNodes = fftinfo.bezierNodes;
+
+            tinfo.P0_P1 = fftinfo.P0_P1_inFrame0;
+            tinfo.P0_P2 = fftinfo.P0_P2_inFrame0;
+            tinfo.P1_P2 = fftinfo.P1_P2_inFrame1;
+            tinfo.P1_P0 = fftinfo.P1_P0_inFrame1;
+            tinfo.P2_P0 = fftinfo.P2_P0_inFrame2;
+            tinfo.P2_P1 = fftinfo.P2_P1_inFrame2;
+
+        }
+        else
+        {
+            // Compute nodes of the Bézier triangle
+
+            // Corners
+            tinfo.bezierNodes[0] = in[ triangle[0] ].getCenter();
+            tinfo.bezierNodes[1] = in[ triangle[1] ].getCenter();
+            tinfo.bezierNodes[2] = in[ triangle[2] ].getCenter();
+
+#define BN(i, p, seg) do { \
+    tinfo.bezierNodes[(i)] = tinfo.bezierNodes[(p)] + \
+        tinfo.R[(p)] * tinfo.seg; \
+} while (0)
+
+            BN(3, 0, P0_P1);
+            BN(4, 0, P0_P2);
+            BN(5, 1, P1_P2);
+            BN(6, 1, P1_P0);
+            BN(7, 2, P2_P0);
+            BN(8, 2, P2_P1);
+
+#undef BN
+
+            // Center
+            tinfo.bezierNodes[9] =
+                (tinfo.bezierNodes[0] + tinfo.R[0]*( tinfo.P0_P1 + tinfo.P0_P2 ))/3.0 +
+                (tinfo.bezierNodes[1] + tinfo.R[1]*( tinfo.P1_P0 + tinfo.P1_P2 ))/3.0 +
+                (tinfo.bezierNodes[2] + tinfo.R[2]*( tinfo.P2_P0 + tinfo.P2_P1 ))/3.0;
+        }
+    }
+    });
+
+    // Only the current positions are worth remembering, other vectors (e.g.
+    // free positions) don't have to be current when applyJ() is called
+    if (&dIn == this->fromModel->read(sofa::core::vec_id::read_access::position))
+    {
+        netSource = &dIn;
+        netCounter = dIn.getCounter();
+    }
+    else
+    {
+        netSource = NULL;
+        netCounter = -1;
+    }
+}
+
+
 // Given H,S,L in range of 0-1
 // Returns a RGB colour in range of 0-255
 // http://www.geekymonkey.com/Programming/CSharp/RGB2HSL_HSL2RGB.htm
@@ -691,108 +824,28 @@ void BezierTriangleMechanicalMapping<TIn, TOut>::apply(const core::MechanicalPar
         return;
     }
 
-    // List of in triangles
-    const SeqTriangles& inTriangles = inputTopo->getTriangles();
+    // Compute the control nets
+    updateControlNet(dIn);
 
-    for (unsigned int t=0; t<inTriangles.size();t++)
+    // Go through the attached points
+    const unsigned int nbTriangles = inputTopo->getNbTriangles();
+    shell::misc::parallelForRange(parallel.getValue(), (unsigned int)0, nbTriangles,
+        [&](unsigned int begin, unsigned int end) {
+    for (unsigned int t=begin; t<end; t++)
     {
+        const sofa::type::fixed_array<Vec3,10> &bn = triangleInfo[t].bezierNodes;
 
-        TriangleInformation &tinfo = triangleInfo[t];
-        Triangle triangle = inTriangles[t];
-
-        if (bezierForcefield)
+        for (Index i=attachedOffsets[t]; i<attachedOffsets[t+1]; i++)
         {
-            // Use data from the force field
-            const typename BezierFF::TriangleInformation fftinfo = 
-                bezierForcefield->getTriangleInfo(t);
-            tinfo.bezierNodes = fftinfo.bezierNodes; 
-
-            tinfo.P0_P1 = fftinfo.P0_P1_inFrame0;
-            tinfo.P0_P2 = fftinfo.P0_P2_inFrame0;
-            tinfo.P1_P2 = fftinfo.P1_P2_inFrame1;
-            tinfo.P1_P0 = fftinfo.P1_P0_inFrame1;
-            tinfo.P2_P0 = fftinfo.P2_P0_inFrame2;
-            tinfo.P2_P1 = fftinfo.P2_P1_inFrame2;
+            const AttachedPoint &ap = attachedPoints[i];
 
+            out[ap.point] = bn[0] * ap.w[0] + bn[1] * ap.w[1] + bn[2] * ap.w[2] +
+                bn[3] * ap.w[3] + bn[4] * ap.w[4] + bn[5] * ap.w[5] +
+                bn[6] * ap.w[6] + bn[7] * ap.w[7] + bn[8] * ap.w[8] +
+                bn[9] * ap.w[9];
         }
-        else
-        {
-            // Compute nodes of the Bézier triangle
-
-            // Corners
-            tinfo.bezierNodes[0] = in[ triangle[0] ].getCenter();
-            tinfo.bezierNodes[1] = in[ triangle[1] ].getCenter();
-            tinfo.bezierNodes[2] = in[ triangle[2] ].getCenter();
-
-#ifdef ROTQ
-            Quaternion q[3] = {
-                in[ triangle[0] ].getOrientation(),
-                in[ triangle[1] ].getOrientation(),
-                in[ triangle[2] ].getOrientation() };
-
-#define BN(i, p, seg) do { \
-    tinfo.bezierNodes[(i)] = tinfo.bezierNodes[(p)] + \
-        q[(p)].rotate(tinfo.seg); \
-} while (0)
-
-#else
-            // Rotation matrices at corner nodes
-            Mat33 R[3];
-            in[ triangle[0] ].getOrientation().toMatrix(R[0]);
-            in[ triangle[1] ].getOrientation().toMatrix(R[1]);
-            in[ triangle[2] ].getOrientation().toMatrix(R[2]);
-
-#define BN(i, p, seg) do { \
-    tinfo.bezierNodes[(i)] = tinfo.bezierNodes[(p)] + \
-        R[(p)] * tinfo.seg; \
-} while (0)
-
-#endif
-            BN(3, 0, P0_P1);
-            BN(4, 0, P0_P2);
-            BN(5, 1, P1_P2);
-            BN(6, 1, P1_P0);
-            BN(7, 2, P2_P0);
-            BN(8, 2, P2_P1);
-
-#undef BN
-
-#ifdef ROTQ
-            // Center
-            tinfo.bezierNodes[9] =
-                (tinfo.bezierNodes[0] + q[0].rotate( tinfo.P0_P1 + tinfo.P0_P2 ))/3.0 +
-                (tinfo.bezierNodes[1] + q[1].rotate( tinfo.P1_P0 + tinfo.P1_P2 ))/3.0 +
-                (tinfo.bezierNodes[2] + q[2].rotate( tinfo.P2_P0 + tinfo.P2_P1 ))/3.0;
-#else
-            // Center
-            tinfo.bezierNodes[9] =
-                (tinfo.bezierNodes[0] + R[0]*( tinfo.P0_P1 + tinfo.P0_P2 ))/3.0 +
-                (tinfo.bezierNodes[1] + R[1]*( tinfo.P1_P0 + tinfo.P1_P2 ))/3.0 +
-                (tinfo.bezierNodes[2] + R[2]*( tinfo.P2_P0 + tinfo.P2_P1 ))/3.0;
-#endif
-
-        }
-
-        // Go through the attached points
-        for (unsigned int i=0; i<tinfo.attachedPoints.size(); i++)
-        {
-            Index pt = tinfo.attachedPoints[i] ;
-            Vec3 bc = barycentricCoordinates[pt];
-
-            // TODO: precompute the coefficients
-            out[pt] = tinfo.bezierNodes[0] * bc[0]*bc[0]*bc[0] +
-                tinfo.bezierNodes[1] * bc[1]*bc[1]*bc[1] +
-                tinfo.bezierNodes[2] * bc[2]*bc[2]*bc[2] +
-                tinfo.bezierNodes[3] * 3*bc[0]*bc[0]*bc[1] +
-                tinfo.bezierNodes[4] * 3*bc[0]*bc[0]*bc[2] +
-                tinfo.bezierNodes[5] * 3*bc[1]*bc[1]*bc[2] +
-                tinfo.bezierNodes[6] * 3*bc[0]*bc[1]*bc[1] +
-                tinfo.bezierNodes[7] * 3*bc[0]*bc[2]*bc[2] +
-                tinfo.bezierNodes[8] * 3*bc[1]*bc[2]*bc[2] +
-                tinfo.bezierNodes[9] * 6*bc[0]*bc[1]*bc[2];
-        }
-
     }
+    });
 
     //{
     //    std::cout << "| In[" << in.size() << "] : ";
@@ -844,13 +897,16 @@ void BezierTriangleMechanicalMapping<TIn, TOut>::applyJ(const core::MechanicalPa
 
     // List of in triangles
     const SeqTriangles& inTriangles = inputTopo->getTriangles();
-    //const type::vector<Rigid>& inVertices = *this->fromModel->getX();
-    const InVecCoord& inVertices = this->fromModel->read(sofa::core::vec_id::read_access::position)->getValue();
+
+    // Rotations at the current positions
+    updateControlNet(*this->fromModel->read(sofa::core::vec_id::read_access::position));
 
     // Compute nodes of the Bézier triangle for each input triangle
-    for (unsigned int t=0; t<inTriangles.size();t++)
+    shell::misc::parallelForRange(parallel.getValue(), (unsigned int)0, (unsigned int)inTriangles.size(),
+        [&](unsigned int begin, unsigned int end) {
+    for (unsigned int t=begin; t<end; t++)
     {
-        Triangle triangle = inTriangles[t];
+        const Triangle &triangle = inTriangles[t];
         TriangleInformation &tinfo = triangleInfo[t];
 
         // Velocities in corner nodes
@@ -864,17 +920,10 @@ void BezierTriangleMechanicalMapping<TIn, TOut>::applyJ(const core::MechanicalPa
         crossMatrix<Real>(in[ triangle[1] ].getVOrientation(), Omega1);
         crossMatrix<Real>(in[ triangle[2] ].getVOrientation(), Omega2);
 
-        Mat33 dR0, dR1, dR2;
-
-        // Rotation matrices at corner nodes
-        inVertices[ triangle[0] ].getOrientation().toMatrix(dR0);
-        inVertices[ triangle[1] ].getOrientation().toMatrix(dR1);
-        inVertices[ triangle[2] ].getOrientation().toMatrix(dR2);
-
-        // Derivatives of the rotation matrix
-        dR0 = Omega0*dR0;
-        dR1 = Omega1*dR1;
-        dR2 = Omega2*dR2;
+        // Derivatives of the rotation matrices at corner nodes
+        Mat33 dR0 = Omega0*tinfo.R[0];
+        Mat33 dR1 = Omega1*tinfo.R[1];
+        Mat33 dR2 = Omega2*tinfo.R[2];
 
         // Velocities at other nodes
         tinfo.bezierNodesV[3] = tinfo.bezierNodesV[0] + dR0*tinfo.P0_P1;
@@ -892,25 +941,18 @@ void BezierTriangleMechanicalMapping<TIn, TOut>::applyJ(const core::MechanicalPa
             (tinfo.bezierNodesV[2] + dR2*(tinfo.P2_P0 + tinfo.P2_P1))
         )/3.0;
 
-        for (unsigned int i=0; i<tinfo.attachedPoints.size(); i++)
+        const sofa::type::fixed_array<Vec3,10> &bnV = tinfo.bezierNodesV;
+        for (Index i=attachedOffsets[t]; i<attachedOffsets[t+1]; i++)
         {
+            const AttachedPoint &ap = attachedPoints[i];
 
-            Index pt = tinfo.attachedPoints[i];
-            Vec3 bc = barycentricCoordinates[pt];
-
-            out[pt] =
-                tinfo.bezierNodesV[0] * bc[0]*bc[0]*bc[0] +
-                tinfo.bezierNodesV[1] * bc[1]*bc[1]*bc[1] +
-                tinfo.bezierNodesV[2] * bc[2]*bc[2]*bc[2] +
-                tinfo.bezierNodesV[3] * 3*bc[0]*bc[0]*bc[1] +
-                tinfo.bezierNodesV[4] * 3*bc[0]*bc[0]*bc[2] +
-                tinfo.bezierNodesV[5] * 3*bc[1]*bc[1]*bc[2] +
-                tinfo.bezierNodesV[6] * 3*bc[0]*bc[1]*bc[1] +
-                tinfo.bezierNodesV[7] * 3*bc[0]*bc[2]*bc[2] +
-                tinfo.bezierNodesV[8] * 3*bc[1]*bc[2]*bc[2] +
-                tinfo.bezierNodesV[9] * 6*bc[0]*bc[1]*bc[2];
+            out[ap.point] = bnV[0] * ap.w[0] + bnV[1] * ap.w[1] + bnV[2] * ap.w[2] +
+                bnV[3] * ap.w[3] + bnV[4] * ap.w[4] + bnV[5] * ap.w[5] +
+                bnV[6] * ap.w[6] + bnV[7] * ap.w[7] + bnV[8] * ap.w[8] +
+                bnV[9] * ap.w[9];
         }
     }
+    });
 
     // The following code compares the result with results obtained using
     // getJ() because checkJacobian sucks (at this point in time).
@@ -1059,19 +1101,16 @@ const linearalgebra::BaseMatrix* BezierTriangleMechanicalMapping<TIn, TOut>::get
         Mat33 I(Vec3(1, 0, 0), Vec3(0, 1, 0), Vec3(0, 0, 1));
 
         const SeqTriangles& inTriangles = inputTopo->getTriangles();
-        const InVecCoord& inVertices = this->fromModel->read(sofa::core::vec_id::read_access::position)->getValue();
+
+        // Rotations at the current positions
+        updateControlNet(*this->fromModel->read(sofa::core::vec_id::read_access::position));
 
         // Go through all input triangles
         for (unsigned int t=0; t<inTriangles.size();t++)
         {
             Triangle triangle = inTriangles[t];
             TriangleInformation &tinfo = triangleInfo[t];
-
-            // Rotation matrices at corner nodes
-            Mat33 R[3];
-            inVertices[ triangle[0] ].getOrientation().toMatrix(R[0]);
-            inVertices[ triangle[1] ].getOrientation().toMatrix(R[1]);
-            inVertices[ triangle[2] ].getOrientation().toMatrix(R[2]);
+            const sofa::type::fixed_array<Mat33, 3> &R = tinfo.R;
 
             // Cross matrices for rotated control nodes
             Mat33 Ap1[3]; // nodes 3, 5, 7
@@ -1092,10 +1131,10 @@ const linearalgebra::BaseMatrix* BezierTriangleMechanicalMapping<TIn, TOut>::get
             }
 
             // Go through all attached nodes
-            for (unsigned int i=0; i<tinfo.attachedPoints.size(); i++)
+            for (Index i=attachedOffsets[t]; i<attachedOffsets[t+1]; i++)
             {
-                Index pt = tinfo.attachedPoints[i];
-                Vec3 bc = barycentricCoordinates[pt];
+                Index pt = attachedPoints[i].point;
+                const Vec3 &bc = attachedPoints[i].bary;
 
                 // Go through the three nodes of a trinagle and consider their
                 // respective influences
@@ -1180,101 +1219,92 @@ void BezierTriangleMechanicalMapping<TIn, TOut>::applyJT(const core::MechanicalP
 
     // List of in triangles
     const SeqTriangles& inTriangles = inputTopo->getTriangles();
-    const InVecCoord& inVertices = this->fromModel->read(sofa::core::vec_id::read_access::position)->getValue();
 
-    // Compute nodes of the Bézier triangle for each input triangle
-    for (unsigned int t=0; t<inTriangles.size();t++)
+    // Rotations at the current positions
+    updateControlNet(*this->fromModel->read(sofa::core::vec_id::read_access::position));
+
+    // Resulting linear forces and torques on the corner nodes of each
+    // triangle. Computed concurrently and summed into the output afterwards.
+    triangleForces.resize(2*3*inTriangles.size());
+
+    shell::misc::parallelForRange(parallel.getValue(), (unsigned int)0, (unsigned int)inTriangles.size(),
+        [&](unsigned int begin, unsigned int end) {
+    for (unsigned int t=begin; t<end; t++)
     {
-        Triangle triangle = inTriangles[t];
-        TriangleInformation &tinfo = triangleInfo[t];
+        const TriangleInformation &tinfo = triangleInfo[t];
+        const sofa::type::fixed_array<Vec3,10> &bn = tinfo.bezierNodes;
+        const sofa::type::fixed_array<Mat33, 3> &R = tinfo.R;
 
-        // Rotation matrices at corner nodes
-        Mat33 R[3];
-        inVertices[ triangle[0] ].getOrientation().toMatrix(R[0]);
-        inVertices[ triangle[1] ].getOrientation().toMatrix(R[1]);
-        inVertices[ triangle[2] ].getOrientation().toMatrix(R[2]);
+        Vec3 f1, f2, f3;    // resulting linear forces on corner nodes
+        Vec3 f1r, f2r, f3r; // resulting torques
+        Vec3 fn;
 
-        for (unsigned int i=0; i<tinfo.attachedPoints.size(); i++)
+        for (Index i=attachedOffsets[t]; i<attachedOffsets[t+1]; i++)
         {
-            Vec3 f1, f2, f3;    // resulting linear forces on corner nodes 
-            Vec3 f1r, f2r, f3r; // resulting torques
-            Vec3 fn;
-
-            Index pt = tinfo.attachedPoints[i];
-            Vec3 bc = barycentricCoordinates[pt];
+            const AttachedPoint &ap = attachedPoints[i];
+            const Vec3 &fp = in[ap.point];
 
-            if (in[pt] == Vec3(0,0,0)) continue;
+            if (fp == Vec3(0,0,0)) continue;
 
             // Compute the influence on the corner nodes
-            f1 = in[pt] * (bc[0]*bc[0]*bc[0]);
-            f2 = in[pt] * (bc[1]*bc[1]*bc[1]);
-            f3 = in[pt] * (bc[2]*bc[2]*bc[2]);
+            f1 += fp * ap.w[0];
+            f2 += fp * ap.w[1];
+            f3 += fp * ap.w[2];
 
             // Now the influence through other nodes
 
-            sofa::type::fixed_array<Vec3,10> &bn = tinfo.bezierNodes;
-
-            fn = in[pt] * (3*bc[0]*bc[0]*bc[1]);
-            if (fn != Vec3(0,0,0))
-            {
-                f1 += fn;
-                f1r += cross((bn[3]-bn[0]), fn);
-            }
-
-            fn = in[pt] * (3*bc[0]*bc[0]*bc[2]);
-            if (fn != Vec3(0,0,0))
-            {
-                f1 += fn;
-                f1r += cross((bn[4]-bn[0]), fn);
-            }
-
-            fn = in[pt] * (3*bc[1]*bc[1]*bc[2]);
-            if (fn != Vec3(0,0,0))
-            {
-                f2 += fn;
-                f2r += cross((bn[5]-bn[1]), fn);
-            }
-
-            fn = in[pt] * (3*bc[0]*bc[1]*bc[1]);
-            if (fn != Vec3(0,0,0))
-            {
-                f2 += fn;
-                f2r += cross((bn[6]-bn[1]), fn);
-            }
-
-            fn = in[pt] * (3*bc[0]*bc[2]*bc[2]);
-            if (fn != Vec3(0,0,0))
-            {
-                f3 += fn;
-                f3r += cross((bn[7]-bn[2]), fn);
-            }
+            fn = fp * ap.w[3];
+            f1 += fn;
+            f1r += cross((bn[3]-bn[0]), fn);
+
+            fn = fp * ap.w[4];
+            f1 += fn;
+            f1r += cross((bn[4]-bn[0]), fn);
+
+            fn = fp * ap.w[5];
+            f2 += fn;
+            f2r += cross((bn[5]-bn[1]), fn);
+
+            fn = fp * ap.w[6];
+            f2 += fn;
+            f2r += cross((bn[6]-bn[1]), fn);
+
+            fn = fp * ap.w[7];
+            f3 += fn;
+            f3r += cross((bn[7]-bn[2]), fn);
+
+            fn = fp * ap.w[8];
+            f3 += fn;
+            f3r += cross((bn[8]-bn[2]), fn);
+
+            fn = fp * (ap.w[9]/3); // <-- 6/3 = 2
+            f1 += fn;
+            f2 += fn;
+            f3 += fn;
+            f1r += cross(R[0]*(tinfo.P0_P1 + tinfo.P0_P2), fn);
+            f2r += cross(R[1]*(tinfo.P1_P2 + tinfo.P1_P0), fn);
+            f3r += cross(R[2]*(tinfo.P2_P0 + tinfo.P2_P1), fn);
+        }
 
-            fn = in[pt] * (3*bc[1]*bc[2]*bc[2]);
-            if (fn != Vec3(0,0,0))
-            {
-                f3 += fn;
-                f3r += cross((bn[8]-bn[2]), fn);
-            }
+        Vec3 *tf = &triangleForces[6*t];
+        tf[0] = f1; tf[1] = f2; tf[2] = f3;
+        tf[3] = f1r; tf[4] = f2r; tf[5] = f3r;
+    }
+    });
 
-            fn = in[pt] * (2*bc[0]*bc[1]*bc[2]);
-            if (fn != Vec3(0,0,0))
-            {
-                f1 += fn;
-                f2 += fn;
-                f3 += fn;
-                f1r += cross(R[0]*(tinfo.P0_P1 + tinfo.P0_P2), fn);
-                f2r += cross(R[1]*(tinfo.P1_P2 + tinfo.P1_P0), fn);
-                f3r += cross(R[2]*(tinfo.P2_P0 + tinfo.P2_P1), fn);
-            }
+    // Accumulate the contributions, corner nodes are shared by triangles
+    for (unsigned int t=0; t<inTriangles.size();t++)
+    {
+        const Triangle &triangle = inTriangles[t];
+        const Vec3 *tf = &triangleForces[6*t];
 
-            getVCenter(out[ triangle[0] ]) += f1;
-            getVCenter(out[ triangle[1] ]) += f2;
-            getVCenter(out[ triangle[2] ]) += f3;
+        getVCenter(out[ triangle[0] ]) += tf[0];
+        getVCenter(out[ triangle[1] ]) += tf[1];
+        getVCenter(out[ triangle[2] ]) += tf[2];
 
-            getVOrientation(out[ triangle[0] ]) += f1r;
-            getVOrientation(out[ triangle[1] ]) += f2r;
-            getVOrientation(out[ triangle[2] ]) += f3r;
-        }
+        getVOrientation(out[ triangle[0] ]) += tf[3];
+        getVOrientation(out[ triangle[1] ]) += tf[4];
+        getVOrientation(out[ triangle[2] ]) += tf[5];
     }
 
     // The following code compares the result with results obtained using
@@ -1346,80 +1376,35 @@ void BezierTriangleMechanicalMapping<TIn, TOut>::draw(const core::visual::Visual
         return;
     }
 
-    const OutVecCoord &outVertices = this->toModel->read(sofa::core::vec_id::read_access::position)->getValue();
+    const Data<OutVecCoord> *dataOut = this->toModel->read(sofa::core::vec_id::read_access::position);
+    const OutVecCoord &outVertices = dataOut->getValue();
+
+    const auto stateLifeCycle = vparams->drawTool()->makeStateLifeCycle();
+    vparams->drawTool()->disableLighting();
 
     if(vparams->displayFlags().getShowVisualModels())
     {
-        glDisable(GL_LIGHTING);
-
         const SeqTriangles &outTriangles = outputTopo->getTriangles();
-        unsigned int index;
 
-        glEnable(GL_DEPTH_TEST);
-        glPolygonOffset(1.0, 1.0);
+        // Rebuild the arrays only when the mapped positions changed
+        if (!drawBuffer.isValid(dataOut->getCounter()) ||
+            (drawBuffer.points.size() != 3*outTriangles.size()))
+        {
+            drawBuffer.setTriangles(outVertices, outTriangles, coloursPerVertex);
+            drawBuffer.validate(dataOut->getCounter());
+        }
+
+        vparams->drawTool()->enableDepthTest();
 
         if(vparams->displayFlags().getShowWireFrame())
         {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-            glEnable(GL_POLYGON_OFFSET_LINE);
-            glColor4f(0.0, 0.0, 1.0, 1.0);
-            glBegin(GL_TRIANGLES);
-            for (unsigned int i=0; i<outTriangles.size(); i++)
-            {
-                index = outTriangles[i][0];
-                glVertex3f(outVertices[index][0],
-                    outVertices[index][1],
-                    outVertices[index][2]);
-
-                index = outTriangles[i][1];
-                glVertex3f(outVertices[index][0],
-                    outVertices[index][1],
-                    outVertices[index][2]);
-
-                index = outTriangles[i][2];
-                glVertex3f(outVertices[index][0],
-                    outVertices[index][1],
-                    outVertices[index][2]);
-            }
-            glEnd();
-            glDisable(GL_POLYGON_OFFSET_LINE);
+            vparams->drawTool()->setPolygonMode(0, true);
+            vparams->drawTool()->drawTriangles(drawBuffer.points, sofa::type::RGBAColor(0.0, 0.0, 1.0, 1.0));
+            vparams->drawTool()->setPolygonMode(0, false);
         }
         else
         {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-            glEnable(GL_POLYGON_OFFSET_FILL);
-            glBegin(GL_TRIANGLES);
-            for (unsigned int i=0; i<outTriangles.size(); i++)
-            {
-                index = outTriangles[i][0];
-                glColor4f(coloursPerVertex[index][0],
-                    coloursPerVertex[index][1],
-                    coloursPerVertex[index][2],
-                    1.0);
-                glVertex3f(outVertices[index][0],
-                    outVertices[index][1],
-                    outVertices[index][2]);
-
-                index = outTriangles[i][1];
-                glColor4f(coloursPerVertex[index][0],
-                    coloursPerVertex[index][1],
-                    coloursPerVertex[index][2],
-                    1.0);
-                glVertex3f(outVertices[index][0],
-                    outVertices[index][1],
-                    outVertices[index][2]);
-
-                index = outTriangles[i][2];
-                glColor4f(coloursPerVertex[index][0],
-                    coloursPerVertex[index][1],
-                    coloursPerVertex[index][2],
-                    1.0);
-                glVertex3f(outVertices[index][0],
-                    outVertices[index][1],
-                    outVertices[index][2]);
-            }
-            glEnd();
-            glDisable(GL_POLYGON_OFFSET_FILL);
+            vparams->drawTool()->drawTriangles(drawBuffer.points, drawBuffer.colours);
         }
 
 #if 0
@@ -1447,22 +1432,16 @@ void BezierTriangleMechanicalMapping<TIn, TOut>::draw(const core::visual::Visual
     if(vparams->displayFlags().getShowMechanicalMappings())
     {
         // Render nodes of the Bézier triangles
-        glPointSize(8);
-        glDisable(GL_LIGHTING);
-        glBegin(GL_POINTS);
+        std::vector<sofa::type::Vec3> points;
         //for (unsigned int i=0; i<inputTopo->getTriangles().size(); i++)
         unsigned int i=3;
+        if (i < triangleInfo.size())
         {
-            sofa::type::fixed_array<Vec3,10> &bn = triangleInfo[i].bezierNodes;
+            const sofa::type::fixed_array<Vec3,10> &bn = triangleInfo[i].bezierNodes;
             for (int j=0; j<10; j++)
-            {
-                //glColor4f(0.0, 0.5, 0.3, 1.0);
-                glColor4f(0.5, 1.0, 0.5, 1.0);
-                glVertex3f(bn[j][0], bn[j][1], bn[j][2]);
-            }
-        } 
-        glEnd();
-        glPointSize(1);
+                points.push_back(sofa::type::Vec3(bn[j][0], bn[j][1], bn[j][2]));
+        }
+        vparams->drawTool()->drawPoints(points, 8, sofa::type::RGBAColor(0.5, 1.0, 0.5, 1.0));
 
     }
         // TODO: visualise the mesh
@@ -0,0 +1,83 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/core/Mapping.h>
+#include <sofa/defaulttype/RigidTypes.h>
+#include <sofa/defaulttype/VecTypes.h>
+
+#include <Shell/config.h>
+
+namespace shell::mapping
+{
+
+/**
+ * @brief Extracts one variant of an ensemble, i.e. of a state holding
+ * nbVariants copies of the same nodes one after the other (as simulated by
+ * TriangularShellEnsembleForceField), as an ordinary state.
+ *
+ * The output state is resized to the number of nodes of one variant.
+ */
+template <class TIn, class TOut>
+class EnsembleVariantMapping : public sofa::core::Mapping<TIn, TOut>
+{
+public:
+    SOFA_CLASS(SOFA_TEMPLATE2(EnsembleVariantMapping,TIn,TOut), SOFA_TEMPLATE2(sofa::core::Mapping,TIn,TOut));
+
+    typedef sofa::core::Mapping<TIn, TOut> Inherit;
+    typedef TIn In;
+    typedef TOut Out;
+
+    typedef typename In::VecCoord InVecCoord;
+    typedef typename In::VecDeriv InVecDeriv;
+    typedef typename In::MatrixDeriv InMatrixDeriv;
+
+    typedef typename Out::VecCoord OutVecCoord;
+    typedef typename Out::VecDeriv OutVecDeriv;
+    typedef typename Out::MatrixDeriv OutMatrixDeriv;
+
+protected:
+
+    EnsembleVariantMapping();
+
+    virtual ~EnsembleVariantMapping();
+
+public:
+
+    void init() override;
+
+    void apply(const sofa::core::MechanicalParams *mparams, sofa::Data<OutVecCoord>& out, const sofa::Data<InVecCoord>& in) override;
+    void applyJ(const sofa::core::MechanicalParams *mparams, sofa::Data<OutVecDeriv>& out, const sofa::Data<InVecDeriv>& in) override;
+    void applyJT(const sofa::core::MechanicalParams *mparams, sofa::Data<InVecDeriv>& out, const sofa::Data<OutVecDeriv>& in) override;
+    void applyJT(const sofa::core::ConstraintParams *cparams, sofa::Data<InMatrixDeriv>& out, const sofa::Data<OutMatrixDeriv>& in) override;
+
+    sofa::Data<unsigned int> d_nbVariants;
+    sofa::Data<unsigned int> d_variant;
+
+protected:
+
+    /// Index of the first node of the variant and number of nodes, from
+    /// the size of the input
+    void getRange(const std::size_t inSize, std::size_t &first, std::size_t &nbNodes) const;
+};
+
+} // namespace
@@ -0,0 +1,144 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <Shell/mapping/EnsembleVariantMapping.h>
+
+#include <sofa/core/MechanicalParams.h>
+
+#include <algorithm>
+
+namespace shell::mapping
+{
+
+template <class TIn, class TOut>
+EnsembleVariantMapping<TIn, TOut>::EnsembleVariantMapping()
+: Inherit()
+, d_nbVariants(initData(&d_nbVariants, 1u, "nbVariants", "Number of variants in the input state"))
+, d_variant(initData(&d_variant, 0u, "variant", "Variant to extract"))
+{
+}
+
+template <class TIn, class TOut>
+EnsembleVariantMapping<TIn, TOut>::~EnsembleVariantMapping()
+{
+}
+
+template <class TIn, class TOut>
+void EnsembleVariantMapping<TIn, TOut>::init()
+{
+    if (!this->fromModel || !this->toModel)
+        return;
+
+    if (d_variant.getValue() >= std::max(d_nbVariants.getValue(), 1u))
+    {
+        msg_error() << "Variant " << d_variant.getValue() << " out of " << d_nbVariants.getValue() << ".";
+        return;
+    }
+    if (this->fromModel->getSize() % std::max(d_nbVariants.getValue(), 1u) != 0)
+        msg_warning() << "The input state has " << this->fromModel->getSize() << " nodes, not a multiple of "
+            << d_nbVariants.getValue() << " variants.";
+
+    std::size_t first, nbNodes;
+    getRange(this->fromModel->getSize(), first, nbNodes);
+    this->toModel->resize(nbNodes);
+
+    Inherit::init();
+}
+
+template <class TIn, class TOut>
+void EnsembleVariantMapping<TIn, TOut>::getRange(const std::size_t inSize, std::size_t &first, std::size_t &nbNodes) const
+{
+    const unsigned int nbVariants = std::max(d_nbVariants.getValue(), 1u);
+    nbNodes = inSize / nbVariants;
+    first = std::min<std::size_t>(d_variant.getValue(), nbVariants - 1) * nbNodes;
+}
+
+template <class TIn, class TOut>
+void EnsembleVariantMapping<TIn, TOut>::apply(const sofa::core::MechanicalParams * /*mparams*/, sofa::Data<OutVecCoord>& dOut, const sofa::Data<InVecCoord>& dIn)
+{
+    const InVecCoord &in = dIn.getValue();
+    OutVecCoord &out = *dOut.beginEdit();
+
+    std::size_t first, nbNodes;
+    getRange(in.size(), first, nbNodes);
+    out.resize(nbNodes);
+    for (std::size_t i=0; i<nbNodes; i++)
+        out[i] = in[first + i];
+
+    dOut.endEdit();
+}
+
+template <class TIn, class TOut>
+void EnsembleVariantMapping<TIn, TOut>::applyJ(const sofa::core::MechanicalParams * /*mparams*/, sofa::Data<OutVecDeriv>& dOut, const sofa::Data<InVecDeriv>& dIn)
+{
+    const InVecDeriv &in = dIn.getValue();
+    OutVecDeriv &out = *dOut.beginEdit();
+
+    std::size_t first, nbNodes;
+    getRange(in.size(), first, nbNodes);
+    out.resize(nbNodes);
+    for (std::size_t i=0; i<nbNodes; i++)
+        out[i] = in[first + i];
+
+    dOut.endEdit();
+}
+
+template <class TIn, class TOut>
+void EnsembleVariantMapping<TIn, TOut>::applyJT(const sofa::core::MechanicalParams * /*mparams*/, sofa::Data<InVecDeriv>& dOut, const sofa::Data<OutVecDeriv>& dIn)
+{
+    const OutVecDeriv &in = dIn.getValue();
+    InVecDeriv &out = *dOut.beginEdit();
+
+    std::size_t first, nbNodes;
+    getRange(out.size(), first, nbNodes);
+    nbNodes = std::min(nbNodes, in.size());
+    for (std::size_t i=0; i<nbNodes; i++)
+        out[first + i] += in[i];
+
+    dOut.endEdit();
+}
+
+template <class TIn, class TOut>
+void EnsembleVariantMapping<TIn, TOut>::applyJT(const sofa::core::ConstraintParams * /*cparams*/, sofa::Data<InMatrixDeriv>& dOut, const sofa::Data<OutMatrixDeriv>& dIn)
+{
+    const OutMatrixDeriv &in = dIn.getValue();
+    InMatrixDeriv &out = *dOut.beginEdit();
+
+    std::size_t first, nbNodes;
+    getRange(this->fromModel->getSize(), first, nbNodes);
+
+    for (auto rowIt = in.begin(); rowIt != in.end(); ++rowIt)
+    {
+        auto colIt = rowIt.begin();
+        if (colIt == rowIt.end())
+            continue;
+
+        auto o = out.writeLine(rowIt.index());
+        for (; colIt != rowIt.end(); ++colIt)
+            o.addCol((sofa::Index)(first + colIt.index()), colIt.val());
+    }
+
+    dOut.endEdit();
+}
+
+} // namespace
@@ -0,0 +1,109 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/core/Mapping.h>
+#include <sofa/core/objectmodel/DataFileName.h>
+#include <sofa/defaulttype/RigidTypes.h>
+#include <sofa/defaulttype/VecTypes.h>
+
+#include <Shell/config.h>
+#include <Shell/misc/ModalBasis.h>
+
+namespace shell::mapping
+{
+
+/**
+ * @brief Maps the modal coordinates q of a reduced model to the nodes of
+ * the shell, x = x0 + sum_j phi_j q_j, with the modes computed offline by
+ * ModalAnalysis.
+ *
+ * If the file has modal derivatives and useDerivatives is set, the
+ * quadratic term 1/2 sum_ij psi_ij q_i q_j is added, which captures the
+ * coupling of bending and membrane deformations of moderate rotations. For
+ * rigid nodes the rotation part of the displacement is a rotation vector
+ * applied to the rest orientation.
+ *
+ * The input state is resized to the number of modes.
+ */
+template <class TIn, class TOut>
+class ModalMapping : public sofa::core::Mapping<TIn, TOut>
+{
+public:
+    SOFA_CLASS(SOFA_TEMPLATE2(ModalMapping,TIn,TOut), SOFA_TEMPLATE2(sofa::core::Mapping,TIn,TOut));
+
+    typedef sofa::core::Mapping<TIn, TOut> Inherit;
+    typedef TIn In;
+    typedef TOut Out;
+
+    typedef typename In::VecCoord InVecCoord;
+    typedef typename In::VecDeriv InVecDeriv;
+    typedef typename In::Deriv InDeriv;
+    typedef typename In::MatrixDeriv InMatrixDeriv;
+
+    typedef typename Out::VecCoord OutVecCoord;
+    typedef typename Out::VecDeriv OutVecDeriv;
+    typedef typename Out::Deriv OutDeriv;
+    typedef typename Out::MatrixDeriv OutMatrixDeriv;
+    typedef typename Out::Real Real;
+
+    static constexpr sofa::Size NbDofs = Out::deriv_total_size;
+
+protected:
+
+    ModalMapping();
+
+    virtual ~ModalMapping();
+
+public:
+
+    void init() override;
+
+    void apply(const sofa::core::MechanicalParams *mparams, sofa::Data<OutVecCoord>& out, const sofa::Data<InVecCoord>& in) override;
+    void applyJ(const sofa::core::MechanicalParams *mparams, sofa::Data<OutVecDeriv>& out, const sofa::Data<InVecDeriv>& in) override;
+    void applyJT(const sofa::core::MechanicalParams *mparams, sofa::Data<InVecDeriv>& out, const sofa::Data<OutVecDeriv>& in) override;
+    void applyJT(const sofa::core::ConstraintParams *cparams, sofa::Data<InMatrixDeriv>& out, const sofa::Data<OutMatrixDeriv>& in) override;
+
+    sofa::core::objectmodel::DataFileName d_filename;
+    sofa::Data<bool> d_useDerivatives;
+    sofa::Data<bool> d_parallel;
+
+protected:
+
+    shell::misc::ModalBasis m_basis;
+    OutVecCoord m_restPositions;
+
+    /// Modes and derivatives as output derivatives
+    sofa::type::vector<OutVecDeriv> m_modes, m_derivatives;
+
+    /// Columns of the Jacobian at the last apply(), the modes if the
+    /// derivatives are not used
+    sofa::type::vector<OutVecDeriv> m_jacobian;
+
+    bool m_useDerivatives;
+
+    /// Load the basis from the file, return false if it does not match the
+    /// output state
+    bool loadBasis();
+};
+
+} // namespace
@@ -0,0 +1,219 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <Shell/mapping/ModalMapping.h>
+#include <Shell/misc/ParallelFor.h>
+
+#include <sofa/core/MechanicalParams.h>
+
+namespace shell::mapping
+{
+
+template <class TIn, class TOut>
+ModalMapping<TIn, TOut>::ModalMapping()
+: Inherit()
+, d_filename(initData(&d_filename, "filename", "File of the modes written by ModalAnalysis"))
+, d_useDerivatives(initData(&d_useDerivatives, true, "useDerivatives", "Add the quadratic term of the modal derivatives if the file has them"))
+, d_parallel(initData(&d_parallel, false, "parallel", "Map the nodes in parallel"))
+, m_useDerivatives(false)
+{
+}
+
+template <class TIn, class TOut>
+ModalMapping<TIn, TOut>::~ModalMapping()
+{
+}
+
+template <class TIn, class TOut>
+void ModalMapping<TIn, TOut>::init()
+{
+    if (!this->fromModel || !this->toModel || !loadBasis())
+        return;
+
+    m_restPositions = this->toModel->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+    if (m_restPositions.size() != m_basis.getNbNodes())
+        m_restPositions = this->toModel->read(sofa::core::vec_id::read_access::position)->getValue();
+
+    if (this->fromModel->getSize() != m_basis.getNbModes())
+        this->fromModel->resize(m_basis.getNbModes());
+
+    Inherit::init();
+}
+
+template <class TIn, class TOut>
+bool ModalMapping<TIn, TOut>::loadBasis()
+{
+    const std::string &filename = d_filename.getFullPath();
+    if (!m_basis.read(filename))
+    {
+        msg_error() << "Cannot read the modes from '" << filename << "'";
+        return false;
+    }
+    if (m_basis.getNbDofs() != NbDofs || m_basis.getNbNodes() != this->toModel->getSize())
+    {
+        msg_error() << "The modes are defined on " << m_basis.getNbNodes() << " nodes with " << m_basis.getNbDofs()
+            << " dofs, the output state has " << this->toModel->getSize() << " nodes with " << NbDofs << " dofs.";
+        return false;
+    }
+
+    const sofa::Size nbModes = m_basis.getNbModes();
+    const sofa::Size nbNodes = m_basis.getNbNodes();
+    const auto toDeriv = [&](const shell::misc::ModalBasis::Vector &v, OutVecDeriv &d) {
+        d.resize(nbNodes);
+        for (sofa::Size i=0; i<nbNodes; i++)
+            for (sofa::Size k=0; k<NbDofs; k++)
+                d[i][k] = (Real)v[NbDofs*i+k];
+    };
+
+    m_modes.resize(nbModes);
+    for (sofa::Size j=0; j<nbModes; j++)
+        toDeriv(m_basis.mode(j), m_modes[j]);
+
+    m_useDerivatives = d_useDerivatives.getValue() && m_basis.hasDerivatives();
+    m_derivatives.clear();
+    if (m_useDerivatives)
+    {
+        m_derivatives.resize(m_basis.getNbDerivatives());
+        for (sofa::Size j=0; j<nbModes; j++)
+            for (sofa::Size i=0; i<=j; i++)
+                toDeriv(m_basis.derivative(i, j), m_derivatives[shell::misc::ModalBasis::derivativeIndex(i, j)]);
+    }
+
+    m_jacobian = m_modes;
+
+    msg_info() << nbModes << " modes loaded" << (m_useDerivatives ? " with their derivatives." : ".");
+    return true;
+}
+
+template <class TIn, class TOut>
+void ModalMapping<TIn, TOut>::apply(const sofa::core::MechanicalParams * /*mparams*/, sofa::Data<OutVecCoord>& dOut, const sofa::Data<InVecCoord>& dIn)
+{
+    const InVecCoord &q = dIn.getValue();
+    OutVecCoord &x = *dOut.beginEdit();
+
+    const std::size_t nbModes = std::min(m_modes.size(), q.size());
+    const std::size_t nbNodes = m_restPositions.size();
+    x.resize(nbNodes);
+
+    // x = x0 + sum_j (phi_j + 1/2 sum_l psi_jl q_l) q_j, the Jacobian column
+    // being phi_j + sum_l psi_jl q_l
+    shell::misc::parallelForRange(d_parallel.getValue(), std::size_t(0), nbNodes, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i=begin; i<end; i++) {
+            OutDeriv d;
+            for (std::size_t j=0; j<nbModes; j++) {
+                OutDeriv column = m_modes[j][i];
+                if (m_useDerivatives) {
+                    OutDeriv dj;
+                    for (std::size_t l=0; l<nbModes; l++)
+                        dj += m_derivatives[shell::misc::ModalBasis::derivativeIndex((sofa::Size)j, (sofa::Size)l)][i] * (Real)q[l][0];
+                    m_jacobian[j][i] = column + dj;
+                    column += dj * (Real)0.5;
+                }
+                d += column * (Real)q[j][0];
+            }
+            x[i] = m_restPositions[i] + d;
+        }
+    });
+
+    dOut.endEdit();
+}
+
+template <class TIn, class TOut>
+void ModalMapping<TIn, TOut>::applyJ(const sofa::core::MechanicalParams * /*mparams*/, sofa::Data<OutVecDeriv>& dOut, const sofa::Data<InVecDeriv>& dIn)
+{
+    const InVecDeriv &dq = dIn.getValue();
+    OutVecDeriv &v = *dOut.beginEdit();
+
+    const std::size_t nbModes = std::min(m_jacobian.size(), dq.size());
+    const std::size_t nbNodes = m_restPositions.size();
+    v.resize(nbNodes);
+
+    shell::misc::parallelForRange(d_parallel.getValue(), std::size_t(0), nbNodes, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i=begin; i<end; i++) {
+            OutDeriv vi;
+            for (std::size_t j=0; j<nbModes; j++)
+                vi += m_jacobian[j][i] * (Real)dq[j][0];
+            v[i] = vi;
+        }
+    });
+
+    dOut.endEdit();
+}
+
+template <class TIn, class TOut>
+void ModalMapping<TIn, TOut>::applyJT(const sofa::core::MechanicalParams * /*mparams*/, sofa::Data<InVecDeriv>& dOut, const sofa::Data<OutVecDeriv>& dIn)
+{
+    const OutVecDeriv &f = dIn.getValue();
+    InVecDeriv &fq = *dOut.beginEdit();
+
+    const std::size_t nbModes = std::min(m_jacobian.size(), fq.size());
+    const std::size_t nbNodes = std::min(m_restPositions.size(), f.size());
+
+    shell::misc::parallelForRange(d_parallel.getValue(), std::size_t(0), nbModes, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t j=begin; j<end; j++) {
+            Real sum = 0;
+            for (std::size_t i=0; i<nbNodes; i++)
+                for (sofa::Size k=0; k<NbDofs; k++)
+                    sum += m_jacobian[j][i][k] * f[i][k];
+            fq[j][0] += sum;
+        }
+    });
+
+    dOut.endEdit();
+}
+
+template <class TIn, class TOut>
+void ModalMapping<TIn, TOut>::applyJT(const sofa::core::ConstraintParams * /*cparams*/, sofa::Data<InMatrixDeriv>& dOut, const sofa::Data<OutMatrixDeriv>& dIn)
+{
+    const OutMatrixDeriv &in = dIn.getValue();
+    InMatrixDeriv &out = *dOut.beginEdit();
+
+    const std::size_t nbModes = m_jacobian.size();
+    sofa::type::vector<Real> sum(nbModes);
+
+    for (auto rowIt = in.begin(); rowIt != in.end(); ++rowIt)
+    {
+        auto colIt = rowIt.begin();
+        if (colIt == rowIt.end())
+            continue;
+
+        std::fill(sum.begin(), sum.end(), (Real)0);
+        for (; colIt != rowIt.end(); ++colIt)
+        {
+            const std::size_t i = colIt.index();
+            const OutDeriv &value = colIt.val();
+            for (std::size_t j=0; j<nbModes; j++)
+                for (sofa::Size k=0; k<NbDofs; k++)
+                    sum[j] += m_jacobian[j][i][k] * value[k];
+        }
+
+        auto o = out.writeLine(rowIt.index());
+        for (std::size_t j=0; j<nbModes; j++)
+            if (sum[j] != 0)
+                o.addCol((sofa::Index)j, InDeriv(sum[j]));
+    }
+
+    dOut.endEdit();
+}
+
+} // namespace
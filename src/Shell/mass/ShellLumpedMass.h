@@ -0,0 +1,136 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/core/behavior/Mass.h>
+#include <sofa/core/behavior/MechanicalState.h>
+#include <sofa/core/objectmodel/Data.h>
+#include <sofa/core/topology/BaseMeshTopology.h>
+#include <sofa/defaulttype/RigidTypes.h>
+#include <sofa/type/Mat.h>
+#include <sofa/type/Vec.h>
+
+#include <Shell/config.h>
+#include <Shell/forcefield/TriangularShellForceField.h>
+
+namespace shell::mass
+{
+
+/**
+ * @brief Lumped mass and rotary inertia of a shell mesh with rigid nodes.
+ *
+ * Each triangle gives a third of its mass (density * thickness * area) to
+ * each of its nodes. The rotary inertia of a node is diagonal in a frame
+ * aligned with its normal: m*h^2/12 about the tangent axes (the rotary
+ * inertia of the thickness) and the polar inertia of a disk with the
+ * tributary area about the normal. It is computed in the rest shape and
+ * rotates with the node.
+ *
+ * The mass is block diagonal and accFromF() is exact, explicit solvers can
+ * use it without a linear solve. If a TriangularShellForceField is linked,
+ * the thickness is taken from it (unless set) and the stable time step of
+ * each element is estimated from its stiffness matrices.
+ */
+template<class DataTypes>
+class ShellLumpedMass : public sofa::core::behavior::Mass<DataTypes>
+{
+public:
+    SOFA_CLASS(SOFA_TEMPLATE(ShellLumpedMass,DataTypes), SOFA_TEMPLATE(sofa::core::behavior::Mass,DataTypes));
+
+    typedef sofa::core::behavior::Mass<DataTypes> Inherited;
+    typedef typename DataTypes::VecCoord VecCoord;
+    typedef typename DataTypes::VecDeriv VecDeriv;
+    typedef typename DataTypes::Coord Coord;
+    typedef typename DataTypes::Deriv Deriv;
+    typedef typename Coord::value_type Real;
+    typedef sofa::type::Vec<3,Real> Vec3;
+    typedef sofa::type::Mat<3,3,Real> Mat33;
+
+    typedef sofa::core::objectmodel::Data<VecCoord> DataVecCoord;
+    typedef sofa::core::objectmodel::Data<VecDeriv> DataVecDeriv;
+
+    typedef sofa::Index Index;
+    typedef sofa::core::topology::BaseMeshTopology::Triangle Triangle;
+    typedef sofa::core::topology::BaseMeshTopology::SeqTriangles SeqTriangles;
+
+    typedef sofa::component::forcefield::TriangularShellForceField<DataTypes> ShellForceField;
+
+protected:
+
+    ShellLumpedMass();
+
+    virtual ~ShellLumpedMass();
+
+public:
+
+    void init() override;
+    void bwdInit() override;
+    void reinit() override;
+
+    void addMDx(const sofa::core::MechanicalParams* mparams, DataVecDeriv& f, const DataVecDeriv& dx, SReal factor) override;
+    void accFromF(const sofa::core::MechanicalParams* mparams, DataVecDeriv& a, const DataVecDeriv& f) override;
+    void addForce(const sofa::core::MechanicalParams* mparams, DataVecDeriv& f, const DataVecCoord& x, const DataVecDeriv& v) override;
+    void addMToMatrix(const sofa::core::MechanicalParams* mparams, const sofa::core::behavior::MultiMatrixAccessor* matrix) override;
+
+    SReal getKineticEnergy(const sofa::core::MechanicalParams* mparams, const DataVecDeriv& v) const override;
+    SReal getPotentialEnergy(const sofa::core::MechanicalParams* mparams, const DataVecCoord& x) const override;
+
+    SReal getElementMass(Index index) const override;
+    void getElementMass(Index index, sofa::linearalgebra::BaseMatrix *m) const override;
+
+    /// The mass is block diagonal, accFromF() inverts it exactly
+    bool isDiagonal() const override { return true; }
+
+    sofa::Data<Real> d_thickness;
+    sofa::Data<Real> d_massDensity;
+    sofa::Data<Real> d_rotaryInertiaScale;
+    sofa::Data<sofa::type::vector<Real> > d_vertexMass;
+    sofa::Data<Real> d_totalMass;
+    sofa::Data<sofa::type::vector<Real> > d_elementTimeStep;
+    sofa::Data<Real> d_stableTimeStep;
+
+    sofa::SingleLink<ShellLumpedMass<DataTypes>, ShellForceField,
+        sofa::BaseLink::FLAG_STOREPATH|sofa::BaseLink::FLAG_STRONGLINK> l_forceField;
+
+protected:
+
+    sofa::core::topology::BaseMeshTopology* m_topology;
+
+    // Rotary inertia of each node about its tangent axes and its normal, and
+    // the inertia tensor and its inverse in the frame of the node
+    sofa::type::vector<Real> m_tangentInertia;
+    sofa::type::vector<Real> m_normalInertia;
+    sofa::type::vector<Mat33> m_inertia;
+    sofa::type::vector<Mat33> m_inertiaInv;
+
+    /// Compute the masses and inertia from the rest shape
+    void computeMass();
+
+    /// Estimate the stable explicit time step of the elements of the linked
+    /// force field
+    void computeStableTimeStep();
+
+    /// Rotate a tensor from the frame of a node into the global frame
+    static Mat33 toGlobal(const Mat33 &m, const Coord &x);
+};
+
+} // namespace
@@ -0,0 +1,398 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <Shell/mass/ShellLumpedMass.h>
+
+#include <sofa/core/behavior/MultiMatrixAccessor.h>
+#include <sofa/core/MechanicalParams.h>
+#include <sofa/linearalgebra/BaseMatrix.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace shell::mass
+{
+
+template<class DataTypes>
+ShellLumpedMass<DataTypes>::ShellLumpedMass()
+: d_thickness(initData(&d_thickness, (Real)0.1, "thickness", "Thickness of the shell, taken from the linked force field if not set"))
+, d_massDensity(initData(&d_massDensity, (Real)1.0, "massDensity", "Mass per unit volume"))
+, d_rotaryInertiaScale(initData(&d_rotaryInertiaScale, (Real)1.0, "rotaryInertiaScale", "Scale factor of the rotary inertia. Values above 1 increase the stable time step of explicit integration at the cost of accuracy of the rotational dynamics"))
+, d_vertexMass(initData(&d_vertexMass, "vertexMass", "Mass of each node"))
+, d_totalMass(initData(&d_totalMass, (Real)0, "totalMass", "Mass of the whole shell"))
+, d_elementTimeStep(initData(&d_elementTimeStep, "elementTimeStep", "Estimated stable explicit time step of each element of the linked force field"))
+, d_stableTimeStep(initData(&d_stableTimeStep, (Real)0, "stableTimeStep", "Smallest estimated stable explicit time step over all elements (0 if not computed)"))
+, l_forceField(initLink("forceField", "TriangularShellForceField providing the thickness and the element stiffness (searched in the context if not set)"))
+, m_topology(nullptr)
+{
+    d_vertexMass.setReadOnly(true);
+    d_totalMass.setReadOnly(true);
+    d_elementTimeStep.setReadOnly(true);
+    d_stableTimeStep.setReadOnly(true);
+}
+
+template<class DataTypes>
+ShellLumpedMass<DataTypes>::~ShellLumpedMass()
+{
+}
+
+template<class DataTypes>
+void ShellLumpedMass<DataTypes>::init()
+{
+    Inherited::init();
+
+    m_topology = this->getContext()->getMeshTopology();
+    if (!m_topology || m_topology->getNbTriangles() == 0)
+    {
+        msg_error() << "No triangular topology found.";
+        return;
+    }
+
+    if (!l_forceField)
+    {
+        ShellForceField *ff = nullptr;
+        this->getContext()->get(ff);
+        if (ff)
+            l_forceField.set(ff);
+    }
+
+    if (l_forceField && !d_thickness.isSet())
+        d_thickness.setValue(l_forceField->d_thickness.getValue());
+
+    computeMass();
+}
+
+template<class DataTypes>
+void ShellLumpedMass<DataTypes>::bwdInit()
+{
+    Inherited::bwdInit();
+
+    // The element stiffness is known once the force field is initialised
+    computeStableTimeStep();
+}
+
+template<class DataTypes>
+void ShellLumpedMass<DataTypes>::reinit()
+{
+    if (!m_topology)
+        return;
+
+    computeMass();
+    computeStableTimeStep();
+}
+
+template<class DataTypes>
+void ShellLumpedMass<DataTypes>::computeMass()
+{
+    const VecCoord& x0 = this->mstate->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+    const SeqTriangles& triangles = m_topology->getTriangles();
+
+    const Real h = d_thickness.getValue();
+    const Real rho = d_massDensity.getValue();
+    const Real scale = d_rotaryInertiaScale.getValue();
+
+    sofa::type::vector<Real>& mass = *d_vertexMass.beginEdit();
+    mass.assign(x0.size(), 0);
+    sofa::type::vector<Real> area(x0.size(), 0);
+    sofa::type::vector<Vec3> normal(x0.size(), Vec3(0,0,0));
+
+    // Each triangle gives a third of its area to each node
+    for (const Triangle& t : triangles)
+    {
+        const Vec3 n = cross(x0[t[1]].getCenter() - x0[t[0]].getCenter(),
+            x0[t[2]].getCenter() - x0[t[0]].getCenter());
+        const Real A = n.norm() / 2;
+
+        for (unsigned int j=0; j<3; j++)
+        {
+            mass[t[j]] += rho * h * A / 3;
+            area[t[j]] += A / 3;
+            normal[t[j]] += n;
+        }
+    }
+
+    m_tangentInertia.resize(x0.size());
+    m_normalInertia.resize(x0.size());
+    m_inertia.resize(x0.size());
+    m_inertiaInv.resize(x0.size());
+
+    Real total = 0;
+    for (std::size_t i=0; i<x0.size(); i++)
+    {
+        total += mass[i];
+
+        // Rotary inertia of the thickness about the tangent axes, of a disk
+        // with the tributary area about the normal
+        m_tangentInertia[i] = scale * mass[i] * h * h / 12;
+        m_normalInertia[i] = scale * mass[i] * area[i] / (2 * (Real)3.14159265358979323846);
+
+        Vec3 n = normal[i];
+        const Real nn = n.norm();
+        n = (nn > 0) ? n / nn : Vec3(0,0,1);
+
+        Mat33 P; // Projection on the normal
+        for (unsigned int j=0; j<3; j++)
+            for (unsigned int k=0; k<3; k++)
+                P[j][k] = n[j]*n[k];
+        Mat33 Q; // ... and on the tangent plane
+        Q.identity();
+        Q -= P;
+
+        const Mat33 I = Q * m_tangentInertia[i] + P * m_normalInertia[i];
+        Mat33 Iinv;
+        if (m_tangentInertia[i] > 0 && m_normalInertia[i] > 0)
+            Iinv = Q * (1/m_tangentInertia[i]) + P * (1/m_normalInertia[i]);
+        else
+            Iinv.clear();
+
+        // Into the frame of the node
+        Mat33 R;
+        x0[i].getOrientation().toMatrix(R);
+        m_inertia[i] = R.transposed() * I * R;
+        m_inertiaInv[i] = R.transposed() * Iinv * R;
+    }
+
+    d_vertexMass.endEdit();
+    d_totalMass.setValue(total);
+}
+
+template<class DataTypes>
+void ShellLumpedMass<DataTypes>::computeStableTimeStep()
+{
+    sofa::type::vector<Real>& dt = *d_elementTimeStep.beginEdit();
+    dt.clear();
+
+    ShellForceField *ff = l_forceField.get();
+    if (!ff)
+    {
+        d_elementTimeStep.endEdit();
+        d_stableTimeStep.setValue(0);
+        return;
+    }
+
+    const VecCoord& x0 = this->mstate->read(sofa::core::vec_id::read_access::restPosition)->getValue();
+    const sofa::type::vector<Real>& mass = d_vertexMass.getValue();
+    const auto& ti = ff->getTriangleInformation();
+
+    const Real h = d_thickness.getValue();
+    const Real rho = d_massDensity.getValue();
+
+    // The lumped mass matrix is the sum of the element shares of the node
+    // masses and inertias, so the largest eigenvalue of M^-1 K is bounded by
+    // the largest one of M_e^-1 K_e over the elements, itself bounded by the
+    // largest row sum of |K_ij|/m_i (Gershgorin) with the element shares
+    // m_i. The time step of the central difference scheme is then 2/omega_max.
+    // Membrane dofs are u, v and the drilling rotation, bending dofs w and
+    // the rotations about the tangent axes.
+    Real minDt = std::numeric_limits<Real>::max();
+    dt.resize(ti.size());
+    for (std::size_t t=0; t<ti.size(); t++)
+    {
+        const Index nodes[3] = { ti[t].a, ti[t].b, ti[t].c };
+
+        // Share of the element in the mass and inertias of its nodes, as
+        // accumulated by computeMass()
+        const Real A = cross(x0[nodes[1]].getCenter() - x0[nodes[0]].getCenter(),
+            x0[nodes[2]].getCenter() - x0[nodes[0]].getCenter()).norm() / 2;
+        const Real mElement = rho * h * A / 3;
+
+        Real lambda = 0;
+        for (unsigned int i=0; i<9; i++)
+        {
+            const Index node = nodes[i/3];
+            const Real share = (mass[node] > 0) ? mElement / mass[node] : 0;
+            const Real mMembrane = (i%3 == 2) ? share * m_normalInertia[node] : mElement;
+            const Real mBending = (i%3 == 0) ? mElement : share * m_tangentInertia[node];
+
+            Real rowMembrane = 0, rowBending = 0;
+            for (unsigned int j=0; j<9; j++)
+            {
+                rowMembrane += std::abs(ti[t].stiffnessMatrixMembrane(i,j));
+                rowBending += std::abs(ti[t].stiffnessMatrixBending(i,j));
+            }
+
+            if (mMembrane > 0)
+                lambda = std::max(lambda, rowMembrane / mMembrane);
+            if (mBending > 0)
+                lambda = std::max(lambda, rowBending / mBending);
+        }
+
+        dt[t] = (lambda > 0) ? 2 / std::sqrt(lambda) : std::numeric_limits<Real>::max();
+        minDt = std::min(minDt, dt[t]);
+    }
+
+    d_elementTimeStep.endEdit();
+
+    if (ti.empty())
+        minDt = 0;
+    d_stableTimeStep.setValue(minDt);
+
+    msg_info() << "Estimated stable explicit time step: " << minDt;
+    if (minDt > 0 && this->getContext()->getDt() > minDt)
+        msg_warning() << "The time step " << this->getContext()->getDt()
+            << " exceeds the estimated stable time step " << minDt
+            << " of explicit integration.";
+}
+
+template<class DataTypes>
+typename ShellLumpedMass<DataTypes>::Mat33 ShellLumpedMass<DataTypes>::toGlobal(const Mat33 &m, const Coord &x)
+{
+    Mat33 R;
+    x.getOrientation().toMatrix(R);
+    return R * m * R.transposed();
+}
+
+template<class DataTypes>
+void ShellLumpedMass<DataTypes>::addMDx(const sofa::core::MechanicalParams* /*mparams*/, DataVecDeriv& f, const DataVecDeriv& dx, SReal factor)
+{
+    VecDeriv& res = *f.beginEdit();
+    const VecDeriv& d = dx.getValue();
+    const VecCoord& x = this->mstate->read(sofa::core::vec_id::read_access::position)->getValue();
+    const sofa::type::vector<Real>& mass = d_vertexMass.getValue();
+
+    const std::size_t n = std::min(d.size(), mass.size());
+    for (std::size_t i=0; i<n; i++)
+    {
+        getVCenter(res[i]) += getVCenter(d[i]) * (mass[i] * (Real)factor);
+        getVOrientation(res[i]) += toGlobal(m_inertia[i], x[i]) * getVOrientation(d[i]) * (Real)factor;
+    }
+
+    f.endEdit();
+}
+
+template<class DataTypes>
+void ShellLumpedMass<DataTypes>::accFromF(const sofa::core::MechanicalParams* /*mparams*/, DataVecDeriv& a, const DataVecDeriv& f)
+{
+    VecDeriv& acc = *a.beginEdit();
+    const VecDeriv& force = f.getValue();
+    const VecCoord& x = this->mstate->read(sofa::core::vec_id::read_access::position)->getValue();
+    const sofa::type::vector<Real>& mass = d_vertexMass.getValue();
+
+    acc.resize(force.size());
+    const std::size_t n = std::min(force.size(), mass.size());
+    for (std::size_t i=0; i<n; i++)
+    {
+        getVCenter(acc[i]) = (mass[i] > 0) ? getVCenter(force[i]) / mass[i] : Vec3(0,0,0);
+        getVOrientation(acc[i]) = toGlobal(m_inertiaInv[i], x[i]) * getVOrientation(force[i]);
+    }
+
+    a.endEdit();
+}
+
+template<class DataTypes>
+void ShellLumpedMass<DataTypes>::addForce(const sofa::core::MechanicalParams* /*mparams*/, DataVecDeriv& f, const DataVecCoord& /*x*/, const DataVecDeriv& /*v*/)
+{
+    const Vec3 g = this->getContext()->getGravity();
+    if (g.norm2() == 0)
+        return;
+
+    VecDeriv& res = *f.beginEdit();
+    const sofa::type::vector<Real>& mass = d_vertexMass.getValue();
+
+    const std::size_t n = std::min(res.size(), mass.size());
+    for (std::size_t i=0; i<n; i++)
+        getVCenter(res[i]) += g * mass[i];
+
+    f.endEdit();
+}
+
+template<class DataTypes>
+void ShellLumpedMass<DataTypes>::addMToMatrix(const sofa::core::MechanicalParams* mparams, const sofa::core::behavior::MultiMatrixAccessor* matrix)
+{
+    sofa::core::behavior::MultiMatrixAccessor::MatrixRef r = matrix->getMatrix(this->mstate);
+    const VecCoord& x = this->mstate->read(sofa::core::vec_id::read_access::position)->getValue();
+    const sofa::type::vector<Real>& mass = d_vertexMass.getValue();
+
+    const Real mFactor = (Real)mparams->mFactorIncludingRayleighDamping(this->rayleighMass.getValue());
+
+    for (std::size_t i=0; i<mass.size(); i++)
+    {
+        const sofa::Index offset = r.offset + 6*(sofa::Index)i;
+        const Mat33 I = toGlobal(m_inertia[i], x[i]);
+
+        for (unsigned int j=0; j<3; j++)
+        {
+            r.matrix->add(offset + j, offset + j, mass[i] * mFactor);
+            for (unsigned int k=0; k<3; k++)
+                r.matrix->add(offset + 3 + j, offset + 3 + k, I[j][k] * mFactor);
+        }
+    }
+}
+
+template<class DataTypes>
+SReal ShellLumpedMass<DataTypes>::getKineticEnergy(const sofa::core::MechanicalParams* /*mparams*/, const DataVecDeriv& v) const
+{
+    const VecDeriv& vel = v.getValue();
+    const VecCoord& x = this->mstate->read(sofa::core::vec_id::read_access::position)->getValue();
+    const sofa::type::vector<Real>& mass = d_vertexMass.getValue();
+
+    SReal e = 0;
+    const std::size_t n = std::min(vel.size(), mass.size());
+    for (std::size_t i=0; i<n; i++)
+    {
+        const Vec3& w = getVOrientation(vel[i]);
+        e += mass[i] * getVCenter(vel[i]).norm2() + dot(w, toGlobal(m_inertia[i], x[i]) * w);
+    }
+
+    return e / 2;
+}
+
+template<class DataTypes>
+SReal ShellLumpedMass<DataTypes>::getPotentialEnergy(const sofa::core::MechanicalParams* /*mparams*/, const DataVecCoord& x) const
+{
+    const VecCoord& pos = x.getValue();
+    const Vec3 g = this->getContext()->getGravity();
+    const sofa::type::vector<Real>& mass = d_vertexMass.getValue();
+
+    SReal e = 0;
+    const std::size_t n = std::min(pos.size(), mass.size());
+    for (std::size_t i=0; i<n; i++)
+        e -= mass[i] * dot(g, pos[i].getCenter());
+
+    return e;
+}
+
+template<class DataTypes>
+SReal ShellLumpedMass<DataTypes>::getElementMass(Index index) const
+{
+    return d_vertexMass.getValue()[index];
+}
+
+template<class DataTypes>
+void ShellLumpedMass<DataTypes>::getElementMass(Index index, sofa::linearalgebra::BaseMatrix *m) const
+{
+    const VecCoord& x = this->mstate->read(sofa::core::vec_id::read_access::position)->getValue();
+    const Mat33 I = toGlobal(m_inertia[index], x[index]);
+
+    m->resize(6, 6);
+    m->clear();
+    for (unsigned int j=0; j<3; j++)
+    {
+        m->set(j, j, d_vertexMass.getValue()[index]);
+        for (unsigned int k=0; k<3; k++)
+            m->set(3 + j, 3 + k, I[j][k]);
+    }
+}
+
+} // namespace
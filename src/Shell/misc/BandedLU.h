@@ -0,0 +1,108 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/type/vector.h>
+#include <Shell/config.h>
+
+#include <algorithm>
+
+namespace shell::misc
+{
+
+/**
+ * @brief LU factorisation without pivoting of a band matrix, for the
+ * systems of a mesh ordered to reduce the bandwidth (e.g. by
+ * reverseCuthillMcKee). The matrix must not need pivoting, as the mass
+ * dominated systems of implicit integration.
+ *
+ * The entries (i,j) with |i-j| <= bandwidth are stored row by row.
+ */
+template<class Real>
+class BandedLU
+{
+public:
+    /// Set the size and bandwidth and clear the matrix
+    void resize(std::size_t n, std::size_t bandwidth)
+    {
+        m_size = n;
+        m_bandwidth = bandwidth;
+        m_values.assign(n*(2*bandwidth+1), 0);
+    }
+
+    std::size_t size() const { return m_size; }
+    std::size_t bandwidth() const { return m_bandwidth; }
+
+    /// Add v to entry (i,j), which must be in the band
+    void add(std::size_t i, std::size_t j, Real v) { at(i,j) += v; }
+
+    /// Factorise in place, return false on a zero pivot
+    bool factorize()
+    {
+        for (std::size_t k=0; k<m_size; k++) {
+            const Real pivot = at(k,k);
+            if (pivot == 0)
+                return false;
+
+            const std::size_t last = std::min(m_size, k+m_bandwidth+1);
+            for (std::size_t i=k+1; i<last; i++) {
+                Real &l = at(i,k);
+                if (l == 0)
+                    continue;
+                l /= pivot;
+                for (std::size_t j=k+1; j<last; j++)
+                    at(i,j) -= l * at(k,j);
+            }
+        }
+        return true;
+    }
+
+    /// Solve in place with the factors
+    template<class Vector>
+    void solve(Vector &x) const
+    {
+        for (std::size_t i=0; i<m_size; i++) {
+            Real sum = x[i];
+            for (std::size_t j=(i > m_bandwidth ? i-m_bandwidth : 0); j<i; j++)
+                sum -= at(i,j) * x[j];
+            x[i] = sum;
+        }
+
+        for (std::size_t i=m_size; i-- > 0; ) {
+            Real sum = x[i];
+            const std::size_t last = std::min(m_size, i+m_bandwidth+1);
+            for (std::size_t j=i+1; j<last; j++)
+                sum -= at(i,j) * x[j];
+            x[i] = sum / at(i,i);
+        }
+    }
+
+private:
+    std::size_t m_size = 0;
+    std::size_t m_bandwidth = 0;
+    sofa::type::vector<Real> m_values;
+
+    Real& at(std::size_t i, std::size_t j) { return m_values[i*(2*m_bandwidth+1) + j+m_bandwidth-i]; }
+    const Real& at(std::size_t i, std::size_t j) const { return m_values[i*(2*m_bandwidth+1) + j+m_bandwidth-i]; }
+};
+
+} // namespace
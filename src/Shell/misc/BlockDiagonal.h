@@ -0,0 +1,177 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/core/topology/BaseMeshTopology.h>
+#include <sofa/type/Mat.h>
+#include <sofa/type/Vec.h>
+#include <sofa/type/vector.h>
+#include <Shell/config.h>
+#include <Shell/misc/ParallelFor.h>
+
+#include <algorithm>
+#include <atomic>
+
+namespace shell::misc
+{
+
+/**
+ * @brief Block diagonal matrix with one N x N block per node, e.g. N=6 for
+ * rigid nodes.
+ *
+ * Force fields add the diagonal blocks of their stiffness into it without
+ * assembling the whole matrix, a block-Jacobi preconditioner then inverts
+ * and applies it.
+ */
+template<sofa::Size N, class Real>
+class BlockDiagonal
+{
+public:
+    typedef sofa::type::Mat<N,N,Real> Block;
+    typedef sofa::type::Vec<N,Real> VecN;
+
+    void resize(std::size_t nbNodes) { m_blocks.resize(nbNodes); }
+    std::size_t size() const { return m_blocks.size(); }
+
+    void clear()
+    {
+        for (Block &b : m_blocks)
+            b.clear();
+    }
+
+    Block& operator[](std::size_t i) { return m_blocks[i]; }
+    const Block& operator[](std::size_t i) const { return m_blocks[i]; }
+
+    /**
+     * @brief Invert all blocks in place.
+     *
+     * A singular block is replaced by the inverse of its diagonal, zero
+     * diagonal entries by 1.
+     *
+     * @return The number of singular blocks.
+     */
+    std::size_t invert(bool parallel)
+    {
+        std::atomic<std::size_t> nbSingular(0);
+        parallelForRange(parallel, std::size_t(0), m_blocks.size(), [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i=begin; i<end; i++) {
+                Block inv;
+                if (inv.invert(m_blocks[i])) {
+                    m_blocks[i] = inv;
+                    continue;
+                }
+
+                inv.clear();
+                for (sofa::Size k=0; k<N; k++)
+                    inv[k][k] = (m_blocks[i][k][k] != 0) ? 1/m_blocks[i][k][k] : 1;
+                m_blocks[i] = inv;
+                nbSingular++;
+            }
+        });
+        return nbSingular;
+    }
+
+private:
+    sofa::type::vector<Block> m_blocks;
+};
+
+/**
+ * @brief Add the diagonal block of node j of an element matrix with n dofs
+ * per node into the N x N block of the node in the element frame.
+ *
+ * @param block  Node block in the element frame.
+ * @param K      Element matrix, accessed as K(row, column).
+ * @param n      Number of dofs per node in K.
+ * @param j      Index of the node in the element.
+ * @param dofs   Position of each of the n dofs in the node block.
+ */
+template<sofa::Size N, class Real, class Matrix>
+void addElementNodeBlock(sofa::type::Mat<N,N,Real> &block, const Matrix &K,
+    unsigned int n, unsigned int j, const unsigned int *dofs)
+{
+    for (unsigned int k=0; k<n; k++)
+        for (unsigned int l=0; l<n; l++)
+            block[dofs[k]][dofs[l]] += (Real)K(n*j+k, n*j+l);
+}
+
+/**
+ * @brief Add factor * Rt * B * R for each 3x3 sub-block B of a node block
+ * given in the element frame, i.e. rotate it into the global frame.
+ *
+ * @param R  Rotation from the global into the element frame.
+ */
+template<sofa::Size N, class Real>
+void addRotatedNodeBlock(sofa::type::Mat<N,N,Real> &out, const sofa::type::Mat<N,N,Real> &local,
+    const sofa::type::Mat<3,3,Real> &R, const Real factor)
+{
+    const sofa::type::Mat<3,3,Real> Rt = R.transposed();
+    for (sofa::Size bi=0; bi<N/3; bi++) {
+        for (sofa::Size bj=0; bj<N/3; bj++) {
+            sofa::type::Mat<3,3,Real> B;
+            for (sofa::Size i=0; i<3; i++)
+                for (sofa::Size j=0; j<3; j++)
+                    B[i][j] = local[3*bi+i][3*bj+j];
+
+            const sofa::type::Mat<3,3,Real> G = Rt * B * R;
+            for (sofa::Size i=0; i<3; i++)
+                for (sofa::Size j=0; j<3; j++)
+                    out[3*bi+i][3*bj+j] += factor * G[i][j];
+        }
+    }
+}
+
+/**
+ * @brief Accumulate the node blocks of all triangles, in parallel over the
+ * nodes. Each node gathers the blocks of the triangles around it, so that no
+ * two threads write the same block.
+ *
+ * @param blocks    Output, one block per node.
+ * @param topology  Triangle mesh.
+ * @param parallel  Process the nodes in parallel.
+ * @param f         Callable with signature void(Block &out, Index triangle,
+ *                  unsigned int j) adding the block of the j-th node of the
+ *                  triangle into out.
+ */
+template<sofa::Size N, class Real, class F>
+void accumulateNodeBlocks(BlockDiagonal<N,Real> &blocks, sofa::core::topology::BaseMeshTopology *topology,
+    bool parallel, const F &f)
+{
+    const sofa::Index nbNodes = (sofa::Index)std::min<std::size_t>(blocks.size(), topology->getNbPoints());
+
+    // Make sure the shells are created before they are accessed concurrently
+    if (nbNodes > 0)
+        topology->getTrianglesAroundVertex(0);
+
+    parallelForRange(parallel, sofa::Index(0), nbNodes, [&](sofa::Index begin, sofa::Index end) {
+        for (sofa::Index i=begin; i<end; i++) {
+            for (const sofa::Index t : topology->getTrianglesAroundVertex(i)) {
+                const sofa::core::topology::BaseMeshTopology::Triangle &tri = topology->getTriangle(t);
+                for (unsigned int j=0; j<3; j++) {
+                    if (tri[j] == i)
+                        f(blocks[i], t, j);
+                }
+            }
+        }
+    });
+}
+
+} // namespace
@@ -0,0 +1,213 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/linearalgebra/BaseMatrix.h>
+#include <sofa/type/Mat.h>
+#include <sofa/type/Vec.h>
+#include <sofa/type/vector.h>
+#include <Shell/config.h>
+#include <Shell/misc/ParallelFor.h>
+
+#include <algorithm>
+#include <map>
+
+namespace shell::misc
+{
+
+/**
+ * @brief Sparse matrix made of N x N blocks, e.g. N=6 for rigid nodes.
+ *
+ * The matrix is filled through the BaseMatrix interface, so that the
+ * components can assemble their contribution with addKToMatrix() and
+ * addMToMatrix(), or block by block with addBlock(). compress() then moves
+ * the blocks into compressed rows, which is required before the products.
+ */
+template<sofa::Size N, class Real>
+class BlockSparseMatrix : public sofa::linearalgebra::BaseMatrix
+{
+public:
+    typedef sofa::linearalgebra::BaseMatrix::Index Index;
+    typedef sofa::type::Mat<N,N,Real> Block;
+    typedef sofa::type::Vec<N,Real> VecN;
+    typedef sofa::type::vector<VecN> VecVecN;
+
+    /// Set the number of block rows and columns and remove all blocks
+    void resizeBlocks(std::size_t nbNodes)
+    {
+        m_nbNodes = nbNodes;
+        clear();
+    }
+
+    std::size_t nbBlockRows() const { return m_nbNodes; }
+
+    /// Add a block, only before compress()
+    void addBlock(Index bi, Index bj, const Block &b)
+    {
+        m_building[bi][bj] += b;
+    }
+
+    /// Move the blocks added since the last clear() into compressed rows
+    void compress()
+    {
+        m_rowBegin.assign(m_nbNodes+1, 0);
+        m_columns.clear();
+        m_blocks.clear();
+        for (std::size_t i=0; i<m_nbNodes; i++) {
+            for (const auto &entry : m_building[i]) {
+                m_columns.push_back(entry.first);
+                m_blocks.push_back(entry.second);
+            }
+            m_rowBegin[i+1] = (Index)m_columns.size();
+        }
+        m_building.clear();
+        m_building.resize(m_nbNodes);
+    }
+
+    /// Compressed rows: the blocks of row i are in [rowBegin(i), rowBegin(i+1))
+    Index rowBegin(std::size_t i) const { return m_rowBegin[i]; }
+    Index column(Index k) const { return m_columns[k]; }
+    const Block& block(Index k) const { return m_blocks[k]; }
+
+    /// Block (i,j), nullptr if absent
+    const Block* findBlock(std::size_t i, Index j) const
+    {
+        const auto first = m_columns.begin() + m_rowBegin[i];
+        const auto last = m_columns.begin() + m_rowBegin[i+1];
+        const auto it = std::lower_bound(first, last, j);
+        return (it != last && *it == j) ? &m_blocks[it-m_columns.begin()] : nullptr;
+    }
+
+    /// Diagonal block of row i, zero if absent
+    Block diagonalBlock(std::size_t i) const
+    {
+        for (Index k=m_rowBegin[i]; k<m_rowBegin[i+1]; k++)
+            if (m_columns[k] == (Index)i)
+                return m_blocks[k];
+        return Block();
+    }
+
+    /// y = A x, in parallel over the rows
+    void mult(const VecVecN &x, VecVecN &y, bool parallel) const
+    {
+        y.resize(m_nbNodes);
+        parallelForRange(parallel, std::size_t(0), m_nbNodes, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i=begin; i<end; i++) {
+                VecN yi;
+                for (Index k=m_rowBegin[i]; k<m_rowBegin[i+1]; k++)
+                    yi += m_blocks[k] * x[m_columns[k]];
+                y[i] = yi;
+            }
+        });
+    }
+
+    /// r = b - A x, in parallel over the rows
+    void residual(const VecVecN &b, const VecVecN &x, VecVecN &r, bool parallel) const
+    {
+        r.resize(m_nbNodes);
+        parallelForRange(parallel, std::size_t(0), m_nbNodes, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i=begin; i<end; i++) {
+                VecN ri = b[i];
+                for (Index k=m_rowBegin[i]; k<m_rowBegin[i+1]; k++)
+                    ri -= m_blocks[k] * x[m_columns[k]];
+                r[i] = ri;
+            }
+        });
+    }
+
+    // BaseMatrix interface, used for the assembly
+
+    Index rowSize() const override { return (Index)(N*m_nbNodes); }
+    Index colSize() const override { return (Index)(N*m_nbNodes); }
+
+    SReal element(Index i, Index j) const override
+    {
+        const Index bi = i/(Index)N, bj = j/(Index)N;
+        const Index k = i%(Index)N, l = j%(Index)N;
+
+        if (!m_building[bi].empty()) {
+            auto it = m_building[bi].find(bj);
+            return it != m_building[bi].end() ? (SReal)it->second[k][l] : 0;
+        }
+        if ((Index)m_rowBegin.size() <= bi+1)
+            return 0;
+
+        const auto first = m_columns.begin() + m_rowBegin[bi];
+        const auto last = m_columns.begin() + m_rowBegin[bi+1];
+        const auto it = std::lower_bound(first, last, bj);
+        return (it != last && *it == bj) ? (SReal)m_blocks[it-m_columns.begin()][k][l] : 0;
+    }
+
+    void resize(Index nbRow, Index /*nbCol*/) override
+    {
+        resizeBlocks((std::size_t)((nbRow+(Index)N-1)/(Index)N));
+    }
+
+    void clear() override
+    {
+        m_building.clear();
+        m_building.resize(m_nbNodes);
+        m_rowBegin.assign(m_nbNodes+1, 0);
+        m_columns.clear();
+        m_blocks.clear();
+    }
+
+    void set(Index i, Index j, double v) override
+    {
+        m_building[i/(Index)N][j/(Index)N][i%(Index)N][j%(Index)N] = (Real)v;
+    }
+
+    void add(Index i, Index j, double v) override
+    {
+        m_building[i/(Index)N][j/(Index)N][i%(Index)N][j%(Index)N] += (Real)v;
+    }
+
+    /// Clear row and column i, assuming that the block structure is
+    /// symmetric as for the stiffness of a mesh
+    void clearRowCol(Index i) override
+    {
+        const Index bi = i/(Index)N, k = i%(Index)N;
+        for (auto &entry : m_building[bi]) {
+            for (sofa::Size l=0; l<N; l++)
+                entry.second[k][l] = 0;
+
+            auto it = m_building[entry.first].find(bi);
+            if (it != m_building[entry.first].end()) {
+                for (sofa::Size l=0; l<N; l++)
+                    it->second[l][k] = 0;
+            }
+        }
+    }
+
+private:
+    std::size_t m_nbNodes = 0;
+
+    // Blocks being assembled, one map per row
+    sofa::type::vector< std::map<Index,Block> > m_building;
+
+    // Compressed rows
+    sofa::type::vector<Index> m_rowBegin;
+    sofa::type::vector<Index> m_columns;
+    sofa::type::vector<Block> m_blocks;
+};
+
+} // namespace
@@ -0,0 +1,96 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/type/RGBAColor.h>
+#include <sofa/type/Vec.h>
+#include <Shell/config.h>
+
+#include <vector>
+
+namespace shell::misc
+{
+
+/**
+ * @brief Vertex and colour arrays handed to the DrawTool in a single call.
+ *
+ * The arrays are kept between frames and tagged with the version of the data
+ * they were built from (usually the counter of a Data), so that they are only
+ * rebuilt when this data changes.
+ */
+class DrawBuffer
+{
+public:
+    DrawBuffer() : m_version(-1) {}
+
+    /// True if the arrays were built from this version of the data.
+    bool isValid(int version) const { return version == m_version; }
+    void validate(int version) { m_version = version; }
+    void invalidate() { m_version = -1; }
+
+    void clear()
+    {
+        points.clear();
+        colours.clear();
+    }
+
+    template<class Coord>
+    void addPoint(const Coord &p, const sofa::type::RGBAColor &colour)
+    {
+        points.push_back(sofa::type::Vec3(p[0], p[1], p[2]));
+        colours.push_back(colour);
+    }
+
+    /**
+     * @brief Unroll an indexed triangle mesh, three points per triangle.
+     *
+     * @param x             Vertex positions.
+     * @param triangles     Vertex indices of the triangles.
+     * @param vertexColours Colour of each vertex as RGB, may be empty.
+     */
+    template<class VecCoord, class SeqTriangles, class VecColour>
+    void setTriangles(const VecCoord &x, const SeqTriangles &triangles, const VecColour &vertexColours)
+    {
+        points.resize(3*triangles.size());
+        colours.resize(vertexColours.empty() ? 0 : 3*triangles.size());
+
+        for (size_t t=0; t<triangles.size(); t++) {
+            for (size_t k=0; k<3; k++) {
+                const auto index = triangles[t][k];
+                points[3*t+k] = sofa::type::Vec3(x[index][0], x[index][1], x[index][2]);
+                if (!vertexColours.empty()) {
+                    colours[3*t+k] = sofa::type::RGBAColor(
+                        (float)vertexColours[index][0], (float)vertexColours[index][1],
+                        (float)vertexColours[index][2], 1.0f);
+                }
+            }
+        }
+    }
+
+    std::vector<sofa::type::Vec3> points;
+    std::vector<sofa::type::RGBAColor> colours;
+
+private:
+    int m_version;
+};
+
+} // namespace
@@ -0,0 +1,279 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/type/vector.h>
+#include <sofa/type/Vec.h>
+#include <Shell/config.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace shell::misc
+{
+
+/**
+ * @brief Element sleeping for the corotational force fields of triangles
+ * with three rigid nodes.
+ *
+ * The force of each element is kept with the node positions it was computed
+ * for. An element whose nodes have moved so little since its previous
+ * evaluation that its force error bound is within the tolerance falls
+ * asleep, its kept force (and the frame and matrices of the force field) is
+ * used instead of evaluating it again. It wakes up when the bound exceeds
+ * the tolerance, and then wakes up its sleeping neighbours (the elements
+ * sharing a node with it).
+ *
+ * The bound holds for element forces f = -R^T K u with a constant matrix K,
+ * the frame R built from the first edge (a, b) and the normal of the
+ * triangle, and local dofs u made of the node positions relative to the
+ * center rotated by R (or of the node positions if the element is not
+ * corotational) and of the rotation vectors of R times the node rotations.
+ * With alpha the rotation of the frame since the kept evaluation,
+ *
+ *   |f - f0| <= |K| |u - u0| + 2 sin(alpha/2) |f0|
+ *   |u - u0| <= d + alpha r + G (theta + sqrt(3) alpha)
+ *
+ * with |K| the Frobenius norm of the element stiffness, |f0| the norm of the
+ * kept force, d and theta the norms of the node displacements and rotations,
+ * r the radius of the element about its center and G = (phi/2)/sin(phi/2)
+ * the largest gain of the rotation vector along the way, phi bounding the
+ * angles of the local rotations. The angle of the first edge changes by at
+ * most asin(2 d_max/l_ab) and the one of the normal by at most
+ * asin((2 d_max (l_ab + l_ac) + 4 d_max^2)/(2 A)), and alpha by at most
+ * twice the first plus the second. An element whose nodes move too much for
+ * these bounds, or whose local rotations could reach pi, is always awake.
+ */
+template<class DataTypes>
+class ElementSleeping
+{
+public:
+    typedef typename DataTypes::Coord Coord;
+    typedef typename DataTypes::Deriv Deriv;
+    typedef typename DataTypes::VecCoord VecCoord;
+    typedef typename DataTypes::VecDeriv VecDeriv;
+    typedef typename DataTypes::Real Real;
+    typedef sofa::type::Vec<3,Real> Vec3;
+    typedef sofa::Index Index;
+
+    ElementSleeping() : m_tolerance(0), m_corotated(true), m_nbActive(0), m_errorBound(0) {}
+
+    /// Wake up all the elements and forget their forces, e.g. when the
+    /// stiffness changes
+    void clear()
+    {
+        m_elements.clear();
+    }
+
+    /**
+     * @brief Prepare the evaluation of the forces at x: wake up the elements
+     * whose error bound exceeds the tolerance, then their neighbours.
+     */
+    void update(const VecCoord &x, const std::size_t nbElements, const Real tolerance, const bool corotated)
+    {
+        m_tolerance = tolerance;
+        m_corotated = corotated;
+        if (m_elements.size() != nbElements)
+            m_elements.assign(nbElements, Element());
+
+        m_wakeNodes.assign(x.size(), false);
+        bool woken = false;
+
+        for (Element &el : m_elements)
+        {
+            if (!el.asleep)
+                continue;
+
+            el.error = bound(el, x);
+            if (el.error > m_tolerance)
+            {
+                el.asleep = false;
+                for (unsigned int k=0; k<3; k++)
+                    if (el.nodes[k] < x.size())
+                        m_wakeNodes[el.nodes[k]] = true;
+                woken = true;
+            }
+        }
+
+        if (woken)
+        {
+            for (Element &el : m_elements)
+                if (el.asleep && (m_wakeNodes[el.nodes[0]] || m_wakeNodes[el.nodes[1]] || m_wakeNodes[el.nodes[2]]))
+                    el.asleep = false;
+        }
+
+        m_nbActive = 0;
+        m_errorBound = 0;
+        for (const Element &el : m_elements)
+        {
+            if (el.asleep)
+                m_errorBound += el.error;
+            else
+                m_nbActive++;
+        }
+    }
+
+    bool isAsleep(const Index e) const
+    {
+        return e < m_elements.size() && m_elements[e].asleep;
+    }
+
+    /**
+     * @brief Keep the force of an element just evaluated at x, and put it to
+     * sleep if it has barely moved since its previous evaluation.
+     *
+     * @param e              Element index.
+     * @param nodes          Its nodes.
+     * @param f              Force on each node.
+     * @param energy         Its strain energy.
+     * @param stiffnessNorm  Frobenius norm of its stiffness matrix.
+     * @param localRotation  Largest angle of the local node rotations.
+     */
+    template<class Nodes>
+    void store(const Index e, const VecCoord &x, const Nodes &nodes, const Deriv f[3], const SReal energy,
+        const Real stiffnessNorm, const Real localRotation)
+    {
+        if (e >= m_elements.size())
+            return;
+
+        Element &el = m_elements[e];
+        const bool same = el.evaluated && el.nodes[0] == nodes[0] && el.nodes[1] == nodes[1] && el.nodes[2] == nodes[2];
+        if (same)
+            el.asleep = (bound(el, x) <= m_tolerance);
+
+        el.evaluated = true;
+        Real f2 = 0;
+        for (unsigned int k=0; k<3; k++)
+        {
+            el.nodes[k] = nodes[k];
+            el.x[k] = x[nodes[k]];
+            el.f[k] = f[k];
+            f2 += f[k].getVCenter().norm2() + f[k].getVOrientation().norm2();
+        }
+        el.energy = energy;
+        el.stiffnessNorm = stiffnessNorm;
+        el.forceNorm = std::sqrt(f2);
+        el.localRotation = localRotation;
+        el.error = 0;
+
+        // Geometry for the frame rotation
+        const Vec3 p[3] = { el.x[0].getCenter(), el.x[1].getCenter(), el.x[2].getCenter() };
+        const Vec3 center = (p[0] + p[1] + p[2]) / 3;
+        el.radius = std::sqrt((p[0]-center).norm2() + (p[1]-center).norm2() + (p[2]-center).norm2());
+        el.edgeAB = (p[1]-p[0]).norm();
+        el.edgeAC = (p[2]-p[0]).norm();
+        el.area2 = sofa::type::cross(p[1]-p[0], p[2]-p[0]).norm();
+    }
+
+    /// Add the kept forces and strain energies of the sleeping elements
+    void addSleepingForces(VecDeriv &f, SReal &energy) const
+    {
+        for (const Element &el : m_elements)
+        {
+            if (!el.asleep)
+                continue;
+            for (unsigned int k=0; k<3; k++)
+                f[el.nodes[k]] += el.f[k];
+            energy += el.energy;
+        }
+    }
+
+    /// Number of elements evaluated by the last force evaluation
+    Index getNbActive() const { return m_nbActive; }
+
+    /// Sum of the error bounds of the sleeping elements in the last force
+    /// evaluation
+    Real getErrorBound() const { return m_errorBound; }
+
+private:
+    struct Element
+    {
+        Element() : evaluated(false), asleep(false), energy(0), stiffnessNorm(0), forceNorm(0),
+            localRotation(0), radius(0), edgeAB(0), edgeAC(0), area2(0), error(0) { nodes[0] = nodes[1] = nodes[2] = 0; }
+
+        bool evaluated, asleep;
+        Index nodes[3];
+        Coord x[3];
+        Deriv f[3];
+        SReal energy;
+        Real stiffnessNorm, forceNorm, localRotation;
+        Real radius, edgeAB, edgeAC, area2;
+        Real error;
+    };
+
+    Real bound(const Element &el, const VecCoord &x) const
+    {
+        const Real infinity = std::numeric_limits<Real>::max();
+        const Real pi = (Real)3.14159265358979323846;
+
+        Real d2 = 0, theta2 = 0, dMax = 0, thetaMax = 0;
+        for (unsigned int k=0; k<3; k++)
+        {
+            if (el.nodes[k] >= x.size())
+                return infinity;
+            const Coord &xk = x[el.nodes[k]];
+
+            const Real d = (xk.getCenter() - el.x[k].getCenter()).norm();
+
+            // Angle of the rotation from the kept orientation
+            const auto q = xk.getOrientation() * el.x[k].getOrientation().inverse();
+            const Real theta = 2 * std::atan2(Vec3(q[0], q[1], q[2]).norm(), std::abs(q[3]));
+
+            d2 += d*d;
+            theta2 += theta*theta;
+            dMax = std::max(dMax, d);
+            thetaMax = std::max(thetaMax, theta);
+        }
+
+        // Rotation of the frame, from the rotations of the first edge and of
+        // the normal
+        Real alpha = 0;
+        if (m_corotated && dMax > 0)
+        {
+            const Real edgeChange = 2*dMax;
+            const Real normalChange = 2*dMax*(el.edgeAB + el.edgeAC) + 4*dMax*dMax;
+            if (edgeChange >= el.edgeAB || normalChange >= el.area2)
+                return infinity;
+            alpha = 2*std::asin(edgeChange / el.edgeAB) + std::asin(normalChange / el.area2);
+        }
+
+        // Gain of the rotation vector of the local rotations, whose angles
+        // stay below phi
+        const Real phi = el.localRotation + thetaMax + alpha;
+        if (phi >= pi)
+            return infinity;
+        const Real gain = (phi > 0) ? (phi/2) / std::sin(phi/2) : 1;
+
+        const Real du = std::sqrt(d2) + alpha*el.radius + gain*(std::sqrt(theta2) + std::sqrt((Real)3)*alpha);
+        return el.stiffnessNorm * du + 2*std::sin(alpha/2) * el.forceNorm;
+    }
+
+    sofa::type::vector<Element> m_elements;
+    sofa::type::vector<bool> m_wakeNodes;
+    Real m_tolerance;
+    bool m_corotated;
+    Index m_nbActive;
+    Real m_errorBound;
+};
+
+} // namespace
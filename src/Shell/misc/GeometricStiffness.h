@@ -0,0 +1,224 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/linearalgebra/BaseMatrix.h>
+#include <sofa/type/Mat.h>
+#include <sofa/type/Vec.h>
+#include <sofa/type/fixed_array.h>
+#include <Shell/config.h>
+
+#include <cmath>
+#include <limits>
+
+namespace shell::misc
+{
+
+/**
+ * @brief Geometric (initial stress) stiffness of a corotational triangle with
+ * three rigid nodes.
+ *
+ * The element forces are computed in the element frame and rotated into the
+ * global frame. When the nodes move by dx the frame rotates by
+ * theta = sum_i G_i dx_i, and so do the element forces: dp_i = theta x p_i.
+ * The material stiffness ignores this, the term added here is
+ * df_i = p_i x theta (and the same for the moments m_i), i.e. the blocks
+ * S(p_i) G_j of the tangent stiffness, S(p) being the cross product matrix.
+ * The blocks are not symmetric.
+ *
+ * Only the translations of the nodes move the frame, hence only the
+ * translation columns of the element matrix are affected.
+ */
+template<class Real>
+class GeometricStiffness
+{
+public:
+    typedef sofa::type::Vec<3,Real> Vec3;
+    typedef sofa::type::Mat<3,3,Real> Mat33;
+
+    GeometricStiffness() { clear(); }
+
+    void clear()
+    {
+        for (unsigned int i=0; i<3; i++) {
+            m_G[i].clear();
+            m_force[i].clear();
+            m_moment[i].clear();
+        }
+    }
+
+    /**
+     * @brief Frame with the x axis along the first edge and the z axis normal
+     * to the triangle.
+     *
+     * @param x  Node positions in the element frame.
+     * @param R  Rotation from the global into the element frame.
+     */
+    void setEdgeFrame(const sofa::type::fixed_array<Vec3,3> &x, const Mat33 &R)
+    {
+        Mat33 G[3];
+        if (!tilt(G, x))
+            return;
+
+        // Rotation of the first edge about the normal
+        const Real L = std::sqrt((x[1][0]-x[0][0])*(x[1][0]-x[0][0]) + (x[1][1]-x[0][1])*(x[1][1]-x[0][1]));
+        G[0][2][1] = -1/L;
+        G[1][2][1] = 1/L;
+
+        toGlobal(G, R);
+    }
+
+    /**
+     * @brief Frame with the z axis normal to the triangle and the in-plane
+     * axes fitted to the nodes, e.g. by polar decomposition.
+     *
+     * The in-plane rotation is the one minimising the squared distance of
+     * the rotated nodes to the displaced ones.
+     */
+    void setFittedFrame(const sofa::type::fixed_array<Vec3,3> &x, const Mat33 &R)
+    {
+        Mat33 G[3];
+        if (!tilt(G, x))
+            return;
+
+        const Vec3 center = (x[0] + x[1] + x[2])/3;
+        Real s = 0;
+        for (unsigned int i=0; i<3; i++) {
+            const Vec3 r = x[i] - center;
+            s += r[0]*r[0] + r[1]*r[1];
+        }
+
+        for (unsigned int i=0; i<3; i++) {
+            const Vec3 r = x[i] - center;
+            G[i][2][0] = -r[1]/s;
+            G[i][2][1] = r[0]/s;
+        }
+
+        toGlobal(G, R);
+    }
+
+    /// Force and moment (in the global frame) the element exerts on node i,
+    /// with the sign they are subtracted from the global force vector
+    void setForce(unsigned int i, const Vec3 &force, const Vec3 &moment)
+    {
+        m_force[i] = force;
+        m_moment[i] = moment;
+    }
+
+    /// Rotation of the frame for the given node translations
+    Vec3 spin(const Vec3 &dxa, const Vec3 &dxb, const Vec3 &dxc) const
+    {
+        return m_G[0]*dxa + m_G[1]*dxb + m_G[2]*dxc;
+    }
+
+    /// Variation of the force on node i for the frame rotation theta
+    Vec3 dForce(unsigned int i, const Vec3 &theta) const { return cross(m_force[i], theta); }
+
+    /// Variation of the moment on node i for the frame rotation theta
+    Vec3 dMoment(unsigned int i, const Vec3 &theta) const { return cross(m_moment[i], theta); }
+
+    /**
+     * @brief Add factor times the geometric stiffness into a global matrix.
+     *
+     * @param matrix  Global matrix.
+     * @param offset  Offset of the mechanical state in the global matrix.
+     * @param t       Node indices of the triangle.
+     * @param factor  Scale factor, i.e. kFactor.
+     */
+    template<class Triangle>
+    void addToMatrix(sofa::linearalgebra::BaseMatrix *matrix, sofa::Index offset,
+        const Triangle &t, const Real factor) const
+    {
+        for (unsigned int i=0; i<3; i++) {
+            const Mat33 Sf = crossMatrix(m_force[i]) * factor;
+            const Mat33 Sm = crossMatrix(m_moment[i]) * factor;
+
+            for (unsigned int j=0; j<3; j++) {
+                const Mat33 Kf = Sf * m_G[j];
+                const Mat33 Km = Sm * m_G[j];
+
+                for (unsigned int k=0; k<3; k++) {
+                    for (unsigned int l=0; l<3; l++) {
+                        matrix->add(offset + 6*t[i] + k, offset + 6*t[j] + l, Kf[k][l]);
+                        matrix->add(offset + 6*t[i] + 3 + k, offset + 6*t[j] + l, Km[k][l]);
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    /// Rotation of the normal about the in-plane axes (element frame). Returns
+    /// false for a degenerate triangle, whose frame spin is left at zero.
+    bool tilt(Mat33 G[3], const sofa::type::fixed_array<Vec3,3> &x)
+    {
+        for (unsigned int i=0; i<3; i++)
+            G[i].clear();
+
+        clearSpin();
+
+        // Twice the signed area
+        const Real area2 = (x[1][0]-x[0][0])*(x[2][1]-x[0][1]) - (x[2][0]-x[0][0])*(x[1][1]-x[0][1]);
+        if (std::abs(area2) < std::numeric_limits<Real>::min())
+            return false;
+
+        // The normal follows the gradient of the out-of-plane displacement w:
+        // theta_x = dw/dy, theta_y = -dw/dx
+        for (unsigned int i=0; i<3; i++) {
+            const unsigned int j = (i+1)%3, k = (i+2)%3;
+            const Real b = x[j][1] - x[k][1];
+            const Real c = x[k][0] - x[j][0];
+            G[i][0][2] = c/area2;
+            G[i][1][2] = -b/area2;
+        }
+
+        return true;
+    }
+
+    void clearSpin()
+    {
+        for (unsigned int i=0; i<3; i++)
+            m_G[i].clear();
+    }
+
+    void toGlobal(const Mat33 G[3], const Mat33 &R)
+    {
+        const Mat33 Rt = R.transposed();
+        for (unsigned int i=0; i<3; i++)
+            m_G[i] = Rt * G[i] * R;
+    }
+
+    static Mat33 crossMatrix(const Vec3 &v)
+    {
+        Mat33 S;
+        S.clear();
+        S[0][1] = -v[2]; S[0][2] = v[1];
+        S[1][0] = v[2];  S[1][2] = -v[0];
+        S[2][0] = -v[1]; S[2][1] = v[0];
+        return S;
+    }
+
+    Mat33 m_G[3];
+    Vec3 m_force[3], m_moment[3];
+};
+
+} // namespace
@@ -0,0 +1,175 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/core/topology/BaseMeshTopology.h>
+#include <sofa/type/vector.h>
+#include <Shell/config.h>
+
+#include <algorithm>
+#include <deque>
+#include <tuple>
+#include <utility>
+
+namespace shell::misc
+{
+
+/**
+ * @brief Breadth-first order of the vertices of a subset of a graph, from a
+ * pseudo-peripheral vertex, i.e. the last vertex reached by a first
+ * traversal. Each connected component is traversed in turn.
+ *
+ * @param adjacency  Neighbours of each vertex of the whole graph.
+ * @param subset     Vertices to order.
+ * @param mark       One entry per vertex of the graph, set to stamp for the
+ *                   vertices of the subset and modified by the traversal.
+ * @param stamp      Value marking the subset in mark, stamp+1 and stamp+2
+ *                   are used for the two traversals.
+ */
+inline sofa::type::vector<sofa::Index> breadthFirstOrder(const sofa::type::vector< sofa::type::vector<sofa::Index> > &adjacency,
+    const sofa::type::vector<sofa::Index> &subset, sofa::type::vector<unsigned int> &mark, unsigned int stamp)
+{
+    sofa::type::vector<sofa::Index> order;
+    order.reserve(subset.size());
+
+    const auto traverse = [&](sofa::Index first, unsigned int from, unsigned int to) {
+        std::deque<sofa::Index> queue(1, first);
+        mark[first] = to;
+        while (!queue.empty()) {
+            const sofa::Index v = queue.front();
+            queue.pop_front();
+            order.push_back(v);
+            for (const sofa::Index w : adjacency[v]) {
+                if (mark[w] == from) {
+                    mark[w] = to;
+                    queue.push_back(w);
+                }
+            }
+        }
+    };
+
+    for (const sofa::Index v : subset) {
+        if (mark[v] != stamp)
+            continue;
+
+        // First traversal to find a far vertex of the component, which
+        // starts the second one
+        const std::size_t begin = order.size();
+        traverse(v, stamp, stamp+1);
+        const sofa::Index start = order.back();
+        order.resize(begin);
+        traverse(start, stamp+1, stamp+2);
+    }
+
+    return order;
+}
+
+/**
+ * @brief Partition the triangles of a mesh into nbParts parts of balanced
+ * sizes, by recursive bisection of the graph of the triangles sharing an
+ * edge. Each bisection cuts the breadth-first order of the triangles at the
+ * ratio of the numbers of parts on each side, which keeps the parts compact
+ * and their interface short.
+ *
+ * @return The part of each triangle.
+ */
+inline sofa::type::vector<unsigned int> partitionTriangles(const sofa::core::topology::BaseMeshTopology::SeqTriangles &triangles,
+    unsigned int nbParts)
+{
+    const std::size_t nbTriangles = triangles.size();
+    sofa::type::vector<unsigned int> parts(nbTriangles, 0);
+    if (nbParts < 2 || nbTriangles < 2)
+        return parts;
+
+    // Triangles sharing an edge are adjacent
+    sofa::type::vector< std::tuple<sofa::Index,sofa::Index,sofa::Index> > edges;
+    edges.reserve(3*nbTriangles);
+    for (std::size_t t=0; t<nbTriangles; t++) {
+        for (unsigned int k=0; k<3; k++) {
+            const sofa::Index a = triangles[t][k], b = triangles[t][(k+1)%3];
+            edges.emplace_back(std::min(a,b), std::max(a,b), (sofa::Index)t);
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    sofa::type::vector< sofa::type::vector<sofa::Index> > adjacency(nbTriangles);
+    for (std::size_t e=0; e<edges.size(); ) {
+        std::size_t end = e+1;
+        while (end < edges.size() && std::get<0>(edges[end]) == std::get<0>(edges[e]) && std::get<1>(edges[end]) == std::get<1>(edges[e]))
+            end++;
+        for (std::size_t i=e; i<end; i++)
+            for (std::size_t j=e; j<end; j++)
+                if (i != j)
+                    adjacency[std::get<2>(edges[i])].push_back(std::get<2>(edges[j]));
+        e = end;
+    }
+
+    struct Task
+    {
+        sofa::type::vector<sofa::Index> triangles;
+        unsigned int firstPart, nbParts;
+    };
+
+    sofa::type::vector<unsigned int> mark(nbTriangles, 0);
+    unsigned int stamp = 0;
+
+    sofa::type::vector<Task> tasks(1);
+    tasks[0].triangles.resize(nbTriangles);
+    for (std::size_t t=0; t<nbTriangles; t++)
+        tasks[0].triangles[t] = (sofa::Index)t;
+    tasks[0].firstPart = 0;
+    tasks[0].nbParts = nbParts;
+
+    while (!tasks.empty()) {
+        Task task = std::move(tasks.back());
+        tasks.pop_back();
+
+        if (task.nbParts < 2 || task.triangles.size() < 2) {
+            for (const sofa::Index t : task.triangles)
+                parts[t] = task.firstPart;
+            continue;
+        }
+
+        stamp += 3;
+        for (const sofa::Index t : task.triangles)
+            mark[t] = stamp;
+        const sofa::type::vector<sofa::Index> order = breadthFirstOrder(adjacency, task.triangles, mark, stamp);
+
+        const unsigned int leftParts = task.nbParts/2;
+        const std::size_t cut = order.size()*leftParts/task.nbParts;
+
+        Task left, right;
+        left.triangles.assign(order.begin(), order.begin()+cut);
+        left.firstPart = task.firstPart;
+        left.nbParts = leftParts;
+        right.triangles.assign(order.begin()+cut, order.end());
+        right.firstPart = task.firstPart+leftParts;
+        right.nbParts = task.nbParts-leftParts;
+
+        tasks.push_back(std::move(left));
+        tasks.push_back(std::move(right));
+    }
+
+    return parts;
+}
+
+} // namespace
@@ -0,0 +1,119 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/type/Vec.h>
+#include <Shell/config.h>
+#include <Shell/misc/SymmetricMatrix.h>
+
+#include <cmath>
+
+namespace shell::misc
+{
+
+/**
+ * @brief Packed symmetric matrix stored either in the precision of Real or in
+ * single precision, chosen when it is set.
+ *
+ * Both representations share the same storage: the single precision option
+ * adds no memory and the products then read half of it. The conversion
+ * happens once, in set().
+ */
+template<sofa::Size N, class Real>
+class MixedSymmetricMatrix
+{
+public:
+    typedef SymmetricMatrix<N, Real> Full;
+    typedef SymmetricMatrix<N, float> Single;
+
+    MixedSymmetricMatrix() : m_full(), m_single(false) {}
+
+    /// Store a matrix, rounded to single precision if requested.
+    void set(const Full &m, bool single)
+    {
+        if (single)
+            m_singleMatrix = Single(m);
+        else
+            m_full = m;
+        m_single = single;
+    }
+
+    bool isSingle() const { return m_single; }
+
+    /// Stored matrix, only valid if !isSingle().
+    const Full& full() const { return m_full; }
+
+    /// Stored matrix, only valid if isSingle().
+    const Single& single() const { return m_singleMatrix; }
+
+    /// Matrix in the precision of Real, whatever the storage.
+    Full toFull() const { return m_single ? Full(m_singleMatrix) : m_full; }
+
+    Real operator()(sofa::Size i, sofa::Size j) const
+    {
+        return m_single ? (Real)m_singleMatrix(i,j) : m_full(i,j);
+    }
+
+    /// Product evaluated in the precision of the storage.
+    template<class VReal>
+    sofa::type::Vec<N,VReal> operator*(const sofa::type::Vec<N,VReal> &v) const
+    {
+        return m_single ? m_singleMatrix * v : m_full * v;
+    }
+
+    Real norm() const { return m_single ? (Real)m_singleMatrix.norm() : m_full.norm(); }
+
+private:
+    union {
+        Full m_full;
+        Single m_singleMatrix;
+    };
+    bool m_single;
+};
+
+/**
+ * @brief Accumulates the difference between element products evaluated in
+ * single and in full precision.
+ */
+class MixedPrecisionError
+{
+public:
+    MixedPrecisionError() : m_diff2(0), m_ref2(0) {}
+
+    void clear() { m_diff2 = m_ref2 = 0; }
+
+    /// Add the result of one product in both precisions.
+    template<sofa::Size N, class Real>
+    void add(const sofa::type::Vec<N,Real> &mixed, const sofa::type::Vec<N,Real> &full)
+    {
+        m_diff2 += (double)(mixed - full).norm2();
+        m_ref2 += (double)full.norm2();
+    }
+
+    /// Relative L2 difference over all products added since clear().
+    double relative() const { return (m_ref2 > 0) ? std::sqrt(m_diff2/m_ref2) : 0.0; }
+
+private:
+    double m_diff2, m_ref2;
+};
+
+} // namespace
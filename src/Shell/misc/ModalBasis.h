@@ -0,0 +1,140 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/type/vector.h>
+#include <Shell/config.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace shell::misc
+{
+
+/**
+ * @brief Mass-normalised vibration modes of a mesh, with their eigenvalues
+ * and optionally the modal derivatives, stored in a binary file.
+ *
+ * The file starts with the 4 bytes "SHMB" and a uint32 version (1), then
+ * the number of modes, of nodes, of dofs per node and of derivatives as
+ * uint32. Follow the eigenvalues, the modes and the derivatives as float64,
+ * each mode or derivative being nbNodes*nbDofs values. Native byte order is
+ * used.
+ *
+ * The derivative of modes i and j, i<=j, is at index j*(j+1)/2+i.
+ */
+class ModalBasis
+{
+public:
+    typedef sofa::type::vector<double> Vector;
+
+    void resize(sofa::Size nbModes, sofa::Size nbNodes, sofa::Size nbDofs)
+    {
+        m_nbNodes = nbNodes;
+        m_nbDofs = nbDofs;
+        m_eigenvalues.assign(nbModes, 0);
+        m_modes.assign(nbModes, Vector(nbNodes*nbDofs, 0));
+        m_derivatives.clear();
+    }
+
+    sofa::Size getNbModes() const { return (sofa::Size)m_modes.size(); }
+    sofa::Size getNbNodes() const { return m_nbNodes; }
+    sofa::Size getNbDofs() const { return m_nbDofs; }
+    bool hasDerivatives() const { return !m_modes.empty() && m_derivatives.size() == getNbDerivatives(); }
+
+    /// Number of derivatives for the current number of modes
+    sofa::Size getNbDerivatives() const { return getNbModes()*(getNbModes()+1)/2; }
+    static sofa::Size derivativeIndex(sofa::Size i, sofa::Size j)
+    {
+        return i <= j ? j*(j+1)/2+i : i*(i+1)/2+j;
+    }
+
+    double& eigenvalue(sofa::Size j) { return m_eigenvalues[j]; }
+    double eigenvalue(sofa::Size j) const { return m_eigenvalues[j]; }
+    const Vector& getEigenvalues() const { return m_eigenvalues; }
+
+    Vector& mode(sofa::Size j) { return m_modes[j]; }
+    const Vector& mode(sofa::Size j) const { return m_modes[j]; }
+
+    /// Allocate the derivatives, zero
+    void initDerivatives() { m_derivatives.assign(getNbDerivatives(), Vector(m_nbNodes*m_nbDofs, 0)); }
+    Vector& derivative(sofa::Size i, sofa::Size j) { return m_derivatives[derivativeIndex(i,j)]; }
+    const Vector& derivative(sofa::Size i, sofa::Size j) const { return m_derivatives[derivativeIndex(i,j)]; }
+
+    bool write(const std::string &filename) const
+    {
+        std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return false;
+
+        const std::uint32_t header[5] = { 1, (std::uint32_t)getNbModes(), (std::uint32_t)m_nbNodes,
+            (std::uint32_t)m_nbDofs, (std::uint32_t)m_derivatives.size() };
+        file.write("SHMB", 4);
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(m_eigenvalues.data()), m_eigenvalues.size()*sizeof(double));
+        for (const Vector &m : m_modes)
+            file.write(reinterpret_cast<const char*>(m.data()), m.size()*sizeof(double));
+        for (const Vector &d : m_derivatives)
+            file.write(reinterpret_cast<const char*>(d.data()), d.size()*sizeof(double));
+        return file.good();
+    }
+
+    bool read(const std::string &filename)
+    {
+        std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+        if (!file.is_open())
+            return false;
+
+        char magic[4];
+        std::uint32_t header[5];
+        file.read(magic, 4);
+        file.read(reinterpret_cast<char*>(header), sizeof(header));
+        if (!file.good() || std::memcmp(magic, "SHMB", 4) != 0 || header[0] != 1)
+            return false;
+
+        resize(header[1], header[2], header[3]);
+        file.read(reinterpret_cast<char*>(m_eigenvalues.data()), m_eigenvalues.size()*sizeof(double));
+        for (Vector &m : m_modes)
+            file.read(reinterpret_cast<char*>(m.data()), m.size()*sizeof(double));
+
+        if (header[4] > 0)
+        {
+            if (header[4] != getNbDerivatives())
+                return false;
+            initDerivatives();
+            for (Vector &d : m_derivatives)
+                file.read(reinterpret_cast<char*>(d.data()), d.size()*sizeof(double));
+        }
+        return file.good();
+    }
+
+private:
+    sofa::Size m_nbNodes = 0;
+    sofa::Size m_nbDofs = 0;
+    Vector m_eigenvalues;
+    sofa::type::vector<Vector> m_modes;
+    sofa::type::vector<Vector> m_derivatives;
+};
+
+} // namespace
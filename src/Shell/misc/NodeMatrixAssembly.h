@@ -0,0 +1,90 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/core/behavior/BaseMass.h>
+#include <sofa/core/behavior/ForceField.h>
+#include <sofa/core/behavior/MechanicalState.h>
+#include <sofa/core/behavior/ProjectiveConstraintSet.h>
+#include <sofa/core/behavior/SingleMatrixAccessor.h>
+#include <sofa/core/MechanicalParams.h>
+#include <sofa/core/objectmodel/BaseContext.h>
+#include <Shell/config.h>
+#include <Shell/misc/BlockSparseMatrix.h>
+
+namespace shell::misc
+{
+
+/**
+ * @brief Assemble M*mFactor + B*bFactor + K*kFactor of a mechanical state
+ * from the mass and the force fields in its context, then compress the
+ * matrix.
+ *
+ * Only the force fields and projective constraints acting on the state
+ * alone are taken into account, mapped components are ignored.
+ *
+ * @param withForceFields  Add the stiffness and damping of the force fields,
+ *                         otherwise only the mass is assembled.
+ * @param withConstraints  Apply the projective constraints to the matrix.
+ */
+template<class DataTypes, sofa::Size N, class Real>
+void assembleNodeMatrix(sofa::core::objectmodel::BaseContext *context,
+    sofa::core::behavior::MechanicalState<DataTypes> *state,
+    const sofa::core::MechanicalParams *mparams, BlockSparseMatrix<N,Real> &matrix,
+    bool withForceFields, bool withConstraints)
+{
+    matrix.resizeBlocks(state->getSize());
+    sofa::core::behavior::SingleMatrixAccessor accessor(&matrix);
+
+    sofa::core::behavior::BaseMass* mass = context->getMass();
+    if (mass)
+        mass->addMToMatrix(mparams, &accessor);
+
+    if (withForceFields)
+    {
+        sofa::type::vector< sofa::core::behavior::ForceField<DataTypes>* > forceFields;
+        context->get< sofa::core::behavior::ForceField<DataTypes> >(&forceFields, sofa::core::objectmodel::BaseContext::Local);
+        for (sofa::core::behavior::ForceField<DataTypes>* ff : forceFields)
+        {
+            if (ff->getMState() != state || dynamic_cast<sofa::core::behavior::BaseMass*>(ff))
+                continue;
+
+            ff->addKToMatrix(mparams, &accessor);
+            ff->addBToMatrix(mparams, &accessor);
+        }
+    }
+
+    if (withConstraints)
+    {
+        sofa::type::vector< sofa::core::behavior::ProjectiveConstraintSet<DataTypes>* > constraints;
+        context->get< sofa::core::behavior::ProjectiveConstraintSet<DataTypes> >(&constraints, sofa::core::objectmodel::BaseContext::Local);
+        for (sofa::core::behavior::ProjectiveConstraintSet<DataTypes>* c : constraints)
+        {
+            if (c->getMState() == state)
+                c->applyConstraint(mparams, &accessor);
+        }
+    }
+
+    matrix.compress();
+}
+
+} // namespace
@@ -74,6 +74,7 @@ class Optimize2DSurface
             : m_adapter(adapter)
             , m_topology(NULL)
             , m_surf(surface)
+            , m_allDirty(true)
             {}
 
         /**
@@ -85,6 +86,25 @@ class Optimize2DSurface
         void initValues(VecReal &metrics,
             sofa::component::topology::TriangleSetTopologyContainer *topology);
 
+        /**
+         * @brief Bring function values up to date.
+         *
+         * Only the values of triangles around points passed to
+         * invalidatePoint() are recomputed. Falls back to initValues() after
+         * invalidateAll() or if the number of triangles changed.
+         *
+         * @param metrics Vector of values to update.
+         * @param topology Associated triangular topology.
+         */
+        void updateValues(VecReal &metrics,
+            sofa::component::topology::TriangleSetTopologyContainer *topology);
+
+        /// Mark values of the triangles around a point as outdated.
+        void invalidatePoint(Index v) { m_dirtyPoints.push_back(v); }
+
+        /// Mark all values as outdated.
+        void invalidateAll() { m_allDirty = true; m_dirtyPoints.clear(); }
+
         /**
          * @brief Perform smoothing step for single point.
          *
@@ -175,6 +195,11 @@ class Optimize2DSurface
         /// Orientation of each triangle.
         type::vector<bool> m_orientation;
 
+        /// Points whose neighbouring triangles need new values.
+        type::vector<Index> m_dirtyPoints;
+        /// All values need to be recomputed.
+        bool m_allDirty;
+
         /// Minimal increase in functional to accept the change
         Real m_sigma;
         /// Amount of precision that is acceptable for us.
@@ -187,6 +212,15 @@ class Optimize2DSurface
         int ngamma;
 
 
+        /**
+         * @brief Compute orientation and function value of one triangle.
+         *
+         * @param i         Triangle index.
+         * @param x         Vertices.
+         * @param metrics   Vector of values to update.
+         */
+        void computeValue(Index i, const VecVec2 &x, VecReal &metrics);
+
         /**
          * @brief Constrained Laplacian smoothing.
          *
@@ -11,6 +11,7 @@
 #include <SofaShells/controller/Test2DAdapter.h>
 #include <SofaShells/misc/Optimize2DSurface.h>
 
+#include <algorithm>
 #include <float.h>
 #include <sofa/helper/rmath.h>
 
@@ -36,13 +37,58 @@ void Optimize2DSurface<DataTypes>::initValues(VecReal &metrics,
 
     // Compute initial metrics and orientations
     for (Index i=0; i < (unsigned int)m_topology->getNbTriangles(); i++) {
-        const Triangle &t = m_topology->getTriangle(i);
-        m_orientation[i] = CCW(x[t[0]], x[t[1]], x[t[2]]);
-        metrics[i] = funcTriangle(t, x, m_orientation[i]);
-        if (std::isnan(metrics[i])) {
-            std::cerr << "NaN value for triangle " << i << "\n";
+        computeValue(i, x, metrics);
+    }
+
+    m_dirtyPoints.clear();
+    m_allDirty = false;
+}
+
+template <class DataTypes>
+void Optimize2DSurface<DataTypes>::updateValues(VecReal &metrics,
+    sofa::component::topology::TriangleSetTopologyContainer *topology)
+{
+    const unsigned int nbTriangles = topology->getNbTriangles();
+
+    if (m_allDirty || (topology != m_topology) ||
+        (metrics.size() != nbTriangles) ||
+        (m_orientation.size() != nbTriangles)) {
+        metrics.resize(nbTriangles);
+        initValues(metrics, topology);
+        return;
+    }
+
+    if (m_dirtyPoints.empty()) return;
+
+    const VecVec2 &x = m_surf.getPositions();
+
+    // Points often get invalidated several times per step
+    std::sort(m_dirtyPoints.begin(), m_dirtyPoints.end());
+    m_dirtyPoints.erase(std::unique(m_dirtyPoints.begin(), m_dirtyPoints.end()),
+        m_dirtyPoints.end());
+
+    for (Index ip=0; ip < m_dirtyPoints.size(); ip++) {
+        const Index v = m_dirtyPoints[ip];
+        if (v >= x.size()) continue;
+
+        const TrianglesAroundVertex &N1 = m_topology->getTrianglesAroundVertex(v);
+        for (Index it=0; it<N1.size(); it++) {
+            computeValue(N1[it], x, metrics);
         }
+    }
+
+    m_dirtyPoints.clear();
+}
 
+template <class DataTypes>
+void Optimize2DSurface<DataTypes>::computeValue(Index i, const VecVec2 &x,
+    VecReal &metrics)
+{
+    const Triangle &t = m_topology->getTriangle(i);
+    m_orientation[i] = CCW(x[t[0]], x[t[1]], x[t[2]]);
+    metrics[i] = funcTriangle(t, x, m_orientation[i]);
+    if (std::isnan(metrics[i])) {
+        std::cerr << "NaN value for triangle " << i << "\n";
     }
 }
 
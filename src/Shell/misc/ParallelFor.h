@@ -0,0 +1,74 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/simulation/MainTaskSchedulerFactory.h>
+#include <sofa/simulation/ParallelForEach.h>
+#include <sofa/simulation/TaskScheduler.h>
+#include <Shell/config.h>
+
+namespace shell::misc
+{
+
+/**
+ * @brief Get the main task scheduler, initialising it on first use.
+ */
+inline sofa::simulation::TaskScheduler* getTaskScheduler()
+{
+    sofa::simulation::TaskScheduler* taskScheduler =
+        sofa::simulation::MainTaskSchedulerFactory::createInRegistry();
+    if (taskScheduler && taskScheduler->getThreadCount() < 1)
+        taskScheduler->init(0);
+    return taskScheduler;
+}
+
+/**
+ * @brief Call f(begin, end) on consecutive chunks of the index range [first,
+ * last). The chunks are processed concurrently by the main task scheduler if
+ * parallel is true, otherwise f is called once on the whole range.
+ *
+ * @param parallel  Dispatch the chunks to the task scheduler.
+ * @param first     First index of the range.
+ * @param last      One past the last index of the range.
+ * @param f         Callable with signature void(Index begin, Index end).
+ */
+template <class Index, class F>
+void parallelForRange(bool parallel, Index first, Index last, const F &f)
+{
+    if (first >= last)
+        return;
+
+    sofa::simulation::TaskScheduler* taskScheduler =
+        parallel ? getTaskScheduler() : nullptr;
+
+    if (taskScheduler == nullptr || taskScheduler->getThreadCount() < 2) {
+        f(first, last);
+        return;
+    }
+
+    sofa::simulation::parallelForEachRange(*taskScheduler, first, last,
+        [&f](const sofa::simulation::Range<Index> &range) {
+            f(range.start, range.end);
+        });
+}
+
+} // namespace
@@ -0,0 +1,164 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <Shell/config.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace shell::misc
+{
+
+/**
+ * @brief 64-bit FNV-1a hash of raw values, used to identify the input of a
+ * cached computation (mesh, rest positions, material parameters...).
+ */
+class Hash64
+{
+public:
+    Hash64() : m_value(14695981039346656037ull) {}
+
+    void addBytes(const void *data, std::size_t size)
+    {
+        const unsigned char *p = static_cast<const unsigned char*>(data);
+        for (std::size_t i=0; i<size; i++) {
+            m_value ^= p[i];
+            m_value *= 1099511628211ull;
+        }
+    }
+
+    /// Add a value made of plain numbers (Vec, Mat, fixed_array...).
+    template<class T>
+    void add(const T &v) { addBytes(&v, sizeof(T)); }
+
+    void add(const std::string &s)
+    {
+        add((std::uint64_t)s.size());
+        addBytes(s.data(), s.size());
+    }
+
+    /// Add all elements of a contiguous container.
+    template<class Container>
+    void addArray(const Container &c)
+    {
+        add((std::uint64_t)c.size());
+        if (!c.empty())
+            addBytes(&c[0], c.size()*sizeof(c[0]));
+    }
+
+    std::uint64_t value() const { return m_value; }
+
+private:
+    std::uint64_t m_value;
+};
+
+/**
+ * @brief File holding the rest state of all the elements of a force field.
+ *
+ * The file starts with the 4 bytes "SHRC", a uint32 version (1), the uint64
+ * key of the input the state was computed from and the uint64 number of
+ * elements, followed by the elements. Native byte order is used, the cache is
+ * not meant to be portable.
+ *
+ * Elements provide a template method serializeRest(Archive &ar) calling ar()
+ * on each of their rest quantities, in the same order for reading and writing.
+ * Only values made of plain numbers can be passed to ar(), containers have to
+ * pass their size first.
+ */
+class RestStateCache
+{
+public:
+    /// Read the elements if the file exists and was written for this key and
+    /// number of elements. Elements may be partly overwritten on failure.
+    template<class VecElement>
+    static bool load(const std::string &filename, std::uint64_t key, VecElement &elements)
+    {
+        std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+        if (!file.is_open())
+            return false;
+
+        char magic[4];
+        std::uint32_t version = 0;
+        std::uint64_t fileKey = 0, count = 0;
+        file.read(magic, 4);
+        file.read(reinterpret_cast<char*>(&version), sizeof(version));
+        file.read(reinterpret_cast<char*>(&fileKey), sizeof(fileKey));
+        file.read(reinterpret_cast<char*>(&count), sizeof(count));
+        if (!file.good() || std::memcmp(magic, "SHRC", 4) != 0 || version != 1 ||
+            fileKey != key || count != (std::uint64_t)elements.size())
+            return false;
+
+        Reader reader(file);
+        for (std::size_t i=0; i<elements.size() && file.good(); i++)
+            elements[i].serializeRest(reader);
+
+        return file.good();
+    }
+
+    /// Write the elements, replacing the file.
+    template<class VecElement>
+    static bool save(const std::string &filename, std::uint64_t key, VecElement &elements)
+    {
+        std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return false;
+
+        const std::uint32_t version = 1;
+        const std::uint64_t count = elements.size();
+        file.write("SHRC", 4);
+        file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+        Writer writer(file);
+        for (std::size_t i=0; i<elements.size(); i++)
+            elements[i].serializeRest(writer);
+
+        return file.good();
+    }
+
+private:
+    class Reader
+    {
+    public:
+        explicit Reader(std::istream &in) : m_in(in) {}
+        template<class T>
+        void operator()(T &v) { m_in.read(reinterpret_cast<char*>(&v), sizeof(T)); }
+    private:
+        std::istream &m_in;
+    };
+
+    class Writer
+    {
+    public:
+        explicit Writer(std::ostream &out) : m_out(out) {}
+        template<class T>
+        void operator()(const T &v) { m_out.write(reinterpret_cast<const char*>(&v), sizeof(T)); }
+    private:
+        std::ostream &m_out;
+    };
+};
+
+} // namespace
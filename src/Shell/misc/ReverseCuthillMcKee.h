@@ -0,0 +1,141 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/type/vector.h>
+#include <Shell/config.h>
+
+#include <algorithm>
+#include <numeric>
+
+namespace shell::misc
+{
+
+/**
+ * @brief Reverse Cuthill-McKee ordering of a graph, which reduces the
+ * bandwidth of the matrices with its sparsity.
+ *
+ * Each connected component starts from a pseudo-peripheral vertex, found by
+ * repeated breadth-first searches from a vertex of lowest degree, and the
+ * neighbours are visited by increasing degree.
+ *
+ * @param nbVertices  Number of vertices of the graph.
+ * @param offsets     Neighbours of vertex v are neighbours[offsets[v] ..
+ *                    offsets[v+1]-1] (compressed rows, nbVertices+1 values).
+ * @param neighbours  Neighbour lists, without self loops.
+ *
+ * @return The vertices in their new order.
+ */
+inline sofa::type::vector<sofa::Index> reverseCuthillMcKee(sofa::Index nbVertices,
+    const sofa::type::vector<sofa::Index> &offsets, const sofa::type::vector<sofa::Index> &neighbours)
+{
+    typedef sofa::Index Index;
+    typedef sofa::type::vector<Index> VecIndex;
+
+    VecIndex perm;
+    perm.reserve(nbVertices);
+
+    auto degree = [&](Index i) { return offsets[i+1] - offsets[i]; };
+
+    // Starting candidates, lowest degree first
+    VecIndex byDegree(nbVertices);
+    std::iota(byDegree.begin(), byDegree.end(), 0);
+    std::stable_sort(byDegree.begin(), byDegree.end(),
+        [&](Index a, Index b) { return degree(a) < degree(b); });
+
+    sofa::type::vector<bool> visited(nbVertices, false);
+
+    // Breadth-first search inside the unvisited part of the graph, returns
+    // the depth and a vertex of lowest degree in the last level
+    VecIndex level(nbVertices, 0), queue;
+    VecIndex stamp(nbVertices, 0);
+    Index currentStamp = 0;
+    auto bfsDepth = [&](Index root, Index &farthest) -> Index {
+        currentStamp++;
+        queue.clear();
+        queue.push_back(root);
+        stamp[root] = currentStamp;
+        level[root] = 0;
+        Index depth = 0;
+        farthest = root;
+        for (std::size_t head=0; head<queue.size(); head++) {
+            Index u = queue[head];
+            if (level[u] > depth || (level[u] == depth && degree(u) < degree(farthest))) {
+                depth = level[u];
+                farthest = u;
+            }
+            for (Index k=offsets[u]; k<offsets[u+1]; k++) {
+                Index v = neighbours[k];
+                if (!visited[v] && stamp[v] != currentStamp) {
+                    stamp[v] = currentStamp;
+                    level[v] = level[u] + 1;
+                    queue.push_back(v);
+                }
+            }
+        }
+        return depth;
+    };
+
+    VecIndex candidates;
+    for (Index start : byDegree) {
+        if (visited[start])
+            continue;
+
+        // Pseudo-peripheral vertex of this component
+        Index root = start, farthest;
+        Index depth = bfsDepth(root, farthest);
+        for (int iter=0; iter<8; iter++) {
+            Index next;
+            Index nextDepth = bfsDepth(farthest, next);
+            if (nextDepth <= depth)
+                break;
+            root = farthest;
+            depth = nextDepth;
+            farthest = next;
+        }
+
+        // Cuthill-McKee: visit neighbours by increasing degree
+        std::size_t head = perm.size();
+        visited[root] = true;
+        perm.push_back(root);
+        while (head < perm.size()) {
+            Index u = perm[head++];
+            candidates.clear();
+            for (Index k=offsets[u]; k<offsets[u+1]; k++) {
+                Index v = neighbours[k];
+                if (!visited[v]) {
+                    visited[v] = true;
+                    candidates.push_back(v);
+                }
+            }
+            std::stable_sort(candidates.begin(), candidates.end(),
+                [&](Index a, Index b) { return degree(a) < degree(b); });
+            perm.insert(perm.end(), candidates.begin(), candidates.end());
+        }
+    }
+
+    // Reverse
+    std::reverse(perm.begin(), perm.end());
+    return perm;
+}
+
+} // namespace
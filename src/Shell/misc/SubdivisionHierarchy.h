@@ -0,0 +1,179 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/core/topology/BaseMeshTopology.h>
+#include <sofa/type/vector.h>
+#include <Shell/config.h>
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+namespace shell::misc
+{
+
+/**
+ * @brief Nested triangle meshes obtained by repeated 1-to-4 subdivision of a
+ * coarse mesh, with the prolongation operators between consecutive levels.
+ *
+ * Level 0 is the coarse mesh. The vertices of level l are the vertices of
+ * level l-1, in the same order, followed by one new vertex per edge of level
+ * l-1 placed at its middle. Each triangle (a,b,c) is split into (a,ab,ac),
+ * (ab,b,bc), (ac,bc,c) and (bc,ac,ab).
+ *
+ * The prolongation P from level l-1 to level l copies the old vertices and
+ * averages the two ends of the edge for the new ones, so that each fine
+ * vertex has at most two parents.
+ */
+class SubdivisionHierarchy
+{
+public:
+    typedef sofa::core::topology::BaseMeshTopology::Triangle Triangle;
+    typedef sofa::core::topology::BaseMeshTopology::Edge Edge;
+    typedef sofa::core::topology::BaseMeshTopology::SeqTriangles SeqTriangles;
+
+    struct Level
+    {
+        sofa::Size nbVertices = 0;
+        SeqTriangles triangles;
+        /// Parents of the vertices added at this level, i.e. vertex
+        /// nbCoarseVertices+k is the middle of midpoints[k]
+        sofa::type::vector<Edge> midpoints;
+    };
+
+    void clear() { m_levels.clear(); }
+
+    /**
+     * @brief Build the hierarchy from a coarse mesh.
+     *
+     * @param nbVertices  Number of vertices of the coarse mesh.
+     * @param triangles   Triangles of the coarse mesh.
+     * @param nbLevels    Number of subdivisions, the hierarchy then has
+     *                    nbLevels+1 levels.
+     */
+    void build(sofa::Size nbVertices, const SeqTriangles &triangles, unsigned int nbLevels)
+    {
+        m_levels.clear();
+        m_levels.resize(nbLevels+1);
+        m_levels[0].nbVertices = nbVertices;
+        m_levels[0].triangles = triangles;
+
+        for (unsigned int l=1; l<=nbLevels; l++)
+            subdivide(m_levels[l-1], m_levels[l]);
+    }
+
+    std::size_t getNbLevels() const { return m_levels.size(); }
+    const Level& getLevel(std::size_t l) const { return m_levels[l]; }
+    const Level& getFinestLevel() const { return m_levels.back(); }
+
+    /**
+     * @brief Call f(coarse, weight) for each parent of a vertex of level l
+     * in level l-1.
+     */
+    template<class F>
+    void forEachParent(std::size_t l, sofa::Index fine, const F &f) const
+    {
+        const sofa::Size nbCoarse = m_levels[l-1].nbVertices;
+        if (fine < nbCoarse) {
+            f(fine, 1.0);
+        } else {
+            const Edge &e = m_levels[l].midpoints[fine-nbCoarse];
+            f(e[0], 0.5);
+            f(e[1], 0.5);
+        }
+    }
+
+    /**
+     * @brief fine = P coarse, from level l-1 to level l. T needs + and
+     * multiplication by a scalar, e.g. Vec3 or the Deriv of rigid nodes.
+     */
+    template<class T>
+    void prolongate(std::size_t l, const sofa::type::vector<T> &coarse, sofa::type::vector<T> &fine) const
+    {
+        const Level &level = m_levels[l];
+        const sofa::Size nbCoarse = m_levels[l-1].nbVertices;
+
+        fine.resize(level.nbVertices);
+        std::copy(coarse.begin(), coarse.begin()+nbCoarse, fine.begin());
+        for (std::size_t k=0; k<level.midpoints.size(); k++)
+            fine[nbCoarse+k] = (coarse[level.midpoints[k][0]] + coarse[level.midpoints[k][1]]) * 0.5;
+    }
+
+    /**
+     * @brief coarse = P^T fine, from level l to level l-1.
+     */
+    template<class T>
+    void restrict(std::size_t l, const sofa::type::vector<T> &fine, sofa::type::vector<T> &coarse) const
+    {
+        const Level &level = m_levels[l];
+        const sofa::Size nbCoarse = m_levels[l-1].nbVertices;
+
+        coarse.resize(nbCoarse);
+        std::copy(fine.begin(), fine.begin()+nbCoarse, coarse.begin());
+        for (std::size_t k=0; k<level.midpoints.size(); k++) {
+            const T half = fine[nbCoarse+k] * 0.5;
+            coarse[level.midpoints[k][0]] += half;
+            coarse[level.midpoints[k][1]] += half;
+        }
+    }
+
+private:
+    sofa::type::vector<Level> m_levels;
+
+    static void subdivide(const Level &coarse, Level &fine)
+    {
+        // Index of the midpoint of each edge, shared by the two triangles
+        // around it
+        std::map<std::pair<sofa::Index,sofa::Index>, sofa::Index> edgeMidpoint;
+        fine.midpoints.clear();
+        fine.triangles.clear();
+        fine.triangles.reserve(4*coarse.triangles.size());
+
+        const auto midpoint = [&](sofa::Index a, sofa::Index b) {
+            const std::pair<sofa::Index,sofa::Index> key(std::min(a,b), std::max(a,b));
+            auto it = edgeMidpoint.find(key);
+            if (it != edgeMidpoint.end())
+                return it->second;
+
+            const sofa::Index index = coarse.nbVertices + (sofa::Index)fine.midpoints.size();
+            fine.midpoints.push_back(Edge(key.first, key.second));
+            edgeMidpoint.emplace(key, index);
+            return index;
+        };
+
+        for (const Triangle &t : coarse.triangles) {
+            const sofa::Index ab = midpoint(t[0], t[1]);
+            const sofa::Index ac = midpoint(t[0], t[2]);
+            const sofa::Index bc = midpoint(t[1], t[2]);
+
+            fine.triangles.push_back(Triangle(t[0], ab, ac));
+            fine.triangles.push_back(Triangle(ab, t[1], bc));
+            fine.triangles.push_back(Triangle(ac, bc, t[2]));
+            fine.triangles.push_back(Triangle(bc, ac, ab));
+        }
+
+        fine.nbVertices = coarse.nbVertices + (sofa::Size)fine.midpoints.size();
+    }
+};
+
+} // namespace
@@ -56,7 +56,31 @@ class SurfaceParametrization
 
         enum { InvalidID = sofa::core::topology::Topology::InvalidID };
 
-        SurfaceParametrization() : m_topology(NULL), m_storedId(InvalidID) {}
+        SurfaceParametrization() : m_topology(NULL), m_splitCharts(false), m_nbCharts(0), m_storedId(InvalidID) {}
+
+        /**
+         * @brief Parametrize each connected part of the surface as a separate
+         * chart.
+         *
+         * By default the surface is unfolded from triangle 0 and only the
+         * part connected to it is parametrized. With charts enabled every
+         * connected part gets its own chart, the charts are unfolded in
+         * parallel and placed next to each other in the parameter space.
+         * Must be set before init().
+         */
+        void setSplitCharts(bool split) { m_splitCharts = split; }
+
+        /**
+         * @brief Number of charts found by init().
+         */
+        unsigned int getNbCharts() const { return m_nbCharts; }
+
+        /**
+         * @brief Chart the triangle belongs to (as of init()).
+         *
+         * @param tId   Triangle ID.
+         */
+        Index getChart(Index tId) const { return m_triChart[tId]; }
 
         /**
          * @brief Initialize parametrization.
@@ -250,14 +274,31 @@ class SurfaceParametrization
         /// Metric tensors (first fundamental form).
         VecMat22 m_metrics;
 
-        // Data for initialization.
-        type::vector<bool> ptDone, triDone, triBoundary;
+        // Data for initialization. Stored as char (not bool) so that
+        // different charts can be processed concurrently.
+        type::vector<char> ptDone, triDone, triBoundary;
+
+        // Flat adjacency used during initialization. Triangles around vertex
+        // v are m_vtxTris[m_vtxTriOffsets[v] .. m_vtxTriOffsets[v+1]-1].
+        VecIndex m_vtxTriOffsets, m_vtxTris;
+        type::vector< sofa::type::fixed_array<Index,2> > m_edgeTris;
+        type::vector< EdgesInTriangle > m_triEdges;
+
+        /// Parametrize connected parts separately.
+        bool m_splitCharts;
+        /// Chart of each triangle.
+        VecIndex m_triChart;
+        unsigned int m_nbCharts;
 
         Index   m_storedId;
         Vec2    m_storedPos;
         //Mat22 m_storedMetric;
 
         virtual void initMetricTensors();
+        void buildAdjacency(unsigned int nbPoints);
+        void findCharts(type::vector<VecIndex> &charts);
+        void unfoldChart(Index seed, const VecVec3 &x);
+        void layoutCharts();
         void projectPoint(const Index pId, Vec2 &pt, const VecVec3 &x) const;
         void computeFrame(Mat33 &frame, const Triangle &t, const VecVec3 &x) const;
         ElementState getEdgeState(Index edgeId) const;
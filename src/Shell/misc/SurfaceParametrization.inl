@@ -8,8 +8,13 @@
 #include <SofaShells/misc/SurfaceParametrization.h>
 #include <SofaShells/misc//PointProjection.h>
 
+#include <Shell/misc/ParallelFor.h>
+
 #include <sofa/helper/rmath.h>
 
+#include <deque>
+#include <limits>
+
 namespace sofa
 {
 
@@ -21,6 +26,7 @@ void SurfaceParametrization<Real>::init(
     m_topology = topology;
     m_points.resize(x.size());
     m_metrics.resize(x.size());
+    m_nbCharts = 0;
 
 #if 0
     for (unsigned int i = 0; i < x.size(); i++) {
@@ -30,51 +36,214 @@ void SurfaceParametrization<Real>::init(
 
     if (m_topology == NULL) return;
 
-    ptDone.resize(x.size(), false);
-    triDone.resize(m_topology->getNbTriangles(), false);
-    triBoundary.resize(m_topology->getNbTriangles(), false);
-    type::vector<Index> boundary;
+    const unsigned int nbTriangles = m_topology->getNbTriangles();
+
+    ptDone.assign(x.size(), false);
+    triDone.assign(nbTriangles, false);
+    triBoundary.assign(nbTriangles, false);
+
+    if (nbTriangles > 0) {
+        buildAdjacency(x.size());
+
+        // Starting triangles of each chart
+        type::vector<VecIndex> charts;
+        if (m_splitCharts) {
+            findCharts(charts);
+        } else {
+            // Let's start with triangle number 0.
+            charts.resize(1);
+            charts[0].push_back(0);
+            m_triChart.assign(nbTriangles, 0);
+        }
+        m_nbCharts = charts.size();
+
+        // Charts share no points nor triangles and can be unfolded
+        // independently
+        shell::misc::parallelForRange(m_splitCharts, size_t(0), charts.size(),
+            [&](size_t begin, size_t end) {
+                for (size_t c = begin; c < end; c++) {
+                    for (Index seed : charts[c]) {
+                        if (!triDone[seed]) unfoldChart(seed, x);
+                    }
+                }
+            });
+
+        if (m_nbCharts > 1) {
+            layoutCharts();
+        }
+
+        // Free the memory
+        m_vtxTriOffsets.clear(); m_vtxTris.clear();
+        m_edgeTris.clear(); m_triEdges.clear();
+    }
+#endif
+
+    initMetricTensors();
+}
+
+template <class Real>
+void SurfaceParametrization<Real>::buildAdjacency(unsigned int nbPoints)
+{
+    const SeqTriangles &triangles = m_topology->getTriangles();
+    const unsigned int nbTriangles = triangles.size();
+
+    // Triangles around vertices
+    m_vtxTriOffsets.assign(nbPoints+1, 0);
+    for (unsigned int t = 0; t < nbTriangles; t++) {
+        for (int i = 0; i < 3; i++) {
+            m_vtxTriOffsets[ triangles[t][i]+1 ]++;
+        }
+    }
+    for (unsigned int i = 0; i < nbPoints; i++) {
+        m_vtxTriOffsets[i+1] += m_vtxTriOffsets[i];
+    }
+    m_vtxTris.resize(m_vtxTriOffsets[nbPoints]);
+    VecIndex next(m_vtxTriOffsets.begin(), m_vtxTriOffsets.end()-1);
+    for (unsigned int t = 0; t < nbTriangles; t++) {
+        for (int i = 0; i < 3; i++) {
+            m_vtxTris[ next[triangles[t][i]]++ ] = t;
+        }
+    }
+
+    // Edges in triangles and (at most two) triangles around edges
+    m_triEdges.resize(nbTriangles);
+    m_edgeTris.resize(m_topology->getNbEdges());
+    for (unsigned int e = 0; e < m_edgeTris.size(); e++) {
+        m_edgeTris[e][0] = m_edgeTris[e][1] = InvalidID;
+    }
+    for (unsigned int t = 0; t < nbTriangles; t++) {
+        m_triEdges[t] = m_topology->getEdgesInTriangle(t);
+        for (int i = 0; i < 3; i++) {
+            sofa::type::fixed_array<Index,2> &tpair = m_edgeTris[ m_triEdges[t][i] ];
+            if (tpair[0] == InvalidID) {
+                tpair[0] = t;
+            } else if (tpair[1] == InvalidID) {
+                tpair[1] = t;
+            }
+        }
+    }
+}
+
+template <class Real>
+void SurfaceParametrization<Real>::findCharts(type::vector<VecIndex> &charts)
+{
+    const SeqTriangles &triangles = m_topology->getTriangles();
+    const unsigned int nbTriangles = m_triEdges.size();
+
+    // Connected components over the vertices. Parts connected only through
+    // a vertex (bow-tie) are kept in the same chart, each one starting from
+    // a triangle touching a point of the previous ones, so that no point is
+    // shared between two charts.
+    m_triChart.assign(nbTriangles, InvalidID);
+    type::vector<char> flooded(nbTriangles, false);
+    charts.clear();
+
+    std::deque<Index> seedQueue, queue;
+    for (unsigned int t = 0; t < nbTriangles; t++) {
+        if (m_triChart[t] != InvalidID) continue;
+
+        const Index chart = charts.size();
+        charts.push_back(VecIndex());
+        m_triChart[t] = chart;
+        seedQueue.push_back(t);
+
+        while (!seedQueue.empty()) {
+            const Index seed = seedQueue.front();
+            seedQueue.pop_front();
+            if (flooded[seed]) continue;
+
+            // Part connected over the edges
+            charts[chart].push_back(seed);
+            flooded[seed] = true;
+            queue.push_back(seed);
+
+            while (!queue.empty()) {
+                Index tId = queue.front();
+                queue.pop_front();
+                m_triChart[tId] = chart;
+
+                for (int i = 0; i < 3; i++) {
+                    const sofa::type::fixed_array<Index,2> &tpair = m_edgeTris[ m_triEdges[tId][i] ];
+                    for (int j = 0; j < 2; j++) {
+                        if (tpair[j] != InvalidID && !flooded[tpair[j]]) {
+                            flooded[tpair[j]] = true;
+                            queue.push_back(tpair[j]);
+                        }
+                    }
+                }
+
+                // Other parts touching this triangle at a vertex
+                for (int i = 0; i < 3; i++) {
+                    const Index p = triangles[tId][i];
+                    for (Index n = m_vtxTriOffsets[p]; n < m_vtxTriOffsets[p+1]; n++) {
+                        const Index tn = m_vtxTris[n];
+                        if (m_triChart[tn] == InvalidID) {
+                            m_triChart[tn] = chart;
+                            seedQueue.push_back(tn);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <class Real>
+void SurfaceParametrization<Real>::unfoldChart(Index tId, const VecVec3 &x)
+{
+    std::deque<Index> boundary;
     Mat33 R;
     Triangle t;
 
-    // Pick first triangle arbitrarily and unfold it.
-    // Let's start with triangle number 0.
-    Index tId = 0;
+    // Unfold the first triangle.
     t = m_topology->getTriangle(tId);
     computeFrame(R, t, x);
     //std::cout << "first: " << t << "\n";
 
+    // When continuing a chart through a shared vertex, keep the points
+    // already placed and attach the new part at the first of them
+    Vec2 offset(0,0);
     for (int i = 0; i < 3; i++) {
+        if (ptDone[t[i]]) {
+            Vec2 p;
+            p = R * x[t[i]];
+            offset = m_points[t[i]] - p;
+            break;
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        if (ptDone[t[i]]) continue;
         m_points[t[i]] = R * x[t[i]];
+        m_points[t[i]] += offset;
         //std::cout << "point[" << t[i] << "] = " << m_points[t[i]] << "\n";
         ptDone[t[i]] = true;
     }
     triDone[tId] = true;
     // Mark boundary triangles (those that already have two points fixed)
-    const EdgesInTriangle &elist = m_topology->getEdgesInTriangle(tId);
+    const EdgesInTriangle &elist = m_triEdges[tId];
     for (unsigned int i = 0; i < elist.size(); i++) {
         boundary.push_back(elist[i]); // Add edges into the queue.
-        const TrianglesAroundEdge &tpair = m_topology->getTrianglesAroundEdge(elist[i]);
+        const sofa::type::fixed_array<Index,2> &tpair = m_edgeTris[elist[i]];
         for (unsigned int j = 0; j < tpair.size(); j++) {
-            triBoundary[tpair[j]] = true;
+            if (tpair[j] != InvalidID) triBoundary[tpair[j]] = true;
         }
     }
     triBoundary[tId] = false;
 
     // Go through the topology
-    while (boundary.size() > 0) {
+    while (!boundary.empty()) {
     //std::cout << "b: " << boundary << "\n";
     //std::cout << "t: " << triBoundary << "\n";
     //std::cout << "p: " << ptDone << "\n";
 
-        Index eId = boundary[0];
-        boundary.erase(boundary.begin());
+        Index eId = boundary.front();
+        boundary.pop_front();
 
-        const TrianglesAroundEdge &tpair = m_topology->getTrianglesAroundEdge(eId);
+        const sofa::type::fixed_array<Index,2> &tpair = m_edgeTris[eId];
         // At most one triangle should be free.
-        if (tpair.size() > 0 && !triDone[tpair[0]]) {
+        if (tpair[0] != InvalidID && !triDone[tpair[0]]) {
             tId = tpair[0];
-        } else if (tpair.size() > 1 && !triDone[tpair[1]]) {
+        } else if (tpair[1] != InvalidID && !triDone[tpair[1]]) {
             tId = tpair[1];
         } else {
             continue;
@@ -96,16 +265,15 @@ void SurfaceParametrization<Real>::init(
         ptDone[pId] = true;
 
         // Update boundary info.
-        const TrianglesAroundVertex &N1 = m_topology->getTrianglesAroundVertex(pId);
-        for (unsigned int i = 0; i < N1.size(); i++) {
-            tId = N1[i];
+        for (Index n = m_vtxTriOffsets[pId]; n < m_vtxTriOffsets[pId+1]; n++) {
+            tId = m_vtxTris[n];
             // Check triangle state.
-            ElementState triState = getTriangleState(tId); 
+            ElementState triState = getTriangleState(tId);
             triBoundary[tId] = (triState == BOUNDARY);
             triDone[tId] = (triState == FIXED);
             if (!triDone[tId]) {
                 // Check edge state.
-                EdgesInTriangle elist = m_topology->getEdgesInTriangle(tId);
+                const EdgesInTriangle &elist = m_triEdges[tId];
                 for (int i = 0; i < 3; i++) {
                     if (getEdgeState(elist[i]) == FIXED) {
                         boundary.push_back(elist[i]);
@@ -115,9 +283,47 @@ void SurfaceParametrization<Real>::init(
         }
 
     }
-#endif
+}
 
-    initMetricTensors();
+template <class Real>
+void SurfaceParametrization<Real>::layoutCharts()
+{
+    const SeqTriangles &triangles = m_topology->getTriangles();
+    const Real inf = std::numeric_limits<Real>::max();
+
+    // Bounding box of each chart
+    VecVec2 bbMin(m_nbCharts, Vec2(inf, inf));
+    VecVec2 bbMax(m_nbCharts, Vec2(-inf, -inf));
+    for (unsigned int t = 0; t < triangles.size(); t++) {
+        const Index c = m_triChart[t];
+        for (int i = 0; i < 3; i++) {
+            const Vec2 &p = m_points[ triangles[t][i] ];
+            for (int k = 0; k < 2; k++) {
+                if (p[k] < bbMin[c][k]) bbMin[c][k] = p[k];
+                if (p[k] > bbMax[c][k]) bbMax[c][k] = p[k];
+            }
+        }
+    }
+
+    // Place the charts in a row along the x axis
+    VecVec2 shift(m_nbCharts);
+    Real xpos = 0;
+    for (unsigned int c = 0; c < m_nbCharts; c++) {
+        const Real width = bbMax[c][0] - bbMin[c][0];
+        shift[c] = Vec2(xpos - bbMin[c][0], -bbMin[c][1]);
+        xpos += width + width/10; // Leave a gap between the charts
+    }
+
+    // Points belong to exactly one chart (see findCharts)
+    type::vector<char> moved(m_points.size(), false);
+    for (unsigned int t = 0; t < triangles.size(); t++) {
+        for (int i = 0; i < 3; i++) {
+            const Index p = triangles[t][i];
+            if (moved[p]) continue;
+            m_points[p] += shift[ m_triChart[t] ];
+            moved[p] = true;
+        }
+    }
 }
 
 template <class Real>
@@ -133,13 +339,12 @@ void SurfaceParametrization<Real>::projectPoint(const Index pId, Vec2 &outPos, c
 {
     if (m_topology == NULL) return;
 
-    const TrianglesAroundVertex &N1 = m_topology->getTrianglesAroundVertex(pId);
     int nTriangles = 0;
     outPos = Vec2(0,0);
-    for (unsigned int i = 0; i < N1.size(); i++) {
-        if (!triBoundary[N1[i]]) continue;
+    for (Index n = m_vtxTriOffsets[pId]; n < m_vtxTriOffsets[pId+1]; n++) {
+        Index tId = m_vtxTris[n];
+        if (!triBoundary[tId]) continue;
 
-        Index tId = N1[i];
         const Triangle &t = m_topology->getTriangle(tId);
         //std::cout << "t=" << t << "\n";
         Mat33 R;
@@ -0,0 +1,229 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/linearalgebra/BaseMatrix.h>
+#include <sofa/type/Mat.h>
+#include <sofa/type/Vec.h>
+#include <Shell/config.h>
+
+#include <cmath>
+
+namespace shell::misc
+{
+
+/**
+ * @brief Symmetric N x N matrix storing only its upper triangle.
+ *
+ * Element stiffness matrices are symmetric by construction, packing them
+ * needs N(N+1)/2 instead of N*N values (45 instead of 81 for 9x9).
+ */
+template<sofa::Size N, class Real>
+class SymmetricMatrix
+{
+public:
+    static constexpr sofa::Size NbEntries = N*(N+1)/2;
+
+    SymmetricMatrix() { clear(); }
+
+    /// Pack a full matrix. It is symmetrised, which only removes round-off.
+    template<class R2>
+    explicit SymmetricMatrix(const sofa::type::Mat<N,N,R2> &m) { set(m); }
+
+    /// Convert from another precision.
+    template<class R2>
+    explicit SymmetricMatrix(const SymmetricMatrix<N,R2> &m)
+    {
+        for (sofa::Size k=0; k<NbEntries; k++)
+            m_data[k] = (Real)m.data()[k];
+    }
+
+    void clear()
+    {
+        for (sofa::Size k=0; k<NbEntries; k++)
+            m_data[k] = 0;
+    }
+
+    template<class R2>
+    void set(const sofa::type::Mat<N,N,R2> &m)
+    {
+        for (sofa::Size i=0; i<N; i++)
+            for (sofa::Size j=i; j<N; j++)
+                m_data[index(i,j)] = (Real)((m[i][j] + m[j][i])/2);
+    }
+
+    Real operator()(sofa::Size i, sofa::Size j) const
+    {
+        return (i <= j) ? m_data[index(i,j)] : m_data[index(j,i)];
+    }
+
+    /// Unpack into a full matrix.
+    sofa::type::Mat<N,N,Real> toMat() const
+    {
+        sofa::type::Mat<N,N,Real> m;
+        for (sofa::Size i=0; i<N; i++) {
+            m[i][i] = m_data[index(i,i)];
+            for (sofa::Size j=i+1; j<N; j++)
+                m[i][j] = m[j][i] = m_data[index(i,j)];
+        }
+        return m;
+    }
+
+    /**
+     * @brief Symmetric matrix-vector product.
+     *
+     * Every stored value is read once and used for both of its positions.
+     * The product is evaluated in the precision of the matrix, only the
+     * result is converted to the precision of the vector.
+     */
+    template<class VReal>
+    sofa::type::Vec<N,VReal> operator*(const sofa::type::Vec<N,VReal> &v) const
+    {
+        Real vr[N], r[N];
+        for (sofa::Size i=0; i<N; i++) {
+            vr[i] = (Real)v[i];
+            r[i] = 0;
+        }
+
+        const Real *row = m_data;
+        for (sofa::Size i=0; i<N; i++) {
+            Real s = row[0] * vr[i];
+            for (sofa::Size j=i+1; j<N; j++) {
+                s += row[j-i] * vr[j];
+                r[j] += row[j-i] * vr[i];
+            }
+            r[i] += s;
+            row += N-i;
+        }
+
+        sofa::type::Vec<N,VReal> result;
+        for (sofa::Size i=0; i<N; i++)
+            result[i] = (VReal)r[i];
+        return result;
+    }
+
+    /// Frobenius norm, the off-diagonal values count twice.
+    Real norm() const
+    {
+        Real s = 0;
+        const Real *row = m_data;
+        for (sofa::Size i=0; i<N; i++) {
+            s += row[0] * row[0];
+            for (sofa::Size j=1; j<N-i; j++)
+                s += 2 * row[j] * row[j];
+            row += N-i;
+        }
+        return std::sqrt(s);
+    }
+
+    const Real* data() const { return m_data; }
+
+private:
+    /// Position of (i,j), i <= j, in the packed rows.
+    static constexpr sofa::Size index(sofa::Size i, sofa::Size j)
+    {
+        return i*(2*N - i + 1)/2 + (j - i);
+    }
+
+    Real m_data[NbEntries];
+};
+
+/**
+ * @brief Rotate the symmetric 18x18 stiffness matrix of a triangle with three
+ * rigid nodes into the global frame, i.e. K_gs = Rt18 * K * R18 with R18 the
+ * block diagonal extension of R.
+ *
+ * The product is done by 3x3 blocks, only those on and above the diagonal
+ * are computed and the others are mirrored.
+ */
+template<class Real>
+void rotateSymmetric18(sofa::type::Mat<18,18,Real> &K_gs, const sofa::type::Mat<18,18,Real> &K,
+    const sofa::type::Mat<3,3,Real> &R, const sofa::type::Mat<3,3,Real> &Rt)
+{
+    for (sofa::Size bi=0; bi<6; bi++) {
+        for (sofa::Size bj=bi; bj<6; bj++) {
+            sofa::type::Mat<3,3,Real> B;
+            for (sofa::Size i=0; i<3; i++)
+                for (sofa::Size j=0; j<3; j++)
+                    B[i][j] = K[3*bi+i][3*bj+j];
+
+            const sofa::type::Mat<3,3,Real> G = Rt * B * R;
+            for (sofa::Size i=0; i<3; i++) {
+                for (sofa::Size j=0; j<3; j++) {
+                    K_gs[3*bi+i][3*bj+j] = G[i][j];
+                    K_gs[3*bj+j][3*bi+i] = G[i][j];
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Add factor*K for a triangle with three rigid nodes into a global
+ * matrix. K is symmetric, each off-diagonal value is computed once and
+ * added at both of its positions.
+ *
+ * @param matrix  Global matrix.
+ * @param offset  Offset of the mechanical state in the global matrix.
+ * @param t       Node indices of the triangle.
+ * @param K       18x18 element matrix in the global frame.
+ * @param factor  Scale factor, e.g. -kFactor.
+ */
+template<class Real, class Triangle>
+void addSymmetricElementMatrix(sofa::linearalgebra::BaseMatrix *matrix, sofa::Index offset,
+    const Triangle &t, const sofa::type::Mat<18,18,Real> &K, const Real factor)
+{
+    for (sofa::Size row=0; row<18; row++) {
+        const sofa::Index ROW = offset + 6*t[row/6] + row%6;
+        matrix->add(ROW, ROW, factor * K[row][row]);
+
+        for (sofa::Size column=row+1; column<18; column++) {
+            const sofa::Index COLUMN = offset + 6*t[column/6] + column%6;
+            const Real value = factor * K[row][column];
+            matrix->add(ROW, COLUMN, value);
+            matrix->add(COLUMN, ROW, value);
+        }
+    }
+}
+
+/**
+ * @brief Same as above for an element matrix stored packed.
+ */
+template<class Real, class Triangle>
+void addSymmetricElementMatrix(sofa::linearalgebra::BaseMatrix *matrix, sofa::Index offset,
+    const Triangle &t, const SymmetricMatrix<18,Real> &K, const Real factor)
+{
+    const Real *k = K.data();
+    for (sofa::Size row=0; row<18; row++) {
+        const sofa::Index ROW = offset + 6*t[row/6] + row%6;
+        matrix->add(ROW, ROW, factor * (*k++));
+
+        for (sofa::Size column=row+1; column<18; column++) {
+            const sofa::Index COLUMN = offset + 6*t[column/6] + column%6;
+            const Real value = factor * (*k++);
+            matrix->add(ROW, COLUMN, value);
+            matrix->add(COLUMN, ROW, value);
+        }
+    }
+}
+
+} // namespace
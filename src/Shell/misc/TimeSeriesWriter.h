@@ -0,0 +1,98 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/type/vector.h>
+#include <Shell/config.h>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace shell::misc
+{
+
+/**
+ * @brief Records a scalar field over time into a binary file.
+ *
+ * The file starts with the 4 bytes "SHTS" and a uint32 version (1). Each
+ * frame then consists of the time as float64, the number of values as uint32
+ * and the values as float32. Native byte order is used.
+ */
+class TimeSeriesWriter
+{
+public:
+    TimeSeriesWriter() {}
+    ~TimeSeriesWriter() { close(); }
+
+    /// Create (or truncate) the file and write the header.
+    bool open(const std::string &filename)
+    {
+        close();
+
+        m_file.open(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!m_file.is_open())
+            return false;
+
+        const std::uint32_t version = 1;
+        m_file.write("SHTS", 4);
+        m_file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        m_filename = filename;
+        return m_file.good();
+    }
+
+    void close()
+    {
+        if (m_file.is_open())
+            m_file.close();
+        m_filename.clear();
+    }
+
+    bool isOpen() const { return m_file.is_open(); }
+
+    /// Name of the open file, empty if none.
+    const std::string& getFilename() const { return m_filename; }
+
+    /// Append one frame.
+    template<class Real>
+    void write(double time, const sofa::type::vector<Real> &values)
+    {
+        if (!m_file.is_open())
+            return;
+
+        const std::uint32_t count = (std::uint32_t)values.size();
+        m_file.write(reinterpret_cast<const char*>(&time), sizeof(time));
+        m_file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+        m_buffer.resize(values.size());
+        for (size_t i=0; i<values.size(); i++)
+            m_buffer[i] = (float)values[i];
+        m_file.write(reinterpret_cast<const char*>(m_buffer.data()), count*sizeof(float));
+    }
+
+private:
+    std::ofstream m_file;
+    std::string m_filename;
+    sofa::type::vector<float> m_buffer;
+};
+
+} // namespace
@@ -9,6 +9,7 @@
 #define SOFA_COMPONENT_FEM_BEZIERSHELLINTERPOLATION_H
 
 #include <Shell/config.h>
+#include <Shell/misc/DrawBuffer.h>
 #include <sofa/core/behavior/MechanicalState.h>
 #include <sofa/component/statecontainer/MechanicalObject.h>
 #include <sofa/component/mapping/linear/Mesh2PointTopologicalMapping.h>
@@ -61,6 +62,7 @@ class BezierShellInterpolation : public virtual sofa::core::objectmodel::BaseObj
         typedef sofa::type::Vec<3, Real> Vec3;
         typedef sofa::type::Mat<3,3,Real> Mat33;
         typedef type::vector<Vec3> VecVec3;
+        typedef type::vector<Mat33> VecMat33;
 
         // These vector is related to Bézier nodes
         typedef type::vector<sofa::type::Vec<3, double> > VecVec3d;
@@ -213,6 +215,13 @@ class BezierShellInterpolation : public virtual sofa::core::objectmodel::BaseObj
         // Interface
         //
 
+        /// Counter of the positions of the Bézier nodes, changes whenever
+        /// they are updated
+        int getBezierNodesCounter() const
+        {
+            return mStateNodes->read(sofa::core::vec_id::read_access::position)->getCounter();
+        }
+
         void getBezierNodes(ElementID elemID, sofa::type::fixed_array<Vec3,10>& bn)
         {
             const BTri& btri = getBezierTriangle(elemID);
@@ -222,6 +231,30 @@ class BezierShellInterpolation : public virtual sofa::core::objectmodel::BaseObj
             }
         }
 
+        /**
+         * @brief Compute the Bézier nodes of an element directly from the
+         * positions and rotations of the simulation nodes.
+         *
+         * @param x     Positions of the simulation nodes.
+         * @param R     Rotation matrices of the simulation nodes (see
+         *              getNodeRotations()).
+         */
+        void computeBezierNodes(ElementID elemID, const VecCoord& x, const VecMat33& R,
+            sofa::type::fixed_array<Vec3,10>& bn);
+
+        /**
+         * @brief Rotation matrices of the simulation nodes.
+         *
+         * The matrices are computed only when @dx changes (according to its
+         * counter) and are shared by all the components using this
+         * interpolation during the time step.
+         */
+        const VecMat33& getNodeRotations(const Data<VecCoord>& dx);
+
+        const VecMat33& getNodeRotations() {
+            return getNodeRotations(*mState->read(sofa::core::vec_id::read_access::position));
+        }
+
         void getDOFtoLocalTransform(sofa::core::topology::Triangle tri,
             Transform DOF0_H_local0, Transform DOF1_H_local1, Transform DOF2_H_local2);
 
@@ -285,10 +318,26 @@ class BezierShellInterpolation : public virtual sofa::core::objectmodel::BaseObj
         core::topology::TriangleData< sofa::type::vector<TriangleInformation> > triInfo;
         TriangleInfoHandler* triHandler;
 
+        // Cached rotation matrices of the simulation nodes and the vector
+        // (and its counter) they were computed from
+        VecMat33 nodeRotations;
+        const Data<VecCoord>* nodeRotationsSource;
+        int nodeRotationsCounter;
+
+        // Arrays for draw(): control mesh (rebuilt when triInfo changes),
+        // barycentric coordinates of the surface samples and the sampled
+        // surface (rebuilt when the nodes move)
+        typedef sofa::type::Vec<2,int> Vec2i;
+        std::vector< Vec2i > drawLines;
+        int drawLinesCounter;
+        VecVec3 drawSamples;
+        shell::misc::DrawBuffer drawSurface;
+
         // init process=> computes the position of the bezier point given the positions and the normals
         void computeBezierPointsUsingNormals(const Index& inputTri, VecVec3d& x, const VecVec3& normals);
         void updateBezierPoints();
         void updateBezierPoints(Index triIndex);
+        void updateBezierPoints(Index triIndex, const VecCoord& xSim, const VecMat33& R, VecVec3d& x);
 
         /////// projection of points
         //Data< VecVec3>  pointsToProject; // input : position of the points to project of the surface
@@ -154,6 +154,9 @@ BezierShellInterpolation<DataTypes>::BezierShellInterpolation()
     , inputNormals(initData(&inputNormals, "normals", "normal defined on the source topology"))
     , pointInfo(initData(&pointInfo, "pointInfo", "Internal point data"))
     , triInfo(initData(&triInfo, "triInfo", "Internal triangle data"))
+    , nodeRotationsSource(NULL)
+    , nodeRotationsCounter(-1)
+    , drawLinesCounter(-1)
 {
     this->f_listening.setValue(true);
     /*
@@ -470,63 +473,105 @@ void BezierShellInterpolation<DataTypes>::computeBezierPointsUsingNormals(const
 template <class DataTypes>
 void BezierShellInterpolation<DataTypes>::updateBezierPoints()
 {
+    // Nodes of the simulation
+    const Data<VecCoord>* dataxSim = mState->read(sofa::core::vec_id::read_access::position);
+    const VecCoord& xSim = dataxSim->getValue();
+    const VecMat33& R = getNodeRotations(*dataxSim);
+
+    Data<VecVec3d>* datax = mStateNodes->write(sofa::core::vec_id::write_access::position);
+    VecVec3d& x = *datax->beginEdit();
+
+    x.resize(dynamic_cast<topology::container::dynamic::PointSetTopologyContainer*>(bezierM2P->getTo())->getNumberOfElements());
+
     for (Index i=0; i<(Index)inputTopology->getNbTriangles(); i++)
     {
-        updateBezierPoints(i);
+        updateBezierPoints(i, xSim, R, x);
     }
+
+    datax->endEdit();
 }
 
 template <class DataTypes>
 void BezierShellInterpolation<DataTypes>::updateBezierPoints(Index triIndex)
 {
-
     // Nodes of the simulation
-    const VecCoord& xSim = mState->read(sofa::core::vec_id::read_access::position)->getValue();
+    const Data<VecCoord>* dataxSim = mState->read(sofa::core::vec_id::read_access::position);
 
     Data<VecVec3d>* datax = mStateNodes->write(sofa::core::vec_id::write_access::position);
     VecVec3d& x = *datax->beginEdit();
 
     x.resize(dynamic_cast<topology::container::dynamic::PointSetTopologyContainer*>(bezierM2P->getTo())->getNumberOfElements());
 
-    sofa::core::topology::Triangle tri = inputTopology->getTriangle(triIndex);
+    updateBezierPoints(triIndex, dataxSim->getValue(), getNodeRotations(*dataxSim), x);
+
+    datax->endEdit();
+}
+
+template <class DataTypes>
+void BezierShellInterpolation<DataTypes>::updateBezierPoints(Index triIndex,
+    const VecCoord& xSim, const VecMat33& R, VecVec3d& x)
+{
+    const BTri& bTri = getBezierTriangle(triIndex);
+
+    sofa::type::fixed_array<Vec3,10> bn;
+    computeBezierNodes(triIndex, xSim, R, bn);
+
+    for (int i=0; i<10; i++) {
+        x[ bTri[i] ] = bn[i];
+    }
+}
+
+template <class DataTypes>
+void BezierShellInterpolation<DataTypes>::computeBezierNodes(ElementID elemID,
+    const VecCoord& xSim, const VecMat33& R, sofa::type::fixed_array<Vec3,10>& bn)
+{
+    sofa::core::topology::Triangle tri = inputTopology->getTriangle(elemID);
     const Index a = tri[0];
     const Index b = tri[1];
     const Index c = tri[2];
 
-    const BTri& bTri = getBezierTriangle(triIndex);
-
-    // Combine global and optional local transformation for the DOFs  
+    const BTri& bTri = getBezierTriangle(elemID);
 
-    Transform global_H_DOF0(xSim[a].getCenter(), xSim[a].getOrientation());
-    Transform global_H_DOF1(xSim[b].getCenter(), xSim[b].getOrientation());
-    Transform global_H_DOF2(xSim[c].getCenter(), xSim[c].getOrientation());
+    // NOTE: The optional local transformation for the DOFs (see
+    // getDOFtoLocalTransform()) is not implemented, the DOF frames are used
+    // directly.
 
-    Transform DOF0_H_local0, DOF1_H_local1, DOF2_H_local2;
-    getDOFtoLocalTransform(tri, DOF0_H_local0, DOF1_H_local1, DOF2_H_local2);
+    bn[0] = xSim[a].getCenter();
+    bn[1] = xSim[b].getCenter();
+    bn[2] = xSim[c].getCenter();
 
-    Transform global_H_local0 = global_H_DOF0 * DOF0_H_local0;
-    Transform global_H_local1 = global_H_DOF1 * DOF1_H_local1;
-    Transform global_H_local2 = global_H_DOF2 * DOF2_H_local2;
+    bn[3] = bn[0] + R[a] * getSegment(bTri[3]);
+    bn[4] = bn[0] + R[a] * getSegment(bTri[4]);
+    bn[5] = bn[1] + R[b] * getSegment(bTri[5]);
+    bn[6] = bn[1] + R[b] * getSegment(bTri[6]);
+    bn[7] = bn[2] + R[c] * getSegment(bTri[7]);
+    bn[8] = bn[2] + R[c] * getSegment(bTri[8]);
 
-    // Update the positions
+    bn[9] = (
+        bn[3] + bn[4] - bn[0] +
+        bn[5] + bn[6] - bn[1] +
+        bn[7] + bn[8] - bn[2])/3;
+}
 
-    x[ bTri[0] ] = global_H_local0.getOrigin();
-    x[ bTri[1] ] = global_H_local1.getOrigin();
-    x[ bTri[2] ] = global_H_local2.getOrigin();
+template <class DataTypes>
+const typename BezierShellInterpolation<DataTypes>::VecMat33&
+BezierShellInterpolation<DataTypes>::getNodeRotations(const Data<VecCoord>& dx)
+{
+    // Still valid?
+    if ((&dx == nodeRotationsSource) && (dx.getCounter() == nodeRotationsCounter))
+        return nodeRotations;
 
-    x[ bTri[3] ] = global_H_local0.projectPoint( getSegment(bTri[3]) );
-    x[ bTri[4] ] = global_H_local0.projectPoint( getSegment(bTri[4]) );
-    x[ bTri[5] ] = global_H_local1.projectPoint( getSegment(bTri[5]) );
-    x[ bTri[6] ] = global_H_local1.projectPoint( getSegment(bTri[6]) );
-    x[ bTri[7] ] = global_H_local2.projectPoint( getSegment(bTri[7]) );
-    x[ bTri[8] ] = global_H_local2.projectPoint( getSegment(bTri[8]) );
+    const VecCoord& x = dx.getValue();
+    nodeRotations.resize(x.size());
+    for (Index i=0; i<(Index)x.size(); i++)
+    {
+        x[i].getOrientation().toMatrix(nodeRotations[i]);
+    }
 
-    x[ bTri[9] ] = (
-        x[ bTri[3] ] + x[ bTri[4] ] - x[ bTri[0] ] +
-        x[ bTri[5] ] + x[ bTri[6] ] - x[ bTri[1] ] +
-        x[ bTri[7] ] + x[ bTri[8] ] - x[ bTri[2] ])/3;
+    nodeRotationsSource = &dx;
+    nodeRotationsCounter = dx.getCounter();
 
-    datax->endEdit();
+    return nodeRotations;
 }
 
 template <class DataTypes>
@@ -686,63 +731,82 @@ void BezierShellInterpolation<DataTypes>::draw(const core::visual::VisualParams*
     if ((!vparams->displayFlags().getShowBehaviorModels()))
         return;
 
-    const VecVec3d& bn = mStateNodes->read(sofa::core::vec_id::read_access::position)->getValue();
+    const Data<VecVec3d>* datax = mStateNodes->read(sofa::core::vec_id::read_access::position);
+    const VecVec3d& bn = datax->getValue();
     vparams->drawTool()->drawPoints(bn, 2.0, type::RGBAColor(0.5, 1.0, 0.5, 1.0));
 
-    typedef sofa::type::Vec<2,int> Vec2i;
-    std::vector< Vec2i > lines;
+    const Index nbTriangles = inputTopology->getNbTriangles();
 
-    VecVec3d points;
+    // Control mesh, depends only on the topology
+    if ((drawLinesCounter != triInfo.getCounter()) || (drawLines.size() != 15*nbTriangles))
+    {
+        drawLines.clear();
+        drawLines.reserve(15*nbTriangles);
+        for (Index tri=0; tri<nbTriangles; tri++ )
+        {
+            //        1        //
+            //       / \       //
+            //      6---5      //
+            //     / \ / \     //
+            //    3---9---8    //
+            //   / \ / \ / \   //
+            //  0---4---7---2  //
+
+            const BTri& btri = getBezierTriangle(tri);
+            drawLines.push_back(Vec2i(btri[0], btri[3]));
+            drawLines.push_back(Vec2i(btri[0], btri[4]));
+            drawLines.push_back(Vec2i(btri[1], btri[5]));
+            drawLines.push_back(Vec2i(btri[1], btri[6]));
+            drawLines.push_back(Vec2i(btri[2], btri[7]));
+            drawLines.push_back(Vec2i(btri[2], btri[8]));
+
+            drawLines.push_back(Vec2i(btri[3], btri[6]));
+            drawLines.push_back(Vec2i(btri[4], btri[7]));
+            drawLines.push_back(Vec2i(btri[8], btri[5]));
+
+            drawLines.push_back(Vec2i(btri[6], btri[9]));
+            drawLines.push_back(Vec2i(btri[5], btri[9]));
+            drawLines.push_back(Vec2i(btri[4], btri[9]));
+            drawLines.push_back(Vec2i(btri[7], btri[9]));
+            drawLines.push_back(Vec2i(btri[3], btri[9]));
+            drawLines.push_back(Vec2i(btri[8], btri[9]));
+        }
+        drawLinesCounter = triInfo.getCounter();
+        drawSurface.invalidate();
+    }
 
-    for (int tri=0; tri<inputTopology->getNbTriangles(); tri++ )
+    // Sampling of the surface, the same for every triangle
+    if (drawSamples.empty())
     {
-        //        1        //
-        //       / \       //
-        //      6---5      //
-        //     / \ / \     //
-        //    3---9---8    //
-        //   / \ / \ / \   //
-        //  0---4---7---2  //
-
-        // Control mesh
-        const BTri& btri = getBezierTriangle(tri);
-        lines.push_back(Vec2i(btri[0], btri[3]));
-        lines.push_back(Vec2i(btri[0], btri[4]));
-        lines.push_back(Vec2i(btri[1], btri[5]));
-        lines.push_back(Vec2i(btri[1], btri[6]));
-        lines.push_back(Vec2i(btri[2], btri[7]));
-        lines.push_back(Vec2i(btri[2], btri[8]));
-
-        lines.push_back(Vec2i(btri[3], btri[6]));
-        lines.push_back(Vec2i(btri[4], btri[7]));
-        lines.push_back(Vec2i(btri[8], btri[5]));
-
-        lines.push_back(Vec2i(btri[6], btri[9]));
-        lines.push_back(Vec2i(btri[5], btri[9]));
-        lines.push_back(Vec2i(btri[4], btri[9]));
-        lines.push_back(Vec2i(btri[7], btri[9]));
-        lines.push_back(Vec2i(btri[3], btri[9]));
-        lines.push_back(Vec2i(btri[8], btri[9]));
-
-        // Surface
-        points.clear();
         for (double alpha=0.0; alpha<1.00001; alpha+=0.1)
         {
             for (double beta=0.0; beta<(1.0001-alpha); beta+=0.1)
             {
-                Vec3 baryCoord(1.0-alpha-beta, alpha, beta);
-                Vec3 posPoint;
-                this->interpolateOnBTriangle(tri, bn, baryCoord, posPoint);
-                points.push_back(posPoint);
-             }
-         }
-
-         vparams->drawTool()->drawPoints(points,1, type::RGBAColor(0,0,1,1));
+                drawSamples.push_back(Vec3(1.0-alpha-beta, alpha, beta));
+            }
+        }
+    }
 
-         // TODO: draw edges, normals?
+    // Surface, only re-evaluated when the nodes have moved
+    if (!drawSurface.isValid(datax->getCounter()))
+    {
+        drawSurface.points.resize(nbTriangles*drawSamples.size());
+        for (Index tri=0; tri<nbTriangles; tri++ )
+        {
+            for (size_t i=0; i<drawSamples.size(); i++)
+            {
+                Vec3 posPoint;
+                this->interpolateOnBTriangle(tri, bn, drawSamples[i], posPoint);
+                drawSurface.points[tri*drawSamples.size() + i] = type::Vec3(posPoint[0], posPoint[1], posPoint[2]);
+            }
+        }
+        drawSurface.validate(datax->getCounter());
     }
 
-    vparams->drawTool()->drawLines(bn, lines, 1, type::RGBAColor(0.5,1.0,0.5,1));
+    // TODO: draw edges, normals?
+    vparams->drawTool()->drawPoints(drawSurface.points, 1, type::RGBAColor(0,0,1,1));
+
+    vparams->drawTool()->drawLines(bn, drawLines, 1, type::RGBAColor(0.5,1.0,0.5,1));
 }
 
 
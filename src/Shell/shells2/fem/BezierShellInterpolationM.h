@@ -68,6 +68,7 @@ class BezierShellInterpolationM : public BezierShellInterpolation<TIn>
         typedef typename Inherit1::Vec3 Vec3;
         typedef typename Inherit1::Mat33 Mat33;
         typedef typename Inherit1::VecVec3 VecVec3;
+        typedef typename Inherit1::VecMat33 VecMat33;
 
         typedef typename Inherit1::VecVec3d VecVec3d;
 
@@ -87,7 +88,7 @@ class BezierShellInterpolationM : public BezierShellInterpolation<TIn>
 
     protected:
 
-        void applyJTCore(const InVecCoord &xSim, const VecVec3d &x,
+        void applyJTCore(const VecMat33 &R, const VecVec3d &x,
             const Index &triId, const ShapeFunctions &N, const OutCoord &force,
             Vec3 &f1, Vec3 &f2, Vec3 &f3, Vec3 &f1r, Vec3 &f2r, Vec3 &f3r);
 
@@ -182,7 +182,7 @@ void BezierShellInterpolationM<TIn,TOut>::applyJTOnBTriangle(
         return;
     }
 
-    const InVecCoord& xSim = this->mState->read(sofa::core::vec_id::read_access::position)->getValue();
+    const VecMat33& R = this->getNodeRotations();
     const VecVec3d& x = this->mStateNodes->read(sofa::core::vec_id::read_access::position)->getValue();
 
     // Compute nodes of the Bézier triangle for each input triangle
@@ -194,7 +194,7 @@ void BezierShellInterpolationM<TIn,TOut>::applyJTOnBTriangle(
         Vec3 f1, f2, f3;    // resulting linear forces on corner nodes 
         Vec3 f1r, f2r, f3r; // resulting torques
 
-        applyJTCore(xSim, x, projElements[i], projN[i], in[i],
+        applyJTCore(R, x, projElements[i], projN[i], in[i],
             f1, f2, f3, f1r, f2r, f3r);
 
         getVCenter(out[ tri[0] ]) += f1;
@@ -212,7 +212,7 @@ void BezierShellInterpolationM<TIn,TOut>::applyJTOnBTriangle(
     VecShapeFunctions projN, VecIndex projElements,
     const OutMatrixDeriv& in, InMatrixDeriv &out)
 {
-    const InVecCoord& xSim = this->mState->read(sofa::core::vec_id::read_access::position)->getValue();
+    const VecMat33& R = this->getNodeRotations();
     const VecVec3d& x = this->mStateNodes->read(sofa::core::vec_id::read_access::position)->getValue();
     typename Out::MatrixDeriv::RowConstIterator rowItEnd = in.end();
 
@@ -231,7 +231,7 @@ void BezierShellInterpolationM<TIn,TOut>::applyJTOnBTriangle(
                 Vec3 f1r, f2r, f3r; // resulting angular velocities
 
                 Index ptId = colIt.index();
-                applyJTCore(xSim, x, projElements[ptId], projN[ptId], colIt.val(),
+                applyJTCore(R, x, projElements[ptId], projN[ptId], colIt.val(),
                     f1, f2, f3, f1r, f2r, f3r);
 
                 sofa::core::topology::Triangle tri = this->inputTopology->getTriangle(projElements[ptId]);
@@ -245,7 +245,7 @@ void BezierShellInterpolationM<TIn,TOut>::applyJTOnBTriangle(
 
 template <class TIn, class TOut>
 void BezierShellInterpolationM<TIn,TOut>::applyJTCore(
-    const InVecCoord &xSim, const VecVec3d &x,
+    const VecMat33 &R, const VecVec3d &x,
     const Index &triId, const ShapeFunctions &N, const OutCoord &force,
     Vec3 &f1, Vec3 &f2, Vec3 &f3, Vec3 &f1r, Vec3 &f2r, Vec3 &f3r)
 {
@@ -311,18 +311,12 @@ void BezierShellInterpolationM<TIn,TOut>::applyJTCore(
     fn = force * N[9]/3;
     if (fn != Vec3(0,0,0))
     {
-        // Rotation matrices at corner nodes
-        Mat33 R[3];
-        xSim[ tri[0] ].getOrientation().toMatrix(R[0]);
-        xSim[ tri[1] ].getOrientation().toMatrix(R[1]);
-        xSim[ tri[2] ].getOrientation().toMatrix(R[2]);
-
         f1 += fn;
         f2 += fn;
         f3 += fn;
-        f1r += cross(R[0]*(this->getSegment(bTri[3]) + this->getSegment(bTri[4])), fn);
-        f2r += cross(R[1]*(this->getSegment(bTri[5]) + this->getSegment(bTri[6])), fn);
-        f3r += cross(R[2]*(this->getSegment(bTri[7]) + this->getSegment(bTri[8])), fn);
+        f1r += cross(R[ tri[0] ]*(this->getSegment(bTri[3]) + this->getSegment(bTri[4])), fn);
+        f2r += cross(R[ tri[1] ]*(this->getSegment(bTri[5]) + this->getSegment(bTri[6])), fn);
+        f3r += cross(R[ tri[2] ]*(this->getSegment(bTri[7]) + this->getSegment(bTri[8])), fn);
     }
 }
 
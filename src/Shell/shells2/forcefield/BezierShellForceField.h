@@ -28,6 +28,7 @@
 #include <sofa/core/behavior/ForceField.h>
 #include <sofa/core/behavior/MechanicalState.h>
 #include <sofa/core/objectmodel/Data.h>
+#include <sofa/core/objectmodel/DataFileName.h>
 
 #include <sofa/core/topology/BaseMeshTopology.h>
 #include <sofa/core/topology/TopologyData.h>
@@ -36,6 +37,12 @@
 
 #include <Shell/controller/MeshInterpolator.h>
 #include <Shell/engine/JoinMeshPoints.h>
+#include <Shell/misc/BlockDiagonal.h>
+#include <Shell/misc/DrawBuffer.h>
+#include <Shell/misc/GeometricStiffness.h>
+#include <Shell/misc/MixedPrecision.h>
+#include <Shell/misc/SymmetricMatrix.h>
+#include <Shell/misc/TimeSeriesWriter.h>
 #include <Shell/shells2/fem/BezierShellInterpolation.h>
 
 
@@ -86,6 +93,7 @@ class BezierShellForceField : public core::behavior::ForceField<DataTypes>
 
         typedef Mat<2,2,Real> Mat22;
         typedef Mat<3,3,Real> Mat33;
+        typedef type::vector<Mat33> VecMat33;
 
         typedef sofa::type::Quat<Real> Quat;
 
@@ -117,6 +125,8 @@ class BezierShellForceField : public core::behavior::ForceField<DataTypes>
         typedef Mat<9, 9, Real> StiffnessMatrix;
         typedef Mat<9, 9, Real> StiffnessMatrixBending;
         typedef Mat<18, 18, Real> StiffnessMatrixGlobalSpace;
+        typedef shell::misc::SymmetricMatrix<9, Real> StiffnessMatrixPacked;    ///< stored (symmetric) stiffness matrix
+        typedef shell::misc::MixedSymmetricMatrix<9, Real> StiffnessMatrixStored; ///< ... in the precision chosen by mixedPrecision
         typedef Mat<4, 6, Real> GradDisplacement;
 
 
@@ -182,20 +192,31 @@ public:
                     StrainDisplacement B;   // Strain-displacement Matrix
                     StrainDisplacement Bb;  // Strain-displacement Matrix bending
                     Index id;               // Index into the result array
+                    Real value;             // Last measured value
                 };
                 type::vector<MeasurePoint> measure;
 
+                // Displacements of the last force evaluation, the measure is
+                // computed from them at the end of the step
+                Displacement measureD;
+                DisplacementBending measureDBending;
+
+                // Frame rotation and element forces of the last force
+                // evaluation for the geometric stiffness
+                shell::misc::GeometricStiffness<Real> geometric;
+
                 // the strain-displacement matrices at each Gauss point
                 StrainDisplacementBending strainDisplacementMatrixB1;
                 StrainDisplacementBending strainDisplacementMatrixB2;
                 StrainDisplacementBending strainDisplacementMatrixB3;
                 StrainDisplacementBending strainDisplacementMatrixB4;
 
-                // Stiffness matrix K = J * M * Jt
-                StiffnessMatrix stiffnessMatrix;
+                // Stiffness matrix K = J * M * Jt (symmetric, packed, in
+                // single precision with mixedPrecision)
+                StiffnessMatrixStored stiffnessMatrix;
 
-                // Stiffness matrix for bending K = Jt * M * J
-                StiffnessMatrixBending stiffnessMatrixBending;
+                // Stiffness matrix for bending K = Jt * M * J (idem)
+                StiffnessMatrixStored stiffnessMatrixBending;
 
                 // Surface Area * 2
                 Real area2;
@@ -242,7 +263,14 @@ public:
         void addKToMatrix(const core::MechanicalParams* mparams, const sofa::core::behavior::MultiMatrixAccessor* matrix) override;
         void handleTopologyChange() override;
 
-        SReal getPotentialEnergy(const sofa::core::MechanicalParams* /*mparams*/, const DataVecCoord& /*x*/) const override { return 0; }
+        /// Strain energy of the positions passed to the last addForce()
+        SReal getPotentialEnergy(const sofa::core::MechanicalParams* /*mparams*/, const DataVecCoord& /*x*/) const override { return m_potentialEnergy; }
+
+        typedef shell::misc::BlockDiagonal<6,Real> NodeBlockDiagonal;
+
+        /// Add kFactor times the node diagonal blocks of the stiffness matrix
+        /// (as assembled by addKToMatrix) into blocks, without assembling it
+        void addNodeBlockDiagonal(NodeBlockDiagonal &blocks, const Real kFactor, const bool parallel);
 
         void draw(const core::visual::VisualParams* vparams) override;
 
@@ -258,6 +286,13 @@ public:
         Data<sofa::helper::OptionsGroup> f_measure;
         Data<unsigned int> f_drawPointSize;
         Data<type::vector<Real> > f_measuredValues;
+        Data<unsigned int> f_measurePeriod;
+        Data<bool> f_parallelMeasure;
+        sofa::core::objectmodel::DataFileName f_measureFile;
+        Data<bool> f_mixedPrecision;
+        Data<bool> f_checkMixedPrecision;
+        Data<Real> f_mixedPrecisionError;
+        Data<bool> f_geometricStiffness;
 
         // Allow transition between rest shapes
         SingleLink<BezierShellForceField<DataTypes>,
@@ -302,6 +337,15 @@ protected :
         TriangleData< sofa::type::vector<TriangleInformation> > triangleInfo;
         TriangleHandler* triangleHandler;
 
+        /// Difference between single and full precision element forces
+        shell::misc::MixedPrecisionError m_mixedError;
+
+        /// Strain energy computed by the last addForce()
+        SReal m_potentialEnergy;
+
+        /// Geometric stiffness requested for the last addForce()
+        bool m_geometricStiffness;
+
         /// Material stiffness matrices for plane stress and bending
         MaterialStiffness materialMatrix;
         //MaterialStiffness materialMatrixBending;
@@ -311,14 +355,28 @@ protected :
         bool bMeasureStrain;
         bool bMeasureStress;
 
+        /// Back buffer of f_measuredValues, steps since the last measure and
+        /// optional recording of the values
+        type::vector<Real> m_measureBuffer;
+        unsigned int m_measureStep;
+        shell::misc::TimeSeriesWriter m_measureWriter;
+
+        /// Bezier nodes for draw(), rebuilt when they have moved
+        shell::misc::DrawBuffer m_drawBuffer;
+
+        /// Compute the stress or strain from the displacements stored by the
+        /// last force evaluation and publish it in f_measuredValues
+        void computeMeasure();
+
         //unsigned int pditers;
 
         void initTriangleOnce(const int i, const Index&a, const Index&b, const Index&c);
         void initTriangle(const int i);
 
         void computeLocalTriangle(const Index elementIndex, bool bFast);
+        void computeLocalTriangle(TriangleInformation &tinfo, const type::fixed_array<Vec3,10> &bn, bool bFast);
 
-        void computeDisplacements( Displacement &Disp, DisplacementBending &BDisp, const VecCoord &x, TriangleInformation *tinfo);
+        void computeDisplacements( Displacement &Disp, DisplacementBending &BDisp, const VecCoord &x, const VecMat33 &R, TriangleInformation *tinfo);
         void computeStrainDisplacementMatrixMembrane(TriangleInformation &tinfo);
         void computeStrainDisplacementMatrixBending(TriangleInformation &tinfo);
         void computeStiffnessMatrixMembrane(StiffnessMatrix &K, const TriangleInformation &tinfo);
@@ -343,9 +401,10 @@ protected :
         //void bezierFunctions(const Vec2& baryCoord, sofa::type::fixed_array<Real,10> &f_bezier);
         //void bezierDerivateFunctions(const Vec2& baryCoord, sofa::type::fixed_array<Real,10> &df_dx_bezier, sofa::type::fixed_array<Real,10> &df_dy_bezier);
         void interpolateRefFrame(TriangleInformation *tinfo, const Vec2& baryCoord);
+        void interpolateRefFrame(TriangleInformation *tinfo, const type::fixed_array<Vec3,10> &bn);
 
 
-        void accumulateForce(VecDeriv& f, const VecCoord & p, const Index elementIndex);
+        void accumulateForce(VecDeriv& f, const VecCoord & p, const VecMat33 &R, const Index elementIndex, SReal &energy);
 
         void convertStiffnessMatrixToGlobalSpace(StiffnessMatrixGlobalSpace &K_gs, TriangleInformation *tinfo);
 
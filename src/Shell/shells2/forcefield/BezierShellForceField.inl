@@ -26,6 +26,7 @@
 #define SOFA_COMPONENT_FORCEFIELD_BEZIERSHELLFORCEFIELD_INL
 
 #include <Shell/shells2/forcefield/BezierShellForceField.h>
+#include <Shell/misc/ParallelFor.h>
 #include <sofa/core/behavior/ForceField.inl>
 #include <sofa/gl/template.h>
 #include <sofa/helper/rmath.h>
@@ -39,6 +40,7 @@
 #include <sofa/core/topology/TopologyData.inl>
 #include <sofa/component/topology/container/dynamic/TriangleSetTopologyContainer.h>
 #include <sofa/core/visual/VisualParams.h>
+#include <sofa/simulation/AnimateEndEvent.h>
 
 #include <sofa/defaulttype/SolidTypes.h>
 
@@ -122,6 +124,13 @@ BezierShellForceField<DataTypes>::BezierShellForceField()
 , f_measure(initData(&f_measure, "measure", "Draw the strain or stress"))
 , f_drawPointSize(initData(&f_drawPointSize, (unsigned int)8, "drawPointSize", "Point size to use"))
 , f_measuredValues(initData(&f_measuredValues, "measuredValues", "Measured values for stress or strain"))
+, f_measurePeriod(initData(&f_measurePeriod, 1u, "measurePeriod", "Compute the measure at the end of every N-th time step"))
+, f_parallelMeasure(initData(&f_parallelMeasure, false, "parallelMeasure", "Compute the measure of the elements in parallel"))
+, f_measureFile(initData(&f_measureFile, "measureFile", "Binary file recording the measured values every time they are computed (optional)"))
+, f_mixedPrecision(initData(&f_mixedPrecision, false, "mixedPrecision", "Store the element stiffness matrices in single precision only and compute element forces with them"))
+, f_checkMixedPrecision(initData(&f_checkMixedPrecision, false, "checkMixedPrecision", "Also compute element forces with full precision matrices, computed again for each element, and report the difference"))
+, f_mixedPrecisionError(initData(&f_mixedPrecisionError, (Real)0, "mixedPrecisionError", "Relative difference between single and full precision element forces in the last addForce"))
+, f_geometricStiffness(initData(&f_geometricStiffness, false, "geometricStiffness", "Add the geometric (initial stress) stiffness due to the rotation of the element frames to the tangent stiffness"))
 , restShape(initLink("restShape","MeshInterpolator component for variable rest shape"))
 , mapTopology(false)
 , topologyMapper(initLink("topologyMapper","Component supplying different topology for the rest shape"))
@@ -137,6 +146,11 @@ BezierShellForceField<DataTypes>::BezierShellForceField()
     f_measure.endEdit();
 
     triangleHandler = new TriangleHandler(this, &triangleInfo);
+
+    bMeasureStrain = bMeasureStress = false;
+    m_measureStep = 0;
+    m_potentialEnergy = 0;
+    m_geometricStiffness = false;
 }
 
 // --------------------------------------------------------------------------------------
@@ -249,6 +263,20 @@ template <class DataTypes>void BezierShellForceField<DataTypes>::reinit()
     {
         f_measuredValues.beginEdit()->resize(_topology->getNbPoints());
         f_measuredValues.endEdit();
+        m_measureBuffer.resize(_topology->getNbPoints());
+        m_measureStep = 0;
+
+        // The measure is computed at the end of the time step
+        *this->f_listening.beginEdit() = true;
+        this->f_listening.endEdit();
+
+        const std::string &filename = f_measureFile.getFullPath();
+        if (filename.empty()) {
+            m_measureWriter.close();
+        } else if (filename != m_measureWriter.getFilename()) {
+            if (!m_measureWriter.open(filename))
+                msg_warning() << "Cannot open '" << filename << "' for writing" ;
+        }
     }
 
     /// Prepare to store info in the triangle array
@@ -351,8 +379,13 @@ void BezierShellForceField<DataTypes>::initTriangle(const int i)
     computeStrainDisplacementMatrixBending(*tinfo);
 
     // Compute stiffness matrices K = ∫ J^T*M*J dV
-    computeStiffnessMatrixMembrane(tinfo->stiffnessMatrix, *tinfo);
-    computeStiffnessMatrixBending(tinfo->stiffnessMatrixBending, *tinfo);
+    StiffnessMatrix K;
+    computeStiffnessMatrixMembrane(K, *tinfo);
+    tinfo->stiffnessMatrix.set(StiffnessMatrixPacked(K), f_mixedPrecision.getValue());
+
+    StiffnessMatrixBending K_bending;
+    computeStiffnessMatrixBending(K_bending, *tinfo);
+    tinfo->stiffnessMatrixBending.set(StiffnessMatrixPacked(K_bending), f_mixedPrecision.getValue());
 
     triangleInfo.endEdit();
 }
@@ -522,13 +555,20 @@ void BezierShellForceField<DataTypes>::interpolateRefFrame(TriangleInformation *
     sofa::type::fixed_array<Vec3,10> X_bezierPoints;
     bsInterpolation->getBezierNodes(tinfo->elementID, X_bezierPoints);
 
+    interpolateRefFrame(tinfo, X_bezierPoints);
+
+#endif
+}
+
+template <class DataTypes>
+void BezierShellForceField<DataTypes>::interpolateRefFrame(TriangleInformation *tinfo,
+    const type::fixed_array<Vec3,10> &X_bezierPoints)
+{
     tinfo->frameCenter = (X_bezierPoints[0] + X_bezierPoints[1] + X_bezierPoints[2])/3;
 
     Vec3 X1 = X_bezierPoints[1] - X_bezierPoints[0],
          Y1 = X_bezierPoints[2] - X_bezierPoints[0];
 
-#endif
-
     // compute the orthogonal frame directions
     Vec3 Y,Z;
     Real X1n = X1.norm(), Y1n = Y1.norm();
@@ -609,12 +649,10 @@ void BezierShellForceField<DataTypes>::applyStiffness(VecDeriv& v, const VecDeri
     Disp_bending[7] = o[0];
     Disp_bending[8] = o[1];
 
-    // Compute dF
+    // Compute dF and dF_bending
     Displacement dF;
-    dF = tinfo->stiffnessMatrix * Disp;
-
-    // Compute dF_bending
     DisplacementBending dF_bending;
+    dF = tinfo->stiffnessMatrix * Disp;
     dF_bending = tinfo->stiffnessMatrixBending * Disp_bending;
 
     // Go back into global frame
@@ -632,6 +670,14 @@ void BezierShellForceField<DataTypes>::applyStiffness(VecDeriv& v, const VecDeri
     v[b] += Deriv(-fb1, -fb2) * kFactor;
     v[c] += Deriv(-fc1, -fc2) * kFactor;
 
+    // Rotation of the element forces with the frame
+    if (m_geometricStiffness) {
+        const Vec3 theta = tinfo->geometric.spin(getVCenter(dx[a]), getVCenter(dx[b]), getVCenter(dx[c]));
+        v[a] += Deriv(tinfo->geometric.dForce(0, theta), tinfo->geometric.dMoment(0, theta)) * kFactor;
+        v[b] += Deriv(tinfo->geometric.dForce(1, theta), tinfo->geometric.dMoment(1, theta)) * kFactor;
+        v[c] += Deriv(tinfo->geometric.dForce(2, theta), tinfo->geometric.dMoment(2, theta)) * kFactor;
+    }
+
     triangleInfo.endEdit();
 }
 
@@ -650,18 +696,30 @@ void BezierShellForceField<DataTypes>::computeLocalTriangle(
     type::fixed_array <Vec3, 10> bn;
     bsInterpolation->getBezierNodes(tinfo->elementID, bn);
 
-    type::fixed_array <Vec3, 10> &pts = tinfo->pts;
+    computeLocalTriangle(*tinfo, bn, bFast);
+
+    triangleInfo.endEdit();
+}
+
+// -----------------------------------------------------------------------------
+// --- Same as above but with the Bézier nodes (in global frame) supplied by
+// --- the caller.
+// -----------------------------------------------------------------------------
+template <class DataTypes>
+void BezierShellForceField<DataTypes>::computeLocalTriangle(
+    TriangleInformation &tinfo, const type::fixed_array<Vec3,10> &bn, bool bFast)
+{
+    type::fixed_array <Vec3, 10> &pts = tinfo.pts;
 
     // The element is being rotated along the frame situated at the center of
     // the element
 
     //// Rotate the already computed nodes
-    //msg_info() << "QFrame: " << tinfo->frame.getOrientation() ;
     for (int i = 0; i < (bFast ? 3 : 10); i++) {
 #ifdef CRQUAT
-        pts[i] = tinfo->frameOrientationQ.rotate(bn[i] - tinfo->frameCenter);
+        pts[i] = tinfo.frameOrientationQ.rotate(bn[i] - tinfo.frameCenter);
 #else
-        pts[i] = tinfo->frameOrientation * (bn[i] - tinfo->frameCenter);
+        pts[i] = tinfo.frameOrientation * (bn[i] - tinfo.frameCenter);
 #endif
     }
 
@@ -674,10 +732,8 @@ void BezierShellForceField<DataTypes>::computeLocalTriangle(
     m(1,0) = pts[0][0]; m(1,1) = pts[1][0]; m(1,2) = pts[2][0];
     m(2,0) = pts[0][1]; m(2,1) = pts[1][1]; m(2,2) = pts[2][1];
 
-    tinfo->interpol.invert(m);
-    tinfo->area2 = cross(pts[1] - pts[0], pts[2] - pts[0]).norm();
-
-    triangleInfo.endEdit();
+    tinfo.interpol.invert(m);
+    tinfo.area2 = cross(pts[1] - pts[0], pts[2] - pts[0]).norm();
 }
 
 // -----------------------------------------------------------------------------
@@ -685,7 +741,7 @@ void BezierShellForceField<DataTypes>::computeLocalTriangle(
 // --- co-rotational frame of reference.
 // -----------------------------------------------------------------------------
 template <class DataTypes>
-void BezierShellForceField<DataTypes>::computeDisplacements( Displacement &Disp, DisplacementBending &BDisp, const VecCoord &x, TriangleInformation *tinfo)
+void BezierShellForceField<DataTypes>::computeDisplacements( Displacement &Disp, DisplacementBending &BDisp, const VecCoord &x, const VecMat33 &R, TriangleInformation *tinfo)
 {
     Index a = tinfo->a;
     Index b = tinfo->b;
@@ -698,14 +754,10 @@ void BezierShellForceField<DataTypes>::computeDisplacements( Displacement &Disp,
     Quat Q1 = (tinfo->frameOrientationQ * x[b].getOrientation()) * tinfo->restLocalOrientationsInv[1];
     Quat Q2 = (tinfo->frameOrientationQ * x[c].getOrientation()) * tinfo->restLocalOrientationsInv[2];
 #else
-    Transformation tmp0, tmp1, tmp2;
-    x[a].getOrientation().toMatrix(tmp0);
-    x[b].getOrientation().toMatrix(tmp1);
-    x[c].getOrientation().toMatrix(tmp2);
-
-    Quat Q0; Q0.fromMatrix( tinfo->frameOrientation * tmp0 * tinfo->restLocalOrientationsInv[0] );
-    Quat Q1; Q1.fromMatrix( tinfo->frameOrientation * tmp1 * tinfo->restLocalOrientationsInv[1] );
-    Quat Q2; Q2.fromMatrix( tinfo->frameOrientation * tmp2 * tinfo->restLocalOrientationsInv[2] );
+    // Rotation matrices of the nodes are shared with bsInterpolation
+    Quat Q0; Q0.fromMatrix( tinfo->frameOrientation * R[a] * tinfo->restLocalOrientationsInv[0] );
+    Quat Q1; Q1.fromMatrix( tinfo->frameOrientation * R[b] * tinfo->restLocalOrientationsInv[1] );
+    Quat Q2; Q2.fromMatrix( tinfo->frameOrientation * R[c] * tinfo->restLocalOrientationsInv[2] );
     // TODO: can we do this without the quaternions?
 #endif
 
@@ -1073,9 +1125,6 @@ void BezierShellForceField<DataTypes>::fixFramePolar(const Displacement &Disp, M
     // R3d = new_R_old
     // so modification of tinfo.frameOrientation
     tinfo.frameOrientation = R3d * tinfo.frameOrientation;
-
-    // Update node position in local frame
-    computeLocalTriangle(tinfo.elementID, true);
 }
 
 
@@ -1329,12 +1378,18 @@ void BezierShellForceField<DataTypes>::stressAtPoints(const VecVec3 &points, con
 
     f_measuredValues.beginEdit()->resize(points.size());
     f_measuredValues.endEdit();
+    m_measureBuffer.resize(points.size());
 
     if (!bMeasureStrain && !bMeasureStress) {
         bMeasureStress = true;
         f_measure.beginEdit()->setSelectedItem("Von Mises stress");
         f_measure.endEdit();
     }
+
+    // Values are available after the end of the next time step
+    m_measureStep = 0;
+    *this->f_listening.beginEdit() = true;
+    this->f_listening.endEdit();
 }
 
 // ----------------------------------------------------------------------------
@@ -1603,6 +1658,13 @@ void BezierShellForceField<DataTypes>::computeForceMembrane(
 
     // Compute forces
     F = tinfo.stiffnessMatrix * D;
+    if (tinfo.stiffnessMatrix.isSingle() && f_checkMixedPrecision.getValue()) {
+        // Only the single precision matrix is stored, compute the reference
+        // one again
+        StiffnessMatrix K;
+        computeStiffnessMatrixMembrane(K, tinfo);
+        m_mixedError.add(F, Displacement(K * D));
+    }
 
     triangleInfo.endEdit();
 }
@@ -1619,6 +1681,11 @@ void BezierShellForceField<DataTypes>::computeForceBending(DisplacementBending &
 
     // Compute forces
     F_bending = tinfo.stiffnessMatrixBending * D_bending;
+    if (tinfo.stiffnessMatrixBending.isSingle() && f_checkMixedPrecision.getValue()) {
+        StiffnessMatrixBending K_bending;
+        computeStiffnessMatrixBending(K_bending, tinfo);
+        m_mixedError.add(F_bending, DisplacementBending(K_bending * D_bending));
+    }
 
     triangleInfo.endEdit();
 }
@@ -1627,7 +1694,7 @@ void BezierShellForceField<DataTypes>::computeForceBending(DisplacementBending &
 // ---
 // --------------------------------------------------------------------------------------
 template <class DataTypes>
-void BezierShellForceField<DataTypes>::accumulateForce(VecDeriv &f, const VecCoord &x, const Index elementIndex)
+void BezierShellForceField<DataTypes>::accumulateForce(VecDeriv &f, const VecCoord &x, const VecMat33 &R, const Index elementIndex, SReal &energy)
 {
     type::vector<TriangleInformation>& triangleInf = *(triangleInfo.beginEdit());
     TriangleInformation *tinfo = &triangleInf[elementIndex];
@@ -1637,26 +1704,33 @@ void BezierShellForceField<DataTypes>::accumulateForce(VecDeriv &f, const VecCoo
     const Index& b = tinfo->b;
     const Index& c = tinfo->c;
 
+    // Bézier nodes of the element in global frame, computed once from the
+    // DOFs and used for the frame and all local positions below
+    type::fixed_array<Vec3,10> bn;
+    bsInterpolation->computeBezierNodes(tinfo->elementID, x, R, bn);
+
     // Compute the quaternion that embodies the rotation between the triangle
     // and world frames (co-rotational method)
-    interpolateRefFrame(tinfo, Vec2(1.0/3.0, 1.0/3.0));
+    interpolateRefFrame(tinfo, bn);
 
-    computeLocalTriangle(elementIndex, true);
+    computeLocalTriangle(*tinfo, bn, true);
 
     // Compute in-plane and bending displacements in the triangle's frame
     Displacement D;
     DisplacementBending D_bending;
-    computeDisplacements(D, D_bending, x, tinfo);
+    computeDisplacements(D, D_bending, x, R, tinfo);
 
     // Use polar decomposition to fix the frame (inPlane)
-    Mat22 R;
+    Mat22 Rpolar;
     //bool bStop = false;
     for (unsigned int i=0; i<f_polarMaxIters.getValue(); i++)
     {
-        fixFramePolar(D, R, *tinfo);
-        computeDisplacements(D, D_bending, x, tinfo);
+        fixFramePolar(D, Rpolar, *tinfo);
+        // Update node position in local frame
+        computeLocalTriangle(*tinfo, bn, true);
+        computeDisplacements(D, D_bending, x, R, tinfo);
         // Stop if sin(θ) of the rotation angle θ is too small
-        if (helper::rabs(R[0][1]) < polarMinSinTheta) {
+        if (helper::rabs(Rpolar[0][1]) < polarMinSinTheta) {
             //std::cout << "Stop after " << i+1 << " iteration(s).\n";
             //pditers -= f_polarMaxIters.getValue() - (i+1);
             //bStop = true;
@@ -1670,7 +1744,7 @@ void BezierShellForceField<DataTypes>::accumulateForce(VecDeriv &f, const VecCoo
     //    std::cout << elementIndex << "\n";
 
     // TODO: is this necessary?
-    computeLocalTriangle(elementIndex, false);
+    computeLocalTriangle(*tinfo, bn, false);
 
     // Compute in-plane forces on this element (in the co-rotational space)
     Displacement F;
@@ -1680,30 +1754,12 @@ void BezierShellForceField<DataTypes>::accumulateForce(VecDeriv &f, const VecCoo
     DisplacementBending F_bending;
     computeForceBending(F_bending, D_bending, elementIndex);
 
-    // Compute the measure to draw
-    if (bMeasureStrain) {
-        type::vector<Real> &values = *f_measuredValues.beginEdit();
-        for (unsigned int i=0; i< tinfo->measure.size(); i++) {
-            Vec3 strain = tinfo->measure[i].B * D + tinfo->measure[i].Bb * D_bending;
-            // Norm from strain in x and y
-            // NOTE: Shear strain is not included
-            values[ tinfo->measure[i].id ] = helper::rsqrt(
-                strain[0] * strain[0] + strain[1] * strain[1]);
-        }
-        f_measuredValues.endEdit();
-    } else if (bMeasureStress) {
-        type::vector<Real> &values = *f_measuredValues.beginEdit();
-        for (unsigned int i=0; i< tinfo->measure.size(); i++) {
-            Vec3 stress = materialMatrix * tinfo->measure[i].B * D
-                + materialMatrix * tinfo->measure[i].Bb * D_bending;
-            // Von Mises stress criterion (plane stress)
-            values[ tinfo->measure[i].id ] = helper::rsqrt(
-                  stress[0] * stress[0] - stress[0] * stress[1]
-                + stress[1] * stress[1] + 3 * stress[2] * stress[2]);
-        }
-        f_measuredValues.endEdit();
-    }
+    // Keep the displacements for the measure
+    tinfo->measureD = D;
+    tinfo->measureDBending = D_bending;
 
+    // Strain energy 1/2 u^T K u in the corotational frame
+    energy += (D * F + D_bending * F_bending) / 2;
 
     // Transform forces back into global reference frame
     Vec3 fa1 = tinfo->frameOrientationInv * Vec3(F[0], F[1], F_bending[0]);
@@ -1730,6 +1786,15 @@ void BezierShellForceField<DataTypes>::accumulateForce(VecDeriv &f, const VecCoo
     f[b] += Deriv(-fb1, -fb2);
     f[c] += Deriv(-fc1, -fc2);
 
+    if (m_geometricStiffness) {
+        // The in-plane axes are fitted by polar decomposition
+        tinfo->geometric.setFittedFrame(type::fixed_array<Vec3,3>(tinfo->pts[0], tinfo->pts[1], tinfo->pts[2]),
+            tinfo->frameOrientation);
+        tinfo->geometric.setForce(0, fa1, fa2);
+        tinfo->geometric.setForce(1, fb1, fb2);
+        tinfo->geometric.setForce(2, fc1, fc2);
+    }
+
     triangleInfo.endEdit();
 }
 
@@ -1753,10 +1818,24 @@ void BezierShellForceField<DataTypes>::addForce(const sofa::core::MechanicalPara
     int nbTriangles=_topology->getNbTriangles();
     f.resize(p.size());
 
+    // Rotations of the nodes, computed once per change of the positions
+    const VecMat33& R = bsInterpolation->getNodeRotations(dataX);
+
+    const bool checkMixed = f_mixedPrecision.getValue() && f_checkMixedPrecision.getValue();
+    if (checkMixed)
+        m_mixedError.clear();
+
+    m_geometricStiffness = f_geometricStiffness.getValue();
+
+    SReal energy = 0;
     for (int i=0; i<nbTriangles; i++)
     {
-        accumulateForce(f, p, i);
+        accumulateForce(f, p, R, i, energy);
     }
+    m_potentialEnergy = energy;
+
+    if (checkMixed)
+        f_mixedPrecisionError.setValue((Real)m_mixedError.relative());
     //std::cout << "Avg pdi: " << (Real)pditers/nbTriangles << "\n";
     //pditers = 0;
 
@@ -1792,11 +1871,34 @@ void BezierShellForceField<DataTypes>::addDForce(const sofa::core::MechanicalPar
 }
 
 
+template<class DataTypes>
+void BezierShellForceField<DataTypes>::addNodeBlockDiagonal(NodeBlockDiagonal &blocks, const Real kFactor, const bool parallel)
+{
+    const type::vector<TriangleInformation>& ti = triangleInfo.getValue();
+
+    // Position of the membrane (u, v, θz) and bending (w, θx, θy) dofs in
+    // the node block
+    const unsigned int membraneDofs[3] = { 0, 1, 5 };
+    const unsigned int bendingDofs[3] = { 2, 3, 4 };
+
+    shell::misc::accumulateNodeBlocks(blocks, _topology, parallel,
+        [&](Mat<6,6,Real> &block, Index t, unsigned int j) {
+            const TriangleInformation &tinfo = ti[t];
+
+            Mat<6,6,Real> local;
+            local.clear();
+            shell::misc::addElementNodeBlock(local, tinfo.stiffnessMatrix, 3, j, membraneDofs);
+            shell::misc::addElementNodeBlock(local, tinfo.stiffnessMatrixBending, 3, j, bendingDofs);
+            shell::misc::addRotatedNodeBlock(block, local, tinfo.frameOrientation, -kFactor);
+        });
+}
+
+
 template<class DataTypes>
 void BezierShellForceField<DataTypes>::convertStiffnessMatrixToGlobalSpace(StiffnessMatrixGlobalSpace &K_gs, TriangleInformation *tinfo)
 {
     // Stiffness matrix of current triangle
-    const StiffnessMatrix &K = tinfo->stiffnessMatrix;
+    const StiffnessMatrixPacked K = tinfo->stiffnessMatrix.toFull();
 
     // Firstly, add all degrees of freedom (we add the unused translation in z)
     StiffnessMatrixGlobalSpace K_18x18;
@@ -1815,25 +1917,25 @@ void BezierShellForceField<DataTypes>::convertStiffnessMatrixToGlobalSpace(Stiff
             jg = 6*by;
 
             // linear X
-            K_18x18[ig+0][jg+0] = K[3*bx+0][3*by+0]; // linear X
-            K_18x18[ig+0][jg+1] = K[3*bx+0][3*by+1]; // linear Y
-            K_18x18[ig+0][jg+5] = K[3*bx+0][3*by+2]; // angular Z
+            K_18x18[ig+0][jg+0] = K(3*bx+0, 3*by+0); // linear X
+            K_18x18[ig+0][jg+1] = K(3*bx+0, 3*by+1); // linear Y
+            K_18x18[ig+0][jg+5] = K(3*bx+0, 3*by+2); // angular Z
 
             // linear Y
-            K_18x18[ig+1][jg+0] = K[3*bx+1][3*by+0]; // linear X
-            K_18x18[ig+1][jg+1] = K[3*bx+1][3*by+1]; // linear Y
-            K_18x18[ig+1][jg+5] = K[3*bx+1][3*by+2]; // angular Z
+            K_18x18[ig+1][jg+0] = K(3*bx+1, 3*by+0); // linear X
+            K_18x18[ig+1][jg+1] = K(3*bx+1, 3*by+1); // linear Y
+            K_18x18[ig+1][jg+5] = K(3*bx+1, 3*by+2); // angular Z
 
             // angular Z
-            K_18x18[ig+5][jg+0] = K[3*bx+2][3*by+0]; // linear X
-            K_18x18[ig+5][jg+1] = K[3*bx+2][3*by+1]; // linear Y
-            K_18x18[ig+5][jg+5] = K[3*bx+2][3*by+2]; // angular Z
+            K_18x18[ig+5][jg+0] = K(3*bx+2, 3*by+0); // linear X
+            K_18x18[ig+5][jg+1] = K(3*bx+2, 3*by+1); // linear Y
+            K_18x18[ig+5][jg+5] = K(3*bx+2, 3*by+2); // angular Z
                 }
             }
 
 
         // Stiffness matrix in bending of current triangle
-        const StiffnessMatrixBending &K_bending = tinfo->stiffnessMatrixBending;
+        const StiffnessMatrixPacked K_bending = tinfo->stiffnessMatrixBending.toFull();
 
         // Copy the stiffness matrix by block 3x3 into global matrix (the new index of each bloc into global matrix is a combination of 2, 8 and 15 in indices)
         for (unsigned int bx=0; bx<3; bx++)
@@ -1851,34 +1953,15 @@ void BezierShellForceField<DataTypes>::convertStiffnessMatrixToGlobalSpace(Stiff
                 {
                     for (unsigned int j=0; j<3; j++)
                     {
-                        K_18x18[ig+i][jg+j] += K_bending[3*bx+i][3*by+j];
+                        K_18x18[ig+i][jg+j] += K_bending(3*bx+i, 3*by+j);
                     }
                 }
 
             }
         }
 
-    // Extend rotation matrix and its transpose
-    StiffnessMatrixGlobalSpace R18x18, Rt18x18;
-
-    for(unsigned int i=0;i<3;++i)
-    {
-        for(unsigned int j=0;j<3;++j)
-        {
-            R18x18[i][j] = R18x18[i+3][j+3] = R18x18[i+6][j+6] = R18x18[i+9][j+9] = R18x18[i+12][j+12] = R18x18[i+15][j+15] =
-                tinfo->frameOrientation[i][j];
-            Rt18x18[i][j] = Rt18x18[i+3][j+3] = Rt18x18[i+6][j+6] = Rt18x18[i+9][j+9] = Rt18x18[i+12][j+12] = Rt18x18[i+15][j+15] =
-                tinfo->frameOrientationInv[i][j];
-        }
-    }
-
-    /*
-    std::cout<<"R18x18 ="<<R18x18<<std::endl;
-    std::cout<<"Rt18x18 ="<<Rt18x18<<std::endl;
-    std::cout<<"K_18x18 ="<<K_18x18<<std::endl;
-    */
     // Then we put the stifness matrix into the global frame
-    K_gs = Rt18x18 * K_18x18 * R18x18;
+    shell::misc::rotateSymmetric18(K_gs, K_18x18, tinfo->frameOrientation, tinfo->frameOrientationInv);
 }
 
 #define ASSEMBLED_K
@@ -1892,9 +1975,6 @@ void BezierShellForceField<DataTypes>::addKToMatrix(const core::MechanicalParams
     StiffnessMatrixGlobalSpace K_gs;
 
     // Build Matrix Block for this ForceField
-    unsigned int i, j ,n1, n2, row, column, ROW, COLUMN;
-    Index node1, node2;
-
     sofa::core::behavior::MultiMatrixAccessor::MatrixRef r = matrix->getMatrix(this->mstate);
     type::vector<TriangleInformation>& triangleInf = *(triangleInfo.beginEdit());
 
@@ -1909,30 +1989,10 @@ void BezierShellForceField<DataTypes>::addKToMatrix(const core::MechanicalParams
 
             convertStiffnessMatrixToGlobalSpace(K_gs, tinfo);
 
-            // find index of node 1
-            for (n1=0; n1<3; n1++)
-            {
-                    node1 = triangle[n1];
+            shell::misc::addSymmetricElementMatrix(r.matrix, r.offset, triangle, K_gs, (Real)-kFactor);
 
-                    for(i=0; i<6; i++)
-                    {
-                            ROW = r.offset+6*node1+i;
-                            row = 6*n1+i;
-                            // find index of node 2
-                            for (n2=0; n2<3; n2++)
-                            {
-                                    node2 = triangle[n2];
-
-                                    for (j=0; j<6; j++)
-                                    {
-                                            COLUMN = r.offset+6*node2+j;
-                                            column = 6*n2+j;
-                                            r.matrix->add(ROW, COLUMN, - K_gs[row][column] * kFactor);
-
-                                    }
-                            }
-                    }
-            }
+            if (m_geometricStiffness)
+                tinfo->geometric.addToMatrix(r.matrix, r.offset, triangle, (Real)kFactor);
     }
 
 
@@ -2013,6 +2073,64 @@ void BezierShellForceField<DataTypes>::handleEvent(sofa::core::objectmodel::Even
             initTriangle(i);
         }
     }
+    else if (dynamic_cast<sofa::simulation::AnimateEndEvent*>(event))
+    {
+        // Measure of stress or strain, once per (measurePeriod) time step(s)
+        if (!bMeasureStrain && !bMeasureStress)
+            return;
+
+        const unsigned int period = f_measurePeriod.getValue();
+        if (period == 0 || ++m_measureStep < period)
+            return;
+
+        m_measureStep = 0;
+        computeMeasure();
+    }
+}
+
+template <class DataTypes>
+void BezierShellForceField<DataTypes>::computeMeasure()
+{
+    type::vector<TriangleInformation>& ti = *(triangleInfo.beginEdit());
+    const bool strain = bMeasureStrain;
+
+    // Each element only writes into its own measure points
+    shell::misc::parallelForRange(f_parallelMeasure.getValue(), std::size_t(0), ti.size(),
+        [&](std::size_t begin, std::size_t end) {
+            for (std::size_t t=begin; t<end; t++) {
+                TriangleInformation &tinfo = ti[t];
+                for (auto &mp : tinfo.measure) {
+                    if (strain) {
+                        Vec3 e = mp.B * tinfo.measureD + mp.Bb * tinfo.measureDBending;
+                        // Norm from strain in x and y
+                        // NOTE: Shear strain is not included
+                        mp.value = helper::rsqrt(e[0] * e[0] + e[1] * e[1]);
+                    } else {
+                        Vec3 stress = materialMatrix * (mp.B * tinfo.measureD + mp.Bb * tinfo.measureDBending);
+                        // Von Mises stress criterion (plane stress)
+                        mp.value = helper::rsqrt(
+                              stress[0] * stress[0] - stress[0] * stress[1]
+                            + stress[1] * stress[1] + 3 * stress[2] * stress[2]);
+                    }
+                }
+            }
+        });
+
+    // Gather into the back buffer. Points shared by several elements get the
+    // value of the last one, as they always did.
+    m_measureBuffer.resize(f_measuredValues.getValue().size());
+    for (const TriangleInformation &tinfo : ti) {
+        for (const auto &mp : tinfo.measure)
+            m_measureBuffer[mp.id] = mp.value;
+    }
+
+    triangleInfo.endEdit();
+
+    // Swap the buffers, the published values are always complete
+    f_measuredValues.beginEdit()->swap(m_measureBuffer);
+    f_measuredValues.endEdit();
+
+    m_measureWriter.write(this->getContext()->getTime(), f_measuredValues.getValue());
 }
 
 // Given H,S,L in range of 0-1
@@ -2091,41 +2209,40 @@ void BezierShellForceField<DataTypes>::draw(const core::visual::VisualParams* vp
     // it in showForceField or showBehaviorModels
     if(vparams->displayFlags().getShowForceFields())
     {
-        type::vector<TriangleInformation>& triangleInf = *(triangleInfo.beginEdit());
+        const type::vector<TriangleInformation>& triangleInf = triangleInfo.getValue();
 
-        // Render Bezier points
+        // Render Bezier points, the arrays are rebuilt only when the nodes
+        // have moved
         if (f_drawNodes.getValue()) {
 
-        glPointSize(f_drawPointSize.getValue());
-        glDisable(GL_LIGHTING);
-        glBegin(GL_POINTS);
-
-        sofa::type::fixed_array<Vec3,10> bn;
-        for (sofa::Index i=0; i<_topology->getNbTriangles(); ++i)
+        if (!m_drawBuffer.isValid(bsInterpolation->getBezierNodesCounter()) ||
+            (m_drawBuffer.points.size() != 10*triangleInf.size()))
         {
-            TriangleInformation *tinfo = &triangleInf[i];
-            bsInterpolation->getBezierNodes(tinfo->elementID, bn);
-
-            for (int j=0; j<9; j++)
+            m_drawBuffer.clear();
+            sofa::type::fixed_array<Vec3,10> bn;
+            for (sofa::Index i=0; i<triangleInf.size(); ++i)
             {
-                glColor4f(0.0, 0.7, 0.0, 1.0);
-                glVertex3f(bn[j][0], bn[j][1], bn[j][2]);
-            }
+                bsInterpolation->getBezierNodes(triangleInf[i].elementID, bn);
+
+                for (int j=0; j<9; j++)
+                    m_drawBuffer.addPoint(bn[j], sofa::type::RGBAColor(0.0, 0.7, 0.0, 1.0));
 
-            // Central node in lighter color
-            glColor4f(0.0, 1.0, 0.0, 1.0);
-            glVertex3f(bn[9][0], bn[9][1], bn[9][2]);
+                // Central node in lighter color
+                m_drawBuffer.addPoint(bn[9], sofa::type::RGBAColor(0.0, 1.0, 0.0, 1.0));
+            }
+            m_drawBuffer.validate(bsInterpolation->getBezierNodesCounter());
         }
 
-        glEnd();
-        glPointSize(1);
+        const auto stateLifeCycle = vparams->drawTool()->makeStateLifeCycle();
+        vparams->drawTool()->disableLighting();
+        vparams->drawTool()->drawPoints(m_drawBuffer.points, (float)f_drawPointSize.getValue(), m_drawBuffer.colours);
         }
 
         // Render the frame of each element
         if (f_drawFrame.getValue()) {
         for (sofa::Index i=0; i<_topology->getNbTriangles(); ++i)
         {
-            TriangleInformation *tinfo = &triangleInf[i];
+            const TriangleInformation *tinfo = &triangleInf[i];
 
 #ifdef CRQUAT
             Quat qFrame = tinfo->frameOrientationQ.inverse();
@@ -2140,8 +2257,6 @@ void BezierShellForceField<DataTypes>::draw(const core::visual::VisualParams* vp
 
         }
         }
-
-        triangleInfo.endEdit();
     } // if(getShowForceFields())
 }
 
@@ -0,0 +1,97 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/core/behavior/LinearSolver.h>
+#include <sofa/core/behavior/MechanicalState.h>
+#include <sofa/core/MultiVecId.h>
+#include <sofa/defaulttype/RigidTypes.h>
+#include <sofa/defaulttype/VecTypes.h>
+
+#include <Shell/config.h>
+#include <Shell/misc/BlockDiagonal.h>
+
+namespace shell::solver
+{
+
+/**
+ * @brief Block-Jacobi preconditioner for the shell force fields.
+ *
+ * Keeps the inverse of the node diagonal blocks of M*mFactor + K*kFactor. The
+ * stiffness blocks are accumulated by the shell force fields of the context
+ * (TriangularShellForceField, TriangularBendingFEMForceField and
+ * BezierShellForceField for rigid nodes, CstFEMForceField for 3D points)
+ * without assembling the matrix, the mass blocks are read from the mass of
+ * the context. Other force fields and damping are ignored.
+ *
+ * It is meant to be linked as the preconditioner of a conjugate gradient
+ * solver, which calls setSystemMBKMatrix() when it updates the
+ * preconditioner and solveSystem() in each iteration.
+ */
+template<class DataTypes>
+class BlockJacobiPreconditioner : public sofa::core::behavior::LinearSolver
+{
+public:
+    SOFA_CLASS(SOFA_TEMPLATE(BlockJacobiPreconditioner,DataTypes), sofa::core::behavior::LinearSolver);
+
+    typedef typename DataTypes::VecDeriv VecDeriv;
+    typedef typename DataTypes::Deriv Deriv;
+    typedef typename DataTypes::Real Real;
+
+    static constexpr sofa::Size NbDofs = DataTypes::deriv_total_size;
+    typedef shell::misc::BlockDiagonal<NbDofs,Real> NodeBlockDiagonal;
+
+protected:
+
+    BlockJacobiPreconditioner();
+
+    virtual ~BlockJacobiPreconditioner();
+
+public:
+
+    void init() override;
+
+    void resetSystem() override;
+    void setSystemMBKMatrix(const sofa::core::MechanicalParams* mparams) override;
+    void setSystemRHVector(sofa::core::MultiVecDerivId v) override;
+    void setSystemLHVector(sofa::core::MultiVecDerivId v) override;
+    void solveSystem() override;
+
+    sofa::Data<bool> d_parallel;
+    sofa::Data<unsigned int> d_nbSingularBlocks;
+
+protected:
+
+    sofa::core::behavior::MechanicalState<DataTypes>* m_state;
+
+    NodeBlockDiagonal m_blocks;
+    sofa::core::MultiVecDerivId m_rhs, m_lhs;
+
+    /// Add the stiffness blocks of the force fields of type FF in the context
+    template<class FF>
+    void addForceFieldBlocks(const sofa::core::MechanicalParams* mparams);
+
+    /// Add the mass blocks of the mass in the context
+    void addMassBlocks(const sofa::core::MechanicalParams* mparams);
+};
+
+} // namespace
@@ -0,0 +1,181 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <Shell/solver/BlockJacobiPreconditioner.h>
+#include <Shell/forcefield/CstFEMForceField.h>
+#include <Shell/forcefield/TriangularBendingFEMForceField.h>
+#include <Shell/forcefield/TriangularShellForceField.h>
+#include <Shell/shells2/forcefield/BezierShellForceField.h>
+
+#include <sofa/core/behavior/BaseMass.h>
+#include <sofa/core/behavior/Mass.h>
+#include <sofa/core/MechanicalParams.h>
+#include <sofa/linearalgebra/FullMatrix.h>
+
+#include <algorithm>
+
+namespace shell::solver
+{
+
+template<class DataTypes>
+BlockJacobiPreconditioner<DataTypes>::BlockJacobiPreconditioner()
+: d_parallel(initData(&d_parallel, false, "parallel", "Accumulate, invert and apply the blocks in parallel"))
+, d_nbSingularBlocks(initData(&d_nbSingularBlocks, 0u, "nbSingularBlocks", "Number of singular node blocks at the last update, replaced by the inverse of their diagonal"))
+, m_state(nullptr)
+{
+    d_nbSingularBlocks.setReadOnly(true);
+}
+
+template<class DataTypes>
+BlockJacobiPreconditioner<DataTypes>::~BlockJacobiPreconditioner()
+{
+}
+
+template<class DataTypes>
+void BlockJacobiPreconditioner<DataTypes>::init()
+{
+    Inherit1::init();
+
+    m_state = dynamic_cast< sofa::core::behavior::MechanicalState<DataTypes>* >(
+        this->getContext()->getMechanicalState());
+    if (!m_state)
+        msg_error() << "No mechanical state of type " << DataTypes::Name() << " found.";
+}
+
+template<class DataTypes>
+void BlockJacobiPreconditioner<DataTypes>::resetSystem()
+{
+}
+
+template<class DataTypes>
+void BlockJacobiPreconditioner<DataTypes>::setSystemMBKMatrix(const sofa::core::MechanicalParams* mparams)
+{
+    if (!m_state)
+        return;
+
+    m_blocks.resize(m_state->getSize());
+    m_blocks.clear();
+
+    addMassBlocks(mparams);
+
+    if constexpr (NbDofs == 6)
+    {
+        addForceFieldBlocks< sofa::component::forcefield::TriangularShellForceField<DataTypes> >(mparams);
+        addForceFieldBlocks< shell::forcefield::TriangularBendingFEMForceField<DataTypes> >(mparams);
+        addForceFieldBlocks< sofa::component::forcefield::BezierShellForceField<DataTypes> >(mparams);
+    }
+    else
+    {
+        addForceFieldBlocks< sofa::component::forcefield::CstFEMForceField<DataTypes> >(mparams);
+    }
+
+    d_nbSingularBlocks.setValue((unsigned int)m_blocks.invert(d_parallel.getValue()));
+}
+
+template<class DataTypes>
+template<class FF>
+void BlockJacobiPreconditioner<DataTypes>::addForceFieldBlocks(const sofa::core::MechanicalParams* mparams)
+{
+    sofa::type::vector<FF*> forceFields;
+    this->getContext()->template get<FF>(&forceFields, sofa::core::objectmodel::BaseContext::Local);
+
+    for (FF* ff : forceFields)
+    {
+        if (ff->getMState() != m_state)
+            continue;
+
+        const Real kFactor = (Real)sofa::core::mechanicalparams::kFactorIncludingRayleighDamping(
+            mparams, ff->rayleighStiffness.getValue());
+        ff->addNodeBlockDiagonal(m_blocks, kFactor, d_parallel.getValue());
+    }
+}
+
+template<class DataTypes>
+void BlockJacobiPreconditioner<DataTypes>::addMassBlocks(const sofa::core::MechanicalParams* mparams)
+{
+    sofa::core::behavior::BaseMass* mass = this->getContext()->getMass();
+    if (!mass)
+        return;
+
+    SReal mFactor = sofa::core::mechanicalparams::mFactor(mparams);
+    if (auto* m = dynamic_cast< sofa::core::behavior::Mass<DataTypes>* >(mass))
+        mFactor = sofa::core::mechanicalparams::mFactorIncludingRayleighDamping(mparams, m->rayleighMass.getValue());
+
+    sofa::linearalgebra::FullMatrix<SReal> M;
+    for (std::size_t i=0; i<m_blocks.size(); i++)
+    {
+        mass->getElementMass((sofa::Index)i, &M);
+
+        const sofa::Size rows = std::min<sofa::Size>((sofa::Size)M.rowSize(), NbDofs);
+        const sofa::Size cols = std::min<sofa::Size>((sofa::Size)M.colSize(), NbDofs);
+        for (sofa::Size k=0; k<rows; k++)
+            for (sofa::Size l=0; l<cols; l++)
+                m_blocks[i][k][l] += (Real)(mFactor * M.element(k, l));
+    }
+}
+
+template<class DataTypes>
+void BlockJacobiPreconditioner<DataTypes>::setSystemRHVector(sofa::core::MultiVecDerivId v)
+{
+    m_rhs = v;
+}
+
+template<class DataTypes>
+void BlockJacobiPreconditioner<DataTypes>::setSystemLHVector(sofa::core::MultiVecDerivId v)
+{
+    m_lhs = v;
+}
+
+template<class DataTypes>
+void BlockJacobiPreconditioner<DataTypes>::solveSystem()
+{
+    if (!m_state)
+        return;
+
+    const VecDeriv& b = m_state->read(sofa::core::ConstVecDerivId(m_rhs.getId(m_state)))->getValue();
+    VecDeriv& x = *m_state->write(sofa::core::VecDerivId(m_lhs.getId(m_state)))->beginEdit();
+
+    x.resize(b.size());
+    const std::size_t n = std::min(b.size(), m_blocks.size());
+
+    // x = D^-1 b
+    shell::misc::parallelForRange(d_parallel.getValue(), std::size_t(0), n, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i=begin; i<end; i++) {
+            typename NodeBlockDiagonal::VecN bi;
+            for (sofa::Size k=0; k<NbDofs; k++)
+                bi[k] = b[i][k];
+
+            const typename NodeBlockDiagonal::VecN xi = m_blocks[i] * bi;
+            for (sofa::Size k=0; k<NbDofs; k++)
+                x[i][k] = xi[k];
+        }
+    });
+
+    // Nodes without blocks are not preconditioned
+    for (std::size_t i=n; i<b.size(); i++)
+        x[i] = b[i];
+
+    m_state->write(sofa::core::VecDerivId(m_lhs.getId(m_state)))->endEdit();
+}
+
+} // namespace
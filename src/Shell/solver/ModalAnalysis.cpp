@@ -0,0 +1,41 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#define SHELL_SOLVER_MODALANALYSIS_CPP
+
+#include <Shell/solver/ModalAnalysis.inl>
+#include <sofa/core/ObjectFactory.h>
+
+namespace shell::solver
+{
+
+using namespace sofa::defaulttype;
+
+// Register in the Factory
+int ModalAnalysisClass = sofa::core::RegisterObject("Computes the lowest vibration modes of a shell for the modal reduced model")
+.add< ModalAnalysis<sofa::defaulttype::Rigid3Types> >(true) // default template
+.add< ModalAnalysis<sofa::defaulttype::Vec3Types> >()
+;
+
+template class SOFA_SHELL_API ModalAnalysis<sofa::defaulttype::Rigid3Types>;
+template class SOFA_SHELL_API ModalAnalysis<sofa::defaulttype::Vec3Types>;
+
+} // namespace
@@ -0,0 +1,136 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/core/objectmodel/BaseObject.h>
+#include <sofa/core/behavior/ForceField.h>
+#include <sofa/core/behavior/MechanicalState.h>
+#include <sofa/core/behavior/ProjectiveConstraintSet.h>
+#include <sofa/defaulttype/RigidTypes.h>
+#include <sofa/defaulttype/VecTypes.h>
+
+#include <Shell/config.h>
+#include <Shell/misc/BlockDiagonal.h>
+#include <Shell/misc/BlockSparseMatrix.h>
+#include <Shell/misc/ModalBasis.h>
+
+namespace shell::solver
+{
+
+/**
+ * @brief Offline computation of the lowest vibration modes of a mechanical
+ * state, for the modal reduced model (ModalMapping and ModalForceField).
+ *
+ * At initialisation, the stiffness K and mass M of the node are assembled
+ * and the lowest eigenpairs of K phi = lambda M phi are computed by a
+ * shift-invert Lanczos iteration with full reorthogonalisation. The modes
+ * are mass-normalised and orthogonal to the dofs fixed by the projective
+ * constraints. The systems with K - shift*M are solved by a conjugate
+ * gradient with block-Jacobi preconditioning, a negative shift is needed
+ * for a free shell.
+ *
+ * Optionally the modal derivatives are computed as the static response
+ * K psi_ij = d2f/dq_i dq_j, the second derivatives of the internal forces
+ * being evaluated by finite differences around the rest state. They are
+ * solved with the unshifted stiffness K, assembled again if the shift is not
+ * zero.
+ *
+ * The result is written into a ModalBasis file.
+ */
+template<class DataTypes>
+class ModalAnalysis : public sofa::core::objectmodel::BaseObject
+{
+public:
+    SOFA_CLASS(SOFA_TEMPLATE(ModalAnalysis,DataTypes), sofa::core::objectmodel::BaseObject);
+
+    typedef typename DataTypes::VecCoord VecCoord;
+    typedef typename DataTypes::VecDeriv VecDeriv;
+    typedef typename DataTypes::Deriv Deriv;
+    typedef typename DataTypes::Real Real;
+
+    static constexpr sofa::Size NbDofs = DataTypes::deriv_total_size;
+    typedef shell::misc::BlockSparseMatrix<NbDofs,Real> Matrix;
+    typedef shell::misc::BlockDiagonal<NbDofs,Real> NodeBlockDiagonal;
+    typedef typename Matrix::VecN VecN;
+    typedef typename Matrix::VecVecN VecVecN;
+
+protected:
+
+    ModalAnalysis();
+
+    virtual ~ModalAnalysis();
+
+public:
+
+    void init() override;
+    void bwdInit() override;
+
+    /// Compute the modes and write them into the file
+    bool computeModes();
+
+    const shell::misc::ModalBasis& getModalBasis() const { return m_basis; }
+
+    sofa::Data<unsigned int> d_nbModes;
+    sofa::Data<unsigned int> d_nbLanczosVectors;
+    sofa::Data<Real> d_shift;
+    sofa::Data<Real> d_tolerance;
+    sofa::Data<unsigned int> d_maxIterations;
+    sofa::Data<bool> d_computeDerivatives;
+    sofa::Data<Real> d_derivativeStep;
+    sofa::Data<bool> d_parallel;
+    sofa::core::objectmodel::DataFileName d_filename;
+    sofa::Data< sofa::type::vector<Real> > d_eigenvalues;
+    sofa::Data< sofa::type::vector<Real> > d_frequencies;
+
+protected:
+
+    sofa::core::behavior::MechanicalState<DataTypes>* m_state;
+    sofa::type::vector< sofa::core::behavior::ForceField<DataTypes>* > m_forceFields;
+    sofa::type::vector< sofa::core::behavior::ProjectiveConstraintSet<DataTypes>* > m_constraints;
+
+    /// K - shift*M with the constraints applied, and M
+    Matrix m_stiffness, m_mass;
+    NodeBlockDiagonal m_preconditioner;
+
+    shell::misc::ModalBasis m_basis;
+
+    /// Set the dofs fixed by the projective constraints to zero
+    void project(VecVecN &v);
+
+    /// Solve A x = b in the constrained space, P being the inverse of the
+    /// diagonal blocks of A, return the number of iterations
+    unsigned int solve(const Matrix &A, const NodeBlockDiagonal &P, const VecVecN &b, VecVecN &x);
+
+    /// Internal forces at the rest position displaced by u
+    void computeForce(const VecVecN &u, VecVecN &f);
+
+    void computeDerivatives();
+
+    Real dot(const VecVecN &a, const VecVecN &b) const;
+
+    /// Eigen decomposition of the symmetric m x m matrix A by cyclic Jacobi
+    /// rotations, the eigenvectors are the columns of V
+    static void symmetricEigen(sofa::type::vector<double> &A, std::size_t m,
+        sofa::type::vector<double> &values, sofa::type::vector<double> &V);
+};
+
+} // namespace
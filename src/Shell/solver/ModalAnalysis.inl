@@ -0,0 +1,508 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <Shell/solver/ModalAnalysis.h>
+#include <Shell/misc/NodeMatrixAssembly.h>
+
+#include <sofa/core/behavior/BaseMass.h>
+#include <sofa/core/MechanicalParams.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace shell::solver
+{
+
+template<class DataTypes>
+ModalAnalysis<DataTypes>::ModalAnalysis()
+: d_nbModes(initData(&d_nbModes, 10u, "nbModes", "Number of modes to compute"))
+, d_nbLanczosVectors(initData(&d_nbLanczosVectors, 0u, "nbLanczosVectors", "Size of the Lanczos basis, max(2*nbModes, nbModes+20) if 0"))
+, d_shift(initData(&d_shift, (Real)0, "shift", "Shift of the inverse iteration, negative for a free shell"))
+, d_tolerance(initData(&d_tolerance, (Real)1e-10, "tolerance", "Relative residual of the linear solves"))
+, d_maxIterations(initData(&d_maxIterations, 2000u, "maxIterations", "Maximum number of iterations of the linear solves"))
+, d_computeDerivatives(initData(&d_computeDerivatives, false, "computeDerivatives", "Also compute the modal derivatives"))
+, d_derivativeStep(initData(&d_derivativeStep, (Real)1e-3, "derivativeStep", "Step in modal coordinates of the finite differences of the forces"))
+, d_parallel(initData(&d_parallel, false, "parallel", "Compute the matrix products in parallel"))
+, d_filename(initData(&d_filename, "filename", "File the modes are written into"))
+, d_eigenvalues(initData(&d_eigenvalues, "eigenvalues", "Eigenvalues of the computed modes"))
+, d_frequencies(initData(&d_frequencies, "frequencies", "Frequencies of the computed modes (Hz)"))
+, m_state(nullptr)
+{
+    d_eigenvalues.setReadOnly(true);
+    d_frequencies.setReadOnly(true);
+}
+
+template<class DataTypes>
+ModalAnalysis<DataTypes>::~ModalAnalysis()
+{
+}
+
+template<class DataTypes>
+void ModalAnalysis<DataTypes>::init()
+{
+    Inherit1::init();
+
+    m_state = dynamic_cast< sofa::core::behavior::MechanicalState<DataTypes>* >(
+        this->getContext()->getMechanicalState());
+    if (!m_state)
+        msg_error() << "No mechanical state of type " << DataTypes::Name() << " found.";
+}
+
+template<class DataTypes>
+void ModalAnalysis<DataTypes>::bwdInit()
+{
+    if (!m_state)
+        return;
+
+    // The force fields are initialised by now
+    m_forceFields.clear();
+    sofa::type::vector< sofa::core::behavior::ForceField<DataTypes>* > forceFields;
+    this->getContext()->template get< sofa::core::behavior::ForceField<DataTypes> >(&forceFields, sofa::core::objectmodel::BaseContext::Local);
+    for (sofa::core::behavior::ForceField<DataTypes>* ff : forceFields)
+        if (ff->getMState() == m_state && !dynamic_cast<sofa::core::behavior::BaseMass*>(ff))
+            m_forceFields.push_back(ff);
+
+    m_constraints.clear();
+    sofa::type::vector< sofa::core::behavior::ProjectiveConstraintSet<DataTypes>* > constraints;
+    this->getContext()->template get< sofa::core::behavior::ProjectiveConstraintSet<DataTypes> >(&constraints, sofa::core::objectmodel::BaseContext::Local);
+    for (sofa::core::behavior::ProjectiveConstraintSet<DataTypes>* c : constraints)
+        if (c->getMState() == m_state)
+            m_constraints.push_back(c);
+
+    if (!computeModes())
+        return;
+
+    const std::string &filename = d_filename.getFullPath();
+    if (filename.empty())
+        return;
+
+    if (m_basis.write(filename))
+        msg_info() << m_basis.getNbModes() << " modes written in " << filename;
+    else
+        msg_error() << "Cannot write " << filename;
+}
+
+template<class DataTypes>
+bool ModalAnalysis<DataTypes>::computeModes()
+{
+    const std::size_t n = m_state->getSize();
+    const Real shift = d_shift.getValue();
+    const bool parallel = d_parallel.getValue();
+
+    // The force fields update their stiffness in addForce
+    VecVecN u(n), f;
+    computeForce(u, f);
+
+    sofa::core::MechanicalParams mparams;
+    mparams.setBFactor(0);
+
+    mparams.setMFactor(-shift);
+    mparams.setKFactor(-1);
+    shell::misc::assembleNodeMatrix(this->getContext(), m_state, &mparams, m_stiffness, true, false);
+
+    mparams.setMFactor(1);
+    mparams.setKFactor(0);
+    shell::misc::assembleNodeMatrix(this->getContext(), m_state, &mparams, m_mass, false, false);
+
+    m_preconditioner.resize(n);
+    for (std::size_t i=0; i<n; i++)
+        m_preconditioner[i] = m_stiffness.diagonalBlock(i);
+    m_preconditioner.invert(parallel);
+
+    const std::size_t nbModes = d_nbModes.getValue();
+    std::size_t m = d_nbLanczosVectors.getValue();
+    if (m == 0)
+        m = std::max(2*nbModes, nbModes+20);
+    m = std::min(m, NbDofs*n);
+
+    // Lanczos iteration on (K - shift*M)^-1 M, which is symmetric for the
+    // M scalar product. Q holds the M-orthonormal basis, MQ its product by M.
+    sofa::type::vector<VecVecN> Q, MQ;
+    sofa::type::vector<double> alpha, beta;
+    VecVecN r(n), Mr, w;
+
+    for (std::size_t i=0; i<n; i++)
+        for (sofa::Size k=0; k<NbDofs; k++)
+            r[i][k] = (Real)(1 + 0.5*std::sin((double)(NbDofs*i+k+1)));
+    project(r);
+    m_mass.mult(r, Mr, parallel);
+    double b = std::sqrt(std::max<double>(dot(r, Mr), 0));
+    if (b == 0)
+    {
+        msg_error() << "No free dof with a mass, no mode computed.";
+        return false;
+    }
+
+    unsigned int nbIterations = 0;
+    for (std::size_t j=0; j<m; j++)
+    {
+        for (std::size_t i=0; i<n; i++)
+        {
+            r[i] /= (Real)b;
+            Mr[i] /= (Real)b;
+        }
+        Q.push_back(r);
+        MQ.push_back(Mr);
+
+        nbIterations += solve(m_stiffness, m_preconditioner, MQ[j], w);
+        alpha.push_back(dot(w, MQ[j]));
+
+        for (std::size_t i=0; i<n; i++)
+            r[i] = w[i] - Q[j][i]*(Real)alpha[j] - (j > 0 ? Q[j-1][i]*(Real)beta[j-1] : VecN());
+
+        // Full reorthogonalisation, twice
+        for (unsigned int pass=0; pass<2; pass++)
+        {
+            for (std::size_t l=0; l<=j; l++)
+            {
+                const Real c = dot(r, MQ[l]);
+                for (std::size_t i=0; i<n; i++)
+                    r[i] -= Q[l][i]*c;
+            }
+        }
+
+        m_mass.mult(r, Mr, parallel);
+        b = std::sqrt(std::max<double>(dot(r, Mr), 0));
+        if (j+1 == m || b <= 1e-12*std::abs(alpha[j]))
+            break;
+        beta.push_back(b);
+    }
+
+    // Ritz values theta = 1/(lambda - shift) of the tridiagonal matrix
+    const std::size_t mm = alpha.size();
+    sofa::type::vector<double> T(mm*mm, 0), theta(mm), S;
+    for (std::size_t j=0; j<mm; j++)
+    {
+        T[j*mm+j] = alpha[j];
+        if (j+1 < mm)
+            T[j*mm+j+1] = T[(j+1)*mm+j] = beta[j];
+    }
+    symmetricEigen(T, mm, theta, S);
+
+    sofa::type::vector<std::size_t> order;
+    for (std::size_t l=0; l<mm; l++)
+        if (theta[l] > 0)
+            order.push_back(l);
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t c) { return theta[a] > theta[c]; });
+    if (order.size() > nbModes)
+        order.resize(nbModes);
+    if (order.size() < nbModes)
+        msg_warning() << "Only " << order.size() << " modes found out of " << nbModes << ".";
+
+    m_basis.resize((sofa::Size)order.size(), (sofa::Size)n, NbDofs);
+    sofa::type::vector<Real> &eigenvalues = *d_eigenvalues.beginEdit();
+    sofa::type::vector<Real> &frequencies = *d_frequencies.beginEdit();
+    eigenvalues.clear();
+    frequencies.clear();
+    double maxResidual = 0;
+    for (std::size_t e=0; e<order.size(); e++)
+    {
+        const std::size_t l = order[e];
+        const double lambda = shift + 1/theta[l];
+        m_basis.eigenvalue((sofa::Size)e) = lambda;
+        eigenvalues.push_back((Real)lambda);
+        frequencies.push_back((Real)(std::sqrt(std::max(lambda, 0.0)) / (2*3.14159265358979323846)));
+
+        // Mode = Q s, M-normalised since Q is M-orthonormal
+        shell::misc::ModalBasis::Vector &mode = m_basis.mode((sofa::Size)e);
+        for (std::size_t j=0; j<mm; j++)
+            for (std::size_t i=0; i<n; i++)
+                for (sofa::Size k=0; k<NbDofs; k++)
+                    mode[NbDofs*i+k] += S[j*mm+l] * Q[j][i][k];
+
+        // The residual of the Ritz pair is b * |last component of s|
+        maxResidual = std::max(maxResidual, b*std::abs(S[(mm-1)*mm+l]) / theta[l]);
+    }
+    d_eigenvalues.endEdit();
+    d_frequencies.endEdit();
+
+    msg_info() << order.size() << " modes from " << mm << " Lanczos vectors (" << nbIterations
+        << " solver iterations), largest relative residual " << maxResidual << ".";
+
+    if (d_computeDerivatives.getValue() && !order.empty())
+        computeDerivatives();
+
+    return !order.empty();
+}
+
+template<class DataTypes>
+void ModalAnalysis<DataTypes>::computeDerivatives()
+{
+    const std::size_t n = m_state->getSize();
+    const sofa::Size nbModes = m_basis.getNbModes();
+    const Real h = d_derivativeStep.getValue();
+    const Real shift = d_shift.getValue();
+
+    // The derivatives are the static response to the second order forces,
+    // solved with K itself and not K - shift*M
+    Matrix stiffness;
+    NodeBlockDiagonal preconditioner;
+    if (shift != 0)
+    {
+        VecVecN u(n), f;
+        computeForce(u, f);
+
+        sofa::core::MechanicalParams mparams;
+        mparams.setBFactor(0);
+        mparams.setMFactor(0);
+        mparams.setKFactor(-1);
+        shell::misc::assembleNodeMatrix(this->getContext(), m_state, &mparams, stiffness, true, false);
+
+        preconditioner.resize(n);
+        for (std::size_t i=0; i<n; i++)
+            preconditioner[i] = stiffness.diagonalBlock(i);
+        preconditioner.invert(d_parallel.getValue());
+    }
+    const Matrix &K = (shift != 0) ? stiffness : m_stiffness;
+    const NodeBlockDiagonal &P = (shift != 0) ? preconditioner : m_preconditioner;
+
+    sofa::type::vector<VecVecN> modes(nbModes, VecVecN(n));
+    for (sofa::Size j=0; j<nbModes; j++)
+        for (std::size_t i=0; i<n; i++)
+            for (sofa::Size k=0; k<NbDofs; k++)
+                modes[j][i][k] = (Real)m_basis.mode(j)[NbDofs*i+k];
+
+    // Forces at 0, h*phi_i and h*(phi_i+phi_j)
+    VecVecN u(n), f0, fij, g(n), psi;
+    computeForce(u, f0);
+
+    sofa::type::vector<VecVecN> fi(nbModes);
+    for (sofa::Size i=0; i<nbModes; i++)
+    {
+        for (std::size_t v=0; v<n; v++)
+            u[v] = modes[i][v] * h;
+        computeForce(u, fi[i]);
+    }
+
+    m_basis.initDerivatives();
+    unsigned int nbIterations = 0;
+    for (sofa::Size j=0; j<nbModes; j++)
+    {
+        for (sofa::Size i=0; i<=j; i++)
+        {
+            for (std::size_t v=0; v<n; v++)
+                u[v] = (modes[i][v] + modes[j][v]) * h;
+            computeForce(u, fij);
+
+            for (std::size_t v=0; v<n; v++)
+                g[v] = (fij[v] - fi[i][v] - fi[j][v] + f0[v]) / (h*h);
+            project(g);
+            nbIterations += solve(K, P, g, psi);
+
+            shell::misc::ModalBasis::Vector &d = m_basis.derivative(i, j);
+            for (std::size_t v=0; v<n; v++)
+                for (sofa::Size k=0; k<NbDofs; k++)
+                    d[NbDofs*v+k] = psi[v][k];
+        }
+    }
+
+    // Leave the force fields in the rest state
+    u.assign(n, VecN());
+    computeForce(u, f0);
+
+    msg_info() << m_basis.getNbDerivatives() << " modal derivatives computed (" << nbIterations << " solver iterations).";
+}
+
+template<class DataTypes>
+void ModalAnalysis<DataTypes>::project(VecVecN &v)
+{
+    if (m_constraints.empty())
+        return;
+
+    sofa::core::objectmodel::Data<VecDeriv> data;
+    VecDeriv &dx = *data.beginEdit();
+    dx.resize(v.size());
+    for (std::size_t i=0; i<v.size(); i++)
+        for (sofa::Size k=0; k<NbDofs; k++)
+            dx[i][k] = v[i][k];
+    data.endEdit();
+
+    for (sofa::core::behavior::ProjectiveConstraintSet<DataTypes>* c : m_constraints)
+        c->projectResponse(sofa::core::MechanicalParams::defaultInstance(), data);
+
+    const VecDeriv &projected = data.getValue();
+    for (std::size_t i=0; i<v.size(); i++)
+        for (sofa::Size k=0; k<NbDofs; k++)
+            v[i][k] = projected[i][k];
+}
+
+template<class DataTypes>
+unsigned int ModalAnalysis<DataTypes>::solve(const Matrix &A, const NodeBlockDiagonal &P, const VecVecN &b, VecVecN &x)
+{
+    const std::size_t n = b.size();
+    const bool parallel = d_parallel.getValue();
+
+    // Preconditioned conjugate gradient, projected on the free dofs
+    x.assign(n, VecN());
+    VecVecN r = b, z(n), p, Ap;
+    project(r);
+    const Real bNorm2 = dot(r, r);
+    if (bNorm2 == 0)
+        return 0;
+
+    for (std::size_t i=0; i<n; i++)
+        z[i] = P[i] * r[i];
+    project(z);
+    p = z;
+    Real rz = dot(r, z);
+
+    const Real tolerance2 = d_tolerance.getValue()*d_tolerance.getValue();
+    unsigned int it = 0;
+    while (it < d_maxIterations.getValue())
+    {
+        it++;
+        A.mult(p, Ap, parallel);
+        project(Ap);
+
+        const Real pAp = dot(p, Ap);
+        if (pAp <= 0)
+        {
+            msg_warning() << "Matrix not positive definite on the free dofs, a free shell needs a negative shift.";
+            break;
+        }
+
+        const Real a = rz / pAp;
+        for (std::size_t i=0; i<n; i++)
+        {
+            x[i] += p[i] * a;
+            r[i] -= Ap[i] * a;
+        }
+        if (dot(r, r) <= tolerance2 * bNorm2)
+            break;
+
+        for (std::size_t i=0; i<n; i++)
+            z[i] = P[i] * r[i];
+        project(z);
+
+        const Real rzNew = dot(r, z);
+        const Real beta = rzNew / rz;
+        rz = rzNew;
+        for (std::size_t i=0; i<n; i++)
+            p[i] = z[i] + p[i] * beta;
+    }
+
+    return it;
+}
+
+template<class DataTypes>
+void ModalAnalysis<DataTypes>::computeForce(const VecVecN &u, VecVecN &f)
+{
+    const VecCoord &x0 = m_state->read(sofa::core::vec_id::read_access::position)->getValue();
+    const std::size_t n = x0.size();
+
+    sofa::core::objectmodel::Data<VecCoord> xData;
+    sofa::core::objectmodel::Data<VecDeriv> vData, fData;
+
+    VecCoord &x = *xData.beginEdit();
+    x.resize(n);
+    for (std::size_t i=0; i<n; i++)
+    {
+        Deriv d;
+        for (sofa::Size k=0; k<NbDofs; k++)
+            d[k] = u[i][k];
+        x[i] = x0[i] + d;
+    }
+    xData.endEdit();
+    vData.setValue(VecDeriv(n, Deriv()));
+    fData.setValue(VecDeriv(n, Deriv()));
+
+    for (sofa::core::behavior::ForceField<DataTypes>* ff : m_forceFields)
+        ff->addForce(sofa::core::MechanicalParams::defaultInstance(), fData, xData, vData);
+
+    const VecDeriv &forces = fData.getValue();
+    f.resize(n);
+    for (std::size_t i=0; i<n; i++)
+        for (sofa::Size k=0; k<NbDofs; k++)
+            f[i][k] = forces[i][k];
+}
+
+template<class DataTypes>
+typename ModalAnalysis<DataTypes>::Real ModalAnalysis<DataTypes>::dot(const VecVecN &a, const VecVecN &b) const
+{
+    double sum = 0;
+    for (std::size_t i=0; i<a.size(); i++)
+        sum += a[i] * b[i];
+    return (Real)sum;
+}
+
+template<class DataTypes>
+void ModalAnalysis<DataTypes>::symmetricEigen(sofa::type::vector<double> &A, std::size_t m,
+    sofa::type::vector<double> &values, sofa::type::vector<double> &V)
+{
+    V.assign(m*m, 0);
+    for (std::size_t i=0; i<m; i++)
+        V[i*m+i] = 1;
+
+    for (unsigned int sweep=0; sweep<100; sweep++)
+    {
+        double off = 0, diag = 0;
+        for (std::size_t p=0; p<m; p++)
+        {
+            diag += A[p*m+p]*A[p*m+p];
+            for (std::size_t q=p+1; q<m; q++)
+                off += A[p*m+q]*A[p*m+q];
+        }
+        if (off <= 1e-30*diag)
+            break;
+
+        for (std::size_t p=0; p<m; p++)
+        {
+            for (std::size_t q=p+1; q<m; q++)
+            {
+                const double apq = A[p*m+q];
+                if (apq == 0)
+                    continue;
+
+                // Rotation in the (p,q) plane zeroing A(p,q)
+                const double h = (A[q*m+q]-A[p*m+p]) / (2*apq);
+                const double t = (h >= 0 ? 1.0 : -1.0) / (std::abs(h) + std::sqrt(h*h+1));
+                const double c = 1/std::sqrt(t*t+1), s = t*c;
+
+                for (std::size_t k=0; k<m; k++)
+                {
+                    const double akp = A[k*m+p], akq = A[k*m+q];
+                    A[k*m+p] = c*akp - s*akq;
+                    A[k*m+q] = s*akp + c*akq;
+                }
+                for (std::size_t k=0; k<m; k++)
+                {
+                    const double apk = A[p*m+k], aqk = A[q*m+k];
+                    A[p*m+k] = c*apk - s*aqk;
+                    A[q*m+k] = s*apk + c*aqk;
+                }
+                for (std::size_t k=0; k<m; k++)
+                {
+                    const double vkp = V[k*m+p], vkq = V[k*m+q];
+                    V[k*m+p] = c*vkp - s*vkq;
+                    V[k*m+q] = s*vkp + c*vkq;
+                }
+            }
+        }
+    }
+
+    values.resize(m);
+    for (std::size_t i=0; i<m; i++)
+        values[i] = A[i*m+i];
+}
+
+} // namespace
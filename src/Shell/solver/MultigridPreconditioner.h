@@ -0,0 +1,136 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/core/behavior/LinearSolver.h>
+#include <sofa/core/behavior/MechanicalState.h>
+#include <sofa/core/MultiVecId.h>
+#include <sofa/core/topology/BaseMeshTopology.h>
+#include <sofa/defaulttype/RigidTypes.h>
+#include <sofa/defaulttype/VecTypes.h>
+
+#include <Shell/config.h>
+#include <Shell/misc/BlockDiagonal.h>
+#include <Shell/misc/BlockSparseMatrix.h>
+#include <Shell/misc/SubdivisionHierarchy.h>
+
+namespace shell::solver
+{
+
+/**
+ * @brief Geometric multigrid preconditioner for meshes obtained by
+ * subdividing a coarse mesh, e.g. the mesh written by the refinement of
+ * TriangularBendingFEMForceField.
+ *
+ * The simulated mesh must be the finest level of the hierarchy built from
+ * the coarse topology with nbLevels 1-to-4 subdivisions, with its vertices
+ * in the same order (the coarse vertices first, then the middle of the edges
+ * of each level). Its system matrix M*mFactor + B*bFactor + K*kFactor is
+ * assembled from the mass and force fields of the context and the projective
+ * constraints are applied to it. The coarse operators are the Galerkin
+ * products P^T A P, where the prolongation P averages the ends of the
+ * subdivided edges.
+ *
+ * solveSystem() applies one V-cycle with damped block-Jacobi smoothing,
+ * solving the coarsest level directly when it is small enough. It is meant
+ * to be linked as the preconditioner of a conjugate gradient solver.
+ */
+template<class DataTypes>
+class MultigridPreconditioner : public sofa::core::behavior::LinearSolver
+{
+public:
+    SOFA_CLASS(SOFA_TEMPLATE(MultigridPreconditioner,DataTypes), sofa::core::behavior::LinearSolver);
+
+    typedef typename DataTypes::VecDeriv VecDeriv;
+    typedef typename DataTypes::Deriv Deriv;
+    typedef typename DataTypes::Real Real;
+
+    static constexpr sofa::Size NbDofs = DataTypes::deriv_total_size;
+    typedef shell::misc::BlockDiagonal<NbDofs,Real> NodeBlockDiagonal;
+    typedef shell::misc::BlockSparseMatrix<NbDofs,Real> Matrix;
+    typedef typename Matrix::VecN VecN;
+    typedef typename Matrix::VecVecN VecVecN;
+
+protected:
+
+    MultigridPreconditioner();
+
+    virtual ~MultigridPreconditioner();
+
+public:
+
+    void init() override;
+
+    void resetSystem() override;
+    void setSystemMBKMatrix(const sofa::core::MechanicalParams* mparams) override;
+    void setSystemRHVector(sofa::core::MultiVecDerivId v) override;
+    void setSystemLHVector(sofa::core::MultiVecDerivId v) override;
+    void solveSystem() override;
+
+    const shell::misc::SubdivisionHierarchy& getHierarchy() const { return m_hierarchy; }
+
+    sofa::Data<unsigned int> d_nbLevels;
+    sofa::Data<unsigned int> d_nbSmoothingSteps;
+    sofa::Data<Real> d_smootherDamping;
+    sofa::Data<unsigned int> d_nbCoarseIterations;
+    sofa::Data<unsigned int> d_coarseDirectSize;
+    sofa::Data<bool> d_parallel;
+    sofa::Data< sofa::type::vector<unsigned int> > d_levelSizes;
+
+    sofa::SingleLink<MultigridPreconditioner<DataTypes>,
+        sofa::core::topology::BaseMeshTopology,
+        sofa::BaseLink::FLAG_STOREPATH|sofa::BaseLink::FLAG_STRONGLINK> l_coarseTopology;
+
+protected:
+
+    sofa::core::behavior::MechanicalState<DataTypes>* m_state;
+
+    shell::misc::SubdivisionHierarchy m_hierarchy;
+
+    /// Operator, inverse diagonal blocks and work vectors of each level,
+    /// the last one being the simulated mesh
+    sofa::type::vector<Matrix> m_operators;
+    sofa::type::vector<NodeBlockDiagonal> m_smoothers;
+    sofa::type::vector<VecVecN> m_rhsLevels, m_lhsLevels, m_residuals;
+
+    /// LU factors of the coarsest operator if it is solved directly
+    sofa::type::vector<Real> m_coarseLU;
+    sofa::type::vector<sofa::Index> m_coarsePivots;
+    bool m_coarseDirect;
+
+    sofa::core::MultiVecDerivId m_rhs, m_lhs;
+
+    /// Set the operator of level l-1 to P^T A P, A being the one of level l
+    void computeGalerkinOperator(std::size_t l);
+
+    /// Factorize the coarsest operator, return false if it is singular
+    bool factorizeCoarseOperator();
+
+    /// x += omega D^-1 (b - A x)
+    void smooth(std::size_t l, unsigned int nbSteps);
+
+    void solveCoarse();
+
+    void vCycle(std::size_t l);
+};
+
+} // namespace
@@ -0,0 +1,346 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <Shell/solver/MultigridPreconditioner.h>
+#include <Shell/misc/NodeMatrixAssembly.h>
+
+#include <sofa/core/MechanicalParams.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace shell::solver
+{
+
+template<class DataTypes>
+MultigridPreconditioner<DataTypes>::MultigridPreconditioner()
+: d_nbLevels(initData(&d_nbLevels, 1u, "nbLevels", "Number of 1-to-4 subdivisions from the coarse topology to the simulated mesh"))
+, d_nbSmoothingSteps(initData(&d_nbSmoothingSteps, 2u, "smoothingSteps", "Number of block-Jacobi steps before and after the coarse correction"))
+, d_smootherDamping(initData(&d_smootherDamping, (Real)(2.0/3.0), "smootherDamping", "Damping of the block-Jacobi steps"))
+, d_nbCoarseIterations(initData(&d_nbCoarseIterations, 20u, "coarseIterations", "Number of block-Jacobi steps on the coarsest level when it is not solved directly"))
+, d_coarseDirectSize(initData(&d_coarseDirectSize, 3000u, "coarseDirectSize", "Largest number of dofs of the coarsest level for which it is factorized"))
+, d_parallel(initData(&d_parallel, false, "parallel", "Compute the residuals and the smoothing steps in parallel"))
+, d_levelSizes(initData(&d_levelSizes, "levelSizes", "Number of nodes of each level, from the coarsest"))
+, l_coarseTopology(initLink("coarseTopology", "Topology the simulated mesh was subdivided from"))
+, m_state(nullptr)
+, m_coarseDirect(false)
+{
+    d_levelSizes.setReadOnly(true);
+}
+
+template<class DataTypes>
+MultigridPreconditioner<DataTypes>::~MultigridPreconditioner()
+{
+}
+
+template<class DataTypes>
+void MultigridPreconditioner<DataTypes>::init()
+{
+    Inherit1::init();
+
+    m_state = dynamic_cast< sofa::core::behavior::MechanicalState<DataTypes>* >(
+        this->getContext()->getMechanicalState());
+    if (!m_state)
+    {
+        msg_error() << "No mechanical state of type " << DataTypes::Name() << " found.";
+        return;
+    }
+
+    m_hierarchy.clear();
+    if (l_coarseTopology)
+    {
+        m_hierarchy.build((sofa::Size)l_coarseTopology->getNbPoints(), l_coarseTopology->getTriangles(), d_nbLevels.getValue());
+
+        const shell::misc::SubdivisionHierarchy::Level &finest = m_hierarchy.getFinestLevel();
+        sofa::core::topology::BaseMeshTopology* topology = this->getContext()->getMeshTopology();
+        if (finest.nbVertices != m_state->getSize())
+        {
+            msg_error() << "Subdividing the coarse topology " << d_nbLevels.getValue() << " times gives "
+                << finest.nbVertices << " nodes instead of " << m_state->getSize() << ", multigrid disabled.";
+            m_hierarchy.clear();
+        }
+        else if (topology && topology->getNbTriangles() != finest.triangles.size())
+        {
+            msg_warning() << "The simulated mesh has " << topology->getNbTriangles() << " triangles, "
+                << finest.triangles.size() << " expected from the coarse topology.";
+        }
+    }
+    else
+    {
+        msg_warning() << "No coarse topology, the simulated mesh is used as the only level.";
+    }
+
+    if (m_hierarchy.getNbLevels() == 0)
+        m_hierarchy.build(m_state->getSize(), shell::misc::SubdivisionHierarchy::SeqTriangles(), 0);
+
+    const std::size_t nbLevels = m_hierarchy.getNbLevels();
+    sofa::type::vector<unsigned int> &sizes = *d_levelSizes.beginEdit();
+    sizes.clear();
+    for (std::size_t l=0; l<nbLevels; l++)
+        sizes.push_back((unsigned int)m_hierarchy.getLevel(l).nbVertices);
+    d_levelSizes.endEdit();
+
+    m_operators.resize(nbLevels);
+    m_smoothers.resize(nbLevels);
+    m_rhsLevels.resize(nbLevels);
+    m_lhsLevels.resize(nbLevels);
+    m_residuals.resize(nbLevels);
+}
+
+template<class DataTypes>
+void MultigridPreconditioner<DataTypes>::resetSystem()
+{
+}
+
+template<class DataTypes>
+void MultigridPreconditioner<DataTypes>::setSystemMBKMatrix(const sofa::core::MechanicalParams* mparams)
+{
+    if (!m_state || m_operators.empty())
+        return;
+
+    shell::misc::assembleNodeMatrix(this->getContext(), m_state, mparams, m_operators.back(), true, true);
+    for (std::size_t l=m_operators.size()-1; l>0; l--)
+        computeGalerkinOperator(l);
+
+    for (std::size_t l=0; l<m_operators.size(); l++)
+    {
+        const Matrix &A = m_operators[l];
+        NodeBlockDiagonal &D = m_smoothers[l];
+        D.resize(A.nbBlockRows());
+        for (std::size_t i=0; i<A.nbBlockRows(); i++)
+            D[i] = A.diagonalBlock(i);
+        D.invert(d_parallel.getValue());
+    }
+
+    m_coarseDirect = NbDofs*m_operators[0].nbBlockRows() <= d_coarseDirectSize.getValue();
+    if (m_coarseDirect && !factorizeCoarseOperator())
+    {
+        msg_warning() << "Singular coarsest operator, it is smoothed instead.";
+        m_coarseDirect = false;
+    }
+}
+
+template<class DataTypes>
+void MultigridPreconditioner<DataTypes>::computeGalerkinOperator(std::size_t l)
+{
+    typedef typename Matrix::Index Index;
+
+    const Matrix &fine = m_operators[l];
+    Matrix &coarse = m_operators[l-1];
+    coarse.resizeBlocks(m_hierarchy.getLevel(l-1).nbVertices);
+
+    // Each fine block (i,j) goes to the blocks (p,q) of the parents of i and
+    // j, weighted by the product of the prolongation weights
+    for (std::size_t i=0; i<fine.nbBlockRows(); i++)
+    {
+        for (Index k=fine.rowBegin(i); k<fine.rowBegin(i+1); k++)
+        {
+            const typename Matrix::Block &B = fine.block(k);
+            m_hierarchy.forEachParent(l, (sofa::Index)i, [&](sofa::Index p, double wp) {
+                m_hierarchy.forEachParent(l, (sofa::Index)fine.column(k), [&](sofa::Index q, double wq) {
+                    coarse.addBlock((Index)p, (Index)q, B * (Real)(wp*wq));
+                });
+            });
+        }
+    }
+
+    coarse.compress();
+}
+
+template<class DataTypes>
+bool MultigridPreconditioner<DataTypes>::factorizeCoarseOperator()
+{
+    typedef typename Matrix::Index Index;
+
+    const Matrix &A = m_operators[0];
+    const std::size_t n = NbDofs*A.nbBlockRows();
+
+    m_coarseLU.assign(n*n, 0);
+    for (std::size_t i=0; i<A.nbBlockRows(); i++)
+        for (Index k=A.rowBegin(i); k<A.rowBegin(i+1); k++)
+            for (sofa::Size r=0; r<NbDofs; r++)
+                for (sofa::Size c=0; c<NbDofs; c++)
+                    m_coarseLU[(NbDofs*i+r)*n + NbDofs*A.column(k)+c] = A.block(k)[r][c];
+
+    // LU decomposition with partial pivoting, the rows are swapped in place
+    m_coarsePivots.resize(n);
+    for (std::size_t k=0; k<n; k++)
+    {
+        std::size_t p = k;
+        for (std::size_t r=k+1; r<n; r++)
+            if (std::abs(m_coarseLU[r*n+k]) > std::abs(m_coarseLU[p*n+k]))
+                p = r;
+        if (m_coarseLU[p*n+k] == 0)
+            return false;
+
+        m_coarsePivots[k] = (sofa::Index)p;
+        if (p != k)
+            std::swap_ranges(m_coarseLU.begin()+k*n, m_coarseLU.begin()+(k+1)*n, m_coarseLU.begin()+p*n);
+
+        const Real pivot = m_coarseLU[k*n+k];
+        shell::misc::parallelForRange(d_parallel.getValue(), k+1, n, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t r=begin; r<end; r++) {
+                const Real f = (m_coarseLU[r*n+k] /= pivot);
+                if (f != 0)
+                    for (std::size_t c=k+1; c<n; c++)
+                        m_coarseLU[r*n+c] -= f * m_coarseLU[k*n+c];
+            }
+        });
+    }
+
+    return true;
+}
+
+template<class DataTypes>
+void MultigridPreconditioner<DataTypes>::smooth(std::size_t l, unsigned int nbSteps)
+{
+    const Matrix &A = m_operators[l];
+    const NodeBlockDiagonal &D = m_smoothers[l];
+    const VecVecN &b = m_rhsLevels[l];
+    VecVecN &x = m_lhsLevels[l];
+    VecVecN &r = m_residuals[l];
+    const Real omega = d_smootherDamping.getValue();
+
+    for (unsigned int s=0; s<nbSteps; s++)
+    {
+        A.residual(b, x, r, d_parallel.getValue());
+        shell::misc::parallelForRange(d_parallel.getValue(), std::size_t(0), x.size(), [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i=begin; i<end; i++)
+                x[i] += (D[i] * r[i]) * omega;
+        });
+    }
+}
+
+template<class DataTypes>
+void MultigridPreconditioner<DataTypes>::solveCoarse()
+{
+    VecVecN &x = m_lhsLevels[0];
+    x.assign(m_rhsLevels[0].size(), VecN());
+
+    if (!m_coarseDirect)
+    {
+        smooth(0, d_nbCoarseIterations.getValue());
+        return;
+    }
+
+    const std::size_t n = NbDofs*x.size();
+    sofa::type::vector<Real> y(n);
+    for (std::size_t i=0; i<x.size(); i++)
+        for (sofa::Size k=0; k<NbDofs; k++)
+            y[NbDofs*i+k] = m_rhsLevels[0][i][k];
+
+    for (std::size_t k=0; k<n; k++)
+        std::swap(y[k], y[m_coarsePivots[k]]);
+
+    for (std::size_t k=0; k<n; k++)
+        for (std::size_t r=k+1; r<n; r++)
+            y[r] -= m_coarseLU[r*n+k] * y[k];
+
+    for (std::size_t k=n; k-- > 0; )
+    {
+        Real sum = y[k];
+        for (std::size_t c=k+1; c<n; c++)
+            sum -= m_coarseLU[k*n+c] * y[c];
+        y[k] = sum / m_coarseLU[k*n+k];
+    }
+
+    for (std::size_t i=0; i<x.size(); i++)
+        for (sofa::Size k=0; k<NbDofs; k++)
+            x[i][k] = y[NbDofs*i+k];
+}
+
+template<class DataTypes>
+void MultigridPreconditioner<DataTypes>::vCycle(std::size_t l)
+{
+    if (l == 0)
+    {
+        solveCoarse();
+        return;
+    }
+
+    const unsigned int nbSteps = d_nbSmoothingSteps.getValue();
+    VecVecN &x = m_lhsLevels[l];
+    VecVecN &r = m_residuals[l];
+    x.assign(m_rhsLevels[l].size(), VecN());
+
+    smooth(l, nbSteps);
+
+    // Coarse grid correction
+    m_operators[l].residual(m_rhsLevels[l], x, r, d_parallel.getValue());
+    m_hierarchy.restrict(l, r, m_rhsLevels[l-1]);
+    vCycle(l-1);
+    m_hierarchy.prolongate(l, m_lhsLevels[l-1], r);
+    for (std::size_t i=0; i<x.size(); i++)
+        x[i] += r[i];
+
+    smooth(l, nbSteps);
+}
+
+template<class DataTypes>
+void MultigridPreconditioner<DataTypes>::setSystemRHVector(sofa::core::MultiVecDerivId v)
+{
+    m_rhs = v;
+}
+
+template<class DataTypes>
+void MultigridPreconditioner<DataTypes>::setSystemLHVector(sofa::core::MultiVecDerivId v)
+{
+    m_lhs = v;
+}
+
+template<class DataTypes>
+void MultigridPreconditioner<DataTypes>::solveSystem()
+{
+    if (!m_state || m_operators.empty())
+        return;
+
+    const VecDeriv& b = m_state->read(sofa::core::ConstVecDerivId(m_rhs.getId(m_state)))->getValue();
+    VecDeriv& x = *m_state->write(sofa::core::VecDerivId(m_lhs.getId(m_state)))->beginEdit();
+
+    const std::size_t finest = m_operators.size()-1;
+    const std::size_t n = m_operators[finest].nbBlockRows();
+    if (b.size() != n)
+    {
+        // The system was not assembled for this state, leave it unpreconditioned
+        x = b;
+        m_state->write(sofa::core::VecDerivId(m_lhs.getId(m_state)))->endEdit();
+        return;
+    }
+
+    VecVecN &rhs = m_rhsLevels[finest];
+    rhs.resize(n);
+    for (std::size_t i=0; i<n; i++)
+        for (sofa::Size k=0; k<NbDofs; k++)
+            rhs[i][k] = b[i][k];
+
+    vCycle(finest);
+
+    x.resize(n);
+    for (std::size_t i=0; i<n; i++)
+        for (sofa::Size k=0; k<NbDofs; k++)
+            x[i][k] = m_lhsLevels[finest][i][k];
+
+    m_state->write(sofa::core::VecDerivId(m_lhs.getId(m_state)))->endEdit();
+}
+
+} // namespace
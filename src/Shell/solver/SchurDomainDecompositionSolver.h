@@ -0,0 +1,155 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <sofa/core/behavior/LinearSolver.h>
+#include <sofa/core/behavior/MechanicalState.h>
+#include <sofa/core/MultiVecId.h>
+#include <sofa/core/topology/BaseMeshTopology.h>
+#include <sofa/defaulttype/RigidTypes.h>
+#include <sofa/defaulttype/VecTypes.h>
+
+#include <Shell/config.h>
+#include <Shell/misc/BandedLU.h>
+#include <Shell/misc/BlockDiagonal.h>
+#include <Shell/misc/BlockSparseMatrix.h>
+
+namespace shell::solver
+{
+
+/**
+ * @brief Linear solver splitting a shell mesh into subdomains solved in
+ * parallel, coupled through a Schur complement on their interface.
+ *
+ * The triangles of the topology are split into nbPartitions parts by
+ * recursive graph bisection. The nodes shared by several parts (or coupled
+ * by the matrix to another part) form the interface, the others are
+ * interior to one subdomain. The system M*mFactor + B*bFactor + K*kFactor
+ * is assembled from the components of the node and each subdomain matrix,
+ * ordered by reverse Cuthill-McKee, gets a banded LU factorisation.
+ *
+ * The interface system S x = g, S = A_GG - sum_p A_Gp A_pp^-1 A_pG, is
+ * solved by a conjugate gradient preconditioned with the diagonal blocks of
+ * A_GG, the products by S being computed in parallel over the subdomains
+ * without forming S. The interior unknowns are then recovered in parallel.
+ */
+template<class DataTypes>
+class SchurDomainDecompositionSolver : public sofa::core::behavior::LinearSolver
+{
+public:
+    SOFA_CLASS(SOFA_TEMPLATE(SchurDomainDecompositionSolver,DataTypes), sofa::core::behavior::LinearSolver);
+
+    typedef typename DataTypes::Deriv Deriv;
+    typedef typename DataTypes::VecDeriv VecDeriv;
+    typedef typename DataTypes::Real Real;
+
+    static constexpr sofa::Size NbDofs = DataTypes::deriv_total_size;
+    typedef shell::misc::BlockSparseMatrix<NbDofs,Real> Matrix;
+    typedef typename Matrix::Index Index;
+    typedef typename Matrix::Block Block;
+    typedef typename Matrix::VecN VecN;
+    typedef typename Matrix::VecVecN VecVecN;
+    typedef shell::misc::BlockDiagonal<NbDofs,Real> NodeBlockDiagonal;
+
+protected:
+
+    SchurDomainDecompositionSolver();
+
+    virtual ~SchurDomainDecompositionSolver();
+
+public:
+
+    void init() override;
+
+    void resetSystem() override;
+    void setSystemMBKMatrix(const sofa::core::MechanicalParams* mparams) override;
+    void setSystemRHVector(sofa::core::MultiVecDerivId v) override;
+    void setSystemLHVector(sofa::core::MultiVecDerivId v) override;
+    void solveSystem() override;
+
+    sofa::Data<unsigned int> d_nbPartitions;
+    sofa::Data<Real> d_tolerance;
+    sofa::Data<unsigned int> d_maxIterations;
+    sofa::Data<bool> d_parallel;
+    sofa::Data<unsigned int> d_interfaceSize;
+    sofa::Data<unsigned int> d_nbIterations;
+
+protected:
+
+    /// Block coupling an interior node of a subdomain with an interface node
+    struct Coupling
+    {
+        std::size_t interior;   ///< Local index of the interior node
+        std::size_t interface;  ///< Index of the node in the subdomain interface
+        Block toInterface;      ///< Block (interior, interface) of A_pG
+        Block fromInterface;    ///< Block (interface, interior) of A_Gp
+    };
+
+    struct Subdomain
+    {
+        /// Interior nodes in their factorisation order
+        sofa::type::vector<sofa::Index> nodes;
+        /// Interface nodes coupled to the subdomain, as indices in m_interface
+        sofa::type::vector<std::size_t> interface;
+        sofa::type::vector<Coupling> couplings;
+        shell::misc::BandedLU<Real> lu;
+
+        /// Work vectors: interior unknowns and contribution to the interface
+        sofa::type::vector<Real> x;
+        VecVecN y;
+    };
+
+    sofa::core::behavior::MechanicalState<DataTypes>* m_state;
+    sofa::core::topology::BaseMeshTopology* m_topology;
+
+    Matrix m_matrix;
+
+    /// Part of each triangle and of each node, nbPartitions for the interface
+    sofa::type::vector<unsigned int> m_triangleParts;
+    sofa::type::vector<unsigned int> m_nodeParts;
+    /// Index of each node in its subdomain or in the interface
+    sofa::type::vector<std::size_t> m_localIndex;
+
+    sofa::type::vector<Subdomain> m_subdomains;
+    sofa::type::vector<sofa::Index> m_interface;
+    Matrix m_interfaceMatrix;
+    NodeBlockDiagonal m_interfacePreconditioner;
+
+    bool m_factorized;
+    bool m_warnedUnsolved;  ///< The warning about skipped solves was shown
+
+    sofa::core::MultiVecDerivId m_rhs, m_lhs;
+
+    void computePartition();
+    void classifyNodes();
+    bool factorizeSubdomain(Subdomain &s);
+    void buildInterfaceMatrix();
+
+    /// out = S v on the interface
+    void applySchurComplement(const VecVecN &v, VecVecN &out);
+
+    /// Solve the interior system of s with right-hand side b - A_pG xG,
+    /// the interior solution is left in s.x
+    void solveInterior(Subdomain &s, const VecDeriv &b, const VecVecN *xG);
+};
+
+} // namespace
@@ -0,0 +1,490 @@
+/******************************************************************************
+*                 SOFA, Simulation Open-Framework Architecture                *
+*                    (c) 2006 INRIA, USTL, UJF, CNRS, MGH                     *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <Shell/solver/SchurDomainDecompositionSolver.h>
+#include <Shell/misc/GraphPartition.h>
+#include <Shell/misc/ReverseCuthillMcKee.h>
+#include <Shell/misc/NodeMatrixAssembly.h>
+#include <Shell/misc/ParallelFor.h>
+
+#include <sofa/core/MechanicalParams.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+
+namespace shell::solver
+{
+
+template<class DataTypes>
+SchurDomainDecompositionSolver<DataTypes>::SchurDomainDecompositionSolver()
+: d_nbPartitions(initData(&d_nbPartitions, 8u, "nbPartitions", "Number of subdomains"))
+, d_tolerance(initData(&d_tolerance, (Real)1e-10, "tolerance", "Relative residual of the interface iteration"))
+, d_maxIterations(initData(&d_maxIterations, 500u, "maxIterations", "Maximum number of interface iterations"))
+, d_parallel(initData(&d_parallel, true, "parallel", "Factorise and solve the subdomains in parallel"))
+, d_interfaceSize(initData(&d_interfaceSize, 0u, "interfaceSize", "Number of interface nodes"))
+, d_nbIterations(initData(&d_nbIterations, 0u, "nbIterations", "Number of interface iterations of the last solve"))
+, m_state(nullptr)
+, m_topology(nullptr)
+, m_factorized(false)
+, m_warnedUnsolved(false)
+{
+    d_interfaceSize.setReadOnly(true);
+    d_nbIterations.setReadOnly(true);
+}
+
+template<class DataTypes>
+SchurDomainDecompositionSolver<DataTypes>::~SchurDomainDecompositionSolver()
+{
+}
+
+template<class DataTypes>
+void SchurDomainDecompositionSolver<DataTypes>::init()
+{
+    Inherit1::init();
+
+    m_state = dynamic_cast< sofa::core::behavior::MechanicalState<DataTypes>* >(
+        this->getContext()->getMechanicalState());
+    if (!m_state)
+        msg_error() << "No mechanical state of type " << DataTypes::Name() << " found.";
+
+    m_topology = this->getContext()->getMeshTopology();
+    if (!m_topology || m_topology->getNbTriangles() == 0)
+        msg_warning() << "No triangle topology, the nodes form a single subdomain.";
+
+    m_triangleParts.clear();
+}
+
+template<class DataTypes>
+void SchurDomainDecompositionSolver<DataTypes>::resetSystem()
+{
+}
+
+template<class DataTypes>
+void SchurDomainDecompositionSolver<DataTypes>::setSystemMBKMatrix(const sofa::core::MechanicalParams* mparams)
+{
+    if (!m_state)
+        return;
+
+    shell::misc::assembleNodeMatrix(this->getContext(), m_state, mparams, m_matrix, true, true);
+
+    if (m_subdomains.empty() || (m_topology && m_triangleParts.size() != m_topology->getNbTriangles()))
+        computePartition();
+    classifyNodes();
+
+    std::atomic<unsigned int> nbFailures(0);
+    shell::misc::parallelForRange(d_parallel.getValue(), std::size_t(0), m_subdomains.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p=begin; p<end; p++)
+            if (!factorizeSubdomain(m_subdomains[p]))
+                nbFailures++;
+    });
+    buildInterfaceMatrix();
+
+    m_factorized = (nbFailures == 0);
+    if (!m_factorized)
+        msg_error() << "Zero pivot in the factorisation of " << nbFailures << " subdomains.";
+
+    d_interfaceSize.setValue((unsigned int)m_interface.size());
+}
+
+template<class DataTypes>
+void SchurDomainDecompositionSolver<DataTypes>::computePartition()
+{
+    const unsigned int nbParts = std::max(1u, d_nbPartitions.getValue());
+
+    if (m_topology)
+        m_triangleParts = shell::misc::partitionTriangles(m_topology->getTriangles(), nbParts);
+    else
+        m_triangleParts.clear();
+
+    m_subdomains.clear();
+    m_subdomains.resize(nbParts);
+}
+
+template<class DataTypes>
+void SchurDomainDecompositionSolver<DataTypes>::classifyNodes()
+{
+    const std::size_t n = m_matrix.nbBlockRows();
+    const unsigned int interfacePart = (unsigned int)m_subdomains.size();
+    const unsigned int unset = interfacePart+1;
+
+    // Nodes of triangles of different parts are on the interface, nodes
+    // without triangles go to the first subdomain
+    m_nodeParts.assign(n, unset);
+    if (m_topology)
+    {
+        const sofa::core::topology::BaseMeshTopology::SeqTriangles &triangles = m_topology->getTriangles();
+        for (std::size_t t=0; t<m_triangleParts.size(); t++)
+        {
+            for (const sofa::Index v : triangles[t])
+            {
+                if (v >= n)
+                    continue;
+                if (m_nodeParts[v] == unset)
+                    m_nodeParts[v] = m_triangleParts[t];
+                else if (m_nodeParts[v] != m_triangleParts[t])
+                    m_nodeParts[v] = interfacePart;
+            }
+        }
+    }
+    for (unsigned int &p : m_nodeParts)
+        if (p == unset)
+            p = 0;
+
+    // Other components may couple nodes of different subdomains
+    for (std::size_t i=0; i<n; i++)
+    {
+        if (m_nodeParts[i] == interfacePart)
+            continue;
+        for (Index k=m_matrix.rowBegin(i); k<m_matrix.rowBegin(i+1); k++)
+        {
+            const Index j = m_matrix.column(k);
+            if (m_nodeParts[j] != interfacePart && m_nodeParts[j] != m_nodeParts[i])
+                m_nodeParts[j] = interfacePart;
+        }
+    }
+
+    for (Subdomain &s : m_subdomains)
+    {
+        s.nodes.clear();
+        s.interface.clear();
+        s.couplings.clear();
+    }
+    m_interface.clear();
+    m_localIndex.resize(n);
+    for (std::size_t v=0; v<n; v++)
+    {
+        if (m_nodeParts[v] == interfacePart)
+        {
+            m_localIndex[v] = m_interface.size();
+            m_interface.push_back((sofa::Index)v);
+        }
+        else
+        {
+            Subdomain &s = m_subdomains[m_nodeParts[v]];
+            m_localIndex[v] = s.nodes.size();
+            s.nodes.push_back((sofa::Index)v);
+        }
+    }
+}
+
+template<class DataTypes>
+bool SchurDomainDecompositionSolver<DataTypes>::factorizeSubdomain(Subdomain &s)
+{
+    const std::size_t ns = s.nodes.size();
+    if (ns == 0)
+    {
+        s.lu.resize(0, 0);
+        return true;
+    }
+    const unsigned int part = m_nodeParts[s.nodes[0]];
+
+    // Reorder the interior nodes to reduce the bandwidth
+    sofa::type::vector<sofa::Index> offsets(ns+1, 0), neighbours;
+    for (std::size_t a=0; a<ns; a++)
+    {
+        const sofa::Index v = s.nodes[a];
+        for (Index k=m_matrix.rowBegin(v); k<m_matrix.rowBegin(v+1); k++)
+        {
+            const Index j = m_matrix.column(k);
+            if ((sofa::Index)j != v && m_nodeParts[j] == part)
+                neighbours.push_back((sofa::Index)m_localIndex[j]);
+        }
+        offsets[a+1] = (sofa::Index)neighbours.size();
+    }
+
+    const sofa::type::vector<sofa::Index> order =
+        shell::misc::reverseCuthillMcKee((sofa::Index)ns, offsets, neighbours);
+    sofa::type::vector<sofa::Index> nodes(ns);
+    for (std::size_t r=0; r<ns; r++)
+        nodes[r] = s.nodes[order[r]];
+    s.nodes.swap(nodes);
+    for (std::size_t r=0; r<ns; r++)
+        m_localIndex[s.nodes[r]] = r;
+
+    std::size_t bandwidth = 0;
+    for (std::size_t r=0; r<ns; r++)
+    {
+        const sofa::Index v = s.nodes[r];
+        for (Index k=m_matrix.rowBegin(v); k<m_matrix.rowBegin(v+1); k++)
+        {
+            const Index j = m_matrix.column(k);
+            if (m_nodeParts[j] == part)
+            {
+                const std::size_t c = m_localIndex[j];
+                bandwidth = std::max(bandwidth, c > r ? c-r : r-c);
+            }
+        }
+    }
+
+    // Interior matrix and couplings with the interface
+    s.lu.resize(NbDofs*ns, NbDofs*(bandwidth+1)-1);
+    std::map<std::size_t, std::size_t> interfaceIndex;
+    for (std::size_t r=0; r<ns; r++)
+    {
+        const sofa::Index v = s.nodes[r];
+        for (Index k=m_matrix.rowBegin(v); k<m_matrix.rowBegin(v+1); k++)
+        {
+            const Index j = m_matrix.column(k);
+            const Block &B = m_matrix.block(k);
+            if (m_nodeParts[j] == part)
+            {
+                const std::size_t c = m_localIndex[j];
+                for (sofa::Size a=0; a<NbDofs; a++)
+                    for (sofa::Size b=0; b<NbDofs; b++)
+                        if (B[a][b] != 0)
+                            s.lu.add(NbDofs*r+a, NbDofs*c+b, B[a][b]);
+                continue;
+            }
+
+            auto it = interfaceIndex.find(m_localIndex[j]);
+            if (it == interfaceIndex.end())
+            {
+                it = interfaceIndex.emplace(m_localIndex[j], s.interface.size()).first;
+                s.interface.push_back(m_localIndex[j]);
+            }
+
+            Coupling coupling;
+            coupling.interior = r;
+            coupling.interface = it->second;
+            coupling.toInterface = B;
+            if (const Block *Bt = m_matrix.findBlock(j, v))
+                coupling.fromInterface = *Bt;
+            s.couplings.push_back(coupling);
+        }
+    }
+
+    s.x.resize(NbDofs*ns);
+    s.y.resize(s.interface.size());
+    return s.lu.factorize();
+}
+
+template<class DataTypes>
+void SchurDomainDecompositionSolver<DataTypes>::buildInterfaceMatrix()
+{
+    const unsigned int interfacePart = (unsigned int)m_subdomains.size();
+    const std::size_t nG = m_interface.size();
+
+    m_interfaceMatrix.resizeBlocks(nG);
+    for (std::size_t a=0; a<nG; a++)
+    {
+        const sofa::Index v = m_interface[a];
+        for (Index k=m_matrix.rowBegin(v); k<m_matrix.rowBegin(v+1); k++)
+        {
+            const Index j = m_matrix.column(k);
+            if (m_nodeParts[j] == interfacePart)
+                m_interfaceMatrix.addBlock((Index)a, (Index)m_localIndex[j], m_matrix.block(k));
+        }
+    }
+    m_interfaceMatrix.compress();
+
+    m_interfacePreconditioner.resize(nG);
+    for (std::size_t a=0; a<nG; a++)
+        m_interfacePreconditioner[a] = m_interfaceMatrix.diagonalBlock(a);
+    m_interfacePreconditioner.invert(d_parallel.getValue());
+}
+
+template<class DataTypes>
+void SchurDomainDecompositionSolver<DataTypes>::solveInterior(Subdomain &s, const VecDeriv &b, const VecVecN *xG)
+{
+    for (std::size_t r=0; r<s.nodes.size(); r++)
+        for (sofa::Size a=0; a<NbDofs; a++)
+            s.x[NbDofs*r+a] = b[s.nodes[r]][a];
+
+    if (xG)
+    {
+        for (const Coupling &c : s.couplings)
+        {
+            const VecN f = c.toInterface * (*xG)[s.interface[c.interface]];
+            for (sofa::Size a=0; a<NbDofs; a++)
+                s.x[NbDofs*c.interior+a] -= f[a];
+        }
+    }
+
+    s.lu.solve(s.x);
+}
+
+template<class DataTypes>
+void SchurDomainDecompositionSolver<DataTypes>::applySchurComplement(const VecVecN &v, VecVecN &out)
+{
+    m_interfaceMatrix.mult(v, out, d_parallel.getValue());
+
+    // A_Gp A_pp^-1 A_pG v of each subdomain
+    shell::misc::parallelForRange(d_parallel.getValue(), std::size_t(0), m_subdomains.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p=begin; p<end; p++) {
+            Subdomain &s = m_subdomains[p];
+            if (s.interface.empty())
+                continue;
+
+            std::fill(s.x.begin(), s.x.end(), (Real)0);
+            for (const Coupling &c : s.couplings) {
+                const VecN f = c.toInterface * v[s.interface[c.interface]];
+                for (sofa::Size a=0; a<NbDofs; a++)
+                    s.x[NbDofs*c.interior+a] += f[a];
+            }
+            s.lu.solve(s.x);
+
+            std::fill(s.y.begin(), s.y.end(), VecN());
+            for (const Coupling &c : s.couplings) {
+                VecN xi;
+                for (sofa::Size a=0; a<NbDofs; a++)
+                    xi[a] = s.x[NbDofs*c.interior+a];
+                s.y[c.interface] += c.fromInterface * xi;
+            }
+        }
+    });
+
+    for (const Subdomain &s : m_subdomains)
+        for (std::size_t k=0; k<s.interface.size(); k++)
+            out[s.interface[k]] -= s.y[k];
+}
+
+template<class DataTypes>
+void SchurDomainDecompositionSolver<DataTypes>::setSystemRHVector(sofa::core::MultiVecDerivId v)
+{
+    m_rhs = v;
+}
+
+template<class DataTypes>
+void SchurDomainDecompositionSolver<DataTypes>::setSystemLHVector(sofa::core::MultiVecDerivId v)
+{
+    m_lhs = v;
+}
+
+template<class DataTypes>
+void SchurDomainDecompositionSolver<DataTypes>::solveSystem()
+{
+    if (!m_state)
+        return;
+
+    const VecDeriv& b = m_state->read(sofa::core::ConstVecDerivId(m_rhs.getId(m_state)))->getValue();
+    VecDeriv& x = *m_state->write(sofa::core::VecDerivId(m_lhs.getId(m_state)))->beginEdit();
+
+    const std::size_t n = m_matrix.nbBlockRows();
+    x.resize(b.size());
+    if (!m_factorized || b.size() != n)
+    {
+        // Return a null correction rather than the stale content of x
+        std::fill(x.begin(), x.end(), Deriv());
+        if (!m_warnedUnsolved)
+        {
+            msg_warning() << "No valid factorisation of the system, the solution is set to zero.";
+            m_warnedUnsolved = true;
+        }
+        m_state->write(sofa::core::VecDerivId(m_lhs.getId(m_state)))->endEdit();
+        return;
+    }
+
+    const bool parallel = d_parallel.getValue();
+    const std::size_t nG = m_interface.size();
+
+    // Right-hand side of the interface, g = b_G - sum_p A_Gp A_pp^-1 b_p
+    VecVecN g(nG);
+    for (std::size_t a=0; a<nG; a++)
+        for (sofa::Size k=0; k<NbDofs; k++)
+            g[a][k] = b[m_interface[a]][k];
+
+    shell::misc::parallelForRange(parallel, std::size_t(0), m_subdomains.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p=begin; p<end; p++) {
+            Subdomain &s = m_subdomains[p];
+            solveInterior(s, b, nullptr);
+
+            std::fill(s.y.begin(), s.y.end(), VecN());
+            for (const Coupling &c : s.couplings) {
+                VecN xi;
+                for (sofa::Size a=0; a<NbDofs; a++)
+                    xi[a] = s.x[NbDofs*c.interior+a];
+                s.y[c.interface] += c.fromInterface * xi;
+            }
+        }
+    });
+    for (const Subdomain &s : m_subdomains)
+        for (std::size_t k=0; k<s.interface.size(); k++)
+            g[s.interface[k]] -= s.y[k];
+
+    // Preconditioned conjugate gradient on S xG = g
+    VecVecN xG(nG), r = g, z(nG), p, Sp;
+    const auto dot = [](const VecVecN &u, const VecVecN &v) {
+        double sum = 0;
+        for (std::size_t a=0; a<u.size(); a++)
+            sum += u[a] * v[a];
+        return sum;
+    };
+
+    const double gNorm2 = dot(g, g);
+    const double tolerance2 = (double)d_tolerance.getValue()*d_tolerance.getValue();
+    unsigned int nbIterations = 0;
+    if (gNorm2 > 0)
+    {
+        for (std::size_t a=0; a<nG; a++)
+            z[a] = m_interfacePreconditioner[a] * r[a];
+        p = z;
+        double rz = dot(r, z);
+
+        while (nbIterations < d_maxIterations.getValue())
+        {
+            nbIterations++;
+            applySchurComplement(p, Sp);
+
+            const double pSp = dot(p, Sp);
+            if (pSp == 0)
+                break;
+
+            const Real alpha = (Real)(rz / pSp);
+            for (std::size_t a=0; a<nG; a++)
+            {
+                xG[a] += p[a] * alpha;
+                r[a] -= Sp[a] * alpha;
+            }
+            if (dot(r, r) <= tolerance2 * gNorm2)
+                break;
+
+            for (std::size_t a=0; a<nG; a++)
+                z[a] = m_interfacePreconditioner[a] * r[a];
+            const double rzNew = dot(r, z);
+            const Real beta = (Real)(rzNew / rz);
+            rz = rzNew;
+            for (std::size_t a=0; a<nG; a++)
+                p[a] = z[a] + p[a] * beta;
+        }
+    }
+    d_nbIterations.setValue(nbIterations);
+
+    // Interior unknowns, x_p = A_pp^-1 (b_p - A_pG xG)
+    shell::misc::parallelForRange(parallel, std::size_t(0), m_subdomains.size(), [&](std::size_t begin, std::size_t end) {
+        for (std::size_t p=begin; p<end; p++) {
+            Subdomain &s = m_subdomains[p];
+            solveInterior(s, b, &xG);
+            for (std::size_t r=0; r<s.nodes.size(); r++)
+                for (sofa::Size a=0; a<NbDofs; a++)
+                    x[s.nodes[r]][a] = s.x[NbDofs*r+a];
+        }
+    });
+    for (std::size_t a=0; a<nG; a++)
+        for (sofa::Size k=0; k<NbDofs; k++)
+            x[m_interface[a]][k] = xG[a][k];
+
+    m_state->write(sofa::core::VecDerivId(m_lhs.getId(m_state)))->endEdit();
+}
+
+} // namespace